@@ -0,0 +1,151 @@
+// 并发压力测试。每个线程在挂载点下拥有自己的目录，循环执行 create、readdir 和 unlink，统计不同线程数下的吞吐量，观察不同目录下的操作能否随核数扩展。
+// 用法：ConcurrencyStressTest <挂载点> [每轮秒数，默认 5]
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "defs.h"
+
+
+static std::atomic<bool> isRunning(false);
+
+
+// 单个线程的工作循环，返回完成的操作数，失败返回 -1。
+static long worker(const std::string &dirPath)
+{
+    std::string filePath = dirPath + "/f";
+    long ops = 0;
+
+
+    while (isRunning.load(std::memory_order_relaxed))
+    {
+        int fd = open(filePath.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+        if (-1 == fd)
+        {
+            perror("open");
+
+            return -1;
+        }
+        close(fd);
+
+        DIR *pDir = opendir(dirPath.c_str());
+        if (!pDir)
+        {
+            perror("opendir");
+
+            return -1;
+        }
+        while (readdir(pDir))
+            ;
+        closedir(pDir);
+
+        if (-1 == unlink(filePath.c_str()))
+        {
+            perror("unlink");
+
+            return -1;
+        }
+
+        ops += 3;
+    }
+
+
+    return ops;
+}
+
+// 以 threadNum 个线程运行 seconds 秒，返回每秒操作数，失败返回 -1。
+static double runRound(const std::string &mountPoint, unsigned threadNum, unsigned seconds)
+{
+    std::vector<std::string> dirPaths;
+    std::vector<std::thread> threads;
+    std::vector<long> results(threadNum, 0);
+    long totalOps = 0;
+
+
+    for (unsigned i = 0; i < threadNum; ++i)
+    {
+        dirPaths.push_back(mountPoint + "/stress" + std::to_string(i));
+
+        if (-1 == mkdir(dirPaths[i].c_str(), 0755))
+        {
+            perror("mkdir");
+
+            return -1;
+        }
+    }
+
+    isRunning = true;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < threadNum; ++i) threads.emplace_back([&, i]() { results[i] = worker(dirPaths[i]); });
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    isRunning = false;
+
+    for (auto &thread : threads) thread.join();
+
+    auto end = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < threadNum; ++i)
+    {
+        rmdir(dirPaths[i].c_str());
+
+        if (results[i] < 0) return -1;
+
+        totalOps += results[i];
+    }
+
+
+    return totalOps / std::chrono::duration<double>(end - start).count();
+}
+
+
+int main(int argc, char const *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <mount point> [seconds per round]" << std::endl;
+
+
+        return EXIT_FAILURE;
+    }
+
+    std::string mountPoint = argv[1];
+    unsigned seconds = (argc > 2) ? std::stoul(argv[2]) : 5;
+
+    // 每个线程占用一个目录和一个文件，共 2 个 inode，根目录占 1 个。
+    unsigned maxThreadNum = std::min<unsigned>(std::max(1u, std::thread::hardware_concurrency()), (NVMIX_MAX_INODE_NUM - 1) / 2);
+    std::vector<unsigned> threadNums;
+    double baseline = 0;
+
+    // 线程数按 1、2、4 …… 递增，最后一轮使用最大线程数。
+    for (unsigned threadNum = 1; threadNum < maxThreadNum; threadNum *= 2) threadNums.push_back(threadNum);
+    threadNums.push_back(maxThreadNum);
+
+    std::cout << "threads\tops/s\tspeedup" << std::endl;
+
+    for (unsigned threadNum : threadNums)
+    {
+        double opsPerSecond = runRound(mountPoint, threadNum, seconds);
+        if (opsPerSecond < 0) return EXIT_FAILURE;
+
+        if (1 == threadNum) baseline = opsPerSecond;
+
+        std::cout << threadNum << "\t" << (long)opsPerSecond << "\t" << opsPerSecond / baseline << std::endl;
+    }
+
+
+    return EXIT_SUCCESS;
+}
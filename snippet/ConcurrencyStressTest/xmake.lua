@@ -0,0 +1,4 @@
+target ("ConcurrencyStressTest")
+    set_kind ("binary")
+    add_files ("main.cpp")
+    add_syslinks ("pthread")
@@ -6,7 +6,7 @@
 int main()
 {
     // 测试 super_block 区会不会溢出。
-    std::cout << sizeof(struct NvmixSuperBlock) << std::endl;          // 24
+    std::cout << sizeof(struct NvmixSuperBlock) << std::endl;          // 40
     std::cout << (sizeof(struct NvmixSuperBlock) < 4096) << std::endl; // 1, true
 
     std::cout << std::endl;
@@ -19,8 +19,8 @@ int main()
     std::cout << std::endl;
 
     // 测试目录的数据块区会不会溢出。
-    std::cout << sizeof(struct NvmixDentry) << std::endl;                                // 24
-    std::cout << sizeof(struct NvmixDentry) * NVMIX_MAX_INODE_NUM << std::endl;          // 24 * 32 = 768
+    std::cout << sizeof(struct NvmixDentry) << std::endl;                                // 32
+    std::cout << sizeof(struct NvmixDentry) * NVMIX_MAX_INODE_NUM << std::endl;          // 32 * 32 = 1024
     std::cout << (sizeof(struct NvmixDentry) * NVMIX_MAX_INODE_NUM < 4096) << std::endl; // 1, true
 
 
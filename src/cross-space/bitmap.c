@@ -0,0 +1,41 @@
+/**
+ * @file bitmap.c
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief NVM 分配位图查找策略的源文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "bitmap.h"
+
+
+unsigned long nvmixBitmapFindZero(const unsigned long *pBitmap, unsigned long start, unsigned long end)
+{
+    unsigned long word = 0;
+    unsigned long index = 0;
+
+
+    while (start < end)
+    {
+        // 取反后把 start 之前的位屏蔽掉，剩下的最低位就是第一个为 0 的位。
+        word = ~pBitmap[start / NVMIX_BITS_PER_LONG] & (~0UL << (start % NVMIX_BITS_PER_LONG));
+        if (0 != word)
+        {
+            index = (start / NVMIX_BITS_PER_LONG) * NVMIX_BITS_PER_LONG + __builtin_ctzl(word);
+
+
+            return index < end ? index : end;
+        }
+
+        start = (start / NVMIX_BITS_PER_LONG + 1) * NVMIX_BITS_PER_LONG;
+    }
+
+
+    return end;
+}
+
+unsigned int nvmixAllocGroupProbe(unsigned long hint, unsigned int round)
+{
+    return (hint + round) % NVMIX_ALLOC_GROUP_NUM;
+}
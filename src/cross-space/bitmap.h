@@ -0,0 +1,56 @@
+/**
+ * @file bitmap.h
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief NVM 分配位图查找策略的头文件。
+ * @details 这里只包含查找空闲位和选择分配组的策略，不修改位图。各组的位可能位于同一个 unsigned long 中，占用和释放必须是原子操作，由调用者用各自环境的原子操作完成（内核的 set_bit()，用户层引擎的 __atomic 内置函数）。同 defs.h 一样不能包含内核或 glibc 的头文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#ifndef _NVMIX_BITMAP_H_
+#define _NVMIX_BITMAP_H_
+
+#include "globalmacros.h"
+
+#include "defs.h"
+
+
+NVMIX_EXTERN_C_BEGIN
+
+
+/**
+ * @brief 每个位图划分的分配组数量。
+ * @details 位图的位数必须是它的整数倍。取与 inode 组相同的数量，m_imap 的分配组就是 inode 组。
+ */
+#define NVMIX_ALLOC_GROUP_NUM NVMIX_INODE_GROUP_NUM
+
+/**
+ * @brief unsigned long 的位数。
+ */
+#define NVMIX_BITS_PER_LONG (8 * sizeof(unsigned long))
+
+
+/**
+ * @brief 在位图的 [start, end) 区间中查找第一个为 0 的位。
+ * @param pBitmap 位图。
+ * @param start 起始位。
+ * @param end 结束位，不含。
+ * @return 找到返回位的下标，否则返回 end。语义与内核的 find_next_zero_bit() 相同。
+ */
+unsigned long nvmixBitmapFindZero(const unsigned long *pBitmap, unsigned long start, unsigned long end);
+
+/**
+ * @brief 计算第 round 次尝试的分配组。
+ * @param hint 分配提示，通常是父目录的 inode 号。
+ * @param round 尝试的次数，从 0 开始，小于 NVMIX_ALLOC_GROUP_NUM。
+ * @return 分配组的编号。
+ * @details 从 hint 对应的组开始，该组满了再依次尝试后面的组。
+ */
+unsigned int nvmixAllocGroupProbe(unsigned long hint, unsigned int round);
+
+
+NVMIX_EXTERN_C_END
+
+
+#endif
@@ -30,9 +30,31 @@ NVMIX_EXTERN_C_BEGIN
 
 /**
  * @brief 数据块的大小单位，4 KIB。
+ * @details NVM 布局始终以本值为单位。SSD 数据块的大小在格式化时确定，记录在 NvmixSuperBlock 的 m_blockSizeBits 中，本值是默认值和最大值。
  */
 #define NVMIX_BLOCK_SIZE 4096
 
+/**
+ * @brief NVMIX_BLOCK_SIZE 以 2 为底的对数。
+ */
+#define NVMIX_BLOCK_SIZE_BITS 12
+
+/**
+ * @brief SSD 数据块大小以 2 为底的对数的最小值，即 1 KiB。
+ * @details 目录的数据块存储 NVMIX_MAX_ENTRY_NUM 个 NvmixDentry，共 768 字节，数据块不能更小。
+ */
+#define NVMIX_MIN_BLOCK_SIZE_BITS 10
+
+/**
+ * @brief 簇大小以 2 为底的对数的最大值，即 1 MiB。
+ */
+#define NVMIX_MAX_CLUSTER_SIZE_BITS 20
+
+/**
+ * @brief CPU 缓存行的大小，也是 NVM 持久化（clflush）的粒度。
+ */
+#define NVMIX_CACHE_LINE_SIZE 64
+
 /**
  * @brief 超级块区在 NVM 空间上的偏移量。
  */
@@ -43,6 +65,27 @@ NVMIX_EXTERN_C_BEGIN
  */
 #define NVMIX_INODE_BLOCK_OFFSET 1 * NVMIX_BLOCK_SIZE
 
+/**
+ * @brief 日志区在 NVM 空间上的偏移量。
+ */
+#define NVMIX_JOURNAL_BLOCK_OFFSET 2 * NVMIX_BLOCK_SIZE
+
+/**
+ * @brief inline 区在 NVM 空间上的偏移量。
+ */
+#define NVMIX_INLINE_BLOCK_OFFSET 3 * NVMIX_BLOCK_SIZE
+
+/**
+ * @brief 扩展属性 inline 区在 NVM 空间上的偏移量。
+ * @details 共 NVMIX_MAX_INODE_NUM * NVMIX_XATTR_INLINE_SIZE = 8 KiB，占两个块。
+ */
+#define NVMIX_XATTR_INLINE_BLOCK_OFFSET 4 * NVMIX_BLOCK_SIZE
+
+/**
+ * @brief 扩展属性块池在 NVM 空间上的偏移量。
+ */
+#define NVMIX_XATTR_POOL_BLOCK_OFFSET 6 * NVMIX_BLOCK_SIZE
+
 /**
  * @brief 起始数据块的逻辑块号。
  */
@@ -54,6 +97,111 @@ NVMIX_EXTERN_C_BEGIN
  */
 #define NVMIX_MAX_INODE_NUM 32
 
+/**
+ * @brief inode 组的数量。
+ * @details inode 号按顺序等分为若干组，数据块号与 inode 号一一对应，因此每组也对应一段连续的数据块。组是延迟初始化的单位，见 NvmixSuperBlock 的 m_initGroups。
+ */
+#define NVMIX_INODE_GROUP_NUM 4
+
+/**
+ * @brief 每个 inode 组中 inode 的数量。
+ */
+#define NVMIX_INODE_GROUP_SIZE (NVMIX_MAX_INODE_NUM / NVMIX_INODE_GROUP_NUM)
+
+/**
+ * @brief 计算 inode 所在的 inode 组。
+ * @param ino inode 号。
+ */
+#define NVMIX_INODE_GROUP(ino) ((ino) / NVMIX_INODE_GROUP_SIZE)
+
+/**
+ * @brief 计算 inode 对应的数据块的逻辑块号。
+ * @param ino inode 号。
+ * @details 每个 inode 只有一个簇，簇号与 inode 号一一对应，分配 inode 即分配了簇。这是本文件系统唯一的块映射。簇只有一个数据块时（默认），簇号就是数据块号，否则用 NVMIX_DATA_BLOCK_NR 换算。
+ */
+#define NVMIX_DATA_BLOCK_INDEX(ino) (NVMIX_FIRST_DATA_BLOCK_INDEX + (ino))
+
+/**
+ * @brief 取超级块记录的 SSD 数据块大小以 2 为底的对数。
+ * @param pNsb NvmixSuperBlock 结构指针。
+ * @details 旧版本格式化的镜像该字段为 0，即默认的 NVMIX_BLOCK_SIZE。
+ */
+#define NVMIX_SB_BLOCK_SIZE_BITS(pNsb) ((pNsb)->m_blockSizeBits ? (pNsb)->m_blockSizeBits : NVMIX_BLOCK_SIZE_BITS)
+
+/**
+ * @brief 将簇号换算为簇的第一个数据块的块号，块号以超级块记录的数据块大小为单位。
+ * @param pNsb NvmixSuperBlock 结构指针。
+ * @param index 簇号，即 NvmixInode 的 m_dataBlockIndex。
+ */
+#define NVMIX_DATA_BLOCK_NR(pNsb, index) ((unsigned long)(index) << (pNsb)->m_clusterBits)
+
+/**
+ * @brief 子簇位图的位数。
+ * @details 普通文件用 inline 区的槽位记录簇内哪些数据块已经写过，因此一个簇最多包含这么多个数据块。
+ */
+#define NVMIX_CLUSTER_BITMAP_BITS (8 * NVMIX_INLINE_DATA_SIZE)
+
+/**
+ * @brief 判断数据块大小和簇大小的组合是否有效。
+ * @param blockSizeBits 数据块大小以 2 为底的对数。
+ * @param clusterBits 每个簇包含的数据块数量以 2 为底的对数。
+ */
+#define NVMIX_IS_VALID_GEOMETRY(blockSizeBits, clusterBits)                                            \
+    (((blockSizeBits) >= NVMIX_MIN_BLOCK_SIZE_BITS) && ((blockSizeBits) <= NVMIX_BLOCK_SIZE_BITS) &&   \
+     ((blockSizeBits) + (clusterBits) <= NVMIX_MAX_CLUSTER_SIZE_BITS) && ((1UL << (clusterBits)) <= NVMIX_CLUSTER_BITMAP_BITS))
+
+/**
+ * @brief 兼容特性：不认识该特性的实现仍然可以读写镜像。
+ * @details 特性位图记录在 NvmixSuperBlock 中，三类特性与 ext4 含义相同。目前没有兼容特性。
+ */
+#define NVMIX_FEATURE_COMPAT_SUPP 0
+
+/**
+ * @brief 只读兼容特性：不认识该特性的实现只能以只读方式挂载镜像。
+ * @details 挂载状态：正常卸载时把分配器的空闲计数保存在超级块中并标记为干净，下次挂载直接使用，不再扫描位图。不认识该特性的实现写入镜像以后不会清除干净标记，因此是只读兼容特性。
+ */
+#define NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE 0x1
+
+/**
+ * @brief 当前版本支持的只读兼容特性。
+ */
+#define NVMIX_FEATURE_RO_COMPAT_SUPP (NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE)
+
+/**
+ * @brief NvmixSuperBlock 的 m_state：文件系统已正常卸载，超级块上的空闲计数与位图一致。
+ * @details 挂载以后、第一次修改位图之前清除，崩溃留下的镜像总是不干净的。
+ */
+#define NVMIX_STATE_CLEAN 0x1
+
+/**
+ * @brief 不兼容特性：簇大小或者数据块大小不是默认值，不支持的实现会读错 SSD 上数据块的位置。
+ */
+#define NVMIX_FEATURE_INCOMPAT_CLUSTER 0x1
+
+/**
+ * @brief 不兼容特性：tune.nvmixfs 正在原地升级镜像，中途崩溃的镜像只能由 tune.nvmixfs 继续升级，任何实现都不能挂载或者检查。
+ */
+#define NVMIX_FEATURE_INCOMPAT_UPGRADE 0x2
+
+/**
+ * @brief 不兼容特性：普通文件有未写入的区段，见 NvmixInode 的 m_unwritten。
+ * @details 第一次 fallocate 预分配时在线启用。未写入区段中的数据块在子簇位图中已经置位，不认识该特性的实现会把簇中残留的旧数据当作文件内容读出。
+ */
+#define NVMIX_FEATURE_INCOMPAT_UNWRITTEN 0x4
+
+/**
+ * @brief 当前版本支持的不兼容特性。
+ */
+#define NVMIX_FEATURE_INCOMPAT_SUPP (NVMIX_FEATURE_INCOMPAT_CLUSTER | NVMIX_FEATURE_INCOMPAT_UNWRITTEN)
+
+/**
+ * @brief 判断超级块是否启用了 mask 中的任意一个特性。
+ * @param pNsb NvmixSuperBlock 结构指针。
+ * @param type 特性的类别，Compat、RoCompat 或者 Incompat。
+ * @param mask 特性的掩码。
+ */
+#define NVMIX_HAS_FEATURE(pNsb, type, mask) (0 != ((pNsb)->m_feature##type & (mask)))
+
 /**
  * @brief 目录下最多包含的目录项数量。
  * @details 注意，此项与 NVMIX_MAX_INODE_NUM 并不是一个东西。NVMIX_MAX_INODE_NUM 是文件系统总 inode 的数量，NVMIX_MAX_ENTRY_NUM 是一个目录下最多包含的目录项数量。从定义可知，NVMIX_MAX_ENTRY_NUM 应小于等于 NVMIX_MAX_INODE_NUM。
@@ -66,9 +214,64 @@ NVMIX_EXTERN_C_BEGIN
 #define NVMIX_MAX_NAME_LENGTH 16
 
 
+/**
+ * @brief 每个 inode 在 inline 区上占据的字节数。
+ * @details inline 区按 inode 号划分为 NVMIX_MAX_INODE_NUM 个槽位，共 32 * 128 = 4096 字节，正好一个块。长度小于本值的符号链接目标（含结尾的 '\0'）直接存储在这里，即快速符号链接，解析路径时只需要读 NVM，不需要读 SSD。设备文件在这里存储设备号。普通文件在这里存储子簇位图，见 NVMIX_CLUSTER_BITMAP_BITS。
+ */
+#define NVMIX_INLINE_DATA_SIZE 128
+
+/**
+ * @brief 每个 inode 在扩展属性 inline 区上占据的字节数。
+ * @details 开头是 NvmixXattrHeader，其余空间存放 NvmixXattrEntry。所有扩展属性的总大小不超过 inline 容量时直接存储在这里，否则整体迁移到扩展属性块池中的一个块上。
+ */
+#define NVMIX_XATTR_INLINE_SIZE 256
+
+/**
+ * @brief 扩展属性块池中块的数量。
+ * @details 块池的分配状态由 NvmixSuperBlock 的 m_xmap 位图管理。
+ */
+#define NVMIX_MAX_XATTR_BLOCK_NUM 32
+
+/**
+ * @brief 文件系统布局在 NVM 空间上占用的总字节数，扩展属性块池是最后一个区。
+ * @details NVM 空间不能小于该值。
+ */
+#define NVMIX_NVM_LAYOUT_SIZE (NVMIX_XATTR_POOL_BLOCK_OFFSET + NVMIX_MAX_XATTR_BLOCK_NUM * NVMIX_BLOCK_SIZE)
+
+/**
+ * @brief 扩展属性名字前缀的编号。
+ * @details NVM 上只存储前缀编号和去掉前缀以后的名字，节省空间。
+ */
+#define NVMIX_XATTR_INDEX_USER 1
+
+#define NVMIX_XATTR_INDEX_TRUSTED 2
+
+#define NVMIX_XATTR_INDEX_SECURITY 3
+
+/**
+ * @brief 计算一条扩展属性条目占据的字节数。
+ * @param nameLength 去掉前缀后的名字长度。
+ * @param valueSize 值的长度。
+ * @details 条目头、名字和值依次存放，整体按 4 字节对齐，保证下一条条目头是对齐的。
+ */
+#define NVMIX_XATTR_ENTRY_SIZE(nameLength, valueSize) ((sizeof(struct NvmixXattrEntry) + (nameLength) + (valueSize) + 3) & ~((unsigned long)3))
+
+/**
+ * @brief 每个普通文件最多记录的未写入区段数量。
+ */
+#define NVMIX_MAX_UNWRITTEN_NUM 8
+
+/**
+ * @brief 一条日志记录最多包含的目录项更新数量。
+ * @details rename 最多同时修改两个目录项槽位：源目录中的槽位和目标目录中的槽位，RENAME_EXCHANGE 同理。
+ */
+#define NVMIX_JOURNAL_MAX_ENTRY_NUM 2
+
+
 /**
  * @struct NvmixVersion
  * @brief 描述文件系统的版本号。
+ * @details 超级块记录格式化时工具的版本号，用于协商磁盘格式：主版本号只在磁盘布局不兼容时增加，内核模块、fsck.nvmixfs 和用户层引擎拒绝主版本号与自己不同的镜像；次版本号和修订版本号不同时布局兼容，只给出提示。主版本号 1 的镜像使用 20 字节的 NvmixInode 和 32 字节的 NvmixDentry，可以用 tune.nvmixfs -U 原地升级。版本号之外，可选的磁盘格式扩展由 NvmixSuperBlock 的特性位图协商。
  */
 struct NvmixVersion
 {
@@ -108,16 +311,91 @@ struct NvmixSuperBlock
      */
     unsigned long m_imap;
 
+    /**
+     * @brief 管理扩展属性块池分配状态的位图信息。
+     * @details 低 NVMIX_MAX_XATTR_BLOCK_NUM 位的每一位代表扩展属性块池中一个块的分配信息。
+     */
+    unsigned long m_xmap;
+
+    /**
+     * @brief 记录各 inode 组是否已经初始化的位图信息。
+     * @details 低 NVMIX_INODE_GROUP_NUM 位的每一位代表一个组。组已初始化是指组内所有 inode 在 NVM 上的 inode 区、inline 区和扩展属性 inline 区的槽位，以及 SSD 上对应的数据块都已清零。mkfs 只初始化第 0 组，其余的组在第一次分配其中的 inode 时，或者由挂载后的后台线程初始化，因此格式化和首次挂载的耗时与设备大小无关。
+     */
+    unsigned long m_initGroups;
+
     /**
      * @brief 文件系统的版本号。
      */
     struct NvmixVersion m_version;
+
+    /**
+     * @brief SSD 数据块大小以 2 为底的对数，格式化时确定。
+     * @details 取值范围是 NVMIX_MIN_BLOCK_SIZE_BITS 到 NVMIX_BLOCK_SIZE_BITS，0 表示旧版本格式化的镜像，见 NVMIX_SB_BLOCK_SIZE_BITS。该字段和 m_clusterBits 正好占用 m_version 之后的填充字节。
+     */
+    unsigned char m_blockSizeBits;
+
+    /**
+     * @brief 每个簇包含的数据块数量以 2 为底的对数，格式化时确定。
+     * @details 簇是 SSD 空间的分配单位，每个 inode 独占一个簇，NvmixInode 的 m_dataBlockIndex 是簇号。目录只使用簇的第一个数据块；普通文件的数据可以占满整个簇，大簇（64 KiB 到 1 MiB）让大文件在 SSD 上连续存放。0 表示每个簇只有一个数据块。
+     */
+    unsigned char m_clusterBits;
+
+    /**
+     * @brief 兼容特性的位图，见 NVMIX_FEATURE_COMPAT_SUPP。
+     * @details 三个特性位图位于 2.1 版本新增的字段，2.0 版本的镜像这些字节是格式化时清零的保留空间，即没有启用任何特性。挂载时不认识的不兼容特性拒绝挂载，不认识的只读兼容特性只允许只读挂载，不认识的兼容特性忽略。
+     */
+    unsigned int m_featureCompat;
+
+    /**
+     * @brief 只读兼容特性的位图，见 NVMIX_FEATURE_RO_COMPAT_SUPP。
+     */
+    unsigned int m_featureRoCompat;
+
+    /**
+     * @brief 不兼容特性的位图，见 NVMIX_FEATURE_INCOMPAT_SUPP。
+     */
+    unsigned int m_featureIncompat;
+
+    /**
+     * @brief 挂载状态，NVMIX_STATE_CLEAN 或者 0。
+     * @details 只在启用 NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE 时有意义。以下的空闲计数只在干净时有效。
+     */
+    unsigned int m_state;
+
+    /**
+     * @brief 正常卸载时 m_imap 中空闲位的数量。
+     */
+    unsigned int m_freeInodeNum;
+
+    /**
+     * @brief 正常卸载时 m_xmap 中空闲位的数量。
+     */
+    unsigned int m_freeXattrBlockNum;
+};
+
+/**
+ * @struct NvmixUnwrittenExtent
+ * @brief 普通文件的一段未写入的数据块。
+ * @details fallocate 预分配的数据块在子簇位图中置位，同时记录为未写入，读到 0 而不读取 SSD。第一次写入时只需要从区段中去掉该块，不需要再修改子簇位图。
+ */
+struct NvmixUnwrittenExtent
+{
+    /**
+     * @brief 区段的第一个数据块在簇内的编号。
+     */
+    unsigned short m_start;
+
+    /**
+     * @brief 区段包含的数据块数量，0 表示空闲的槽位。
+     */
+    unsigned short m_length;
 };
 
 /**
  * @struct NvmixInode
  * @brief 文件系统 inode 的元数据信息。
  * @details 每个 inode 都有一个 NvmixInode 结构。NVM 空间上 inode 区存储的就是 NvmixInode[] 数组。
+ * @details 结构正好占一个缓存行，inode 区按页对齐，因此每个 inode 独占一个缓存行：持久化一个 inode 只刷写一行，也不会与相邻 inode 的并发更新落在同一行上。常用字段都在前 20 字节，之后是普通文件的未写入区段，其余空间保留。
  */
 struct NvmixInode
 {
@@ -128,6 +406,8 @@ struct NvmixInode
      * - S_IFMT：文件类型掩码（0170000）。
      * - S_IFREG：普通文件（0100000）。
      * - S_IFDIR：目录（0040000）。
+     * - S_IFLNK：符号链接（0120000）。
+     * - S_IFCHR、S_IFBLK、S_IFIFO、S_IFSOCK：特殊文件。
      * 权限部分：低 12 位，按 0ABC 八进制格式解析。
      * - A（用户）：0 ~ 2 位 == rwx （例: 07 == 111₂ == rwx）。
      * - B（组）：3 ~ 5 位 == rwx （例: 05 == 101₂ == r-x）。
@@ -147,6 +427,7 @@ struct NvmixInode
 
     /**
      * @brief 文件或目录的大小（以字节为单位）。
+     * @details 符号链接的大小是链接目标的长度（不含结尾的 '\0'）。
      */
     unsigned int m_size;
 
@@ -154,12 +435,29 @@ struct NvmixInode
      * @brief 文件或目录对应的数据块的逻辑块号。
      */
     unsigned short m_dataBlockIndex;
+
+    /**
+     * @brief 硬链接数。
+     * @details 普通文件可以有多个硬链接，目录为 2 加上子目录的个数。
+     */
+    unsigned short m_nlink;
+
+    /**
+     * @brief 普通文件的未写入区段，互不重叠，只在启用 NVMIX_FEATURE_INCOMPAT_UNWRITTEN 时有意义。
+     * @details 创建普通文件时清零。只由内核的 fallocate 和写入路径修改，nvmixWriteInode() 不覆盖。
+     */
+    struct NvmixUnwrittenExtent m_unwritten[NVMIX_MAX_UNWRITTEN_NUM];
+
+    /**
+     * @brief 保留，将结构补齐到 NVMIX_CACHE_LINE_SIZE，格式化时清零。
+     */
+    unsigned char m_reserved[12];
 };
 
 /**
  * @struct NvmixDentry
  * @brief 目录对应的数据块的各条目录项的信息。
- * @details 目录项指目录下的文件或子目录（包括 . 和 ..）。本结构类似 vfs 的 dentry 结构的作用，将 inode 和目录项的名字关联在一起。目录的数据块存储的就是 NvmixDentry[] 数组，记录该目录下所有目录项的信息。
+ * @details 目录项指目录下的文件或子目录。本结构类似 vfs 的 dentry 结构的作用，将 inode 和目录项的名字关联在一起。目录的数据块存储的就是 NvmixDentry[] 数组，记录该目录下所有目录项的信息。. 和 .. 不存储在数据块中，由 readdir 动态生成。
  */
 struct NvmixDentry
 {
@@ -170,8 +468,109 @@ struct NvmixDentry
 
     /**
      * @brief 目录项在 vfs 中全局唯一的 inode 号。
+     * @details inode 号小于 NVMIX_MAX_INODE_NUM，4 字节足够，整个目录项 24 字节。
+     */
+    unsigned int m_ino;
+
+    /**
+     * @brief 目录项对应文件的类型。
+     * @details 取值与 dirent 的 d_type 一致，即 DT_REG、DT_DIR 等宏（DT_UNKNOWN 为 0）。这些值是用户态 ABI 的一部分，内核和用户层程序可以共用。在目录项中记录文件类型后，readdir 可以直接把真实类型返回给用户，ls、find 等工具就不需要再对每个目录项调用 stat 来判断类型了。
+     */
+    unsigned char m_fileType;
+
+    /**
+     * @brief 保留，显式写出结构末尾的填充字节，清空目录项时一并清零。
+     */
+    unsigned char m_reserved[3];
+};
+
+/**
+ * @struct NvmixXattrHeader
+ * @brief 每个 inode 的扩展属性区的头部，位于扩展属性 inline 区中该 inode 槽位的开头。
+ * @details 整个结构 8 字节，更新时作为一次 8 字节写入提交。迁移到块池或者换块时，先完整写好新位置的条目，再一次性切换本结构，崩溃时看到的要么是旧的扩展属性，要么是新的。
+ */
+struct NvmixXattrHeader
+{
+    /**
+     * @brief 扩展属性所在的块池块号加 1。
+     * @details 0 表示扩展属性存储在 inline 区中紧跟本结构的位置。
+     */
+    unsigned int m_blockIndex;
+
+    /**
+     * @brief 所有扩展属性条目占据的总字节数。
+     */
+    unsigned int m_size;
+};
+
+/**
+ * @struct NvmixXattrEntry
+ * @brief 单条扩展属性的条目头。
+ * @details 条目头之后依次是 m_nameLength 字节的名字（不含 '\0'）和 m_valueSize 字节的值，大小见 NVMIX_XATTR_ENTRY_SIZE。
+ */
+struct NvmixXattrEntry
+{
+    /**
+     * @brief 名字前缀的编号，见 NVMIX_XATTR_INDEX_USER 等。
+     */
+    unsigned char m_nameIndex;
+
+    /**
+     * @brief 去掉前缀以后的名字长度。
+     */
+    unsigned char m_nameLength;
+
+    /**
+     * @brief 值的长度。
+     */
+    unsigned short m_valueSize;
+};
+
+/**
+ * @struct NvmixJournalEntry
+ * @brief 日志中单个目录项槽位的更新记录。
+ * @details 记录的是槽位更新后的完整内容（redo 日志），重放时直接覆盖写入，因此重放多少次结果都一样。
+ */
+struct NvmixJournalEntry
+{
+    /**
+     * @brief 目录项所在目录的数据块的逻辑块号。
+     */
+    unsigned short m_dataBlockIndex;
+
+    /**
+     * @brief 目录项在目录数据块 NvmixDentry[] 数组中的槽位下标。
+     */
+    unsigned short m_slot;
+
+    /**
+     * @brief 槽位更新后的目录项内容。
+     */
+    struct NvmixDentry m_dentry;
+};
+
+/**
+ * @struct NvmixJournal
+ * @brief NVM 空间上日志区的元数据信息。
+ * @details 目录项存储在 SSD 的目录数据块上，一次 rename 需要修改两个目录的数据块，无法通过一次 SSD 写入原子完成。因此先将所有修改写入 NVM 上的日志区并持久化，再通过一次 8 字节的 m_commit 写入提交，最后才修改 SSD 上的数据块。提交点之前崩溃，修改全部不生效；提交点之后崩溃，挂载时根据日志重放。
+ */
+struct NvmixJournal
+{
+    /**
+     * @brief 日志的提交标志。
+     * @details 非 0 表示日志已提交但尚未全部落盘到 SSD，挂载时需要重放；0 表示日志为空。对齐的 8 字节写入在 x86 上是原子的，因此作为唯一的提交点。
+     */
+    unsigned long m_commit;
+
+    /**
+     * @brief 日志中有效的更新记录数量。
+     */
+    unsigned int m_entryNum;
+
+    /**
+     * @brief 目录项槽位的更新记录。
      */
-    unsigned long m_ino;
+    struct NvmixJournalEntry m_entries[NVMIX_JOURNAL_MAX_ENTRY_NUM];
 };
 
 
@@ -0,0 +1,93 @@
+/**
+ * @file dentry.c
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 目录数据块中目录项操作的源文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "dentry.h"
+
+
+int nvmixDentryNameMatch(const struct NvmixDentry *pNd, const char *pName, unsigned int len)
+{
+    unsigned int i = 0;
+
+
+    if ((0 == len) || (len > NVMIX_MAX_NAME_LENGTH)) return 0;
+
+    for (i = 0; i < len; ++i)
+    {
+        if (pNd->m_name[i] != pName[i]) return 0;
+    }
+
+
+    // 名字更短时，后面必须是 '\0'。
+    return (NVMIX_MAX_NAME_LENGTH == len) || ('\0' == pNd->m_name[len]);
+}
+
+int nvmixDentryFind(const struct NvmixDentry *pDentries, const char *pName, unsigned int len)
+{
+    int i = 0;
+
+
+    for (i = 0; i < NVMIX_MAX_ENTRY_NUM; ++i)
+    {
+        if ((0 != pDentries[i].m_ino) && nvmixDentryNameMatch(pDentries + i, pName, len)) return i;
+    }
+
+
+    return -1;
+}
+
+int nvmixDentryFindFree(const struct NvmixDentry *pDentries)
+{
+    int i = 0;
+
+
+    for (i = 0; i < NVMIX_MAX_ENTRY_NUM; ++i)
+    {
+        if (0 == pDentries[i].m_ino) return i;
+    }
+
+
+    return -1;
+}
+
+int nvmixDentryIsEmpty(const struct NvmixDentry *pDentries)
+{
+    int i = 0;
+
+
+    for (i = 0; i < NVMIX_MAX_ENTRY_NUM; ++i)
+    {
+        if (0 != pDentries[i].m_ino) return 0;
+    }
+
+
+    return 1;
+}
+
+void nvmixDentryFill(struct NvmixDentry *pNd, const char *pName, unsigned int len, unsigned long ino, unsigned char fileType)
+{
+    unsigned int i = 0;
+
+
+    for (i = 0; i < NVMIX_MAX_NAME_LENGTH; ++i) pNd->m_name[i] = (i < len) ? pName[i] : '\0';
+
+    pNd->m_ino = ino;
+    pNd->m_fileType = fileType;
+
+    for (i = 0; i < sizeof(pNd->m_reserved); ++i) pNd->m_reserved[i] = 0;
+}
+
+void nvmixDentryClear(struct NvmixDentry *pNd)
+{
+    unsigned char *p = (unsigned char *)pNd;
+    unsigned long i = 0;
+
+
+    // 连同结构体的填充字节一起清零，与 memset() 相同。
+    for (i = 0; i < sizeof(struct NvmixDentry); ++i) p[i] = 0;
+}
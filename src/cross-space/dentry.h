@@ -0,0 +1,76 @@
+/**
+ * @file dentry.h
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 目录数据块中目录项操作的头文件。
+ * @details 目录数据块就是 NvmixDentry[NVMIX_MAX_ENTRY_NUM] 数组，这里的函数只操作这个数组，不关心它来自内核的 buffer_head 还是用户层读入的缓冲区，由内核模块和用户层引擎共用。同 defs.h 一样不能包含内核或 glibc 的头文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#ifndef _NVMIX_DENTRY_H_
+#define _NVMIX_DENTRY_H_
+
+#include "globalmacros.h"
+
+#include "defs.h"
+
+
+NVMIX_EXTERN_C_BEGIN
+
+
+/**
+ * @brief 判断目录项的名字是否与给定的名字相同。
+ * @param pNd 目录项指针。
+ * @param pName 名字，不要求以 '\0' 结尾。
+ * @param len 名字的长度。
+ * @return 相同返回 1，否则返回 0。
+ * @details 名字占满 NVMIX_MAX_NAME_LENGTH 时数组末尾没有 '\0'，因此按最多 NVMIX_MAX_NAME_LENGTH 个字节比较。
+ */
+int nvmixDentryNameMatch(const struct NvmixDentry *pNd, const char *pName, unsigned int len);
+
+/**
+ * @brief 在目录数据块中按名字查找目录项。
+ * @param pDentries 目录数据块的目录项数组。
+ * @param pName 名字。
+ * @param len 名字的长度。
+ * @return 找到返回槽位下标，否则返回 -1。
+ */
+int nvmixDentryFind(const struct NvmixDentry *pDentries, const char *pName, unsigned int len);
+
+/**
+ * @brief 在目录数据块中找到第一个空闲的槽位，即 inode 号为 0 的目录项。
+ * @param pDentries 目录数据块的目录项数组。
+ * @return 成功返回槽位下标，目录已满返回 -1。
+ */
+int nvmixDentryFindFree(const struct NvmixDentry *pDentries);
+
+/**
+ * @brief 判断目录数据块中是否没有任何目录项。
+ * @param pDentries 目录数据块的目录项数组。
+ * @return 为空返回 1，否则返回 0。
+ */
+int nvmixDentryIsEmpty(const struct NvmixDentry *pDentries);
+
+/**
+ * @brief 填充一个目录项。
+ * @param pNd 目录项指针。
+ * @param pName 名字，长度超过 NVMIX_MAX_NAME_LENGTH 的部分被截断，调用者应事先检查。
+ * @param len 名字的长度。
+ * @param ino inode 号。
+ * @param fileType 文件类型，即 DT_* 值。
+ * @details 名字不足 NVMIX_MAX_NAME_LENGTH 的部分补 '\0'，与 strncpy() 相同。
+ */
+void nvmixDentryFill(struct NvmixDentry *pNd, const char *pName, unsigned int len, unsigned long ino, unsigned char fileType);
+
+/**
+ * @brief 清空一个目录项，使其成为空闲槽位。
+ * @param pNd 目录项指针。
+ */
+void nvmixDentryClear(struct NvmixDentry *pNd);
+
+
+NVMIX_EXTERN_C_END
+
+
+#endif
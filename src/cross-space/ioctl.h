@@ -0,0 +1,67 @@
+/**
+ * @file ioctl.h
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 普通文件 ioctl 接口的头文件。
+ * @details 定义内核模块和用户层共用的 ioctl 命令号和参数结构。同 defs.h 一样不能包含内核或 glibc 的头文件，唯一的例外是 <linux/ioctl.h>，它属于内核导出给用户层的 uapi 头文件，两边都可以包含，_IOR 等宏由它定义。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#ifndef _NVMIX_IOCTL_H_
+#define _NVMIX_IOCTL_H_
+
+#include "globalmacros.h"
+
+#include <linux/ioctl.h>
+
+
+NVMIX_EXTERN_C_BEGIN
+
+
+/**
+ * @brief 本文件系统 ioctl 命令号的类型字段。
+ */
+#define NVMIX_IOC_MAGIC 'N'
+
+/**
+ * @brief 读取一个打开的文件的预读统计，参数为 struct NvmixReadaheadStats *。
+ * @details 统计属于 open() 返回的这个打开的文件，而不是 inode，dup() 和 fork() 得到的描述符共用同一份统计。
+ */
+#define NVMIX_IOC_GET_READAHEAD_STATS _IOR(NVMIX_IOC_MAGIC, 1, struct NvmixReadaheadStats)
+
+
+/**
+ * @struct NvmixReadaheadStats
+ * @brief 一个打开的文件的预读统计。
+ * @details 字段含义同 sysfs 中挂载点级别的 readahead_pages、readahead_hole_pages 和 readpage_pages，只统计经过这个打开的文件的读取。m_readpageNum 相对于 m_readaheadPageNum 越小，预读的命中率越高。所有字段都是 8 字节，32 位和 64 位的用户层布局相同。
+ */
+struct NvmixReadaheadStats
+{
+    /**
+     * @brief 预读读入的页数，包括间隔访问的提前预读。
+     */
+    unsigned long long m_readaheadPageNum;
+
+    /**
+     * @brief 预读的页中整页都是空洞、不需要读取 SSD 的页数。
+     */
+    unsigned long long m_readaheadHolePageNum;
+
+    /**
+     * @brief 预读没有覆盖、只能单独同步读取的页数。
+     */
+    unsigned long long m_readpageNum;
+
+    /**
+     * @brief 识别出固定间隔的访问以后，提前发起预读的页数。
+     * @details 已经在 page cache 中的页不会再次读取，因此可能大于这部分实际计入 m_readaheadPageNum 的页数。
+     */
+    unsigned long long m_strideReadaheadNum;
+};
+
+
+NVMIX_EXTERN_C_END
+
+
+#endif
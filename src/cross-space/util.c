@@ -10,10 +10,10 @@
 #include "util.h"
 
 
-unsigned long long nvmixCalcInodeBlocks(long long size)
+unsigned long long nvmixCalcInodeBlocks(long long size, unsigned int blockSize)
 {
     if (0 == size) return 0;
 
 
-    return NVMIX_DIV_ROUND_UP(size, NVMIX_BLOCK_SIZE) * (NVMIX_BLOCK_SIZE / 512);
+    return NVMIX_DIV_ROUND_UP(size, blockSize) * (blockSize / 512);
 }
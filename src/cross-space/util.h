@@ -32,6 +32,7 @@ NVMIX_EXTERN_C_BEGIN
 /**
  * @brief 根据文件大小计算占据 inode 中 i_blocks 的值。
  * @param size 文件大小。
+ * @param blockSize 数据块大小，即 1 << NVMIX_SB_BLOCK_SIZE_BITS(pNsb)。
  * @return 占用的磁盘块数（以 512 B 为单位）。
  * @details 通过 inode 对应文件的大小转化为 inode->i_blocks 的值，注意 inode->i_blocks 以 512 B 为单位。
  * typedef u64 blkcnt_t; typedef __u64 u64; typedef unsigned long long __u64;
@@ -39,7 +40,7 @@ NVMIX_EXTERN_C_BEGIN
  * blkcnt_t（返回值） == unsigned long long
  * loff_t（参数） == long long
  */
-unsigned long long nvmixCalcInodeBlocks(long long size);
+unsigned long long nvmixCalcInodeBlocks(long long size, unsigned int blockSize);
 
 
 NVMIX_EXTERN_C_END
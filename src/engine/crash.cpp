@@ -0,0 +1,248 @@
+/**
+ * @file crash.cpp
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 崩溃一致性测试记录器的源文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "crash.h"
+
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <set>
+#include <algorithm>
+#include <functional>
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "defs.h"
+
+
+int NvmixCrashRecorder::start(const char *pNvm, const std::string &ssdPath)
+{
+    struct stat st;
+    int fd = -1;
+    int res = 0;
+
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    fd = open(ssdPath.c_str(), O_RDONLY);
+    if ((-1 == fd) || (-1 == fstat(fd, &st)))
+    {
+        res = -errno;
+        goto ERR;
+    }
+
+    m_media.m_nvm.assign(pNvm, NVMIX_NVM_LAYOUT_SIZE);
+    m_media.m_ssd.resize(st.st_size);
+
+    if (st.st_size != pread(fd, &m_media.m_ssd[0], st.st_size, 0))
+    {
+        res = -EIO;
+        goto ERR;
+    }
+
+    m_points.clear();
+    m_isRecording = true;
+
+
+ERR:
+    if (-1 != fd) close(fd);
+
+
+    return res;
+}
+
+void NvmixCrashRecorder::stop(const char *pNvm)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (!m_isRecording) return;
+
+    addPoint(pNvm, "end");
+    m_isRecording = false;
+}
+
+void NvmixCrashRecorder::onPersist(const char *pNvm, unsigned long offset, unsigned long size)
+{
+    const unsigned long start = offset & ~(unsigned long)(NVMIX_CRASH_LINE_SIZE - 1);
+    const unsigned long end = std::min<unsigned long>(NVMIX_NVM_LAYOUT_SIZE, offset + size);
+    char name[64];
+
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (!m_isRecording || (0 == size)) return;
+
+    snprintf(name, sizeof(name), "persist nvm+0x%lx/%lu", offset, size);
+    addPoint(pNvm, name);
+
+    // 刷写以后，覆盖该范围的缓存行落到介质上。
+    memcpy(&m_media.m_nvm[start], pNvm + start, end - start);
+}
+
+void NvmixCrashRecorder::onWriteBlock(const char *pNvm, unsigned long blockIndex, const void *pBuf)
+{
+    const unsigned long offset = blockIndex * NVMIX_BLOCK_SIZE;
+    Point *pPoint = nullptr;
+
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (!m_isRecording || (offset + NVMIX_BLOCK_SIZE > m_media.m_ssd.size())) return;
+
+    pPoint = &addPoint(pNvm, "write block " + std::to_string(blockIndex));
+    pPoint->m_blockIndex = blockIndex;
+    pPoint->m_block.assign((const char *)pBuf, NVMIX_BLOCK_SIZE);
+
+    memcpy(&m_media.m_ssd[offset], pBuf, NVMIX_BLOCK_SIZE);
+}
+
+size_t NvmixCrashRecorder::pointNum() const
+{
+    return m_points.size();
+}
+
+std::string NvmixCrashRecorder::describe(const NvmixCrashState &state) const
+{
+    const Point &point = m_points[state.m_point];
+    std::string description = ("end" == point.m_name) ? "after all operations" : "before " + point.m_name;
+
+
+    if (!point.m_dirtyLines.empty())
+    {
+        description += ", " + std::to_string(state.m_lines.size()) + " of " + std::to_string(point.m_dirtyLines.size()) + " dirty lines";
+    }
+
+    if (0 != state.m_tornSectors) description += ", " + std::to_string(state.m_tornSectors) + " sectors written";
+
+
+    return description;
+}
+
+std::vector<NvmixCrashState> NvmixCrashRecorder::enumerate(unsigned maxExhaustive, bool isTorn) const
+{
+    const unsigned sectorNum = NVMIX_BLOCK_SIZE / NVMIX_CRASH_SECTOR_SIZE;
+    std::vector<NvmixCrashState> states;
+    std::set<std::pair<size_t, size_t>> seen;
+    NvmixCrashImage image;
+    std::hash<std::string> hasher;
+
+
+    // 只保留内容不同的状态，例如没有脏缓存行的相邻持久化点往往产生相同的状态。
+    auto add = [&](const NvmixCrashState &state) {
+        materialize(state, &image);
+
+        if (seen.insert({hasher(image.m_nvm), hasher(image.m_ssd)}).second) states.push_back(state);
+    };
+
+    for (size_t p = 0; p < m_points.size(); ++p)
+    {
+        const size_t dirtyNum = m_points[p].m_dirtyLines.size();
+        NvmixCrashState state;
+
+
+        state.m_point = p;
+
+        if (dirtyNum <= maxExhaustive)
+        {
+            for (unsigned long mask = 0; mask < (1UL << dirtyNum); ++mask)
+            {
+                state.m_lines.clear();
+                for (size_t i = 0; i < dirtyNum; ++i)
+                {
+                    if (mask & (1UL << i)) state.m_lines.push_back(i);
+                }
+
+                add(state);
+            }
+        }
+        else
+        {
+            add(state);
+
+            for (size_t skip = 0; skip <= dirtyNum; ++skip)
+            {
+                // skip == dirtyNum 时是全集。
+                state.m_lines.clear();
+                for (size_t i = 0; i < dirtyNum; ++i)
+                {
+                    if (i != skip) state.m_lines.push_back(i);
+                }
+                add(state);
+
+                if (skip < dirtyNum)
+                {
+                    state.m_lines.assign(1, skip);
+                    add(state);
+                }
+            }
+        }
+
+        if (isTorn && (m_points[p].m_blockIndex >= 0))
+        {
+            state.m_lines.clear();
+
+            for (unsigned sector = 1; sector < sectorNum; ++sector)
+            {
+                state.m_tornSectors = sector;
+                add(state);
+            }
+        }
+    }
+
+
+    return states;
+}
+
+void NvmixCrashRecorder::materialize(const NvmixCrashState &state, NvmixCrashImage *pImage) const
+{
+    const Point &point = m_points[state.m_point];
+
+
+    *pImage = point.m_media;
+
+    for (size_t i : state.m_lines)
+    {
+        const std::pair<size_t, std::string> &line = point.m_dirtyLines[i];
+
+
+        pImage->m_nvm.replace(line.first * NVMIX_CRASH_LINE_SIZE, line.second.size(), line.second);
+    }
+
+    if (0 != state.m_tornSectors)
+    {
+        pImage->m_ssd.replace(point.m_blockIndex * NVMIX_BLOCK_SIZE, state.m_tornSectors * NVMIX_CRASH_SECTOR_SIZE, point.m_block, 0, state.m_tornSectors * NVMIX_CRASH_SECTOR_SIZE);
+    }
+}
+
+NvmixCrashRecorder::Point &NvmixCrashRecorder::addPoint(const char *pNvm, const std::string &name)
+{
+    Point point;
+
+
+    point.m_name = name;
+    point.m_media = m_media;
+
+    for (size_t line = 0; line < NVMIX_NVM_LAYOUT_SIZE / NVMIX_CRASH_LINE_SIZE; ++line)
+    {
+        const size_t offset = line * NVMIX_CRASH_LINE_SIZE;
+
+
+        if (0 != memcmp(pNvm + offset, m_media.m_nvm.data() + offset, NVMIX_CRASH_LINE_SIZE))
+        {
+            point.m_dirtyLines.emplace_back(line, std::string(pNvm + offset, NVMIX_CRASH_LINE_SIZE));
+        }
+    }
+
+    m_points.push_back(std::move(point));
+
+
+    return m_points.back();
+}
@@ -0,0 +1,173 @@
+/**
+ * @file crash.h
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 崩溃一致性测试的记录器。
+ * @details 记录器作为 NvmixPersistObserver 挂在引擎上，记录每一个持久化点：NVM 的每次刷写和 SSD 的每次块写入。在每个持久化点上，NVM 映射中与介质内容不同的缓存行是已经执行但尚未刷写的存储，真实的掉电可能让其中任意一部分被缓存逐出而落到介质上。SSD 的块写入是同步的，但可能按扇区撕裂。据此枚举掉电可能留下的所有介质状态，交给 fsck.nvmixfs 和引擎检查，见 nvmix-crash。
+ * @details 存储以缓存行为单位建模：同一缓存行内的多次存储只记录持久化点上的最终内容。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#ifndef _NVMIX_CRASH_H_
+#define _NVMIX_CRASH_H_
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "engine.h"
+
+
+/**
+ * @brief NVM 持久化的粒度，即缓存行的大小。
+ */
+#define NVMIX_CRASH_LINE_SIZE 64
+
+/**
+ * @brief SSD 写入撕裂的粒度，即扇区的大小。
+ */
+#define NVMIX_CRASH_SECTOR_SIZE 512
+
+
+/**
+ * @struct NvmixCrashImage
+ * @brief 一份完整的介质内容。
+ */
+struct NvmixCrashImage
+{
+    /**
+     * @brief NVM 的内容，大小为 NVMIX_NVM_LAYOUT_SIZE。
+     */
+    std::string m_nvm;
+
+    /**
+     * @brief SSD 的内容。
+     */
+    std::string m_ssd;
+};
+
+/**
+ * @struct NvmixCrashState
+ * @brief 一个崩溃状态的描述，由 NvmixCrashRecorder::materialize() 生成对应的介质内容。
+ */
+struct NvmixCrashState
+{
+    /**
+     * @brief 崩溃发生在第 m_point 个持久化点之前，等于持久化点的数量时表示所有操作之后。
+     */
+    size_t m_point = 0;
+
+    /**
+     * @brief 额外落到介质上的未刷写缓存行，是该持久化点上脏缓存行的下标。
+     */
+    std::vector<size_t> m_lines;
+
+    /**
+     * @brief 该持久化点的块写入已经写入的扇区数，0 表示没有写入。
+     */
+    unsigned m_tornSectors = 0;
+};
+
+
+/**
+ * @class NvmixCrashRecorder
+ * @brief 记录持久化点并枚举崩溃状态。
+ */
+class NvmixCrashRecorder : public NvmixPersistObserver
+{
+public:
+    /**
+     * @brief 开始记录，当前的 NVM 映射和 SSD 文件的内容视为已经全部持久化的初始状态。
+     * @param pNvm NVM 映射的起始地址，见 NvmixEngine::nvmAddr()。
+     * @param ssdPath 模拟 SSD 的文件路径。
+     * @return 成功返回 0，失败返回负的 errno。
+     */
+    int start(const char *pNvm, const std::string &ssdPath);
+
+    /**
+     * @brief 结束记录，添加所有操作之后的最后一个崩溃点。
+     * @param pNvm NVM 映射的起始地址。
+     */
+    void stop(const char *pNvm);
+
+    void onPersist(const char *pNvm, unsigned long offset, unsigned long size) override;
+
+    void onWriteBlock(const char *pNvm, unsigned long blockIndex, const void *pBuf) override;
+
+    /**
+     * @brief 返回崩溃点的数量，即持久化点的数量加 1。
+     */
+    size_t pointNum() const;
+
+    /**
+     * @brief 描述一个崩溃状态，例如 "before persist nvm+0x1040/16, 2 of 3 dirty lines"。
+     */
+    std::string describe(const NvmixCrashState &state) const;
+
+    /**
+     * @brief 枚举所有不同的崩溃状态。
+     * @param maxExhaustive 脏缓存行不超过该数量时枚举所有子集，否则只枚举空集、全集、每个单独的缓存行和每个缺少一个缓存行的子集。
+     * @param isTorn 是否枚举按扇区撕裂的块写入，写入按扇区顺序进行，撕裂的是前若干个扇区。
+     * @return 内容互不相同的崩溃状态。
+     */
+    std::vector<NvmixCrashState> enumerate(unsigned maxExhaustive, bool isTorn) const;
+
+    /**
+     * @brief 生成崩溃状态对应的介质内容。
+     */
+    void materialize(const NvmixCrashState &state, NvmixCrashImage *pImage) const;
+
+private:
+    /**
+     * @struct Point
+     * @brief 一个持久化点。
+     */
+    struct Point
+    {
+        /**
+         * @brief 描述，例如 "persist nvm+0x1040/16" 或者 "write block 3"。
+         */
+        std::string m_name;
+
+        /**
+         * @brief 持久化点之前的介质内容。
+         */
+        NvmixCrashImage m_media;
+
+        /**
+         * @brief 持久化点上的脏缓存行：缓存行号和当时的内容。
+         */
+        std::vector<std::pair<size_t, std::string>> m_dirtyLines;
+
+        /**
+         * @brief 块写入的数据块号，NVM 刷写时为 -1。
+         */
+        long m_blockIndex = -1;
+
+        /**
+         * @brief 块写入的内容。
+         */
+        std::string m_block;
+    };
+
+    /**
+     * @brief 以当前的介质内容和 NVM 映射的差异添加一个持久化点。
+     */
+    Point &addPoint(const char *pNvm, const std::string &name);
+
+private:
+    std::mutex m_lock;
+
+    /**
+     * @brief 当前的介质内容。
+     */
+    NvmixCrashImage m_media;
+
+    std::vector<Point> m_points;
+
+    bool m_isRecording = false;
+};
+
+
+#endif
@@ -0,0 +1,754 @@
+/**
+ * @file engine.cpp
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 用户层文件系统引擎的源文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "engine.h"
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "config.h"
+
+#include "defs.h"
+#include "bitmap.h"
+#include "dentry.h"
+
+
+/**
+ * @brief 模拟 SSD 的文件的大小，正好容纳所有数据块。
+ */
+#define NVMIX_ENGINE_SSD_SIZE ((off_t)NVMIX_DATA_BLOCK_INDEX(NVMIX_MAX_INODE_NUM) * NVMIX_BLOCK_SIZE)
+
+
+/**
+ * @brief 读入内存的一个目录数据块。
+ * @details 只有前 NVMIX_MAX_ENTRY_NUM 个目录项有效，其余是数据块中未使用的空间。数据块的大小不一定是目录项的整数倍，数组向上取整，读写时只使用前 NVMIX_BLOCK_SIZE 字节。
+ */
+typedef NvmixDentry NvmixDirBlock[(NVMIX_BLOCK_SIZE + sizeof(NvmixDentry) - 1) / sizeof(NvmixDentry)];
+
+static_assert(sizeof(NvmixDirBlock) >= NVMIX_BLOCK_SIZE, "a directory block must hold one data block");
+
+
+int NvmixEngine::format(const std::string &nvmPath, const std::string &ssdPath)
+{
+    NvmixSuperBlock superBlock = {};
+    NvmixInode rootDirInode = {};
+    int nvmFd = -1;
+    int ssdFd = -1;
+    int res = 0;
+
+
+    nvmFd = open(nvmPath.c_str(), O_RDWR | O_CREAT, 0644);
+    ssdFd = open(ssdPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if ((-1 == nvmFd) || (-1 == ssdFd))
+    {
+        res = -errno;
+        goto ERR;
+    }
+
+    // 先截断为 0 再扩展，文件的内容全部变为 0，不论之前是什么。第 0 个以外的 inode 组仍然标记为未初始化，挂载以后走与内核相同的延迟初始化路径。
+    if ((-1 == ftruncate(nvmFd, 0)) || (-1 == ftruncate(nvmFd, NVMIX_NVM_LAYOUT_SIZE)) || (-1 == ftruncate(ssdFd, 0)) || (-1 == ftruncate(ssdFd, NVMIX_ENGINE_SSD_SIZE)))
+    {
+        res = -errno;
+        goto ERR;
+    }
+
+    rootDirInode.m_mode = S_IFDIR | 0755;
+    rootDirInode.m_dataBlockIndex = NVMIX_DATA_BLOCK_INDEX(NVMIX_ROOT_DIR_INODE_NUMBER);
+    rootDirInode.m_nlink = 2;
+
+    if (sizeof(NvmixInode) != pwrite(nvmFd, &rootDirInode, sizeof(NvmixInode), NVMIX_INODE_BLOCK_OFFSET + NVMIX_ROOT_DIR_INODE_NUMBER * sizeof(NvmixInode)))
+    {
+        res = -EIO;
+        goto ERR;
+    }
+
+    superBlock.m_magic = NVMIX_MAGIC_NUMBER;
+    superBlock.m_imap = 1UL << NVMIX_ROOT_DIR_INODE_NUMBER;
+    superBlock.m_initGroups = 1UL << NVMIX_INODE_GROUP(NVMIX_ROOT_DIR_INODE_NUMBER);
+    superBlock.m_version.m_major = NVMIX_CONFIG_VERSION_MAJOR;
+    superBlock.m_version.m_minor = NVMIX_CONFIG_VERSION_MINOR;
+    superBlock.m_version.m_alter = NVMIX_CONFIG_VERSION_ALTER;
+    superBlock.m_blockSizeBits = NVMIX_BLOCK_SIZE_BITS;
+    // 与 mkfs.nvmixfs 相同，新格式化的镜像是干净的。
+    superBlock.m_featureRoCompat = NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE;
+    superBlock.m_state = NVMIX_STATE_CLEAN;
+    superBlock.m_freeInodeNum = NVMIX_MAX_INODE_NUM - 1;
+    superBlock.m_freeXattrBlockNum = NVMIX_MAX_XATTR_BLOCK_NUM;
+
+    // 与 mkfs.nvmixfs 相同，超级块在其余内容持久化以后最后写入。
+    if ((-1 == fsync(ssdFd)) || (-1 == fsync(nvmFd)))
+    {
+        res = -errno;
+        goto ERR;
+    }
+
+    if (sizeof(NvmixSuperBlock) != pwrite(nvmFd, &superBlock, sizeof(NvmixSuperBlock), NVMIX_SUPER_BLOCK_OFFSET))
+    {
+        res = -EIO;
+        goto ERR;
+    }
+
+    if (-1 == fsync(nvmFd)) res = -errno;
+
+
+ERR:
+    if (-1 != nvmFd) close(nvmFd);
+    if (-1 != ssdFd) close(ssdFd);
+
+
+    return res;
+}
+
+NvmixEngine::~NvmixEngine()
+{
+    unmount();
+}
+
+int NvmixEngine::mount(const std::string &nvmPath, const std::string &ssdPath, bool isSync)
+{
+    void *pNvm = MAP_FAILED;
+    int nvmFd = -1;
+    int res = 0;
+
+
+    if (m_pNvm) return -EBUSY;
+
+    nvmFd = open(nvmPath.c_str(), O_RDWR);
+    if (-1 == nvmFd) return -errno;
+
+    pNvm = mmap(nullptr, NVMIX_NVM_LAYOUT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, nvmFd, 0);
+    res = (MAP_FAILED == pNvm) ? -errno : 0;
+    close(nvmFd);
+    if (0 != res) return res;
+
+    m_pNvm = (char *)pNvm;
+    m_pSuperBlock = (NvmixSuperBlock *)(m_pNvm + NVMIX_SUPER_BLOCK_OFFSET);
+
+    if (NVMIX_MAGIC_NUMBER != m_pSuperBlock->m_magic)
+    {
+        res = -EINVAL;
+        goto ERR;
+    }
+
+    // 主版本号不同的镜像布局不兼容，见 NvmixVersion。
+    if (NVMIX_CONFIG_VERSION_MAJOR != m_pSuperBlock->m_version.m_major)
+    {
+        res = -EINVAL;
+        goto ERR;
+    }
+
+    // 引擎总是读写挂载，不认识的只读兼容特性和不兼容特性都不能挂载。
+    if ((0 != (m_pSuperBlock->m_featureIncompat & ~NVMIX_FEATURE_INCOMPAT_SUPP)) || (0 != (m_pSuperBlock->m_featureRoCompat & ~NVMIX_FEATURE_RO_COMPAT_SUPP)))
+    {
+        res = -EINVAL;
+        goto ERR;
+    }
+
+    // 引擎按默认的布局读写 SSD：4 KiB 的数据块，每个簇一个数据块。
+    if (NVMIX_HAS_FEATURE(m_pSuperBlock, Incompat, NVMIX_FEATURE_INCOMPAT_CLUSTER) || (NVMIX_BLOCK_SIZE_BITS != NVMIX_SB_BLOCK_SIZE_BITS(m_pSuperBlock)) || (0 != m_pSuperBlock->m_clusterBits))
+    {
+        res = -EOPNOTSUPP;
+        goto ERR;
+    }
+
+    // 引擎的数据通路不认识未写入区段，会把预分配的块当作已写入的数据读出。
+    if (NVMIX_HAS_FEATURE(m_pSuperBlock, Incompat, NVMIX_FEATURE_INCOMPAT_UNWRITTEN))
+    {
+        res = -EOPNOTSUPP;
+        goto ERR;
+    }
+
+    // 引擎不执行 rename，日志区必须是空的。已提交的日志需要先由内核挂载或者 fsck.nvmixfs 重放。
+    if (0 != ((NvmixJournal *)(m_pNvm + NVMIX_JOURNAL_BLOCK_OFFSET))->m_commit)
+    {
+        res = -EUCLEAN;
+        goto ERR;
+    }
+
+    m_ssdFd = open(ssdPath.c_str(), O_RDWR);
+    if (-1 == m_ssdFd)
+    {
+        res = -errno;
+        goto ERR;
+    }
+
+    m_isSync = isSync;
+
+    // 与内核模块相同，正常卸载的镜像直接使用保存的空闲计数，并在第一次修改位图之前清除干净标记。
+    if (NVMIX_HAS_FEATURE(m_pSuperBlock, RoCompat, NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE) && (NVMIX_STATE_CLEAN == m_pSuperBlock->m_state) && (m_pSuperBlock->m_freeInodeNum <= NVMIX_MAX_INODE_NUM))
+    {
+        m_freeInodeNum = m_pSuperBlock->m_freeInodeNum;
+    }
+    else
+    {
+        m_freeInodeNum = NVMIX_MAX_INODE_NUM - __builtin_popcountl(m_pSuperBlock->m_imap);
+    }
+
+    m_pSuperBlock->m_state = 0;
+    persist(&m_pSuperBlock->m_state, sizeof(m_pSuperBlock->m_state));
+
+
+    return 0;
+
+
+ERR:
+    munmap(m_pNvm, NVMIX_NVM_LAYOUT_SIZE);
+    m_pNvm = nullptr;
+    m_pSuperBlock = nullptr;
+
+
+    return res;
+}
+
+int NvmixEngine::unmount()
+{
+    int res = 0;
+
+
+    if (!m_pNvm) return 0;
+
+    // 与 fsck.nvmixfs 相同，SSD 先于 NVM 持久化。
+    if (-1 == fsync(m_ssdFd)) res = -errno;
+    if (-1 == msync(m_pNvm, NVMIX_NVM_LAYOUT_SIZE, MS_SYNC)) res = -errno;
+
+    // 与内核模块的 nvmixPutSuper() 相同，所有修改持久化以后保存空闲计数，再标记为干净。引擎不分配扩展属性块，m_xmap 在挂载期间不变。
+    if ((0 == res) && NVMIX_HAS_FEATURE(m_pSuperBlock, RoCompat, NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE))
+    {
+        m_pSuperBlock->m_freeInodeNum = m_freeInodeNum;
+        m_pSuperBlock->m_freeXattrBlockNum = NVMIX_MAX_XATTR_BLOCK_NUM - __builtin_popcountl(m_pSuperBlock->m_xmap);
+        if (-1 == msync(m_pSuperBlock, sizeof(NvmixSuperBlock), MS_SYNC)) res = -errno;
+
+        m_pSuperBlock->m_state = NVMIX_STATE_CLEAN;
+        if (-1 == msync(m_pSuperBlock, sizeof(NvmixSuperBlock), MS_SYNC)) res = -errno;
+    }
+
+    close(m_ssdFd);
+    m_ssdFd = -1;
+
+    munmap(m_pNvm, NVMIX_NVM_LAYOUT_SIZE);
+    m_pNvm = nullptr;
+    m_pSuperBlock = nullptr;
+
+
+    return res;
+}
+
+int NvmixEngine::lookup(unsigned long dirIno, const std::string &name, unsigned long *pIno)
+{
+    NvmixDirBlock dentries;
+    int slot = 0;
+    int res = 0;
+
+
+    res = checkName(name);
+    if (0 != res) return res;
+
+    std::lock_guard<std::mutex> dirLock(m_inodeLocks[dirIno % NVMIX_MAX_INODE_NUM]);
+
+    if (!isAllocated(dirIno) || !S_ISDIR(inode(dirIno)->m_mode)) return -ENOTDIR;
+
+    res = readBlock(inode(dirIno)->m_dataBlockIndex, dentries);
+    if (0 != res) return res;
+
+    slot = nvmixDentryFind(dentries, name.data(), name.size());
+    if (slot < 0) return -ENOENT;
+
+    *pIno = dentries[slot].m_ino;
+
+
+    return 0;
+}
+
+int NvmixEngine::create(unsigned long dirIno, const std::string &name, unsigned int mode, unsigned long *pIno)
+{
+    if (S_ISDIR(mode)) return -EISDIR;
+
+    if (0 == (mode & S_IFMT)) mode |= S_IFREG;
+
+
+    return makeNode(dirIno, name, mode, pIno);
+}
+
+int NvmixEngine::mkdir(unsigned long dirIno, const std::string &name, unsigned int mode, unsigned long *pIno)
+{
+    return makeNode(dirIno, name, S_IFDIR | (mode & ~S_IFMT), pIno);
+}
+
+int NvmixEngine::unlink(unsigned long dirIno, const std::string &name)
+{
+    return removeNode(dirIno, name, false);
+}
+
+int NvmixEngine::rmdir(unsigned long dirIno, const std::string &name)
+{
+    return removeNode(dirIno, name, true);
+}
+
+int NvmixEngine::readdir(unsigned long dirIno, std::vector<NvmixDentry> *pEntries)
+{
+    NvmixDirBlock dentries;
+    int res = 0;
+
+
+    std::lock_guard<std::mutex> dirLock(m_inodeLocks[dirIno % NVMIX_MAX_INODE_NUM]);
+
+    if (!isAllocated(dirIno) || !S_ISDIR(inode(dirIno)->m_mode)) return -ENOTDIR;
+
+    res = readBlock(inode(dirIno)->m_dataBlockIndex, dentries);
+    if (0 != res) return res;
+
+    pEntries->clear();
+    for (int i = 0; i < NVMIX_MAX_ENTRY_NUM; ++i)
+    {
+        if (0 != dentries[i].m_ino) pEntries->push_back(dentries[i]);
+    }
+
+
+    return 0;
+}
+
+int NvmixEngine::getattr(unsigned long ino, NvmixInode *pNi)
+{
+    if (!isAllocated(ino)) return -ENOENT;
+
+    std::lock_guard<std::mutex> inodeLock(m_inodeLocks[ino]);
+
+    *pNi = *inode(ino);
+
+
+    return 0;
+}
+
+long NvmixEngine::read(unsigned long ino, unsigned long offset, void *pBuf, unsigned long size)
+{
+    char block[NVMIX_BLOCK_SIZE];
+    NvmixInode *pNi = nullptr;
+    int res = 0;
+
+
+    if (!isAllocated(ino)) return -ENOENT;
+
+    std::lock_guard<std::mutex> inodeLock(m_inodeLocks[ino]);
+
+    pNi = inode(ino);
+    if (!S_ISREG(pNi->m_mode)) return -EINVAL;
+
+    if (offset >= pNi->m_size) return 0;
+
+    size = std::min<unsigned long>(size, pNi->m_size - offset);
+
+    // 子簇位图中没有置位的数据块是空洞，与内核的 nvmixGetBlock() 相同。
+    if (!isBlockWritten(ino))
+    {
+        memset(pBuf, 0, size);
+
+        return size;
+    }
+
+    res = readBlock(pNi->m_dataBlockIndex, block);
+    if (0 != res) return res;
+
+    memcpy(pBuf, block + offset, size);
+
+
+    return size;
+}
+
+long NvmixEngine::write(unsigned long ino, unsigned long offset, const void *pBuf, unsigned long size)
+{
+    char block[NVMIX_BLOCK_SIZE];
+    NvmixInode *pNi = nullptr;
+    int res = 0;
+
+
+    if (!isAllocated(ino)) return -ENOENT;
+
+    if ((offset > NVMIX_BLOCK_SIZE) || (size > NVMIX_BLOCK_SIZE - offset)) return -EFBIG;
+
+    std::lock_guard<std::mutex> inodeLock(m_inodeLocks[ino]);
+
+    pNi = inode(ino);
+    if (!S_ISREG(pNi->m_mode)) return -EINVAL;
+
+    // 空洞从全 0 开始，不读取簇中残留的旧数据。
+    if (isBlockWritten(ino))
+    {
+        res = readBlock(pNi->m_dataBlockIndex, block);
+        if (0 != res) return res;
+    }
+    else
+    {
+        memset(block, 0, sizeof(block));
+    }
+
+    memcpy(block + offset, pBuf, size);
+
+    res = writeBlock(pNi->m_dataBlockIndex, block);
+    if (0 != res) return res;
+
+    // 数据落盘以后才在子簇位图中置位。
+    if (!isBlockWritten(ino))
+    {
+        *(unsigned long *)inlineData(ino) |= 1UL;
+        persist(inlineData(ino), sizeof(unsigned long));
+    }
+
+    if (offset + size > pNi->m_size)
+    {
+        pNi->m_size = offset + size;
+        persist(pNi, sizeof(NvmixInode));
+    }
+
+
+    return size;
+}
+
+long NvmixEngine::freeInodeNum() const
+{
+    return m_freeInodeNum;
+}
+
+void NvmixEngine::setObserver(NvmixPersistObserver *pObserver)
+{
+    m_pObserver = pObserver;
+}
+
+const char *NvmixEngine::nvmAddr() const
+{
+    return m_pNvm;
+}
+
+long NvmixEngine::allocInode(unsigned long hint)
+{
+    const unsigned int groupBitNum = NVMIX_MAX_INODE_NUM / NVMIX_ALLOC_GROUP_NUM;
+    unsigned long *pBitmap = &m_pSuperBlock->m_imap;
+
+
+    // 与内核的 nvmixAllocatorAlloc() 相同：查找策略来自 cross-space，组锁内查找并原子地置位。
+    for (unsigned int i = 0; i < NVMIX_ALLOC_GROUP_NUM; ++i)
+    {
+        unsigned int group = nvmixAllocGroupProbe(hint, i);
+        unsigned long start = group * groupBitNum;
+        unsigned long end = start + groupBitNum;
+        unsigned long index = end;
+
+
+        {
+            std::lock_guard<std::mutex> groupLock(m_groupLocks[group]);
+
+            index = nvmixBitmapFindZero(pBitmap, start, end);
+            if (index < end) __atomic_fetch_or(pBitmap + index / NVMIX_BITS_PER_LONG, 1UL << (index % NVMIX_BITS_PER_LONG), __ATOMIC_SEQ_CST);
+        }
+
+        if (index < end)
+        {
+            persist(pBitmap + index / NVMIX_BITS_PER_LONG, sizeof(unsigned long));
+
+            --m_freeInodeNum;
+
+
+            return index;
+        }
+    }
+
+
+    return -ENOSPC;
+}
+
+void NvmixEngine::freeInode(unsigned long ino)
+{
+    unsigned long *pWord = &m_pSuperBlock->m_imap + ino / NVMIX_BITS_PER_LONG;
+    unsigned long mask = 1UL << (ino % NVMIX_BITS_PER_LONG);
+    unsigned long old = 0;
+
+
+    {
+        std::lock_guard<std::mutex> groupLock(m_groupLocks[ino / (NVMIX_MAX_INODE_NUM / NVMIX_ALLOC_GROUP_NUM)]);
+
+        old = __atomic_fetch_and(pWord, ~mask, __ATOMIC_SEQ_CST);
+    }
+
+    persist(pWord, sizeof(unsigned long));
+
+    if (old & mask) ++m_freeInodeNum;
+}
+
+int NvmixEngine::lazyInitGroup(unsigned int group)
+{
+    const unsigned long firstIno = group * NVMIX_INODE_GROUP_SIZE;
+    char zeroBlock[NVMIX_BLOCK_SIZE] = {};
+    char *pSlot = nullptr;
+    int res = 0;
+
+
+    if (__atomic_load_n(&m_pSuperBlock->m_initGroups, __ATOMIC_ACQUIRE) & (1UL << group)) return 0;
+
+    std::lock_guard<std::mutex> lazyInitLock(m_lazyInitLock);
+
+    if (m_pSuperBlock->m_initGroups & (1UL << group)) return 0;
+
+    pSlot = (char *)inode(firstIno);
+    memset(pSlot, 0, NVMIX_INODE_GROUP_SIZE * sizeof(NvmixInode));
+    persist(pSlot, NVMIX_INODE_GROUP_SIZE * sizeof(NvmixInode));
+
+    pSlot = inlineData(firstIno);
+    memset(pSlot, 0, NVMIX_INODE_GROUP_SIZE * NVMIX_INLINE_DATA_SIZE);
+    persist(pSlot, NVMIX_INODE_GROUP_SIZE * NVMIX_INLINE_DATA_SIZE);
+
+    pSlot = m_pNvm + NVMIX_XATTR_INLINE_BLOCK_OFFSET + firstIno * NVMIX_XATTR_INLINE_SIZE;
+    memset(pSlot, 0, NVMIX_INODE_GROUP_SIZE * NVMIX_XATTR_INLINE_SIZE);
+    persist(pSlot, NVMIX_INODE_GROUP_SIZE * NVMIX_XATTR_INLINE_SIZE);
+
+    for (unsigned long ino = firstIno; ino < firstIno + NVMIX_INODE_GROUP_SIZE; ++ino)
+    {
+        res = writeBlock(NVMIX_DATA_BLOCK_INDEX(ino), zeroBlock);
+        if (0 != res) return res;
+    }
+
+    __atomic_fetch_or(&m_pSuperBlock->m_initGroups, 1UL << group, __ATOMIC_RELEASE);
+    persist(&m_pSuperBlock->m_initGroups, sizeof(unsigned long));
+
+
+    return 0;
+}
+
+int NvmixEngine::makeNode(unsigned long dirIno, const std::string &name, unsigned int mode, unsigned long *pIno)
+{
+    NvmixDirBlock dentries;
+    NvmixInode *pDirNi = nullptr;
+    NvmixInode *pNi = nullptr;
+    long ino = 0;
+    int slot = 0;
+    int res = 0;
+
+
+    res = checkName(name);
+    if (0 != res) return res;
+
+    std::lock_guard<std::mutex> dirLock(m_inodeLocks[dirIno % NVMIX_MAX_INODE_NUM]);
+
+    if (!isAllocated(dirIno) || !S_ISDIR(inode(dirIno)->m_mode)) return -ENOTDIR;
+
+    pDirNi = inode(dirIno);
+
+    res = readBlock(pDirNi->m_dataBlockIndex, dentries);
+    if (0 != res) return res;
+
+    if (nvmixDentryFind(dentries, name.data(), name.size()) >= 0) return -EEXIST;
+
+    slot = nvmixDentryFindFree(dentries);
+    if (slot < 0) return -ENOSPC;
+
+    ino = allocInode(dirIno);
+    if (ino < 0) return ino;
+
+    res = lazyInitGroup(NVMIX_INODE_GROUP(ino));
+    if (0 != res) goto ERR;
+
+    // 数据块号随 inode 号复用，新目录必须从空的数据块开始。
+    if (S_ISDIR(mode))
+    {
+        char zeroBlock[NVMIX_BLOCK_SIZE] = {};
+
+        res = writeBlock(NVMIX_DATA_BLOCK_INDEX(ino), zeroBlock);
+        if (0 != res) goto ERR;
+    }
+
+    pNi = inode(ino);
+    *pNi = NvmixInode{};
+    pNi->m_mode = mode;
+    pNi->m_uid = getuid();
+    pNi->m_gid = getgid();
+    pNi->m_dataBlockIndex = NVMIX_DATA_BLOCK_INDEX(ino);
+    pNi->m_nlink = S_ISDIR(mode) ? 2 : 1;
+    persist(pNi, sizeof(NvmixInode));
+
+    // 编号可能来自刚被释放的 inode，扩展属性区需要清空，与内核的 nvmixXattrInit() 相同。
+    memset(m_pNvm + NVMIX_XATTR_INLINE_BLOCK_OFFSET + ino * NVMIX_XATTR_INLINE_SIZE, 0, sizeof(NvmixXattrHeader));
+    persist(m_pNvm + NVMIX_XATTR_INLINE_BLOCK_OFFSET + ino * NVMIX_XATTR_INLINE_SIZE, sizeof(NvmixXattrHeader));
+
+    // 普通文件的子簇位图同理，与内核的 nvmixMknod() 相同。
+    if (S_ISREG(mode))
+    {
+        memset(inlineData(ino), 0, NVMIX_INLINE_DATA_SIZE);
+        persist(inlineData(ino), NVMIX_INLINE_DATA_SIZE);
+    }
+
+    nvmixDentryFill(dentries + slot, name.data(), name.size(), ino, IFTODT(mode));
+
+    res = writeBlock(pDirNi->m_dataBlockIndex, dentries);
+    if (0 != res) goto ERR;
+
+    // 新目录的 .. 指向父目录。
+    if (S_ISDIR(mode))
+    {
+        ++pDirNi->m_nlink;
+        persist(pDirNi, sizeof(NvmixInode));
+    }
+
+    if (pIno) *pIno = ino;
+
+
+    return 0;
+
+
+ERR:
+    freeInode(ino);
+
+
+    return res;
+}
+
+int NvmixEngine::removeNode(unsigned long dirIno, const std::string &name, bool isDir)
+{
+    NvmixDirBlock dentries;
+    NvmixDirBlock childDentries;
+    NvmixInode *pDirNi = nullptr;
+    NvmixInode *pNi = nullptr;
+    unsigned long ino = 0;
+    int slot = 0;
+    int res = 0;
+
+
+    res = checkName(name);
+    if (0 != res) return res;
+
+    std::lock_guard<std::mutex> dirLock(m_inodeLocks[dirIno % NVMIX_MAX_INODE_NUM]);
+
+    if (!isAllocated(dirIno) || !S_ISDIR(inode(dirIno)->m_mode)) return -ENOTDIR;
+
+    pDirNi = inode(dirIno);
+
+    res = readBlock(pDirNi->m_dataBlockIndex, dentries);
+    if (0 != res) return res;
+
+    slot = nvmixDentryFind(dentries, name.data(), name.size());
+    if (slot < 0) return -ENOENT;
+
+    ino = dentries[slot].m_ino;
+    pNi = inode(ino);
+
+    if (isDir && !S_ISDIR(pNi->m_mode)) return -ENOTDIR;
+    if (!isDir && S_ISDIR(pNi->m_mode)) return -EISDIR;
+
+    // 加锁顺序与 vfs 相同，先父目录后子节点。
+    std::lock_guard<std::mutex> childLock(m_inodeLocks[ino]);
+
+    if (isDir)
+    {
+        res = readBlock(pNi->m_dataBlockIndex, childDentries);
+        if (0 != res) return res;
+
+        if (!nvmixDentryIsEmpty(childDentries)) return -ENOTEMPTY;
+    }
+
+    nvmixDentryClear(dentries + slot);
+
+    res = writeBlock(pDirNi->m_dataBlockIndex, dentries);
+    if (0 != res) return res;
+
+    if (isDir)
+    {
+        --pDirNi->m_nlink;
+        persist(pDirNi, sizeof(NvmixInode));
+
+        pNi->m_nlink = 0;
+    }
+    else
+    {
+        --pNi->m_nlink;
+    }
+
+    persist(pNi, sizeof(NvmixInode));
+
+    if (0 == pNi->m_nlink) freeInode(ino);
+
+
+    return 0;
+}
+
+int NvmixEngine::readBlock(unsigned long blockIndex, void *pBuf)
+{
+    ssize_t n = pread(m_ssdFd, pBuf, NVMIX_BLOCK_SIZE, (off_t)blockIndex * NVMIX_BLOCK_SIZE);
+
+
+    if (NVMIX_BLOCK_SIZE == n) return 0;
+
+
+    return (-1 == n) ? -errno : -EIO;
+}
+
+int NvmixEngine::writeBlock(unsigned long blockIndex, const void *pBuf)
+{
+    ssize_t n = 0;
+
+
+    if (m_pObserver) m_pObserver->onWriteBlock(m_pNvm, blockIndex, pBuf);
+
+    n = pwrite(m_ssdFd, pBuf, NVMIX_BLOCK_SIZE, (off_t)blockIndex * NVMIX_BLOCK_SIZE);
+    if (NVMIX_BLOCK_SIZE != n) return (-1 == n) ? -errno : -EIO;
+
+    if (m_isSync && (-1 == fdatasync(m_ssdFd))) return -errno;
+
+
+    return 0;
+}
+
+void NvmixEngine::persist(const void *pAddr, unsigned long size)
+{
+    const unsigned long pageSize = sysconf(_SC_PAGESIZE);
+    unsigned long start = 0;
+    unsigned long end = 0;
+
+
+    if (m_pObserver) m_pObserver->onPersist(m_pNvm, (const char *)pAddr - m_pNvm, size);
+
+    if (!m_isSync) return;
+
+    // msync() 要求起始地址按页对齐。
+    start = (unsigned long)pAddr & ~(pageSize - 1);
+    end = (unsigned long)pAddr + size;
+
+    msync((void *)start, end - start, MS_SYNC);
+}
+
+NvmixInode *NvmixEngine::inode(unsigned long ino)
+{
+    return (NvmixInode *)(m_pNvm + NVMIX_INODE_BLOCK_OFFSET) + ino;
+}
+
+char *NvmixEngine::inlineData(unsigned long ino)
+{
+    return m_pNvm + NVMIX_INLINE_BLOCK_OFFSET + ino * NVMIX_INLINE_DATA_SIZE;
+}
+
+bool NvmixEngine::isBlockWritten(unsigned long ino)
+{
+    return *(unsigned long *)inlineData(ino) & 1UL;
+}
+
+bool NvmixEngine::isAllocated(unsigned long ino) const
+{
+    return (ino < NVMIX_MAX_INODE_NUM) && (__atomic_load_n(&m_pSuperBlock->m_imap, __ATOMIC_ACQUIRE) & (1UL << ino));
+}
+
+int NvmixEngine::checkName(const std::string &name)
+{
+    if (name.empty()) return -EINVAL;
+
+
+    return (name.size() > NVMIX_MAX_NAME_LENGTH) ? -ENAMETOOLONG : 0;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file engine.h
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 用户层文件系统引擎的头文件。
+ * @details 用普通文件模拟 NVM 和 SSD，在用户层运行与内核模块相同的元数据算法：inode 分配（cross-space 的 bitmap.h）、目录项操作（cross-space 的 dentry.h）、块映射（NVMIX_DATA_BLOCK_INDEX）以及 inode 组的延迟初始化。磁盘布局与内核模块完全一致。不需要 root 权限、预留内存和块设备，用于在 CI 和开发机上做单元测试、性能剖析和压力测试。
+ * @details 锁的粒度与内核模块对应：每个目录一把互斥锁，相当于目录 inode 的 i_rwsem；inode 位图每个分配组一把互斥锁，相当于 NvmixAllocator 的组锁。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#ifndef _NVMIX_ENGINE_H_
+#define _NVMIX_ENGINE_H_
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include "defs.h"
+#include "bitmap.h"
+
+
+/**
+ * @class NvmixPersistObserver
+ * @brief 观察引擎的每一个持久化点，用于崩溃一致性测试，见 crash.h。
+ * @details 回调在持久化生效之前调用，此时 NVM 映射中已经是新内容，SSD 上还是旧内容。回调可能来自多个线程，实现需要自己加锁。
+ */
+class NvmixPersistObserver
+{
+public:
+    virtual ~NvmixPersistObserver() = default;
+
+    /**
+     * @brief NVM 上的一段内存将被刷写，对应内核的 clflush_cache_range()。
+     * @param pNvm NVM 映射的起始地址。
+     * @param offset 刷写范围在 NVM 中的偏移量。
+     * @param size 刷写范围的大小。
+     */
+    virtual void onPersist(const char *pNvm, unsigned long offset, unsigned long size) = 0;
+
+    /**
+     * @brief SSD 上的一个数据块将被写入，对应内核的 sync_dirty_buffer()。
+     * @param pNvm NVM 映射的起始地址。
+     * @param blockIndex 数据块号。
+     * @param pBuf 写入的内容，大小为 NVMIX_BLOCK_SIZE。
+     */
+    virtual void onWriteBlock(const char *pNvm, unsigned long blockIndex, const void *pBuf) = 0;
+};
+
+
+/**
+ * @class NvmixEngine
+ * @brief 用户层文件系统引擎。
+ * @details 所有操作成功返回 0 或者非负的结果，失败返回负的 errno，与内核的约定一致。目录和文件都通过 inode 号引用，不做路径解析。
+ */
+class NvmixEngine
+{
+public:
+    /**
+     * @brief 在两个普通文件上创建新的文件系统。
+     * @param nvmPath 模拟 NVM 的文件路径，不存在时创建。
+     * @param ssdPath 模拟 SSD 的文件路径，不存在时创建。
+     * @return 成功返回 0，失败返回负的 errno。
+     * @details 布局与 mkfs.nvmixfs 相同，只是不创建 reserved.txt，只有一个空的根目录。同样只初始化第 0 个 inode 组。
+     */
+    static int format(const std::string &nvmPath, const std::string &ssdPath);
+
+    NvmixEngine() = default;
+
+    NvmixEngine(const NvmixEngine &) = delete;
+
+    NvmixEngine &operator=(const NvmixEngine &) = delete;
+
+    /**
+     * @brief 析构时自动卸载。
+     */
+    ~NvmixEngine();
+
+    /**
+     * @brief 挂载文件系统。
+     * @param nvmPath 模拟 NVM 的文件路径。
+     * @param ssdPath 模拟 SSD 的文件路径。
+     * @param isSync 是否在每次修改后同步到文件。为 true 时 NVM 的每次持久化调用 msync()，SSD 的每次写入调用 fdatasync()，对应内核的 clflush_cache_range() 和 sync_dirty_buffer()；为 false 时只在卸载时同步，用于测量算法本身的开销。
+     * @return 成功返回 0，失败返回负的 errno。主版本号与引擎不同或者启用了引擎不认识的特性时返回 -EINVAL，数据块大小或簇大小不是默认值、或者有未写入区段时返回 -EOPNOTSUPP。
+     */
+    int mount(const std::string &nvmPath, const std::string &ssdPath, bool isSync = false);
+
+    /**
+     * @brief 卸载文件系统，同步所有修改。
+     * @return 成功返回 0，失败返回负的 errno。未挂载时什么都不做。
+     */
+    int unmount();
+
+    /**
+     * @brief 在目录中按名字查找目录项。
+     * @param dirIno 目录的 inode 号。
+     * @param name 名字。
+     * @param pIno 找到时用于返回 inode 号。
+     * @return 成功返回 0，不存在返回 -ENOENT。
+     */
+    int lookup(unsigned long dirIno, const std::string &name, unsigned long *pIno);
+
+    /**
+     * @brief 在目录中创建普通文件或者其他非目录文件。
+     * @param dirIno 父目录的 inode 号。
+     * @param name 名字。
+     * @param mode 文件类型和权限，不含类型时视为普通文件。
+     * @param pIno 用于返回新文件的 inode 号，可以为 nullptr。
+     * @return 成功返回 0，失败返回负的 errno。
+     */
+    int create(unsigned long dirIno, const std::string &name, unsigned int mode, unsigned long *pIno = nullptr);
+
+    /**
+     * @brief 在目录中创建子目录。
+     * @param dirIno 父目录的 inode 号。
+     * @param name 名字。
+     * @param mode 权限。
+     * @param pIno 用于返回新目录的 inode 号，可以为 nullptr。
+     * @return 成功返回 0，失败返回负的 errno。
+     */
+    int mkdir(unsigned long dirIno, const std::string &name, unsigned int mode, unsigned long *pIno = nullptr);
+
+    /**
+     * @brief 删除目录中的非目录文件。
+     * @param dirIno 父目录的 inode 号。
+     * @param name 名字。
+     * @return 成功返回 0，失败返回负的 errno。
+     * @details 硬链接数降为 0 时立即释放 inode。引擎没有打开文件的概念，不存在删除后仍被打开的文件。
+     */
+    int unlink(unsigned long dirIno, const std::string &name);
+
+    /**
+     * @brief 删除目录中的空子目录。
+     * @param dirIno 父目录的 inode 号。
+     * @param name 名字。
+     * @return 成功返回 0，失败返回负的 errno。
+     */
+    int rmdir(unsigned long dirIno, const std::string &name);
+
+    /**
+     * @brief 列出目录中的所有目录项，不含 . 和 ..。
+     * @param dirIno 目录的 inode 号。
+     * @param pEntries 用于返回目录项。
+     * @return 成功返回 0，失败返回负的 errno。
+     */
+    int readdir(unsigned long dirIno, std::vector<NvmixDentry> *pEntries);
+
+    /**
+     * @brief 读取 inode 的元数据。
+     * @param ino inode 号。
+     * @param pNi 用于返回元数据。
+     * @return 成功返回 0，inode 未分配返回 -ENOENT。
+     */
+    int getattr(unsigned long ino, NvmixInode *pNi);
+
+    /**
+     * @brief 读取普通文件的内容。
+     * @param ino inode 号。
+     * @param offset 文件内的偏移量。
+     * @param pBuf 缓冲区。
+     * @param size 最多读取的字节数。
+     * @return 成功返回读取的字节数，失败返回负的 errno。
+     */
+    long read(unsigned long ino, unsigned long offset, void *pBuf, unsigned long size);
+
+    /**
+     * @brief 写入普通文件的内容。
+     * @param ino inode 号。
+     * @param offset 文件内的偏移量。
+     * @param pBuf 缓冲区。
+     * @param size 写入的字节数。
+     * @return 成功返回写入的字节数，失败返回负的 errno。超出单个数据块时返回 -EFBIG，与内核模块的限制相同。
+     */
+    long write(unsigned long ino, unsigned long offset, const void *pBuf, unsigned long size);
+
+    /**
+     * @brief 返回空闲 inode 的数量。
+     */
+    long freeInodeNum() const;
+
+    /**
+     * @brief 设置持久化点的观察者，为 nullptr 时取消。
+     * @details 观察者在挂载期间一直有效，由调用者管理生命周期。
+     */
+    void setObserver(NvmixPersistObserver *pObserver);
+
+    /**
+     * @brief 返回 NVM 映射的起始地址，未挂载时为 nullptr。
+     */
+    const char *nvmAddr() const;
+
+private:
+    /**
+     * @brief 在 m_imap 中分配一个 inode 号。
+     * @param hint 分配提示，父目录的 inode 号。
+     * @return 成功返回 inode 号，没有空闲 inode 返回 -ENOSPC。
+     */
+    long allocInode(unsigned long hint);
+
+    /**
+     * @brief 释放 m_imap 中的一个 inode 号。
+     */
+    void freeInode(unsigned long ino);
+
+    /**
+     * @brief 确保 inode 组已经初始化，与内核的 nvmixLazyInitGroup() 相同。
+     * @return 成功返回 0，失败返回负的 errno。
+     */
+    int lazyInitGroup(unsigned int group);
+
+    /**
+     * @brief 创建 inode 并在父目录中添加目录项，create() 和 mkdir() 的公共部分。
+     */
+    int makeNode(unsigned long dirIno, const std::string &name, unsigned int mode, unsigned long *pIno);
+
+    /**
+     * @brief 删除目录项，unlink() 和 rmdir() 的公共部分。
+     */
+    int removeNode(unsigned long dirIno, const std::string &name, bool isDir);
+
+    /**
+     * @brief 读取 SSD 上的一个数据块。
+     */
+    int readBlock(unsigned long blockIndex, void *pBuf);
+
+    /**
+     * @brief 写入 SSD 上的一个数据块。
+     */
+    int writeBlock(unsigned long blockIndex, const void *pBuf);
+
+    /**
+     * @brief 持久化 NVM 上的一段内存，对应内核的 clflush_cache_range()。
+     */
+    void persist(const void *pAddr, unsigned long size);
+
+    /**
+     * @brief 返回 inode 号对应的 NvmixInode。
+     */
+    NvmixInode *inode(unsigned long ino);
+
+    /**
+     * @brief 返回 inode 号在 inline 区上的槽位，普通文件在这里存储子簇位图。
+     */
+    char *inlineData(unsigned long ino);
+
+    /**
+     * @brief 判断普通文件唯一的数据块是否已经写过，即子簇位图的第 0 位。
+     */
+    bool isBlockWritten(unsigned long ino);
+
+    /**
+     * @brief 判断 inode 号是否已分配。
+     */
+    bool isAllocated(unsigned long ino) const;
+
+    /**
+     * @brief 检查名字的长度。
+     * @return 合法返回 0，为空返回 -EINVAL，过长返回 -ENAMETOOLONG。
+     */
+    static int checkName(const std::string &name);
+
+private:
+    /**
+     * @brief NVM 映射的起始地址，未挂载时为 nullptr。
+     */
+    char *m_pNvm = nullptr;
+
+    /**
+     * @brief SSD 的文件描述符。
+     */
+    int m_ssdFd = -1;
+
+    /**
+     * @brief 是否在每次修改后同步。
+     */
+    bool m_isSync = false;
+
+    /**
+     * @brief 持久化点的观察者。
+     */
+    NvmixPersistObserver *m_pObserver = nullptr;
+
+    /**
+     * @brief 超级块，位于 NVM 映射中。
+     */
+    NvmixSuperBlock *m_pSuperBlock = nullptr;
+
+    /**
+     * @brief 每个分配组一把锁。
+     */
+    std::mutex m_groupLocks[NVMIX_ALLOC_GROUP_NUM];
+
+    /**
+     * @brief 每个 inode 一把锁，目录使用它保护自己的数据块，普通文件使用它保护数据和大小。
+     */
+    std::mutex m_inodeLocks[NVMIX_MAX_INODE_NUM];
+
+    /**
+     * @brief 串行化 inode 组的延迟初始化。
+     */
+    std::mutex m_lazyInitLock;
+
+    /**
+     * @brief 空闲 inode 的数量。
+     */
+    std::atomic<long> m_freeInodeNum{0};
+};
+
+
+#endif
@@ -0,0 +1,1013 @@
+/**
+ * @file main.cpp
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 检查并修复 nvmixfs 文件系统一致性的用户层程序。
+ * @details 在文件系统未挂载时运行。依次检查超级块、日志区、目录树、inode 区、扩展属性区和超级块上的位图，默认只报告问题，-y 时修复。目录树按层遍历，每一层的目录数据块由多个线程并发读取和检查。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <dirent.h>
+
+#include "config.h"
+
+#include "defs.h"
+
+
+/**
+ * @brief 与 e2fsck 含义相同的退出码。
+ */
+#define NVMIX_FSCK_EXIT_OK 0
+
+#define NVMIX_FSCK_EXIT_FIXED 1
+
+#define NVMIX_FSCK_EXIT_UNCORRECTED 4
+
+#define NVMIX_FSCK_EXIT_ERROR 8
+
+
+/**
+ * @struct FsckContext
+ * @brief 一次检查的全局状态。
+ * @details 只读检查时 NVM 以只读方式映射，所有修复都只记录在本结构的副本中，不写回设备，后续的检查基于修复后的状态继续进行，报告的问题与真正修复时一致。
+ */
+struct FsckContext
+{
+    /**
+     * @brief 是否修复发现的问题。
+     */
+    bool m_isRepair = false;
+
+    /**
+     * @brief NVM 映射的起始地址。
+     */
+    char *m_pNvm = nullptr;
+
+    /**
+     * @brief SSD 的文件描述符。
+     */
+    int m_ssdFd = -1;
+
+    /**
+     * @brief 修复后的超级块，最后统一写回。
+     */
+    NvmixSuperBlock m_superBlock = {};
+
+    /**
+     * @brief 修复后的 inode 区，最后统一写回。
+     */
+    NvmixInode m_inodes[NVMIX_MAX_INODE_NUM] = {};
+
+    /**
+     * @brief 修复后的扩展属性头部，最后统一写回。
+     */
+    NvmixXattrHeader m_xattrHeaders[NVMIX_MAX_INODE_NUM] = {};
+
+    /**
+     * @brief 只读检查时尚未重放的日志记录，读取目录数据块时叠加上去。
+     */
+    std::vector<NvmixJournalEntry> m_pendingJournal;
+
+    /**
+     * @brief 是否需要清空 NVM 上的日志区。
+     */
+    bool m_isJournalDirty = false;
+
+    /**
+     * @brief 用于并发检查目录树的线程数量。
+     */
+    unsigned m_threadNum = 1;
+
+    /**
+     * @brief 发现的问题数量。
+     */
+    unsigned m_errorNum = 0;
+
+    /**
+     * @brief 检查过的目录数量。
+     */
+    unsigned m_dirNum = 0;
+};
+
+/**
+ * @struct FsckDir
+ * @brief 目录树遍历中一个目录的检查结果。
+ * @details 由检查线程填充，每个目录只属于一个线程，主线程在一层结束以后合并。
+ */
+struct FsckDir
+{
+    /**
+     * @brief 目录的 inode 号。
+     */
+    unsigned long m_ino = 0;
+
+    /**
+     * @brief 目录数据块的内容。
+     */
+    std::vector<char> m_block;
+
+    /**
+     * @brief 数据块是否被修改过，需要写回。
+     */
+    bool m_isDirty = false;
+
+    /**
+     * @brief 读取数据块失败时的 errno，成功时为 0。
+     */
+    int m_errno = 0;
+
+    /**
+     * @brief 本目录中发现的问题的描述。
+     */
+    std::vector<std::string> m_problems;
+};
+
+
+/**
+ * @brief 计时工具，返回从 start 到现在经过的毫秒数。
+ */
+static double elapsedMs(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief 打印一个问题并计数。
+ * @param ctx 检查的全局状态。
+ * @param problem 问题的描述。
+ */
+static void report(FsckContext &ctx, const std::string &problem)
+{
+    ++ctx.m_errorNum;
+
+    std::cout << problem << (ctx.m_isRepair ? ": fixed." : ": not fixed.") << std::endl;
+}
+
+/**
+ * @brief 将 inode 的 m_mode 转化为目录项中的文件类型，与内核的 fs_umode_to_dtype() 一致。
+ */
+static unsigned char modeToFileType(unsigned int mode)
+{
+    return IFTODT(mode);
+}
+
+/**
+ * @brief 判断 m_mode 是否是本文件系统支持的文件类型。
+ */
+static bool isValidMode(unsigned int mode)
+{
+    return S_ISREG(mode) || S_ISDIR(mode) || S_ISLNK(mode) || S_ISCHR(mode) || S_ISBLK(mode) || S_ISFIFO(mode) || S_ISSOCK(mode);
+}
+
+/**
+ * @brief 判断 inode 号在修复后的 m_imap 中是否已分配。
+ */
+static bool isAllocated(const FsckContext &ctx, unsigned long ino)
+{
+    return (ino < NVMIX_MAX_INODE_NUM) && (ctx.m_superBlock.m_imap & (1UL << ino));
+}
+
+/**
+ * @brief 返回超级块记录的数据块大小。
+ */
+static unsigned blockSize(const FsckContext &ctx)
+{
+    return 1U << NVMIX_SB_BLOCK_SIZE_BITS(&ctx.m_superBlock);
+}
+
+/**
+ * @brief 计算目录数据块在 SSD 上的偏移量，即 inode 的簇的第一个数据块。
+ */
+static off_t dirBlockOffset(const FsckContext &ctx, unsigned long ino)
+{
+    return (off_t)NVMIX_DATA_BLOCK_NR(&ctx.m_superBlock, NVMIX_DATA_BLOCK_INDEX(ino)) << NVMIX_SB_BLOCK_SIZE_BITS(&ctx.m_superBlock);
+}
+
+/**
+ * @brief 读取目录的数据块，只读检查时叠加尚未重放的日志。
+ * @param ctx 检查的全局状态。
+ * @param dir 用于保存结果的目录结构。
+ */
+static void readDirBlock(const FsckContext &ctx, FsckDir &dir)
+{
+    off_t blockIndex = NVMIX_DATA_BLOCK_INDEX(dir.m_ino);
+
+
+    dir.m_block.assign(blockSize(ctx), 0);
+
+    if ((ssize_t)dir.m_block.size() != pread(ctx.m_ssdFd, dir.m_block.data(), dir.m_block.size(), dirBlockOffset(ctx, dir.m_ino)))
+    {
+        dir.m_errno = (0 == errno) ? EIO : errno;
+
+        return;
+    }
+
+    for (const NvmixJournalEntry &entry : ctx.m_pendingJournal)
+    {
+        if (blockIndex == entry.m_dataBlockIndex) ((NvmixDentry *)dir.m_block.data())[entry.m_slot] = entry.m_dentry;
+    }
+}
+
+/**
+ * @brief 检查一个目录数据块中各个目录项自身的合法性。
+ * @param ctx 检查的全局状态，只读访问。
+ * @param dir 待检查的目录。
+ * @details 由检查线程调用。只做不依赖其他目录的检查：inode 号的范围、分配状态和类型，名字是否为空或重复，记录的文件类型是否与 inode 一致。非法的目录项直接清空，文件类型不一致时以 inode 为准。
+ */
+static void checkDirBlock(const FsckContext &ctx, FsckDir &dir)
+{
+    NvmixDentry *pDentries = nullptr;
+    std::set<std::string> names;
+
+
+    readDirBlock(ctx, dir);
+    if (0 != dir.m_errno) return;
+
+    pDentries = (NvmixDentry *)dir.m_block.data();
+
+    for (unsigned slot = 0; slot < NVMIX_MAX_ENTRY_NUM; ++slot)
+    {
+        NvmixDentry *pNd = pDentries + slot;
+        std::string name(pNd->m_name, strnlen(pNd->m_name, NVMIX_MAX_NAME_LENGTH));
+        std::ostringstream where;
+        std::string problem;
+
+
+        // inode 号为 0 表示空闲槽位。根目录不会出现在任何目录项中。
+        if (0 == pNd->m_ino) continue;
+
+        where << "directory " << dir.m_ino << " slot " << slot << " (\"" << name << "\" -> " << pNd->m_ino << ")";
+
+        if (pNd->m_ino >= NVMIX_MAX_INODE_NUM)
+        {
+            problem = where.str() + " has an out-of-range inode number";
+        }
+        else if (!isAllocated(ctx, pNd->m_ino))
+        {
+            problem = where.str() + " refers to an unallocated inode";
+        }
+        else if (!isValidMode(ctx.m_inodes[pNd->m_ino].m_mode))
+        {
+            problem = where.str() + " refers to an inode with invalid mode " + std::to_string(ctx.m_inodes[pNd->m_ino].m_mode);
+        }
+        else if (name.empty())
+        {
+            problem = where.str() + " has an empty name";
+        }
+        else if (!names.insert(name).second)
+        {
+            problem = where.str() + " duplicates an earlier name";
+        }
+
+        if (!problem.empty())
+        {
+            dir.m_problems.push_back(problem);
+
+            memset(pNd, 0, sizeof(NvmixDentry));
+            dir.m_isDirty = true;
+
+            continue;
+        }
+
+        if (modeToFileType(ctx.m_inodes[pNd->m_ino].m_mode) != pNd->m_fileType)
+        {
+            dir.m_problems.push_back(where.str() + " has wrong file type " + std::to_string(pNd->m_fileType));
+
+            pNd->m_fileType = modeToFileType(ctx.m_inodes[pNd->m_ino].m_mode);
+            dir.m_isDirty = true;
+        }
+    }
+}
+
+/**
+ * @brief 并发检查一层目录。
+ * @param ctx 检查的全局状态。
+ * @param dirs 这一层的所有目录。
+ * @details 线程从共享的下标中依次领取目录，读取 SSD 的延迟可以互相重叠。
+ */
+static void checkDirLevel(const FsckContext &ctx, std::vector<FsckDir> &dirs)
+{
+    unsigned threadNum = std::min<size_t>(ctx.m_threadNum, dirs.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+
+
+    for (unsigned i = 0; i < threadNum; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (size_t j = next++; j < dirs.size(); j = next++) checkDirBlock(ctx, dirs[j]);
+        });
+    }
+
+    for (auto &thread : threads) thread.join();
+}
+
+/**
+ * @brief 将修改过的目录数据块写回 SSD。
+ * @return 成功返回 0，失败返回 -1 并设置 errno。
+ */
+static int writeDirBlock(const FsckContext &ctx, const FsckDir &dir)
+{
+    if ((ssize_t)dir.m_block.size() != pwrite(ctx.m_ssdFd, dir.m_block.data(), dir.m_block.size(), dirBlockOffset(ctx, dir.m_ino)))
+    {
+        if (0 == errno) errno = EIO;
+
+
+        return -1;
+    }
+
+
+    return 0;
+}
+
+/**
+ * @brief 检查日志区。
+ * @return 成功返回 0，操作失败返回 -1。
+ * @details 已提交的日志说明上次在 rename 中途崩溃。合法的日志按内核相同的方式重放，只读检查时记录下来叠加到读取的目录数据块上；损坏的日志无法重放，直接丢弃。
+ */
+static int checkJournal(FsckContext &ctx)
+{
+    const NvmixJournal *pNj = (const NvmixJournal *)(ctx.m_pNvm + NVMIX_JOURNAL_BLOCK_OFFSET);
+    bool isValid = true;
+
+
+    if (0 == pNj->m_commit) return 0;
+
+    isValid = pNj->m_entryNum <= NVMIX_JOURNAL_MAX_ENTRY_NUM;
+    for (unsigned i = 0; isValid && (i < pNj->m_entryNum); ++i)
+    {
+        const NvmixJournalEntry &entry = pNj->m_entries[i];
+
+        isValid = (entry.m_slot < NVMIX_MAX_ENTRY_NUM) && (entry.m_dataBlockIndex >= NVMIX_DATA_BLOCK_INDEX(0)) && (entry.m_dataBlockIndex < NVMIX_DATA_BLOCK_INDEX(NVMIX_MAX_INODE_NUM));
+    }
+
+    ctx.m_isJournalDirty = true;
+
+    if (!isValid)
+    {
+        report(ctx, "journal is committed but corrupted, discarding it");
+
+
+        return 0;
+    }
+
+    report(ctx, "journal has " + std::to_string(pNj->m_entryNum) + " committed entries, replaying it");
+
+    if (!ctx.m_isRepair)
+    {
+        ctx.m_pendingJournal.assign(pNj->m_entries, pNj->m_entries + pNj->m_entryNum);
+
+
+        return 0;
+    }
+
+    for (unsigned i = 0; i < pNj->m_entryNum; ++i)
+    {
+        const NvmixJournalEntry &entry = pNj->m_entries[i];
+        FsckDir dir;
+
+
+        dir.m_ino = entry.m_dataBlockIndex - NVMIX_FIRST_DATA_BLOCK_INDEX;
+
+        readDirBlock(ctx, dir);
+        if (0 != dir.m_errno)
+        {
+            errno = dir.m_errno;
+
+
+            return -1;
+        }
+
+        ((NvmixDentry *)dir.m_block.data())[entry.m_slot] = entry.m_dentry;
+
+        if (-1 == writeDirBlock(ctx, dir)) return -1;
+    }
+
+    // 日志区在目录数据块持久化之后才清空，与内核的顺序一致。
+    if (-1 == fsync(ctx.m_ssdFd)) return -1;
+
+
+    return 0;
+}
+
+/**
+ * @brief 检查根目录的 inode。
+ * @details 根目录丢失时整棵树都不可达，因此重建一个空的根目录 inode，原来的目录项仍然保留在数据块中。
+ */
+static void checkRoot(FsckContext &ctx)
+{
+    NvmixInode &root = ctx.m_inodes[NVMIX_ROOT_DIR_INODE_NUMBER];
+
+
+    if (isAllocated(ctx, NVMIX_ROOT_DIR_INODE_NUMBER) && S_ISDIR(root.m_mode)) return;
+
+    report(ctx, "root directory inode is missing or not a directory, recreating it");
+
+    ctx.m_superBlock.m_imap |= 1UL << NVMIX_ROOT_DIR_INODE_NUMBER;
+
+    root = NvmixInode{};
+    root.m_mode = S_IFDIR | 0755;
+    root.m_dataBlockIndex = NVMIX_DATA_BLOCK_INDEX(NVMIX_ROOT_DIR_INODE_NUMBER);
+    root.m_nlink = 2;
+}
+
+/**
+ * @brief 从根目录开始按层遍历目录树。
+ * @param ctx 检查的全局状态。
+ * @param isReachable 用于返回每个 inode 是否可达。
+ * @param linkNums 用于返回每个 inode 实际的硬链接数。
+ * @return 成功返回 0，操作失败返回 -1。
+ * @details 同一层的目录由多个线程并发检查，主线程按固定的顺序合并结果，因此输出与线程数无关。一个目录只能有一个父目录，后出现的指向同一目录的目录项被清空，这同时也消除了环。
+ */
+static int checkDirTree(FsckContext &ctx, std::vector<bool> &isReachable, std::vector<unsigned> &linkNums)
+{
+    std::vector<unsigned long> level = {NVMIX_ROOT_DIR_INODE_NUMBER};
+
+
+    isReachable.assign(NVMIX_MAX_INODE_NUM, false);
+    linkNums.assign(NVMIX_MAX_INODE_NUM, 0);
+
+    isReachable[NVMIX_ROOT_DIR_INODE_NUMBER] = true;
+    // 根目录的父目录是自己，自身的 . 和父目录中的目录项各算一个。
+    linkNums[NVMIX_ROOT_DIR_INODE_NUMBER] = 2;
+
+    while (!level.empty())
+    {
+        std::vector<FsckDir> dirs(level.size());
+        std::vector<unsigned long> nextLevel;
+
+
+        for (size_t i = 0; i < level.size(); ++i) dirs[i].m_ino = level[i];
+
+        checkDirLevel(ctx, dirs);
+
+        for (FsckDir &dir : dirs)
+        {
+            NvmixDentry *pDentries = (NvmixDentry *)dir.m_block.data();
+
+
+            ++ctx.m_dirNum;
+
+            if (0 != dir.m_errno)
+            {
+                errno = dir.m_errno;
+
+
+                return -1;
+            }
+
+            for (const std::string &problem : dir.m_problems) report(ctx, problem);
+
+            for (unsigned slot = 0; slot < NVMIX_MAX_ENTRY_NUM; ++slot)
+            {
+                unsigned long ino = pDentries[slot].m_ino;
+
+
+                if (0 == ino) continue;
+
+                if (!S_ISDIR(ctx.m_inodes[ino].m_mode))
+                {
+                    isReachable[ino] = true;
+                    ++linkNums[ino];
+
+                    continue;
+                }
+
+                if (isReachable[ino])
+                {
+                    report(ctx, "directory " + std::to_string(ino) + " is also linked from directory " + std::to_string(dir.m_ino) + " slot " + std::to_string(slot) + ", removing the extra link");
+
+                    memset(pDentries + slot, 0, sizeof(NvmixDentry));
+                    dir.m_isDirty = true;
+
+                    continue;
+                }
+
+                isReachable[ino] = true;
+                // 子目录自身的 . 和父目录中的目录项，以及子目录的 .. 给父目录增加的一个。
+                linkNums[ino] = 2;
+                ++linkNums[dir.m_ino];
+
+                nextLevel.push_back(ino);
+            }
+
+            if (ctx.m_isRepair && dir.m_isDirty && (-1 == writeDirBlock(ctx, dir))) return -1;
+        }
+
+        level.swap(nextLevel);
+    }
+
+
+    return 0;
+}
+
+/**
+ * @brief 检查一个 inode 的未写入区段。
+ * @details 区段必须属于普通文件、落在簇内、互不重叠，并且其中的数据块在子簇位图中已经置位，否则丢弃该区段：丢弃以后这些块按已写入或者空洞处理，与没有 fallocate 时崩溃的结果相同。有区段的镜像必须启用 NVMIX_FEATURE_INCOMPAT_UNWRITTEN。
+ */
+static void checkUnwritten(FsckContext &ctx, unsigned long ino)
+{
+    NvmixInode &ni = ctx.m_inodes[ino];
+    const unsigned char *pBitmap = (const unsigned char *)ctx.m_pNvm + NVMIX_INLINE_BLOCK_OFFSET + ino * NVMIX_INLINE_DATA_SIZE;
+    unsigned long blockNum = 1UL << ctx.m_superBlock.m_clusterBits;
+    std::vector<bool> isCovered(blockNum, false);
+    bool hasExtent = false;
+
+
+    for (unsigned i = 0; i < NVMIX_MAX_UNWRITTEN_NUM; ++i)
+    {
+        NvmixUnwrittenExtent &extent = ni.m_unwritten[i];
+        unsigned long end = (unsigned long)extent.m_start + extent.m_length;
+        bool isValid = S_ISREG(ni.m_mode) && (end <= blockNum);
+
+
+        if (0 == extent.m_length) continue;
+
+        for (unsigned long block = extent.m_start; isValid && (block < end); ++block)
+        {
+            isValid = !isCovered[block] && (0 != (pBitmap[block / 8] & (1 << (block % 8))));
+        }
+
+        if (!isValid)
+        {
+            report(ctx, "inode " + std::to_string(ino) + " has an invalid unwritten extent " + std::to_string(extent.m_start) + "+" + std::to_string(extent.m_length) + ", dropping it");
+
+            extent = {};
+
+            continue;
+        }
+
+        for (unsigned long block = extent.m_start; block < end; ++block) isCovered[block] = true;
+
+        hasExtent = true;
+    }
+
+    if (hasExtent && !NVMIX_HAS_FEATURE(&ctx.m_superBlock, Incompat, NVMIX_FEATURE_INCOMPAT_UNWRITTEN))
+    {
+        report(ctx, "inode " + std::to_string(ino) + " has unwritten extents but the super block lacks the unwritten feature");
+
+        ctx.m_superBlock.m_featureIncompat |= NVMIX_FEATURE_INCOMPAT_UNWRITTEN;
+    }
+}
+
+/**
+ * @brief 检查 inode 区和 m_imap。
+ * @details 已分配但不可达的 inode（例如崩溃时已删除但仍被打开的文件）被释放。可达的 inode 检查数据块号和硬链接数。
+ */
+static void checkInodes(FsckContext &ctx, const std::vector<bool> &isReachable, const std::vector<unsigned> &linkNums)
+{
+    for (unsigned long ino = 0; ino < NVMIX_MAX_INODE_NUM; ++ino)
+    {
+        NvmixInode &ni = ctx.m_inodes[ino];
+        std::string prefix = "inode " + std::to_string(ino);
+
+
+        if (!isAllocated(ctx, ino)) continue;
+
+        if (!isReachable[ino])
+        {
+            report(ctx, prefix + " is allocated but unreachable, freeing it");
+
+            ctx.m_superBlock.m_imap &= ~(1UL << ino);
+
+            continue;
+        }
+
+        // 数据块号与 inode 号一一对应，不一致时可能与其他 inode 共用数据块。
+        if (NVMIX_DATA_BLOCK_INDEX(ino) != ni.m_dataBlockIndex)
+        {
+            report(ctx, prefix + " has data block " + std::to_string(ni.m_dataBlockIndex) + " instead of " + std::to_string(NVMIX_DATA_BLOCK_INDEX(ino)));
+
+            ni.m_dataBlockIndex = NVMIX_DATA_BLOCK_INDEX(ino);
+        }
+
+        // 普通文件最多占满自己的簇。
+        if (S_ISREG(ni.m_mode) && (ni.m_size > ((unsigned long)blockSize(ctx) << ctx.m_superBlock.m_clusterBits)))
+        {
+            report(ctx, prefix + " has size " + std::to_string(ni.m_size) + " larger than its cluster, truncating it");
+
+            ni.m_size = blockSize(ctx) << ctx.m_superBlock.m_clusterBits;
+        }
+
+        if (linkNums[ino] != ni.m_nlink)
+        {
+            report(ctx, prefix + " has link count " + std::to_string(ni.m_nlink) + ", should be " + std::to_string(linkNums[ino]));
+
+            ni.m_nlink = linkNums[ino];
+        }
+
+        checkUnwritten(ctx, ino);
+    }
+}
+
+
+/**
+ * @brief 检查一个 inode 的扩展属性条目是否能完整解析。
+ * @param pEntries 条目的起始地址。
+ * @param size 头部记录的总字节数。
+ */
+static bool isValidXattrArea(const char *pEntries, unsigned int size)
+{
+    unsigned int offset = 0;
+
+
+    while (offset < size)
+    {
+        const NvmixXattrEntry *pEntry = (const NvmixXattrEntry *)(pEntries + offset);
+
+
+        if (size - offset < sizeof(NvmixXattrEntry)) return false;
+
+        if ((pEntry->m_nameIndex < NVMIX_XATTR_INDEX_USER) || (pEntry->m_nameIndex > NVMIX_XATTR_INDEX_SECURITY) || (0 == pEntry->m_nameLength)) return false;
+
+        if (NVMIX_XATTR_ENTRY_SIZE(pEntry->m_nameLength, pEntry->m_valueSize) > size - offset) return false;
+
+        offset += NVMIX_XATTR_ENTRY_SIZE(pEntry->m_nameLength, pEntry->m_valueSize);
+    }
+
+
+    return true;
+}
+
+/**
+ * @brief 检查扩展属性区和 m_xmap。
+ * @details 头部越界、与其他 inode 共用块池块或条目无法解析时清空该 inode 的扩展属性。m_xmap 按仍被引用的块重建，泄漏的块被回收。
+ */
+static void checkXattrs(FsckContext &ctx)
+{
+    unsigned long xmap = 0;
+
+
+    for (unsigned long ino = 0; ino < NVMIX_MAX_INODE_NUM; ++ino)
+    {
+        NvmixXattrHeader &header = ctx.m_xattrHeaders[ino];
+        const char *pEntries = nullptr;
+        unsigned int capacity = 0;
+        unsigned int poolIndex = 0;
+        std::string problem;
+
+
+        if (!isAllocated(ctx, ino) || ((0 == header.m_blockIndex) && (0 == header.m_size))) continue;
+
+        if (0 == header.m_blockIndex)
+        {
+            pEntries = ctx.m_pNvm + NVMIX_XATTR_INLINE_BLOCK_OFFSET + ino * NVMIX_XATTR_INLINE_SIZE + sizeof(NvmixXattrHeader);
+            capacity = NVMIX_XATTR_INLINE_SIZE - sizeof(NvmixXattrHeader);
+        }
+        else
+        {
+            poolIndex = header.m_blockIndex - 1;
+
+            if (poolIndex >= NVMIX_MAX_XATTR_BLOCK_NUM)
+            {
+                problem = "has an out-of-range block " + std::to_string(header.m_blockIndex);
+            }
+            else if (xmap & (1UL << poolIndex))
+            {
+                problem = "shares block " + std::to_string(header.m_blockIndex) + " with another inode";
+            }
+            else
+            {
+                pEntries = ctx.m_pNvm + NVMIX_XATTR_POOL_BLOCK_OFFSET + poolIndex * NVMIX_BLOCK_SIZE;
+                capacity = NVMIX_BLOCK_SIZE;
+            }
+        }
+
+        if (problem.empty() && ((header.m_size > capacity) || !isValidXattrArea(pEntries, header.m_size))) problem = "has corrupted entries";
+
+        if (!problem.empty())
+        {
+            report(ctx, "extended attributes of inode " + std::to_string(ino) + " " + problem + ", clearing them");
+
+            header = NvmixXattrHeader{};
+
+            continue;
+        }
+
+        if (0 != header.m_blockIndex) xmap |= 1UL << poolIndex;
+    }
+
+    if (xmap != ctx.m_superBlock.m_xmap)
+    {
+        std::ostringstream problem;
+
+        problem << "xattr block bitmap is 0x" << std::hex << ctx.m_superBlock.m_xmap << ", should be 0x" << xmap;
+        report(ctx, problem.str());
+
+        ctx.m_superBlock.m_xmap = xmap;
+    }
+}
+
+/**
+ * @brief 检查 m_initGroups。
+ * @details 有已分配 inode 的组一定已经初始化，否则内核的延迟初始化会清零其中的 inode。
+ */
+static void checkInitGroups(FsckContext &ctx)
+{
+    for (unsigned group = 0; group < NVMIX_INODE_GROUP_NUM; ++group)
+    {
+        unsigned long groupMask = ((1UL << NVMIX_INODE_GROUP_SIZE) - 1) << (group * NVMIX_INODE_GROUP_SIZE);
+
+
+        if ((ctx.m_superBlock.m_imap & groupMask) && !(ctx.m_superBlock.m_initGroups & (1UL << group)))
+        {
+            report(ctx, "inode group " + std::to_string(group) + " has allocated inodes but is marked uninitialized");
+
+            ctx.m_superBlock.m_initGroups |= 1UL << group;
+        }
+    }
+}
+
+/**
+ * @brief 检查特性位图与超级块记录的布局是否一致。
+ * @details 2.0 版本格式化的镜像没有特性位图，数据块大小或簇大小不是默认值时补上 NVMIX_FEATURE_INCOMPAT_CLUSTER，不支持该特性的实现才能正确地拒绝挂载。
+ */
+static void checkFeatures(FsckContext &ctx)
+{
+    bool isDefaultGeometry = (NVMIX_BLOCK_SIZE_BITS == NVMIX_SB_BLOCK_SIZE_BITS(&ctx.m_superBlock)) && (0 == ctx.m_superBlock.m_clusterBits);
+
+
+    if (!isDefaultGeometry && !NVMIX_HAS_FEATURE(&ctx.m_superBlock, Incompat, NVMIX_FEATURE_INCOMPAT_CLUSTER))
+    {
+        report(ctx, "super block has a non-default block size or cluster size but not the cluster feature");
+
+        ctx.m_superBlock.m_featureIncompat |= NVMIX_FEATURE_INCOMPAT_CLUSTER;
+    }
+}
+
+/**
+ * @brief 检查干净的镜像上保存的空闲计数。
+ * @details 挂载时直接使用干净镜像上的空闲计数，不再扫描位图，因此计数必须与修复后的位图一致。不干净的镜像上计数没有意义，挂载时会重新统计。
+ */
+static void checkMountState(FsckContext &ctx)
+{
+    unsigned int freeInodeNum = NVMIX_MAX_INODE_NUM - __builtin_popcountl(ctx.m_superBlock.m_imap);
+    unsigned int freeXattrBlockNum = NVMIX_MAX_XATTR_BLOCK_NUM - __builtin_popcountl(ctx.m_superBlock.m_xmap);
+
+
+    if (!NVMIX_HAS_FEATURE(&ctx.m_superBlock, RoCompat, NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE) || (NVMIX_STATE_CLEAN != ctx.m_superBlock.m_state)) return;
+
+    if ((freeInodeNum != ctx.m_superBlock.m_freeInodeNum) || (freeXattrBlockNum != ctx.m_superBlock.m_freeXattrBlockNum))
+    {
+        report(ctx, "super block is clean but records " + std::to_string(ctx.m_superBlock.m_freeInodeNum) + " free inodes and " + std::to_string(ctx.m_superBlock.m_freeXattrBlockNum) + " free xattr blocks, should be " +
+                        std::to_string(freeInodeNum) + " and " + std::to_string(freeXattrBlockNum));
+
+        ctx.m_superBlock.m_freeInodeNum = freeInodeNum;
+        ctx.m_superBlock.m_freeXattrBlockNum = freeXattrBlockNum;
+    }
+}
+
+/**
+ * @brief 将修复后的 NVM 元数据写回。
+ * @return 成功返回 0，失败返回 -1 并设置 errno。
+ * @details 与 mkfs 相同，超级块最后写入并持久化。
+ */
+static int writeBack(FsckContext &ctx)
+{
+    NvmixJournal *pNj = (NvmixJournal *)(ctx.m_pNvm + NVMIX_JOURNAL_BLOCK_OFFSET);
+
+
+    // 目录数据块先于 NVM 元数据持久化，NVM 上不会出现指向未写好的目录项的状态。
+    if (-1 == fsync(ctx.m_ssdFd)) return -1;
+
+    memcpy(ctx.m_pNvm + NVMIX_INODE_BLOCK_OFFSET, ctx.m_inodes, sizeof(ctx.m_inodes));
+
+    for (unsigned long ino = 0; ino < NVMIX_MAX_INODE_NUM; ++ino)
+    {
+        memcpy(ctx.m_pNvm + NVMIX_XATTR_INLINE_BLOCK_OFFSET + ino * NVMIX_XATTR_INLINE_SIZE, ctx.m_xattrHeaders + ino, sizeof(NvmixXattrHeader));
+    }
+
+    if (ctx.m_isJournalDirty)
+    {
+        pNj->m_commit = 0;
+        pNj->m_entryNum = 0;
+    }
+
+    if (-1 == msync(ctx.m_pNvm + NVMIX_INODE_BLOCK_OFFSET, NVMIX_NVM_LAYOUT_SIZE - (NVMIX_INODE_BLOCK_OFFSET), MS_SYNC)) return -1;
+
+    memcpy(ctx.m_pNvm + NVMIX_SUPER_BLOCK_OFFSET, &ctx.m_superBlock, sizeof(NvmixSuperBlock));
+
+
+    return msync(ctx.m_pNvm + NVMIX_SUPER_BLOCK_OFFSET, sizeof(NvmixSuperBlock), MS_SYNC);
+}
+
+
+int main(int argc, char *argv[])
+{
+    FsckContext ctx;
+    int opt = 0;
+
+
+    ctx.m_threadNum = std::max(1u, std::thread::hardware_concurrency());
+
+    // -n 与 -y 与 e2fsck 含义相同：只检查，或者修复所有问题。默认只检查。
+    while (-1 != (opt = getopt(argc, argv, "nyj:")))
+    {
+        if ('n' == opt)
+        {
+            ctx.m_isRepair = false;
+        }
+        else if ('y' == opt)
+        {
+            ctx.m_isRepair = true;
+        }
+        else if (('j' == opt) && (0 < atoi(optarg)))
+        {
+            ctx.m_threadNum = atoi(optarg);
+        }
+        else
+        {
+            argc = 0;
+
+            break;
+        }
+    }
+
+    if (2 != argc - optind)
+    {
+        std::cerr << "Error: Invalid arguments.\n"
+                  << "Usage: " << argv[0]
+                  << " [-n|-y] [-j <threads>] <nvm-device-path> <ssd-device-path>\n"
+                  << "  -n                    Check only, do not modify anything (default)\n"
+                  << "  -y                    Repair all problems found\n"
+                  << "  -j <threads>          Number of threads walking the directory tree\n"
+                  << "  <nvm-device-path>     Path to persistent memory device (e.g. /dev/pmem0)\n"
+                  << "  <ssd-device-path>     Path to SSD block device (e.g. /dev/sdb2)\n";
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+
+    const char *nvmDevicePath = argv[optind];
+    const char *ssdDevicePath = argv[optind + 1];
+    auto totalStart = std::chrono::steady_clock::now();
+
+    int nvmFd = open(nvmDevicePath, ctx.m_isRepair ? O_RDWR : O_RDONLY);
+    if (-1 == nvmFd)
+    {
+        perror("open");
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+    void *nvmVirtAddr = mmap(nullptr, NVMIX_NVM_LAYOUT_SIZE, ctx.m_isRepair ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, nvmFd, 0);
+    close(nvmFd);
+    if (MAP_FAILED == nvmVirtAddr)
+    {
+        perror("mmap");
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+    ctx.m_pNvm = (char *)nvmVirtAddr;
+
+    ctx.m_ssdFd = open(ssdDevicePath, ctx.m_isRepair ? O_RDWR : O_RDONLY);
+    if (-1 == ctx.m_ssdFd)
+    {
+        perror("open");
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+    // 检查基于 NVM 元数据的副本进行，最后统一写回。
+    memcpy(&ctx.m_superBlock, ctx.m_pNvm + NVMIX_SUPER_BLOCK_OFFSET, sizeof(NvmixSuperBlock));
+    memcpy(ctx.m_inodes, ctx.m_pNvm + NVMIX_INODE_BLOCK_OFFSET, sizeof(ctx.m_inodes));
+    for (unsigned long ino = 0; ino < NVMIX_MAX_INODE_NUM; ++ino)
+    {
+        memcpy(ctx.m_xattrHeaders + ino, ctx.m_pNvm + NVMIX_XATTR_INLINE_BLOCK_OFFSET + ino * NVMIX_XATTR_INLINE_SIZE, sizeof(NvmixXattrHeader));
+    }
+
+    // 魔数错误时无法判断设备上是不是本文件系统，不做任何修改。
+    if (NVMIX_MAGIC_NUMBER != ctx.m_superBlock.m_magic)
+    {
+        std::cerr << "Error: Wrong nvmix magic number, " << nvmDevicePath << " does not contain an nvmixfs file system." << std::endl;
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+    // 主版本号不同的镜像布局不兼容，按当前的布局检查只会把正常的元数据当成错误，见 NvmixVersion。
+    if (NVMIX_CONFIG_VERSION_MAJOR != ctx.m_superBlock.m_version.m_major)
+    {
+        std::cerr << "Error: File system version " << (int)ctx.m_superBlock.m_version.m_major << "." << (int)ctx.m_superBlock.m_version.m_minor << "." << (int)ctx.m_superBlock.m_version.m_alter
+                  << " has an incompatible on-disk format, fsck supports version " << NVMIX_CONFIG_VERSION_MAJOR << ".x." << std::endl;
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+    if (NVMIX_CONFIG_VERSION_MINOR != ctx.m_superBlock.m_version.m_minor)
+    {
+        std::cout << "Warning: file system version " << (int)ctx.m_superBlock.m_version.m_major << "." << (int)ctx.m_superBlock.m_version.m_minor << "." << (int)ctx.m_superBlock.m_version.m_alter
+                  << " differs from fsck version " << NVMIX_CONFIG_VERSION_MAJOR << "." << NVMIX_CONFIG_VERSION_MINOR << "." << NVMIX_CONFIG_VERSION_ALTER << std::endl;
+    }
+
+    // 中断的原地升级只能由 tune.nvmixfs 继续，此时 NVM 上的元数据一部分还是旧的布局。
+    if (NVMIX_HAS_FEATURE(&ctx.m_superBlock, Incompat, NVMIX_FEATURE_INCOMPAT_UPGRADE))
+    {
+        std::cerr << "Error: An in-place upgrade was interrupted, run tune.nvmixfs -U to finish it." << std::endl;
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+    // 不认识的特性改变了元数据的含义，按当前的规则检查会把正常的元数据当成错误。
+    if ((0 != (ctx.m_superBlock.m_featureIncompat & ~NVMIX_FEATURE_INCOMPAT_SUPP)) || (0 != (ctx.m_superBlock.m_featureRoCompat & ~NVMIX_FEATURE_RO_COMPAT_SUPP)))
+    {
+        std::cerr << std::hex << "Error: Unsupported features: incompatible 0x" << (ctx.m_superBlock.m_featureIncompat & ~NVMIX_FEATURE_INCOMPAT_SUPP)
+                  << ", read-only compatible 0x" << (ctx.m_superBlock.m_featureRoCompat & ~NVMIX_FEATURE_RO_COMPAT_SUPP) << std::dec << "." << std::endl;
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+    // 数据块大小决定了目录数据块的位置，无法猜测，不做任何修改。
+    if (!NVMIX_IS_VALID_GEOMETRY(NVMIX_SB_BLOCK_SIZE_BITS(&ctx.m_superBlock), ctx.m_superBlock.m_clusterBits))
+    {
+        std::cerr << "Error: Unsupported block size 2^" << NVMIX_SB_BLOCK_SIZE_BITS(&ctx.m_superBlock) << " with 2^" << (int)ctx.m_superBlock.m_clusterBits << " blocks per cluster." << std::endl;
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+    std::vector<bool> isReachable;
+    std::vector<unsigned> linkNums;
+
+    // 日志必须先于目录树处理，目录数据块以重放后的内容为准。
+    if (-1 == checkJournal(ctx))
+    {
+        perror("journal");
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+    checkRoot(ctx);
+
+    auto treeStart = std::chrono::steady_clock::now();
+
+    if (-1 == checkDirTree(ctx, isReachable, linkNums))
+    {
+        perror("directory tree");
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+    double treeMs = elapsedMs(treeStart);
+
+    checkInodes(ctx, isReachable, linkNums);
+    checkXattrs(ctx);
+    checkInitGroups(ctx);
+    checkFeatures(ctx);
+    checkMountState(ctx);
+
+    if (ctx.m_isRepair && (0 != ctx.m_errorNum) && (-1 == writeBack(ctx)))
+    {
+        perror("write back");
+
+
+        return NVMIX_FSCK_EXIT_ERROR;
+    }
+
+    munmap(nvmVirtAddr, NVMIX_NVM_LAYOUT_SIZE);
+    close(ctx.m_ssdFd);
+
+
+    std::cout << nvmDevicePath << ", " << ssdDevicePath << ": "
+              << __builtin_popcountl(ctx.m_superBlock.m_imap) << "/" << NVMIX_MAX_INODE_NUM << " inodes, "
+              << ctx.m_dirNum << " directories, "
+              << ctx.m_errorNum << " problems" << (ctx.m_isRepair ? " fixed" : " found") << "\n"
+              << "directory tree: " << treeMs << " ms (" << ctx.m_threadNum << " threads)\n"
+              << "total:          " << elapsedMs(totalStart) << " ms" << std::endl;
+
+
+    if (0 == ctx.m_errorNum) return NVMIX_FSCK_EXIT_OK;
+
+
+    return ctx.m_isRepair ? NVMIX_FSCK_EXIT_FIXED : NVMIX_FSCK_EXIT_UNCORRECTED;
+}
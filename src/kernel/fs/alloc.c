@@ -0,0 +1,110 @@
+/**
+ * @file alloc.c
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief NVM 位图分配器的源文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "alloc.h"
+
+#include <linux/bitops.h>
+#include <linux/bitmap.h>
+#include <linux/spinlock.h>
+#include <linux/percpu_counter.h>
+#include <asm/cacheflush.h>
+
+
+int nvmixAllocatorInit(struct NvmixAllocator *pAllocator, unsigned long *pBitmap, unsigned int bitNum, long freeNum)
+{
+    int i = 0;
+
+
+    pAllocator->m_pBitmap = pBitmap;
+    pAllocator->m_bitNum = bitNum;
+
+    for (i = 0; i < NVMIX_ALLOC_GROUP_NUM; ++i) spin_lock_init(&pAllocator->m_groupLocks[i]);
+
+
+    // 空闲数只在这里确定一次，此后随分配和释放增减。没有可信的保存值时才扫描位图。
+    if (freeNum < 0) freeNum = bitNum - bitmap_weight(pBitmap, bitNum);
+
+
+    return percpu_counter_init(&pAllocator->m_freeCounter, freeNum, GFP_KERNEL);
+}
+
+void nvmixAllocatorDestroy(struct NvmixAllocator *pAllocator)
+{
+    percpu_counter_destroy(&pAllocator->m_freeCounter);
+}
+
+long nvmixAllocatorAlloc(struct NvmixAllocator *pAllocator, unsigned long hint)
+{
+    unsigned int groupBitNum = 0;
+    unsigned int group = 0;
+    unsigned long start = 0;
+    unsigned long end = 0;
+    unsigned long index = 0;
+    int i = 0;
+
+
+    groupBitNum = pAllocator->m_bitNum / NVMIX_ALLOC_GROUP_NUM;
+
+    for (i = 0; i < NVMIX_ALLOC_GROUP_NUM; ++i)
+    {
+        group = nvmixAllocGroupProbe(hint, i);
+        start = group * groupBitNum;
+        end = start + groupBitNum;
+
+        spin_lock(&pAllocator->m_groupLocks[group]);
+
+        index = nvmixBitmapFindZero(pAllocator->m_pBitmap, start, end);
+        if (index < end) set_bit(index, pAllocator->m_pBitmap);
+
+        spin_unlock(&pAllocator->m_groupLocks[group]);
+
+        if (index < end)
+        {
+            // 刷写位所在的整个 unsigned long。
+            clflush_cache_range(pAllocator->m_pBitmap + BIT_WORD(index), sizeof(unsigned long));
+
+            percpu_counter_dec(&pAllocator->m_freeCounter);
+
+
+            return index;
+        }
+    }
+
+
+    return -ENOSPC;
+}
+
+void nvmixAllocatorFree(struct NvmixAllocator *pAllocator, unsigned long index)
+{
+    unsigned int group = 0;
+    int wasSet = 0;
+
+
+    group = index / (pAllocator->m_bitNum / NVMIX_ALLOC_GROUP_NUM);
+
+    spin_lock(&pAllocator->m_groupLocks[group]);
+
+    wasSet = test_and_clear_bit(index, pAllocator->m_pBitmap);
+
+    spin_unlock(&pAllocator->m_groupLocks[group]);
+
+    clflush_cache_range(pAllocator->m_pBitmap + BIT_WORD(index), sizeof(unsigned long));
+
+    if (wasSet) percpu_counter_inc(&pAllocator->m_freeCounter);
+}
+
+s64 nvmixAllocatorFreeCount(struct NvmixAllocator *pAllocator)
+{
+    return percpu_counter_read_positive(&pAllocator->m_freeCounter);
+}
+
+s64 nvmixAllocatorFreeCountExact(struct NvmixAllocator *pAllocator)
+{
+    return percpu_counter_sum_positive(&pAllocator->m_freeCounter);
+}
@@ -0,0 +1,100 @@
+/**
+ * @file alloc.h
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief NVM 位图分配器的头文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#ifndef _NVMIX_ALLOC_H_
+#define _NVMIX_ALLOC_H_
+
+#include "defs.h"
+#include "bitmap.h"
+
+#include <linux/spinlock.h>
+#include <linux/percpu_counter.h>
+
+
+/**
+ * @struct NvmixAllocator
+ * @brief 管理 NVM 超级块上一张分配位图的内存结构。
+ * @details 位图被等分为 NVMIX_ALLOC_GROUP_NUM 个分配组，每组一把自旋锁。查找策略见 cross-space 的 bitmap.h，与用户层引擎共用。不同目录下的创建使用不同的 hint，通常落在不同的组，互不等待。
+ * @details 各组的位可能位于同一个 unsigned long 中，因此组锁内仍使用原子的 set_bit() 和 test_and_clear_bit()。组锁只保证“查找空闲位并占用”这两步在组内不被打断。
+ */
+struct NvmixAllocator
+{
+    /**
+     * @brief NVM 上的位图。
+     */
+    unsigned long *m_pBitmap;
+
+    /**
+     * @brief 位图的有效位数。
+     */
+    unsigned int m_bitNum;
+
+    /**
+     * @brief 各分配组的自旋锁。
+     */
+    spinlock_t m_groupLocks[NVMIX_ALLOC_GROUP_NUM];
+
+    /**
+     * @brief 空闲位数量的 per-CPU 计数器。
+     * @details 分配和释放时只修改本 CPU 的计数，读取时才把各 CPU 的计数累加起来，因此频繁轮询既不扫描位图，也不会和分配路径争抢同一条缓存行。
+     */
+    struct percpu_counter m_freeCounter;
+};
+
+
+/**
+ * @brief 初始化分配器。
+ * @param pAllocator 分配器指针。
+ * @param pBitmap NVM 上的位图。
+ * @param bitNum 位图的有效位数。
+ * @param freeNum 上次正常卸载时保存的空闲位数量，为负数时根据位图统计。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int nvmixAllocatorInit(struct NvmixAllocator *pAllocator, unsigned long *pBitmap, unsigned int bitNum, long freeNum);
+
+/**
+ * @brief 销毁分配器。
+ * @param pAllocator 分配器指针。
+ * @details 对未初始化（全 0）的分配器调用是安全的。
+ */
+void nvmixAllocatorDestroy(struct NvmixAllocator *pAllocator);
+
+/**
+ * @brief 分配一个空闲位并持久化位图。
+ * @param pAllocator 分配器指针。
+ * @param hint 选择起始分配组的提示，例如父目录的 inode 号。
+ * @return 成功返回位的下标，没有空闲位返回 -ENOSPC。
+ */
+long nvmixAllocatorAlloc(struct NvmixAllocator *pAllocator, unsigned long hint);
+
+/**
+ * @brief 释放一个位并持久化位图。
+ * @param pAllocator 分配器指针。
+ * @param index 位的下标。
+ */
+void nvmixAllocatorFree(struct NvmixAllocator *pAllocator, unsigned long index);
+
+/**
+ * @brief 获得空闲位的近似数量。
+ * @param pAllocator 分配器指针。
+ * @return 空闲位的数量，不包含各个 CPU 上尚未汇总的增量。
+ * @details 只读取全局计数，不加锁也不遍历 CPU，供 statfs 和 sysfs 频繁轮询。
+ */
+s64 nvmixAllocatorFreeCount(struct NvmixAllocator *pAllocator);
+
+/**
+ * @brief 获得空闲位的精确数量。
+ * @param pAllocator 分配器指针。
+ * @return 空闲位的数量。
+ * @details 汇总所有 CPU 上的计数，开销较大，只在卸载时持久化空闲数量使用。
+ */
+s64 nvmixAllocatorFreeCountExact(struct NvmixAllocator *pAllocator);
+
+
+#endif
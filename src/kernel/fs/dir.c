@@ -10,10 +10,15 @@
 #include "dir.h"
 
 #include "defs.h"
+#include "fs.h"
 #include "inode.h"
 
 #include <linux/kernel.h>
 #include <linux/buffer_head.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/rcupdate.h>
+#include <linux/atomic.h>
 
 
 /**
@@ -28,11 +33,31 @@ struct file_operations nvmixDirFileOps = {
     // iterate 是独占式遍历，持有目录的 inode 互斥锁，支持并发访问，确保遍历期间目录结构不会被修改。
     // iterate_shared 是共享式遍历，仅持有目录的 inode 共享锁，允许其他进程并发遍历同一目录。
     // 优先使用 iterate_shared，未实现则退回 iterate。
-    // 后续考虑共享式遍历的 iterate_shared 的修改实现。
-    .iterate = nvmixReaddir,
+    // nvmixReaddir() 只读目录的数据块，修改目录项的操作都持有目录的 inode 互斥锁，因此可以使用共享式遍历，与同一目录下的 lookup 和其他 readdir 并发执行。
+    .iterate_shared = nvmixReaddir,
+    // 目录的 inode 同样可能在 m_dirtyInodes 中等待刷写，见 nvmixFsync()。
+    .fsync = nvmixFsync,
 };
 
 
+/**
+ * @brief 从目录数据块建立目录的 RCU 副本。
+ * @param pDirInode 目录的 inode 指针。
+ * @return 成功返回 0，失败返回负的错误码。
+ * @details 调用者持有目录的 i_rwsem 读锁，同一目录的多个 lookup 可能同时建立副本，只有第一个安装成功，其余的丢弃自己的副本。持有读锁时不会有写者，各自读到的数据块内容相同。
+ */
+static int nvmixDirIndexBuild(struct inode *pDirInode);
+
+/**
+ * @brief 在 RCU 副本中查找目录项。
+ * @param pIndex 目录的 RCU 副本。
+ * @param pName 目录项名字。
+ * @param pIno 找到时用于返回 inode 号。
+ * @return 找到返回槽位下标，不存在返回 -ENOENT。
+ */
+static int nvmixDirIndexSearch(const struct NvmixDirIndex *pIndex, const struct qstr *pName, unsigned long *pIno);
+
+
 int nvmixReaddir(struct file *pDirFile, struct dir_context *pCtx)
 {
     struct inode *pParentDirInode = NULL;
@@ -41,16 +66,21 @@ int nvmixReaddir(struct file *pDirFile, struct dir_context *pCtx)
     struct buffer_head *pBh = NULL;
     struct NvmixDentry *pNde = NULL;
     int res = 0;
-    int isOver = 0;
 
 
-    pParentDirInode = pDirFile->f_inode;
+    // dir_emit_dots() 依次输出 . 和 ..，分别占据位置 0 和 1。返回 false 代表用户空间缓冲区已满。
+    if (!dir_emit_dots(pDirFile, pCtx)) goto ERR;
+
+    // 已经遍历到末尾，直接返回，不需要再读取数据块。getdents 通常会以一次返回 0 的调用作为结束，这样可以省掉这次多余的磁盘读取。
+    if (pCtx->pos >= NVMIX_DIR_DOTS_NUM + NVMIX_MAX_ENTRY_NUM) goto ERR;
+
+    pParentDirInode = file_inode(pDirFile);
     pNih = NVMIX_I(pParentDirInode);
 
     pSb = pParentDirInode->i_sb;
     // sb_bread() 用于从磁盘读取指定块的数据到内存缓冲区，第一个参数是超级块指针，第二个参数是要读取的逻辑块号。返回缓冲区的头指针。
     // 目录的数据块存储的设计见 defs.h，这样能更方便理解下面的逻辑。
-    pBh = sb_bread(pSb, pNih->m_dataBlockIndex);
+    pBh = sb_bread(pSb, NVMIX_SB_DATA_BLOCK(pSb, pNih->m_dataBlockIndex));
     if (!pBh)
     {
         pr_err("nvmixfs: could not read data block.\n");
@@ -60,25 +90,25 @@ int nvmixReaddir(struct file *pDirFile, struct dir_context *pCtx)
     }
 
     // dir_context 是内核用于目录遍历操作的关键数据结构。它封装了遍历目录时的上下文信息。主要作用是在多次调用目录遍历函数（如 .iterate 或 .iterate_shared）时，保存遍历的进度和状态，确保每次调用能正确继续上一次的位置。
-    for (; pCtx->pos <= NVMIX_MAX_ENTRY_NUM; ++pCtx->pos)
+    // pCtx->pos 的编码见 dir.h 的 NVMIX_DIR_DOTS_NUM。
+    for (; pCtx->pos < NVMIX_DIR_DOTS_NUM + NVMIX_MAX_ENTRY_NUM; ++pCtx->pos)
     {
         // 当前处理的对象是目录（特殊文件），包括普通目录，. 和 .. 等。目录不存在数据信息，但与文件一样有 inode 以及 inode 的相关元数据。在磁盘块中目录的数据应额外存储目录下文件的一些信息，至少应关联文件名和 inode 号，方便接口例如 readdir()、lookup() 等使用。这也是内存中的 vfs dentry 做的事情。
         // 由此，目录的磁盘块存储的是一个 NvmixDentry 数组，记录的信息前面提到了。通过 pBh->b_data 获得 NvmixDentry 数组的头指针，然后加上偏移量即可得到每条目录项的信息。
-        // [Entry 0] -> ino = 5, name = "file1"
+        // [Entry 0] -> ino = 5, name = "file1", type = DT_REG
         // [Entry 1] -> ino = 0, name = ""（无效条目，0 == m_ino 时跳过）
-        // [Entry 2] -> ino = 7, name = "dir2"
-        pNde = (struct NvmixDentry *)(pBh->b_data) + pCtx->pos;
+        // [Entry 2] -> ino = 7, name = "dir2", type = DT_DIR
+        pNde = (struct NvmixDentry *)(pBh->b_data) + (pCtx->pos - NVMIX_DIR_DOTS_NUM);
 
         // inode 为 0 无效条目，需跳过。
         if (0 == pNde->m_ino) continue;
 
-        // dir_emit() 用于在实现文件系统的 readdir 操作时，将有效的目录项信息填充到用户空间的缓冲区。返回非 0 值标识用户空间缓冲区已满或发生错误，此时需记录当前位置并跳出循环，以方便下次读取剩余条目。
-        isOver = dir_emit(pCtx, pNde->m_name, NVMIX_MAX_NAME_LENGTH, pNde->m_ino, DT_UNKNOWN);
-        if (isOver)
+        // dir_emit() 用于在实现文件系统的 readdir 操作时，将有效的目录项信息填充到用户空间的缓冲区。返回 true 表示填充成功，可以继续；返回 false 表示用户空间缓冲区已满，此时保持 pos 不变并跳出循环，下次调用从该位置继续读取剩余条目。
+        // 名字的长度需要传实际长度。名字占满 NVMIX_MAX_NAME_LENGTH 时数组末尾没有 '\0'，因此使用 strnlen()。
+        // 文件类型直接使用目录项中记录的 m_fileType，用户态不需要再 stat 每个条目。
+        if (!dir_emit(pCtx, pNde->m_name, strnlen(pNde->m_name, NVMIX_MAX_NAME_LENGTH), pNde->m_ino, pNde->m_fileType))
         {
-            pr_info("nvmixfs: read %s from directory %s, ctx->pos: %lld\n", pNde->m_name, pDirFile->f_path.dentry->d_name.name, pCtx->pos);
-
-            ++pCtx->pos; // 当前 pos 位置读取完毕，跳到下个位置并跳出循环。
+            pr_info("nvmixfs: user buffer is full when reading directory %s, ctx->pos: %lld\n", pDirFile->f_path.dentry->d_name.name, pCtx->pos);
 
             break;
         }
@@ -86,10 +116,132 @@ int nvmixReaddir(struct file *pDirFile, struct dir_context *pCtx)
 
 
 ERR:
-    // 释放缓冲区。
+    // 释放缓冲区。brelse() 对 NULL 什么都不做。
+    brelse(pBh);
+    pBh = NULL;
+
+
+    return res;
+}
+
+int nvmixDirIndexLookup(struct inode *pDirInode, const struct qstr *pName, unsigned long *pIno)
+{
+    struct NvmixInodeHelper *pNih = NULL;
+    struct NvmixDirIndex *pIndex = NULL;
+    int res = 0;
+
+
+    pNih = NVMIX_I(pDirInode);
+
+    for (;;)
+    {
+        rcu_read_lock();
+
+        pIndex = rcu_dereference(pNih->m_pDirIndex);
+        if (pIndex) res = nvmixDirIndexSearch(pIndex, pName, pIno);
+
+        rcu_read_unlock();
+
+        if (pIndex) break;
+
+        // 副本尚未建立，或者上次更新时分配内存失败被撤下。建立会睡眠，必须在 RCU 读临界区之外进行。
+        res = nvmixDirIndexBuild(pDirInode);
+        if (0 != res) break;
+    }
+
+
+    return res;
+}
+
+void nvmixDirIndexUpdate(struct inode *pDirInode, struct buffer_head *pBh)
+{
+    struct NvmixInodeHelper *pNih = NULL;
+    struct NvmixDirIndex *pOldIndex = NULL;
+    struct NvmixDirIndex *pNewIndex = NULL;
+
+
+    pNih = NVMIX_I(pDirInode);
+
+    // 写者持有 i_rwsem 写锁，此时不会有并发的建立或更新。
+    pOldIndex = rcu_dereference_protected(pNih->m_pDirIndex, inode_is_locked(pDirInode));
+    if (!pOldIndex) return;
+
+    pNewIndex = kmalloc(sizeof(struct NvmixDirIndex), GFP_KERNEL);
+    if (pNewIndex) memcpy(pNewIndex->m_dentries, pBh->b_data, sizeof(pNewIndex->m_dentries));
+
+    // 分配失败时 pNewIndex 为 NULL，相当于撤下副本，不能让读者继续看到过时的内容。
+    rcu_assign_pointer(pNih->m_pDirIndex, pNewIndex);
+
+    // 正在 rcu_read_lock() 中读旧副本的 lookup 结束后再释放。
+    kfree_rcu(pOldIndex, m_rcu);
+}
+
+void nvmixDirIndexFree(struct inode *pDirInode)
+{
+    struct NvmixInodeHelper *pNih = NULL;
+
+
+    pNih = NVMIX_I(pDirInode);
+
+    kfree(rcu_dereference_protected(pNih->m_pDirIndex, 1));
+    RCU_INIT_POINTER(pNih->m_pDirIndex, NULL);
+}
+
+
+int nvmixDirIndexBuild(struct inode *pDirInode)
+{
+    struct NvmixInodeHelper *pNih = NULL;
+    struct NvmixDirIndex *pIndex = NULL;
+    struct buffer_head *pBh = NULL;
+    int res = 0;
+
+
+    pNih = NVMIX_I(pDirInode);
+
+    pIndex = kmalloc(sizeof(struct NvmixDirIndex), GFP_KERNEL);
+    if (!pIndex)
+    {
+        res = -ENOMEM;
+        goto ERR;
+    }
+
+    pBh = sb_bread(pDirInode->i_sb, NVMIX_SB_DATA_BLOCK(pDirInode->i_sb, pNih->m_dataBlockIndex));
+    if (!pBh)
+    {
+        pr_err("nvmixfs: could not read data block.\n");
+
+        res = -EIO;
+        goto ERR;
+    }
+
+    memcpy(pIndex->m_dentries, pBh->b_data, sizeof(pIndex->m_dentries));
+
+    // cmpxchg() 带有完整的内存屏障，读者通过 rcu_dereference() 看到指针时一定能看到已初始化的内容。
+    if (NULL == cmpxchg((struct NvmixDirIndex **)&pNih->m_pDirIndex, NULL, pIndex)) pIndex = NULL;
+
+
+ERR:
+    // 安装成功时 pIndex 已置空，否则释放自己的副本。
+    kfree(pIndex);
+    pIndex = NULL;
+
     brelse(pBh);
     pBh = NULL;
 
 
     return res;
 }
+
+int nvmixDirIndexSearch(const struct NvmixDirIndex *pIndex, const struct qstr *pName, unsigned long *pIno)
+{
+    int i = 0;
+
+
+    i = nvmixDentryFind(pIndex->m_dentries, (const char *)pName->name, pName->len);
+    if (i < 0) return -ENOENT;
+
+    *pIno = pIndex->m_dentries[i].m_ino;
+
+
+    return i;
+}
@@ -10,16 +10,74 @@
 #ifndef _NVMIX_DIR_H_
 #define _NVMIX_DIR_H_
 
+#include "defs.h"
+#include "dentry.h"
+
 #include <linux/fs.h>
+#include <linux/buffer_head.h>
+#include <linux/rcupdate.h>
+#include <linux/string.h>
+
+
+/**
+ * @brief 目录遍历时 . 和 .. 占据的位置数量。
+ * @details readdir 的位置 pCtx->pos 按如下规则编码：0 为 .，1 为 ..，从 NVMIX_DIR_DOTS_NUM 开始依次对应目录数据块中 NvmixDentry 数组的槽位下标。目录项在数据块中的槽位一旦分配就不会移动，因此该位置在并发的创建和删除下保持稳定，可以安全地用作 telldir/seekdir 的 cookie。
+ */
+#define NVMIX_DIR_DOTS_NUM 2
+
+
+/**
+ * @struct NvmixDirIndex
+ * @brief 目录数据块中 NvmixDentry 数组在内存中的 RCU 副本，挂在目录的 NvmixInodeHelper::m_pDirIndex 上。
+ * @details lookup 在 rcu_read_lock() 下查找副本，不读 SSD、不持有会睡眠的锁。修改目录项的操作持有目录的 i_rwsem 写锁，写完数据块后整体复制出一份新副本替换旧副本，旧副本经过 RCU 宽限期后释放。目录第一次被 lookup 时才从数据块建立副本。
+ */
+struct NvmixDirIndex
+{
+    /**
+     * @brief 用于延迟释放旧副本。
+     */
+    struct rcu_head m_rcu;
+
+    /**
+     * @brief 目录数据块中 NvmixDentry 数组的副本。
+     */
+    struct NvmixDentry m_dentries[NVMIX_MAX_ENTRY_NUM];
+};
 
 
 /**
- * @brief 遍历指定打开目录的目录项。注册进程打开的目录操作的 iterate 函数。
+ * @brief 遍历指定打开目录的目录项。注册进程打开的目录操作的 iterate_shared 函数。
  * @param pDirFile 进程打开的目录的 file 指针。
  * @param pCtx 存储遍历的目录项，由内核提供维护。
  * @return 是否成功。0 代表成功，非 0 代表失败。
+ * @details 一次调用会尽可能填满用户空间缓冲区，直到遍历结束或 dir_emit() 报告缓冲区已满。
  */
 int nvmixReaddir(struct file *pDirFile, struct dir_context *pCtx);
 
+/**
+ * @brief 通过目录的 RCU 副本查找目录项。
+ * @param pDirInode 目录的 inode 指针。
+ * @param pName 目录项名字。
+ * @param pIno 找到时用于返回 inode 号。
+ * @return 找到返回槽位下标，不存在返回 -ENOENT，建立副本失败返回其他负的错误码。
+ * @details 调用者至少持有目录的 i_rwsem 读锁。副本已建立时不会睡眠，也不读 SSD。
+ */
+int nvmixDirIndexLookup(struct inode *pDirInode, const struct qstr *pName, unsigned long *pIno);
+
+/**
+ * @brief 目录数据块被修改后，用数据块的最新内容替换目录的 RCU 副本。
+ * @param pDirInode 目录的 inode 指针。
+ * @param pBh 目录数据块的缓冲区头指针。
+ * @details 调用者持有目录的 i_rwsem 写锁。副本尚未建立时什么都不做；分配新副本失败时撤下旧副本，下次 lookup 重新建立。
+ */
+void nvmixDirIndexUpdate(struct inode *pDirInode, struct buffer_head *pBh);
+
+/**
+ * @brief 释放目录的 RCU 副本。
+ * @param pDirInode 目录的 inode 指针。
+ * @details 只在 inode 经过 RCU 宽限期后的 free_inode 中调用，此时不会再有读者，直接释放即可。
+ */
+void nvmixDirIndexFree(struct inode *pDirInode);
+
 
 #endif
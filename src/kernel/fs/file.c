@@ -9,7 +9,86 @@
 
 #include "file.h"
 
+#include "page.h"
+#include "fs.h"
+#include "ioctl.h"
+
 #include <linux/fs.h>
+#include <linux/pagemap.h>
+#include <linux/uio.h>
+#include <linux/backing-dev.h>
+#include <linux/falloc.h>
+#include <linux/fadvise.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+
+/**
+ * @brief 打开普通文件。注册文件操作的 open 函数。
+ * @details 设置 FMODE_NOWAIT，声明读写路径支持 IOCB_NOWAIT，RWF_NOWAIT 和 io_uring 才会先尝试在提交者的上下文中完成请求。
+ * 文件的数据在 SSD 上连续存放，把本文件的最大预读窗口放大到设备单次 I/O 的上限，但不超过簇的大小。窗口仍由内核按需预读的逻辑根据顺序访问逐步增长，随机访问不受影响。
+ * 同时分配本次打开的 NvmixFileInfo，存放在 private_data 中，由 nvmixFileRelease() 释放。
+ */
+static int nvmixFileOpen(struct inode *pInode, struct file *pFile);
+
+/**
+ * @brief 关闭普通文件。注册文件操作的 release 函数。
+ * @details 最后一个引用这个打开的文件的描述符关闭时调用，释放 nvmixFileOpen() 分配的 NvmixFileInfo。
+ */
+static int nvmixFileRelease(struct inode *pInode, struct file *pFile);
+
+/**
+ * @brief 读取普通文件。注册文件操作的 read_iter 函数。
+ * @details 缓冲读先交给 nvmixFileStrideAhead() 识别间隔访问，其余同 generic_file_read_iter()。直接 I/O 不经过 page cache，不参与识别。
+ */
+static ssize_t nvmixFileReadIter(struct kiocb *pIocb, struct iov_iter *pTo);
+
+/**
+ * @brief 识别固定间隔的读取，并提前预读之后的记录。
+ * @param pFile 打开的文件。
+ * @param pos 本次读取的起始位置。
+ * @param count 本次读取的长度。
+ * @param isNowait 本次读取是否带有 IOCB_NOWAIT。
+ * @details 相邻两次读取的间隔连续 NVMIX_STRIDE_MIN_NUM 次相同、并且间隔大于上一次读取的长度时，认为是间隔访问，对之后 NVMIX_STRIDE_AHEAD_NUM 条记录调用 generic_fadvise() 的 POSIX_FADV_WILLNEED。顺序访问由内核的按需预读处理。
+ * IOCB_NOWAIT 的读取不能在提交者的上下文中分配页和提交 bio，只更新识别的状态，不预读；它失败以后的重试读取同一位置，不改变识别的状态，由重试发起预读。
+ */
+static void nvmixFileStrideAhead(struct file *pFile, loff_t pos, size_t count, bool isNowait);
+
+/**
+ * @brief 普通文件的 ioctl。注册文件操作的 unlocked_ioctl 和 compat_ioctl 函数。
+ * @details 目前只支持 NVMIX_IOC_GET_READAHEAD_STATS，读取本次打开的预读统计，见 ioctl.h。
+ */
+static long nvmixFileIoctl(struct file *pFile, unsigned int cmd, unsigned long arg);
+
+/**
+ * @brief 写入普通文件。注册文件操作的 write_iter 函数。
+ * @details 同 generic_file_write_iter()，额外支持直接 I/O 的 IOCB_NOWAIT：拿不到 inode 锁时返回 -EAGAIN，其余部分由 generic_file_direct_write() 和 nvmixDirectIO() 处理。缓冲写即使命中 page cache 也可能睡眠，IOCB_NOWAIT 时总是返回 -EAGAIN，io_uring 会转交给 io-wq 重试。
+ */
+static ssize_t nvmixFileWriteIter(struct kiocb *pIocb, struct iov_iter *pFrom);
+
+/**
+ * @brief 移动文件的读写位置。注册文件操作的 llseek 函数。
+ * @details SEEK_DATA 和 SEEK_HOLE 由 nvmixSeekData() 根据 NVM 上的元数据回答，其余同 generic_file_llseek()。
+ */
+static loff_t nvmixFileLlseek(struct file *pFile, loff_t offset, int whence);
+
+/**
+ * @brief 在文件之间复制数据。注册文件操作的 copy_file_range 函数。
+ * @details 同一个文件系统内、按数据块对齐的部分由 nvmixCopyBlocks() 直接在 SSD 上复制，空洞和未写入的块只复制 NVM 上的元数据。其余情况，以及不足一个块的结尾，交给 generic_copy_file_range() 经过 page cache 复制。返回值可以小于 len，调用者会继续复制剩下的部分。
+ */
+static ssize_t nvmixFileCopyRange(struct file *pFileIn, loff_t posIn, struct file *pFileOut, loff_t posOut, size_t len, unsigned int flags);
+
+/**
+ * @brief 预分配、打洞或者清零文件的一段范围。注册文件操作的 fallocate 函数。
+ * @details 支持 FALLOC_FL_KEEP_SIZE、FALLOC_FL_PUNCH_HOLE、FALLOC_FL_ZERO_RANGE 和 FALLOC_FL_COLLAPSE_RANGE。预分配和清零只把整块记录为未写入，不读写 SSD；首尾不足一个块的部分通过 page cache 清零。
+ */
+static long nvmixFallocate(struct file *pFile, int mode, loff_t offset, loff_t len);
+
+/**
+ * @brief FALLOC_FL_COLLAPSE_RANGE 的实现，删除 [offset, offset + len)，之后的数据前移。
+ * @details 同 ext4，offset 和 len 必须按数据块对齐，并且范围不能到达文件尾。
+ */
+static long nvmixFallocateCollapse(struct inode *pInode, loff_t offset, loff_t len);
 
 
 /**
@@ -17,13 +96,345 @@
  */
 struct file_operations nvmixFileFileOps = {
     .owner = THIS_MODULE,
-    .open = generic_file_open,
+    .open = nvmixFileOpen,
+    .release = nvmixFileRelease,
     // 新内核优先使用 read_iter 和 write_iter 替代 read 和 write，支持异步并且更高效。
-    .read_iter = generic_file_read_iter,
-    .write_iter = generic_file_write_iter,
+    // generic_file_read_iter() 本身支持 IOCB_NOWAIT：命中 page cache 时直接返回，未命中时返回 -EAGAIN，不会同步读取 SSD。
+    .read_iter = nvmixFileReadIter,
+    .write_iter = nvmixFileWriteIter,
     .mmap = generic_file_mmap,
-    .llseek = generic_file_llseek,
+    .llseek = nvmixFileLlseek,
     // fsync 的作用是将文件在内存中的修改（包括数据和元数据）强制同步到物理存储设备（如磁盘），确保数据持久化。
     // 另一个命名相似的接口 fasync，用于管理文件的异步通知机制，二者完全不同。本文件系统暂不考虑。
-    .fsync = generic_file_fsync,
+    // 除了 generic_file_fsync() 的工作，还要刷写可能仍在等待批量刷写的 inode，见 nvmixFsync()。
+    .fsync = nvmixFsync,
+    .fallocate = nvmixFallocate,
+    .copy_file_range = nvmixFileCopyRange,
+    // 不注册 remap_file_range：文件的第 i 个块固定是簇内的第 i 个数据块，两个文件无法共享数据块。FICLONE、FICLONERANGE 和 FIDEDUPERANGE 由 vfs 返回 -EOPNOTSUPP，cp --reflink=auto 会退回 copy_file_range。
+    .unlocked_ioctl = nvmixFileIoctl,
+    // NvmixReadaheadStats 在 32 位和 64 位的用户层布局相同，参数只是一个指针，不需要转换。
+    .compat_ioctl = nvmixFileIoctl,
 };
+
+
+int nvmixFileOpen(struct inode *pInode, struct file *pFile)
+{
+    struct backing_dev_info *pBdi = inode_to_bdi(pInode);
+    unsigned long clusterPages = (unsigned long)(pInode->i_sb->s_maxbytes >> PAGE_SHIFT);
+    int res = 0;
+
+
+    res = generic_file_open(pInode, pFile);
+    if (0 != res) return res;
+
+    pFile->private_data = kzalloc(sizeof(struct NvmixFileInfo), GFP_KERNEL);
+    if (!pFile->private_data) return -ENOMEM;
+
+    pFile->f_ra.ra_pages = min(clusterPages, max(pFile->f_ra.ra_pages, (unsigned long)pBdi->io_pages));
+
+    pFile->f_mode |= FMODE_NOWAIT;
+
+
+    return 0;
+}
+
+int nvmixFileRelease(struct inode *pInode, struct file *pFile)
+{
+    kfree(pFile->private_data);
+    pFile->private_data = NULL;
+
+
+    return 0;
+}
+
+ssize_t nvmixFileReadIter(struct kiocb *pIocb, struct iov_iter *pTo)
+{
+    size_t count = iov_iter_count(pTo);
+
+
+    if (!(pIocb->ki_flags & IOCB_DIRECT) && (0 != count)) nvmixFileStrideAhead(pIocb->ki_filp, pIocb->ki_pos, count, pIocb->ki_flags & IOCB_NOWAIT);
+
+
+    return generic_file_read_iter(pIocb, pTo);
+}
+
+void nvmixFileStrideAhead(struct file *pFile, loff_t pos, size_t count, bool isNowait)
+{
+    struct NvmixFileInfo *pInfo = NVMIX_FILE_INFO(pFile);
+    loff_t size = i_size_read(file_inode(pFile));
+    loff_t stride = pos - pInfo->m_lastPos;
+    loff_t ahead = 0;
+    long pageNum = 0;
+
+
+    // 文件尾之后的读取什么也不做，同时保证下面的位置计算不会溢出：位置都小于文件大小，而文件大小不超过一个簇。
+    if (pos >= size) return;
+
+    if (0 != stride)
+    {
+        if ((stride > (loff_t)pInfo->m_lastCount) && (stride == pInfo->m_stride))
+        {
+            if (pInfo->m_strideNum < NVMIX_STRIDE_MIN_NUM) ++pInfo->m_strideNum;
+        }
+        else
+        {
+            pInfo->m_stride = stride;
+            pInfo->m_strideNum = 1;
+            pInfo->m_strideAheadPos = pos;
+        }
+
+        pInfo->m_lastPos = pos;
+        pInfo->m_lastCount = count;
+    }
+
+    if (isNowait || (pInfo->m_strideNum < NVMIX_STRIDE_MIN_NUM)) return;
+
+    // 保持 NVMIX_STRIDE_AHEAD_NUM 条记录的提前量，每次只预读新进入窗口的记录，已经在 page cache 中的页不会再次读取。
+    for (ahead = max(pInfo->m_strideAheadPos, pos) + pInfo->m_stride; (ahead <= pos + NVMIX_STRIDE_AHEAD_NUM * pInfo->m_stride) && (ahead < size); ahead += pInfo->m_stride)
+    {
+        generic_fadvise(pFile, ahead, count, POSIX_FADV_WILLNEED);
+
+        pageNum += ((ahead + count - 1) >> PAGE_SHIFT) - (ahead >> PAGE_SHIFT) + 1;
+        pInfo->m_strideAheadPos = ahead;
+    }
+
+    atomic64_add(pageNum, &pInfo->m_strideReadaheadNum);
+}
+
+long nvmixFileIoctl(struct file *pFile, unsigned int cmd, unsigned long arg)
+{
+    struct NvmixFileInfo *pInfo = NVMIX_FILE_INFO(pFile);
+    struct NvmixReadaheadStats stats = {0};
+
+
+    if (NVMIX_IOC_GET_READAHEAD_STATS != cmd) return -ENOTTY;
+
+    stats.m_readaheadPageNum = atomic64_read(&pInfo->m_readaheadPageNum);
+    stats.m_readaheadHolePageNum = atomic64_read(&pInfo->m_readaheadHolePageNum);
+    stats.m_readpageNum = atomic64_read(&pInfo->m_readpageNum);
+    stats.m_strideReadaheadNum = atomic64_read(&pInfo->m_strideReadaheadNum);
+
+    if (copy_to_user((void __user *)arg, &stats, sizeof(stats))) return -EFAULT;
+
+
+    return 0;
+}
+
+ssize_t nvmixFileWriteIter(struct kiocb *pIocb, struct iov_iter *pFrom)
+{
+    struct inode *pInode = file_inode(pIocb->ki_filp);
+    ssize_t res = 0;
+
+
+    // 缓冲写可能在 lock_page()、wait_for_stable_page()、balance_dirty_pages_ratelimited() 和 file_update_time() 中睡眠，同 5.4 的其他文件系统一样不在提交者的上下文中执行。generic_write_checks() 对它返回 -EINVAL，io_uring 不会重试，因此提前返回 -EAGAIN。
+    if ((pIocb->ki_flags & IOCB_NOWAIT) && !(pIocb->ki_flags & IOCB_DIRECT)) return -EAGAIN;
+
+    if (pIocb->ki_flags & IOCB_NOWAIT)
+    {
+        if (!inode_trylock(pInode)) return -EAGAIN;
+    }
+    else
+    {
+        inode_lock(pInode);
+    }
+
+    res = generic_write_checks(pIocb, pFrom);
+    if (res > 0) res = __generic_file_write_iter(pIocb, pFrom);
+
+    inode_unlock(pInode);
+
+    if (res > 0) res = generic_write_sync(pIocb, res);
+
+
+    return res;
+}
+
+loff_t nvmixFileLlseek(struct file *pFile, loff_t offset, int whence)
+{
+    struct inode *pInode = file_inode(pFile);
+    loff_t res = 0;
+
+
+    if ((SEEK_DATA != whence) && (SEEK_HOLE != whence)) return generic_file_llseek(pFile, offset, whence);
+
+    // 没有 page_mkwrite，mmap 写入的页回写时才映射数据块，先回写才能在元数据中看到这些数据。
+    if (mapping_mapped(pFile->f_mapping))
+    {
+        res = filemap_write_and_wait(pFile->f_mapping);
+        if (0 != res) return res;
+    }
+
+    inode_lock_shared(pInode);
+    res = nvmixSeekData(pInode, offset, SEEK_DATA == whence);
+    inode_unlock_shared(pInode);
+
+    if (res < 0) return res;
+
+
+    return vfs_setpos(pFile, res, pInode->i_sb->s_maxbytes);
+}
+
+ssize_t nvmixFileCopyRange(struct file *pFileIn, loff_t posIn, struct file *pFileOut, loff_t posOut, size_t len, unsigned int flags)
+{
+    struct inode *pInodeIn = file_inode(pFileIn);
+    struct inode *pInodeOut = file_inode(pFileOut);
+    unsigned bits = pInodeIn->i_sb->s_blocksize_bits;
+    loff_t mask = pInodeIn->i_sb->s_blocksize - 1;
+    loff_t count = 0;
+    ssize_t res = 0;
+
+
+    // vfs 已经检查过范围，并把 len 截断到源文件尾。只有整块可以直接复制。
+    count = len & ~mask;
+    if ((pInodeIn->i_sb != pInodeOut->i_sb) || ((posIn | posOut) & mask) || (0 == count)) return generic_copy_file_range(pFileIn, posIn, pFileOut, posOut, len, flags);
+
+    lock_two_nondirectories(pInodeIn, pInodeOut);
+
+    inode_dio_wait(pInodeIn);
+    inode_dio_wait(pInodeOut);
+
+    res = file_remove_privs(pFileOut);
+    if (0 != res) goto ERR;
+
+    res = filemap_write_and_wait_range(pInodeIn->i_mapping, posIn, posIn + count - 1);
+    if (0 != res) goto ERR;
+
+    // 目标范围所在的页整页丢弃，否则数据块小于页时，页中其余部分的 page cache 会盖住 SSD 上的新数据。
+    res = filemap_write_and_wait_range(pInodeOut->i_mapping, round_down(posOut, PAGE_SIZE), round_up(posOut + count, PAGE_SIZE) - 1);
+    if (0 != res) goto ERR;
+
+    truncate_pagecache_range(pInodeOut, round_down(posOut, PAGE_SIZE), round_up(posOut + count, PAGE_SIZE) - 1);
+
+    res = nvmixCopyBlocks(pInodeOut, posOut >> bits, pInodeIn, posIn >> bits, count >> bits);
+    if (0 != res) goto ERR;
+
+    if (posOut + count > i_size_read(pInodeOut)) i_size_write(pInodeOut, posOut + count);
+
+    pInodeOut->i_mtime = pInodeOut->i_ctime = current_time(pInodeOut);
+    mark_inode_dirty(pInodeOut);
+
+    res = count;
+
+
+ERR:
+    unlock_two_nondirectories(pInodeIn, pInodeOut);
+
+
+    return res;
+}
+
+long nvmixFallocate(struct file *pFile, int mode, loff_t offset, loff_t len)
+{
+    struct inode *pInode = file_inode(pFile);
+    unsigned bits = pInode->i_sb->s_blocksize_bits;
+    loff_t mask = pInode->i_sb->s_blocksize - 1;
+    loff_t end = offset + len;
+    loff_t first = (offset + mask) & ~mask;
+    loff_t last = end & ~mask;
+    loff_t oldSize = 0;
+    long res = 0;
+
+
+    if (mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE | FALLOC_FL_ZERO_RANGE | FALLOC_FL_COLLAPSE_RANGE)) return -EOPNOTSUPP;
+
+    inode_lock(pInode);
+
+    // 同 nvmixSetattr()，修改映射之前等待进行中的直接 I/O。
+    inode_dio_wait(pInode);
+
+    if (mode & FALLOC_FL_COLLAPSE_RANGE)
+    {
+        res = nvmixFallocateCollapse(pInode, offset, len);
+        goto ERR;
+    }
+
+    oldSize = i_size_read(pInode);
+
+    if (!(mode & FALLOC_FL_KEEP_SIZE) && (end > oldSize))
+    {
+        res = inode_newsize_ok(pInode, end);
+        if (0 != res) goto ERR;
+    }
+
+    if (mode & (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_ZERO_RANGE))
+    {
+        res = filemap_write_and_wait_range(pInode->i_mapping, offset, end - 1);
+        if (0 != res) goto ERR;
+
+        // 范围在一个块以内时 first 大于 last。
+        if (first > last)
+        {
+            res = nvmixZeroRange(pInode, offset, end);
+        }
+        else
+        {
+            res = nvmixZeroRange(pInode, offset, first);
+            if (0 == res) res = nvmixZeroRange(pInode, last, end);
+        }
+        if (0 != res) goto ERR;
+
+        if (first < last)
+        {
+            truncate_pagecache_range(pInode, first, last - 1);
+
+            if (mode & FALLOC_FL_PUNCH_HOLE)
+            {
+                res = nvmixPunchBlocks(pInode, first >> bits, last >> bits);
+            }
+            else
+            {
+                res = nvmixPreallocBlocks(pInode, first >> bits, last >> bits, true);
+            }
+        }
+    }
+    else
+    {
+        res = nvmixPreallocBlocks(pInode, offset >> bits, (end + mask) >> bits, false);
+    }
+    if (0 != res) goto ERR;
+
+    if (!(mode & FALLOC_FL_KEEP_SIZE) && (end > oldSize))
+    {
+        i_size_write(pInode, end);
+        pagecache_isize_extended(pInode, oldSize, end);
+    }
+
+    pInode->i_mtime = pInode->i_ctime = current_time(pInode);
+    mark_inode_dirty(pInode);
+
+
+ERR:
+    inode_unlock(pInode);
+
+
+    return res;
+}
+
+long nvmixFallocateCollapse(struct inode *pInode, loff_t offset, loff_t len)
+{
+    unsigned bits = pInode->i_sb->s_blocksize_bits;
+    loff_t size = i_size_read(pInode);
+    long res = 0;
+
+
+    if ((offset | len) & (pInode->i_sb->s_blocksize - 1)) return -EINVAL;
+
+    if (offset + len >= size) return -EINVAL;
+
+    res = filemap_write_and_wait_range(pInode->i_mapping, offset, LLONG_MAX);
+    if (0 != res) return res;
+
+    // 从 offset 所在页的开头丢弃，部分丢弃的页会在 page cache 中被清零，而这里需要从 SSD 重新读到前移后的数据。
+    truncate_pagecache(pInode, round_down(offset, PAGE_SIZE));
+
+    res = nvmixCollapseBlocks(pInode, offset >> bits, (offset + len) >> bits);
+    if (0 != res) return res;
+
+    i_size_write(pInode, size - len);
+
+    pInode->i_mtime = pInode->i_ctime = current_time(pInode);
+    mark_inode_dirty(pInode);
+
+
+    return 0;
+}
@@ -10,5 +10,80 @@
 #ifndef _NVMIX_FILE_H_
 #define _NVMIX_FILE_H_
 
+#include <linux/fs.h>
+#include <linux/atomic.h>
+
+
+/**
+ * @brief 相邻两次读取的间隔连续相同多少次以后才开始提前预读。
+ */
+#define NVMIX_STRIDE_MIN_NUM 2
+
+/**
+ * @brief 识别出间隔访问以后，提前预读之后的多少条记录。
+ */
+#define NVMIX_STRIDE_AHEAD_NUM 4
+
+
+/**
+ * @struct NvmixFileInfo
+ * @brief 一个打开的普通文件的私有信息，存放在 file->private_data 中。
+ * @details 内核的按需预读只识别顺序访问，以固定间隔读取等长记录的访问每次都会落在预读窗口之外。这里记录最近一次读取的位置，识别出固定间隔以后提前预读之后的几条记录。间隔检测的字段只在 read_iter 中修改，多个线程共用一个打开的文件时不加锁，最坏只是少预读或多预读几条记录；统计字段会在 readpage 和 readpages 中并发修改，因此是原子的。
+ */
+struct NvmixFileInfo
+{
+    /**
+     * @brief 最近一次读取的起始位置。
+     */
+    loff_t m_lastPos;
+
+    /**
+     * @brief 最近一次读取的长度。
+     */
+    size_t m_lastCount;
+
+    /**
+     * @brief 最近两次读取起始位置的间隔。
+     */
+    loff_t m_stride;
+
+    /**
+     * @brief 相邻两次读取的间隔连续等于 m_stride 的次数。
+     */
+    unsigned int m_strideNum;
+
+    /**
+     * @brief 已经提前预读到的最后一条记录的起始位置，下一次只预读它之后新进入窗口的记录。
+     */
+    loff_t m_strideAheadPos;
+
+    /**
+     * @brief 预读读入的页数，见 NvmixReadaheadStats。
+     */
+    atomic64_t m_readaheadPageNum;
+
+    /**
+     * @brief 预读的页中整页都是空洞的页数，见 NvmixReadaheadStats。
+     */
+    atomic64_t m_readaheadHolePageNum;
+
+    /**
+     * @brief 预读没有覆盖、单独同步读取的页数，见 NvmixReadaheadStats。
+     */
+    atomic64_t m_readpageNum;
+
+    /**
+     * @brief 间隔访问提前预读的页数，见 NvmixReadaheadStats。
+     */
+    atomic64_t m_strideReadaheadNum;
+};
+
+
+/**
+ * @brief 通过打开的文件获得其 NvmixFileInfo 结构指针。
+ * @details 读取页的路径不一定有打开的文件，例如 read_cache_page() 传入 NULL，此时返回 NULL。
+ */
+#define NVMIX_FILE_INFO(pFile) ((pFile) ? (struct NvmixFileInfo *)((pFile)->private_data) : NULL)
+
 
 #endif
@@ -10,15 +10,26 @@
 #include "fs.h"
 
 #include "inode.h"
+#include "journal.h"
+#include "dir.h"
+#include "xattr.h"
+#include "sysfs.h"
+#include "lazyinit.h"
+#include "page.h"
 #include "defs.h"
 #include "util.h"
+#include "config.h"
 
 #include <linux/fs.h>
 #include <linux/export.h>
 #include <linux/buffer_head.h>
 #include <linux/slab.h>
 #include <linux/ktime.h>
+#include <linux/kdev_t.h>
+#include <linux/statfs.h>
+#include <linux/bitops.h>
 #include <asm/cacheflush.h>
+#include <asm/special_insns.h>
 
 
 /**
@@ -37,25 +48,53 @@ struct file_system_type nvmixFileSystemType = {
  * @brief 超级块操作的注册接口。
  */
 struct super_operations nvmixSuperOps = {
-    .statfs = simple_statfs,
+    .statfs = nvmixStatfs,
+    .remount_fs = nvmixRemount,
     .put_super = nvmixPutSuper,
     .alloc_inode = nvmixAllocInode,
-    .destroy_inode = nvmixDestroyInode,
+    .free_inode = nvmixFreeInode,
     .write_inode = nvmixWriteInode,
+    .sync_fs = nvmixSyncFs,
+    .evict_inode = nvmixEvictInode,
 };
 
 
 extern void *nvmixNvmVirtAddr;
 
-extern struct address_space_operations nvmixAops;
 
-extern struct file_operations nvmixFileFileOps;
+/**
+ * @brief 检查超级块的特性位图是否允许以给定的方式挂载。
+ * @param pNsb NvmixSuperBlock 结构指针。
+ * @param isReadOnly 是否以只读方式挂载。
+ * @return 允许返回 0；有不认识的不兼容特性返回 -EINVAL；以读写方式挂载时有不认识的只读兼容特性返回 -EROFS。
+ */
+static int nvmixCheckFeatures(struct NvmixSuperBlock *pNsb, bool isReadOnly);
 
-extern struct file_operations nvmixDirFileOps;
+/**
+ * @brief 以读写方式挂载时清除干净标记，此后崩溃留下的镜像不会被当成干净的。
+ * @param pNsb NvmixSuperBlock 结构指针。
+ * @param isClean 镜像上次是否正常卸载。不是时以 m_imap 为准补上 m_initGroups 中缺少的标记。
+ */
+static void nvmixMarkDirty(struct NvmixSuperBlock *pNsb, bool isClean);
 
-extern struct inode_operations nvmixFileInodeOps;
+/**
+ * @brief 保存空闲计数并标记为干净，下次挂载不再扫描位图。卸载和重新挂载为只读时调用，此时位图不会再变化。
+ * @param pNsbh NvmixNvmHelper 结构指针。
+ */
+static void nvmixMarkClean(struct NvmixNvmHelper *pNsbh);
 
-extern struct inode_operations nvmixDirInodeOps;
+/**
+ * @brief 刷写 mask 中的 inode 在 NVM 上的缓存行。
+ * @param pNsbh NvmixNvmHelper 结构指针。
+ * @param mask 要刷写的 inode，每一位代表一个 inode 号。
+ * @details 每个 NvmixInode 正好一个缓存行。clflushopt 之间互不排序，最后的一个 mb() 保证所有刷写完成，不像 clflush_cache_range() 那样每次调用都有一对栅栏。
+ */
+static void nvmixFlushInodes(struct NvmixNvmHelper *pNsbh, unsigned long mask);
+
+/**
+ * @brief m_inodeFlushWork 的处理函数，刷写所有等待中的 inode。
+ */
+static void nvmixInodeFlushWork(struct work_struct *pWork);
 
 
 struct dentry *nvmixMount(struct file_system_type *pFileSystemType, int flags, const char *pDevName, void *pData)
@@ -99,6 +138,8 @@ int nvmixFillSuper(struct super_block *pSb, void *pData, int silent)
     struct NvmixSuperBlock *pNsb = NULL;
     struct inode *pRootDirInode = NULL;
     struct dentry *pRootDirDentry = NULL;
+    unsigned int blockSizeBits = 0;
+    bool isClean = false;
     int res = 0;
     u64 startTime = 0, endTime = 0, duration = 0;
 
@@ -119,19 +160,17 @@ int nvmixFillSuper(struct super_block *pSb, void *pData, int silent)
     // 将辅助结构 NvmixNvmHelper 设置为 vfs super_block 的私有数据。
     pSb->s_fs_info = pNsbh;
 
-    // 设置文件系统的逻辑块大小，这是初始化超级块的第一步，后续的操作都依赖于正确的文件系统逻辑块大小（这里是 4 KIB）。
-    // 返回 0 表示设置失败。
-    if (0 == sb_set_blocksize(pSb, NVMIX_BLOCK_SIZE))
-    {
-        pr_err("nvmixfs: bad block size when running function sb_set_blocksize().\n");
-
-        res = -EINVAL;
-        goto ERR;
-    }
-
     // 将超级块缓冲区指针传递给 NvmixNvmHelper 存储起来，后续的很多操作都需要更新磁盘超级块的元数据内容。
     pNsbh->m_superBlockVirtAddr = (void *)((char *)nvmixNvmVirtAddr + NVMIX_SUPER_BLOCK_OFFSET);
     pNsbh->m_inodeVirtAddr = (void *)((char *)nvmixNvmVirtAddr + NVMIX_INODE_BLOCK_OFFSET);
+    pNsbh->m_journalVirtAddr = (void *)((char *)nvmixNvmVirtAddr + NVMIX_JOURNAL_BLOCK_OFFSET);
+    pNsbh->m_inlineVirtAddr = (void *)((char *)nvmixNvmVirtAddr + NVMIX_INLINE_BLOCK_OFFSET);
+    pNsbh->m_xattrInlineVirtAddr = (void *)((char *)nvmixNvmVirtAddr + NVMIX_XATTR_INLINE_BLOCK_OFFSET);
+    pNsbh->m_xattrPoolVirtAddr = (void *)((char *)nvmixNvmVirtAddr + NVMIX_XATTR_POOL_BLOCK_OFFSET);
+
+    mutex_init(&pNsbh->m_journalLock);
+    mutex_init(&pNsbh->m_lazyInitLock);
+    INIT_DELAYED_WORK(&pNsbh->m_inodeFlushWork, nvmixInodeFlushWork);
 
     // 这个地方不用 clflush_cache_range，因为只涉及到读取操作。
     pNsb = (struct NvmixSuperBlock *)(pNsbh->m_superBlockVirtAddr);
@@ -145,9 +184,74 @@ int nvmixFillSuper(struct super_block *pSb, void *pData, int silent)
         goto ERR;
     }
 
+    // 主版本号不同的镜像布局不兼容，例如 1.x 的 inode 只有 20 字节，见 NvmixVersion。次版本号不同时布局兼容。
+    if (NVMIX_CONFIG_VERSION_MAJOR != pNsb->m_version.m_major)
+    {
+        pr_err("nvmixfs: on-disk format %u.%u.%u is incompatible with module version %s, please reformat.\n", pNsb->m_version.m_major, pNsb->m_version.m_minor, pNsb->m_version.m_alter, NVMIX_CONFIG_VERSION);
+
+        res = -EINVAL;
+        goto ERR;
+    }
+
+    if (NVMIX_CONFIG_VERSION_MINOR != pNsb->m_version.m_minor) pr_info("nvmixfs: on-disk format %u.%u.%u differs from module version %s.\n", pNsb->m_version.m_major, pNsb->m_version.m_minor, pNsb->m_version.m_alter, NVMIX_CONFIG_VERSION);
+
+    res = nvmixCheckFeatures(pNsb, sb_rdonly(pSb));
+    if (0 != res) goto ERR;
+
+    // 上次正常卸载时保存的空闲计数可信，跳过下面对位图的扫描。
+    isClean = NVMIX_HAS_FEATURE(pNsb, RoCompat, NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE) && (NVMIX_STATE_CLEAN == pNsb->m_state) && (pNsb->m_freeInodeNum <= NVMIX_MAX_INODE_NUM) && (pNsb->m_freeXattrBlockNum <= NVMIX_MAX_XATTR_BLOCK_NUM);
+
+    // 设置文件系统的逻辑块大小，后续读写 SSD 的操作都依赖于正确的逻辑块大小。块大小在格式化时确定，记录在超级块中，旧镜像是 4 KiB。
+    // 返回 0 表示设置失败，例如块小于设备的逻辑块。
+    blockSizeBits = NVMIX_SB_BLOCK_SIZE_BITS(pNsb);
+    if (!NVMIX_IS_VALID_GEOMETRY(blockSizeBits, pNsb->m_clusterBits) || (0 == sb_set_blocksize(pSb, 1 << blockSizeBits)))
+    {
+        pr_err("nvmixfs: bad block size %u with %u blocks per cluster.\n", 1U << blockSizeBits, 1U << pNsb->m_clusterBits);
+
+        res = -EINVAL;
+        goto ERR;
+    }
+
+    // 每个普通文件的数据最多占满自己的簇。
+    pSb->s_maxbytes = (loff_t)pSb->s_blocksize << pNsb->m_clusterBits;
+
+    // 重放上次崩溃时已提交但未落盘的目录项更新，必须在读取任何目录之前完成。
+    res = nvmixJournalRecover(pSb);
+    if (0 != res)
+    {
+        pr_err("nvmixfs: failed to recover journal.\n");
+
+        goto ERR;
+    }
+
+    // 每个 inode 独占一个缓存行，持久化一个 inode 不会刷写相邻的 inode。
+    BUILD_BUG_ON(sizeof(struct NvmixInode) != NVMIX_CACHE_LINE_SIZE);
+    BUILD_BUG_ON(0 != NVMIX_INODE_BLOCK_OFFSET % NVMIX_CACHE_LINE_SIZE);
+
+    // 位图按分配组等分。
+    BUILD_BUG_ON(0 != NVMIX_MAX_INODE_NUM % NVMIX_ALLOC_GROUP_NUM);
+    BUILD_BUG_ON(0 != NVMIX_MAX_XATTR_BLOCK_NUM % NVMIX_ALLOC_GROUP_NUM);
+
+    res = nvmixAllocatorInit(&pNsbh->m_inodeAllocator, &pNsb->m_imap, NVMIX_MAX_INODE_NUM, isClean ? (long)pNsb->m_freeInodeNum : -1);
+    if (0 == res) res = nvmixAllocatorInit(&pNsbh->m_xattrBlockAllocator, &pNsb->m_xmap, NVMIX_MAX_XATTR_BLOCK_NUM, isClean ? (long)pNsb->m_freeXattrBlockNum : -1);
+    if (0 != res)
+    {
+        pr_err("nvmixfs: failed to initialize allocators.\n");
+
+        goto ERR;
+    }
+
+    // 第一次修改位图之前清除干净标记。只读挂载不修改 NVM，重新挂载为读写时再清除，见 nvmixRemount()。
+    if (!sb_rdonly(pSb)) nvmixMarkDirty(pNsb, isClean);
+
     // 填充 vfs super_block 结构的相关信息。
     pSb->s_magic = NVMIX_MAGIC_NUMBER;
     pSb->s_op = &nvmixSuperOps;
+    // 扩展属性的 getxattr、setxattr 和 removexattr 由 vfs 按名字前缀分发到这些处理函数。
+    pSb->s_xattr = nvmixXattrHandlers;
+
+    res = nvmixSysfsRegister(pSb);
+    if (0 != res) goto ERR;
 
     // 分配根目录的 inode 和 dentry。
     pRootDirInode = nvmixIget(pSb, NVMIX_ROOT_DIR_INODE_NUMBER);
@@ -172,6 +276,9 @@ int nvmixFillSuper(struct super_block *pSb, void *pData, int silent)
     }
     pSb->s_root = pRootDirDentry;
 
+    // 剩余的 inode 组交给后台线程初始化。
+    if (!sb_rdonly(pSb)) nvmixLazyInitStart(pSb);
+
 
     // 获得初始化超级块的结束时间，单位是纳秒。
     endTime = ktime_get_ns();
@@ -186,6 +293,17 @@ int nvmixFillSuper(struct super_block *pSb, void *pData, int silent)
 
     // 错误流程分支，正常流程走不到这里，于上面已退出。
 ERR:
+    if (pNsbh)
+    {
+        nvmixSysfsUnregister(pSb);
+
+        cancel_delayed_work_sync(&pNsbh->m_inodeFlushWork);
+
+        // 未初始化的分配器也可以安全地销毁。
+        nvmixAllocatorDestroy(&pNsbh->m_xattrBlockAllocator);
+        nvmixAllocatorDestroy(&pNsbh->m_inodeAllocator);
+    }
+
     pSb->s_fs_info = NULL;
 
     kzfree(pNsbh);
@@ -195,6 +313,47 @@ ERR:
     return res;
 }
 
+int nvmixRemount(struct super_block *pSb, int *pFlags, char *pData)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+    struct NvmixSuperBlock *pNsb = NULL;
+    bool isReadOnly = *pFlags & SB_RDONLY;
+    int res = 0;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+    pNsb = (struct NvmixSuperBlock *)(pNsbh->m_superBlockVirtAddr);
+
+    sync_filesystem(pSb);
+
+    res = nvmixCheckFeatures(pNsb, isReadOnly);
+    if (0 != res) return res;
+
+    // 此时 s_flags 还没有更新，sb_rdonly() 是重新挂载之前的状态。
+    if (isReadOnly == sb_rdonly(pSb)) return 0;
+
+    if (isReadOnly)
+    {
+        // vfs 已经确认没有写者，sync_filesystem() 之后等待中的 inode 也已经刷写，同 nvmixPutSuper()。
+        nvmixLazyInitStop(pSb);
+
+        cancel_delayed_work_sync(&pNsbh->m_inodeFlushWork);
+        nvmixFlushInodes(pNsbh, xchg(&pNsbh->m_dirtyInodes, 0));
+
+        nvmixMarkClean(pNsbh);
+    }
+    else
+    {
+        // 分配器在只读挂载时已经建立，空闲计数在挂载时已经检查过。
+        nvmixMarkDirty(pNsb, NVMIX_HAS_FEATURE(pNsb, RoCompat, NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE) && (NVMIX_STATE_CLEAN == pNsb->m_state));
+
+        nvmixLazyInitStart(pSb);
+    }
+
+
+    return 0;
+}
+
 void nvmixPutSuper(struct super_block *pSb)
 {
     struct NvmixNvmHelper *pNsbh = NULL;
@@ -203,12 +362,67 @@ void nvmixPutSuper(struct super_block *pSb)
     // s_fs_info 类似于 file 结构的 private_data，是文件系统中可被我们自己定义的私有数据信息。s_fs_info 在 fill_super 时会被初始化。这里拿到该部分数据以推进后续代码。
     pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
 
+    // 先停止后台初始化线程，它会访问下面释放的资源。
+    nvmixLazyInitStop(pSb);
+
+    nvmixSysfsUnregister(pSb);
+
+    // 等待中的 inode 必须在标记为干净之前落到 NVM 上。
+    cancel_delayed_work_sync(&pNsbh->m_inodeFlushWork);
+    nvmixFlushInodes(pNsbh, xchg(&pNsbh->m_dirtyInodes, 0));
+
+    // 此时所有 inode 都已经写回和释放，位图不会再变化。只读挂载时镜像保持挂载前的状态。
+    if (!sb_rdonly(pSb)) nvmixMarkClean(pNsbh);
+
+    nvmixAllocatorDestroy(&pNsbh->m_xattrBlockAllocator);
+    nvmixAllocatorDestroy(&pNsbh->m_inodeAllocator);
+
     pNsbh->m_superBlockVirtAddr = NULL;
     pNsbh->m_inodeVirtAddr = NULL;
+    pNsbh->m_journalVirtAddr = NULL;
+    pNsbh->m_inlineVirtAddr = NULL;
+    pNsbh->m_xattrInlineVirtAddr = NULL;
+    pNsbh->m_xattrPoolVirtAddr = NULL;
+
+    // 与 nvmixFillSuper() 的错误流程相同，释放辅助结构本身。
+    pSb->s_fs_info = NULL;
+
+    kzfree(pNsbh);
+    pNsbh = NULL;
 
     pr_info("nvmixfs: released super block resources.\n");
 }
 
+int nvmixStatfs(struct dentry *pDentry, struct kstatfs *pKstatfs)
+{
+    struct super_block *pSb = NULL;
+    struct NvmixNvmHelper *pNsbh = NULL;
+    u64 id = 0;
+
+
+    pSb = pDentry->d_sb;
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+
+    // 空闲数只读取 per-CPU 计数器的全局值，不加锁也不遍历 CPU，可能相差各 CPU 上尚未汇总的少量增量。
+    pKstatfs->f_type = NVMIX_MAGIC_NUMBER;
+    // 空间以簇为单位分配，每个 inode 独占一个簇。
+    pKstatfs->f_bsize = pSb->s_blocksize << ((struct NvmixSuperBlock *)(pNsbh->m_superBlockVirtAddr))->m_clusterBits;
+    pKstatfs->f_blocks = NVMIX_MAX_INODE_NUM;
+    pKstatfs->f_bfree = nvmixAllocatorFreeCount(&pNsbh->m_inodeAllocator);
+    pKstatfs->f_bavail = pKstatfs->f_bfree;
+    pKstatfs->f_files = NVMIX_MAX_INODE_NUM;
+    pKstatfs->f_ffree = pKstatfs->f_bfree;
+    pKstatfs->f_namelen = NVMIX_MAX_NAME_LENGTH;
+
+    // 参考 ext2_statfs()，用设备号作为文件系统 ID。
+    id = huge_encode_dev(pSb->s_bdev->bd_dev);
+    pKstatfs->f_fsid.val[0] = (u32)id;
+    pKstatfs->f_fsid.val[1] = (u32)(id >> 32);
+
+
+    return 0;
+}
+
 struct inode *nvmixAllocInode(struct super_block *pSb)
 {
     struct NvmixInodeHelper *pNih = NULL;
@@ -230,22 +444,26 @@ struct inode *nvmixAllocInode(struct super_block *pSb)
     // inode_init_once() 是内核中与 inode 对象初始化相关的函数，通常与 Slab 分配器配合使用。核心作用是为新分配的 inode 对象设置初始状态，确保其关键字段（如锁、链表、引用计数等）在首次使用时处于合法状态。
     inode_init_once(&pNih->m_vfsInode);
 
+    init_rwsem(&pNih->m_xattrSem);
+    mutex_init(&pNih->m_unwrittenLock);
+
     pr_info("nvmixfs: allocated inode successfully.\n");
 
 
     return &pNih->m_vfsInode;
 }
 
-void nvmixDestroyInode(struct inode *pInode)
+void nvmixFreeInode(struct inode *pInode)
 {
+    // 目录的 RCU 副本与 inode 一起释放，此时已经没有读者。
+    nvmixDirIndexFree(pInode);
+
     // kfree() 是内核用于释放动态分配内存的函数。释放由 kmalloc()、kzalloc()、kmem_cache_alloc() 等内核内存分配函数申请的内存。
     // kzfree() 的区别是先清 0 再释放内存，避免敏感内存内容的残留。
     // 如果传入的指针是 NULL, kzfree() 什么都不会做。
     // 当前版本内核为 5.4，5.15 中 kzfree() 接口已废弃，转而使用 kfree_sensitive()。
-    // 销毁 inode 时，同时也要销毁它所在的 NvmixInodeHelper 结构，因此直接释放外层 NvmixInodeHelper 结构。
+    // 释放 inode 时，同时也要释放它所在的 NvmixInodeHelper 结构，因此直接释放外层 NvmixInodeHelper 结构。
     kzfree(NVMIX_I(pInode));
-
-    pr_info("nvmixfs: destroyed inode successfully.\n");
 }
 
 int nvmixWriteInode(struct inode *pInode, struct writeback_control *pWbc)
@@ -268,12 +486,27 @@ int nvmixWriteInode(struct inode *pInode, struct writeback_control *pWbc)
     pNi->m_uid = i_uid_read(pInode);
     pNi->m_gid = i_gid_read(pInode);
     pNi->m_size = pInode->i_size;
+    pNi->m_nlink = pInode->i_nlink;
 
     pNih = NVMIX_I(pInode);
     pNi->m_dataBlockIndex = pNih->m_dataBlockIndex;
 
+    atomic64_inc(&pNsbh->m_inodeWriteNum);
+
     // 需保证持久性内存 NVM 更改的顺序一致性和同步性。具体见 snippet/ReservedMemoryTest/main.c。
-    clflush_cache_range(pNi, sizeof(struct NvmixInode));
+    // set_bit() 是带有内存屏障的原子操作，刷写工作看到这一位时一定也能看到上面的存储。
+    if (WB_SYNC_ALL == pWbc->sync_mode)
+    {
+        // 调用者要求返回前持久化，连同等待中的 inode 一起刷写。
+        nvmixFlushInodes(pNsbh, xchg(&pNsbh->m_dirtyInodes, 0) | BIT(pInode->i_ino));
+    }
+    else
+    {
+        set_bit(pInode->i_ino, &pNsbh->m_dirtyInodes);
+
+        // 已经排队的工作不会被推迟，一轮回写中的 inode 由同一次工作刷写。
+        schedule_delayed_work(&pNsbh->m_inodeFlushWork, msecs_to_jiffies(NVMIX_INODE_FLUSH_DELAY_MS));
+    }
 
     pr_info("nvmixfs: m_mode is %05o; m_dataBlockIndex is %d.\n", pNi->m_mode, pNi->m_dataBlockIndex);
 
@@ -283,6 +516,69 @@ int nvmixWriteInode(struct inode *pInode, struct writeback_control *pWbc)
     return res;
 }
 
+int nvmixSyncFs(struct super_block *pSb, int wait)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+
+    nvmixFlushInodes(pNsbh, xchg(&pNsbh->m_dirtyInodes, 0));
+
+
+    return 0;
+}
+
+int nvmixFsync(struct file *pFile, loff_t start, loff_t end, int datasync)
+{
+    struct inode *pInode = file_inode(pFile);
+    struct NvmixNvmHelper *pNsbh = NULL;
+    int res = 0;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pInode->i_sb->s_fs_info);
+
+    res = generic_file_fsync(pFile, start, end, datasync);
+    if (0 != res) return res;
+
+    // 延迟工作可能已经取走了本 inode 的位但还没有刷写完成，因此总是刷写本 inode，同 WB_SYNC_ALL 的 nvmixWriteInode()。
+    nvmixFlushInodes(pNsbh, xchg(&pNsbh->m_dirtyInodes, 0) | BIT(pInode->i_ino));
+
+
+    return 0;
+}
+
+void nvmixEvictInode(struct inode *pInode)
+{
+    // 释放 inode 的页缓存，然后清理 vfs inode 的状态。这两步是 evict_inode 的固定写法，参考 ext2_evict_inode()。
+    truncate_inode_pages_final(&pInode->i_data);
+    clear_inode(pInode);
+
+    // 硬链接数不为 0 说明只是从内存中回收，NVM 上的 inode 仍然有效。
+    if (0 != pInode->i_nlink) return;
+
+    nvmixXattrDrop(pInode);
+    nvmixReleaseInode(pInode->i_sb, pInode->i_ino);
+
+    pr_info("nvmixfs: evicted inode %lu and released it.\n", pInode->i_ino);
+}
+
+void nvmixReleaseInode(struct super_block *pSb, unsigned long ino)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+    struct NvmixSuperBlock *pNsb = NULL;
+
+
+    // 磁盘上超级块区的缓冲区指针一直存在于内存中，被 NvmixNvmHelper 维护，不需要手动创建和释放。
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+    pNsb = (struct NvmixSuperBlock *)(pNsbh->m_superBlockVirtAddr);
+
+    // inode 区和 inline 区的内容不需要清空，新创建的时候覆盖即可。
+    nvmixAllocatorFree(&pNsbh->m_inodeAllocator, ino);
+
+    pr_info("nvmixfs: m_imap after releasing inode %lu: %ld\n", ino, pNsb->m_imap);
+}
+
 struct inode *nvmixIget(struct super_block *pSb, unsigned long ino)
 {
     struct inode *pInode = NULL;
@@ -323,40 +619,130 @@ struct inode *nvmixIget(struct super_block *pSb, unsigned long ino)
     pInode->i_atime = current_time(pInode);
     pInode->i_ctime = current_time(pInode);
 
-    // 封装了一个函数专门计算 i_blocks。
-    // 但由于目前本文件系统限制了文件的最大大小为一个块，即 4 KIB，因此这个值不是 0 就是 1。这样为以后的改造留出了口子。
-    pInode->i_blocks = nvmixCalcInodeBlocks(pInode->i_size);
+    // 硬链接数持久化在 NvmixInode 中。目录的硬链接数为 2 加上子目录的个数，例如新建目录 temp，两个硬链接分别为 temp 目录的 . 和父目录的 temp。
+    // 硬链接与原始文件共享相同的 inode（索引节点），即两者指向磁盘上的同一块数据。删除原始文件后，只要存在至少一个硬链接，文件数据仍可通过其他硬链接访问。
+    set_nlink(pInode, pNi->m_nlink);
 
-    // 填充 page cache 相关的 address_space_operations。
-    pInode->i_mapping->a_ops = &nvmixAops;
+    // 根据 inode 的类型注册不同的操作，与新建 inode 时共用同一套逻辑。设备文件的设备号存储在 NVM 的 inline 区中。
+    nvmixSetInodeOps(pInode, (S_ISCHR(pInode->i_mode) || S_ISBLK(pInode->i_mode)) ? new_decode_dev(*(u32 *)NVMIX_INLINE_DATA(pNsbh, ino)) : 0);
 
-    // 根据 inode 是文件还是目录进行不同操作的注册。
+    // 更新 inode 对应的 NvmixInodeHelper 结构的逻辑块号。
+    pNih = NVMIX_I(pInode);
+    pNih->m_dataBlockIndex = pNi->m_dataBlockIndex;
+
+    // 普通文件的 i_blocks 是子簇位图中写过的数据块，其余类型只使用簇的第一个数据块，按大小计算。
     if (S_ISREG(pInode->i_mode))
     {
-        pInode->i_fop = &nvmixFileFileOps;
-        pInode->i_op = &nvmixFileInodeOps;
-    }
-    else if (S_ISDIR(pInode->i_mode))
-    {
-        pInode->i_fop = &nvmixDirFileOps;
-        pInode->i_op = &nvmixDirInodeOps;
+        // 写入过程中崩溃时，位图可能已经置位而文件大小还没有更新，文件尾之后的块要释放，否则扩展文件时会读到旧数据。
+        nvmixTruncateBlocks(pInode, pInode->i_size);
 
-        // inode 的硬链接个数 i_nlink 默认为 1。但对目录应为 2。例如新建目录 temp，两个硬链接分别为 temp 目录的 . 和父目录的 temp。
-        // 硬链接与原始文件共享相同的 inode（索引节点），即两者指向磁盘上的同一块数据。删除原始文件后，只要存在至少一个硬链接，文件数据仍可通过其他硬链接访问。
-        inc_nlink(pInode);
+        pInode->i_blocks = nvmixCountBlocks(pInode);
     }
     else
     {
-        // 非普通文件或目录，暂不考虑。
+        pInode->i_blocks = nvmixCalcInodeBlocks(pInode->i_size, pSb->s_blocksize);
     }
 
-    // 更新 inode 对应的 NvmixInodeHelper 结构的逻辑块号。
-    pNih = NVMIX_I(pInode);
-    pNih->m_dataBlockIndex = pNi->m_dataBlockIndex;
-
     // 与 iget_locked() 配合，确保新 inode 在初始化完成后安全解锁，保障并发访问的正确性。
     unlock_new_inode(pInode);
 
 
     return pInode;
 }
+
+int nvmixCheckFeatures(struct NvmixSuperBlock *pNsb, bool isReadOnly)
+{
+    unsigned int unknown = 0;
+
+
+    // 不认识的不兼容特性改变了磁盘布局的含义，按当前的布局读写会破坏数据，例如 tune.nvmixfs 中途中断的升级。
+    unknown = pNsb->m_featureIncompat & ~NVMIX_FEATURE_INCOMPAT_SUPP;
+    if (0 != unknown)
+    {
+        pr_err("nvmixfs: unsupported incompatible features 0x%x.\n", unknown);
+
+
+        return -EINVAL;
+    }
+
+    // 不认识的只读兼容特性不影响读取，但写入时无法维护它们的元数据。
+    unknown = pNsb->m_featureRoCompat & ~NVMIX_FEATURE_RO_COMPAT_SUPP;
+    if ((0 != unknown) && !isReadOnly)
+    {
+        pr_err("nvmixfs: unsupported read-only compatible features 0x%x, mount read-only.\n", unknown);
+
+
+        return -EROFS;
+    }
+
+    // 不认识的兼容特性直接忽略。
+    unknown = pNsb->m_featureCompat & ~NVMIX_FEATURE_COMPAT_SUPP;
+    if (0 != unknown) pr_info("nvmixfs: ignoring unknown compatible features 0x%x.\n", unknown);
+
+
+    return 0;
+}
+
+void nvmixMarkDirty(struct NvmixSuperBlock *pNsb, bool isClean)
+{
+    unsigned int group = 0;
+    unsigned long groupEnd = 0;
+
+
+    pNsb->m_state = 0;
+    clflush_cache_range(&pNsb->m_state, sizeof(pNsb->m_state));
+
+    // 正常卸载的镜像已经在上次以读写方式挂载时检查过。
+    if (isClean) return;
+
+    // 已有 inode 的组一定已经初始化过。m_initGroups 与 m_imap 不一致时（例如镜像不是由当前版本的 mkfs 格式化的）以 m_imap 为准补上标记，延迟初始化绝不能清零已分配的 inode。
+    for (group = 0; group < NVMIX_INODE_GROUP_NUM; ++group)
+    {
+        if (test_bit(group, &pNsb->m_initGroups)) continue;
+
+        groupEnd = (group + 1) * NVMIX_INODE_GROUP_SIZE;
+
+        if (groupEnd > find_next_bit(&pNsb->m_imap, groupEnd, group * NVMIX_INODE_GROUP_SIZE)) set_bit(group, &pNsb->m_initGroups);
+    }
+    clflush_cache_range(&pNsb->m_initGroups, sizeof(pNsb->m_initGroups));
+}
+
+void nvmixMarkClean(struct NvmixNvmHelper *pNsbh)
+{
+    struct NvmixSuperBlock *pNsb = (struct NvmixSuperBlock *)(pNsbh->m_superBlockVirtAddr);
+
+
+    if (!NVMIX_HAS_FEATURE(pNsb, RoCompat, NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE)) return;
+
+    // 计数先于标记持久化。
+    pNsb->m_freeInodeNum = nvmixAllocatorFreeCountExact(&pNsbh->m_inodeAllocator);
+    pNsb->m_freeXattrBlockNum = nvmixAllocatorFreeCountExact(&pNsbh->m_xattrBlockAllocator);
+    clflush_cache_range(&pNsb->m_freeInodeNum, 2 * sizeof(unsigned int));
+
+    pNsb->m_state = NVMIX_STATE_CLEAN;
+    clflush_cache_range(&pNsb->m_state, sizeof(pNsb->m_state));
+}
+
+void nvmixFlushInodes(struct NvmixNvmHelper *pNsbh, unsigned long mask)
+{
+    unsigned long ino = 0;
+
+
+    if (0 == mask) return;
+
+    for_each_set_bit(ino, &mask, NVMIX_MAX_INODE_NUM) clflushopt((struct NvmixInode *)(pNsbh->m_inodeVirtAddr) + ino);
+
+    mb();
+
+    atomic64_inc(&pNsbh->m_inodeFlushNum);
+}
+
+void nvmixInodeFlushWork(struct work_struct *pWork)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+
+
+    pNsbh = container_of(to_delayed_work(pWork), struct NvmixNvmHelper, m_inodeFlushWork);
+
+    nvmixFlushInodes(pNsbh, xchg(&pNsbh->m_dirtyInodes, 0));
+}
@@ -11,9 +11,23 @@
 #define _NVMIX_FS_H_
 
 #include "defs.h"
+#include "alloc.h"
 
 #include <linux/fs.h>
 #include <linux/buffer_head.h>
+#include <linux/mutex.h>
+#include <linux/kobject.h>
+#include <linux/completion.h>
+#include <linux/sched.h>
+#include <linux/workqueue.h>
+#include <linux/atomic.h>
+
+
+/**
+ * @brief 异步回写的 inode 等待批量刷写的时间，单位是毫秒。
+ * @details vfs 的一轮回写会连续对许多 inode 调用 nvmixWriteInode()，这段时间内写入的 inode 合并为一次刷写。
+ */
+#define NVMIX_INODE_FLUSH_DELAY_MS 10
 
 
 /**
@@ -31,9 +45,115 @@ struct NvmixNvmHelper
      * @brief NVM 空间上 inode 区的起始虚拟地址。
      */
     void *m_inodeVirtAddr;
+
+    /**
+     * @brief NVM 空间上日志区的起始虚拟地址。
+     */
+    void *m_journalVirtAddr;
+
+    /**
+     * @brief NVM 空间上 inline 区的起始虚拟地址。
+     */
+    void *m_inlineVirtAddr;
+
+    /**
+     * @brief NVM 空间上扩展属性 inline 区的起始虚拟地址。
+     */
+    void *m_xattrInlineVirtAddr;
+
+    /**
+     * @brief NVM 空间上扩展属性块池的起始虚拟地址。
+     */
+    void *m_xattrPoolVirtAddr;
+
+    /**
+     * @brief 保护日志区的互斥锁。
+     * @details 日志区只有一份。不同目录内的 rename 只持有各自目录的 i_rwsem，可能并发执行，因此需要额外的锁串行化对日志区的使用。
+     */
+    struct mutex m_journalLock;
+
+    /**
+     * @brief 超级块 m_imap 位图的分配器。
+     */
+    struct NvmixAllocator m_inodeAllocator;
+
+    /**
+     * @brief 超级块 m_xmap 位图的分配器。
+     */
+    struct NvmixAllocator m_xattrBlockAllocator;
+
+    /**
+     * @brief /sys/fs/nvmixfs/<设备名>/ 对应的 kobject。
+     */
+    struct kobject m_kobj;
+
+    /**
+     * @brief m_kobj 的最后一个引用释放时完成，卸载时等待它以保证 sysfs 不再访问本结构。
+     */
+    struct completion m_kobjUnregister;
+
+    /**
+     * @brief 串行化 inode 组的延迟初始化。
+     */
+    struct mutex m_lazyInitLock;
+
+    /**
+     * @brief 后台初始化线程，未启动时为 NULL。
+     */
+    struct task_struct *m_pLazyInitTask;
+
+    /**
+     * @brief 已经写入 NVM 但尚未刷写的 inode，每一位代表一个 inode 号。见 nvmixWriteInode()。
+     */
+    unsigned long m_dirtyInodes;
+
+    /**
+     * @brief 批量刷写 m_dirtyInodes 的延迟工作。
+     */
+    struct delayed_work m_inodeFlushWork;
+
+    /**
+     * @brief nvmixWriteInode() 的调用次数，由 sysfs 导出。
+     */
+    atomic64_t m_inodeWriteNum;
+
+    /**
+     * @brief 刷写 inode 区的次数，每次刷写以一个内存栅栏结束，由 sysfs 导出。
+     */
+    atomic64_t m_inodeFlushNum;
+
+    /**
+     * @brief 预读读入的页数，由 sysfs 导出。见 page.c 中 nvmixReadpages()。
+     */
+    atomic64_t m_readaheadPageNum;
+
+    /**
+     * @brief 预读的页中整页都是空洞、不需要读取 SSD 的页数，由 sysfs 导出。
+     */
+    atomic64_t m_readaheadHolePageNum;
+
+    /**
+     * @brief 预读没有覆盖、只能单独同步读取的页数，由 sysfs 导出。
+     */
+    atomic64_t m_readpageNum;
 };
 
 
+/**
+ * @brief 获得 inode 在 NVM inline 区上的槽位的虚拟地址。
+ * @param pNsbh NvmixNvmHelper 结构指针。
+ * @param ino 全局唯一 inode 号。
+ */
+#define NVMIX_INLINE_DATA(pNsbh, ino) ((char *)((pNsbh)->m_inlineVirtAddr) + (ino)*NVMIX_INLINE_DATA_SIZE)
+
+/**
+ * @brief 将簇号换算为 sb_bread() 等使用的块号，即簇的第一个数据块。
+ * @param pSb 超级块指针。
+ * @param index 簇号，即 m_dataBlockIndex。
+ */
+#define NVMIX_SB_DATA_BLOCK(pSb, index) NVMIX_DATA_BLOCK_NR((struct NvmixSuperBlock *)(((struct NvmixNvmHelper *)((pSb)->s_fs_info))->m_superBlockVirtAddr), index)
+
+
 /**
  * @brief 挂载文件系统实例。注册文件系统类型结构的 mount 函数。
  * @param pFileSystemType 要挂载的文件系统类型描述符的指针。
@@ -61,10 +181,29 @@ void nvmixKillSb(struct super_block *pSb);
  */
 int nvmixFillSuper(struct super_block *pSb, void *pData, int silent);
 
+/**
+ * @brief 获取文件系统的统计信息。注册超级块操作的 statfs 函数。
+ * @param pDentry 文件系统中任意一个 dentry 指针。
+ * @param pKstatfs 用于返回统计信息的结构指针。
+ * @return 成功返回 0。
+ * @details 簇号与 inode 号一一对应，每个 inode 独占 SSD 上的一个簇，因此以簇为 f_bsize，SSD 空闲块数与空闲 inode 数相同。NVM 的使用情况无法通过 statfs 表达，由 sysfs 单独导出，见 sysfs.h。
+ */
+int nvmixStatfs(struct dentry *pDentry, struct kstatfs *pKstatfs);
+
+/**
+ * @brief 重新挂载文件系统。注册超级块操作的 remount_fs 函数。
+ * @param pSb 超级块指针。
+ * @param pFlags 新的挂载标志。
+ * @param pData 挂载参数。
+ * @return 成功返回 0，镜像带有不认识的只读兼容特性时不允许重新挂载为读写，返回 -EROFS。
+ */
+int nvmixRemount(struct super_block *pSb, int *pFlags, char *pData);
+
 /**
  * @brief 释放超级块持有的资源。注册超级块操作的 put_super 函数。
  * @param pSb 超级块指针。
  * @details put_super 的作用是在文件系统卸载或不再需要超级块时，释放与该超级块关联的资源。
+ * @details 启用 NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE 时把分配器的空闲计数保存到超级块上并标记为干净，下次 nvmixFillSuper() 直接使用，不扫描位图。
  */
 void nvmixPutSuper(struct super_block *pSb);
 
@@ -76,19 +215,55 @@ void nvmixPutSuper(struct super_block *pSb);
 struct inode *nvmixAllocInode(struct super_block *pSb);
 
 /**
- * @brief 销毁 vfs inode。注册超级块操作的 destroy_inode 函数。
- * @param pInode 要删除的 inode 指针。
+ * @brief 释放 vfs inode 的内存。注册超级块操作的 free_inode 函数。
+ * @param pInode 要释放的 inode 指针。
+ * @details 与 destroy_inode 不同，vfs 在 RCU 宽限期之后才调用 free_inode。RCU 模式的路径解析不持有 inode 的引用，可能仍在读取刚被回收的 inode，因此内存必须等宽限期过后才能释放。
  */
-void nvmixDestroyInode(struct inode *pInode);
+void nvmixFreeInode(struct inode *pInode);
 
 /**
  * @brief 将内存中的 vfs inode 数据持久化到盘上的 NvmixInode 元数据。注册超级块操作的 write_inode 函数。
  * @param pInode vfs inode 指针。
  * @param pWbc 回写控制参数及上下文信息。
- * @return
+ * @return 成功返回 0。
+ * @details 同步回写（WB_SYNC_ALL，例如 fsync）立即刷写，顺带刷写其他等待中的 inode。异步回写（WB_SYNC_NONE）只把 inode 记入 m_dirtyInodes，NVMIX_INODE_FLUSH_DELAY_MS 以后由延迟工作一次刷写所有等待中的 inode：每个缓存行一条 clflushopt，最后只有一个内存栅栏。批量 chmod、chown 和 touch 时相邻 inode 的更新因此合并为一次刷写。
  */
 int nvmixWriteInode(struct inode *pInode, struct writeback_control *pWbc);
 
+/**
+ * @brief 刷写所有等待中的 inode。注册超级块操作的 sync_fs 函数。
+ * @param pSb 超级块指针。
+ * @param wait 是否等待完成，刷写总是同步完成的。
+ * @return 成功返回 0。
+ * @details sync 先以 WB_SYNC_NONE 回写所有 inode，这些 inode 在 vfs 看来已经是干净的，只能在这里刷写。
+ */
+int nvmixSyncFs(struct super_block *pSb, int wait);
+
+/**
+ * @brief 同步文件的数据和元数据。注册普通文件和目录的文件操作的 fsync 函数。
+ * @param pFile 文件指针。
+ * @param start 同步范围的起始位置。
+ * @param end 同步范围的结束位置，包含在内。
+ * @param datasync 是否只同步与读取数据有关的元数据。
+ * @return 成功返回 0，失败返回负的错误码。
+ * @details 在 generic_file_fsync() 之后刷写本 inode 的缓存行。异步回写已经清除了 vfs 的脏标记，inode 可能还在 m_dirtyInodes 中等待刷写，此时 generic_file_fsync() 不会再调用 nvmixWriteInode()。
+ */
+int nvmixFsync(struct file *pFile, loff_t start, loff_t end, int datasync);
+
+/**
+ * @brief 从内存中回收 vfs inode。注册超级块操作的 evict_inode 函数。
+ * @param pInode 要回收的 inode 指针。
+ * @details inode 的最后一个引用释放时调用。若此时硬链接数已为 0，说明已没有目录项指向它，才真正释放 m_imap 中的位。unlink 时不能直接释放，因为 inode 可能还有其他硬链接或仍被进程打开。
+ */
+void nvmixEvictInode(struct inode *pInode);
+
+/**
+ * @brief 释放 inode 在超级块 m_imap 位图中占用的位。
+ * @param pSb 超级块指针。
+ * @param ino 要释放的 inode 号。
+ */
+void nvmixReleaseInode(struct super_block *pSb, unsigned long ino);
+
 /**
  * @brief 通过超级块和全局唯一 inode 号获得 inode 指针。
  * @param pSb 超级块指针。
@@ -11,9 +11,18 @@
 
 #include "defs.h"
 #include "fs.h"
+#include "dir.h"
+#include "journal.h"
+#include "xattr.h"
+#include "lazyinit.h"
+#include "page.h"
 
 #include <linux/cred.h>
 #include <linux/buffer_head.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/kdev_t.h>
+#include <linux/mm.h>
 #include <asm/cacheflush.h>
 
 
@@ -21,7 +30,10 @@
  * @brief 文件 inode 操作的注册接口。
  */
 struct inode_operations nvmixFileInodeOps = {
+    .setattr = nvmixSetattr,
     .getattr = simple_getattr,
+    .listxattr = nvmixListxattr,
+    .fiemap = nvmixFiemap,
 };
 
 /**
@@ -30,9 +42,43 @@ struct inode_operations nvmixFileInodeOps = {
 struct inode_operations nvmixDirInodeOps = {
     .lookup = nvmixLookup,
     .create = nvmixCreate,
+    .link = nvmixLink,
     .unlink = nvmixUnlink,
+    .symlink = nvmixSymlink,
     .mkdir = nvmixMkdir,
     .rmdir = nvmixRmdir,
+    .mknod = nvmixMknod,
+    .rename = nvmixRename,
+    .listxattr = nvmixListxattr,
+};
+
+/**
+ * @brief 快速符号链接 inode 操作的注册接口。
+ * @details 链接目标存储在 NVM 的 inline 区，inode->i_link 直接指向它。simple_get_link() 只返回 i_link，不会睡眠，因此路径解析可以一直停留在 RCU 模式。
+ */
+struct inode_operations nvmixFastSymlinkInodeOps = {
+    .get_link = simple_get_link,
+    .getattr = simple_getattr,
+    .listxattr = nvmixListxattr,
+};
+
+/**
+ * @brief 普通符号链接 inode 操作的注册接口。
+ * @details 链接目标超出 inline 区时存储在 SSD 的数据块上。
+ */
+struct inode_operations nvmixSymlinkInodeOps = {
+    .get_link = nvmixGetLink,
+    .getattr = simple_getattr,
+    .listxattr = nvmixListxattr,
+};
+
+/**
+ * @brief 特殊文件 inode 操作的注册接口。
+ * @details 字符设备、块设备、FIFO 和 socket 的读写由 init_special_inode() 设置的 i_fop 处理，这里只需要提供属性相关的操作。
+ */
+struct inode_operations nvmixSpecialInodeOps = {
+    .getattr = simple_getattr,
+    .listxattr = nvmixListxattr,
 };
 
 
@@ -63,32 +109,45 @@ static struct inode *nvmixNewInode(struct inode *pParentDirInode);
 static int nvmixUpdateParentDirDentry(struct dentry *pDentry, struct inode *pInode);
 
 /**
- * @brief 给定目标 dentry，找到磁盘对应的 NvmixDentry 结构。
- * @param pDentry 目标 dentry 的指针。
- * @param ppBh 磁盘缓冲区头的二级指针。
- * @return 成功返回目标指针，失败返回 NULL。
- * @details 为什么会有第二个参数，且为什么是二级指针，请参考函数定义的注释。
+ * @brief 在目录数据块中定位目录项对应的槽位。
+ * @param pBh 父目录数据块的缓冲区头指针。
+ * @param pDentry 目标目录项的 dentry 指针，必须是正状态。
+ * @return 成功返回槽位下标，失败返回负的错误码。
+ * @details 优先使用 dentry 缓存的槽位（见 NVMIX_DENTRY_SLOT），校验 inode 号和名字一致后直接返回，否则退回遍历并重新缓存。
  */
-static struct NvmixDentry *nvmixFindDentry(struct dentry *pDentry, struct buffer_head **ppBh);
+static int nvmixGetDentrySlot(struct buffer_head *pBh, struct dentry *pDentry);
 
 /**
- * @brief 在父目录中创建新文件或目录的节点。
- * @param pParentDirInode 父目录的 inode 指针。
+ * @brief 在目录数据块中找到第一个空闲的槽位。
+ * @param pBh 目录数据块的缓冲区头指针。
+ * @return 成功返回槽位下标，目录已满返回 -ENOSPC。
+ */
+static int nvmixFindFreeSlot(struct buffer_head *pBh);
+
+/**
+ * @brief 检查目录在磁盘上是否为空。
+ * @param pDirInode 目录的 inode 指针。
+ * @return 为空返回 0，非空返回 -ENOTEMPTY，读取失败返回 -EIO。
+ * @details simple_empty() 只检查 dcache 中的子 dentry，而磁盘上的目录项不一定都在 dcache 中，因此以目录数据块为准。
+ */
+static int nvmixCheckDirEmpty(struct inode *pDirInode);
+
+/**
+ * @brief 将新创建的 inode 关联到父目录中，并与 dentry 绑定。
  * @param pDentry 新创建的节点的 dentry 指针。
- * @param mode 创建模式参数。
- * @param excl 独占创建标志，若设置为 true 要求目标必须不存在。暂未用到。
- * @return 成功返回 0，失败返回非 0。
- * @details 接口的参数逆天。pParentDirInode 是父目录的 inode 节点，在函数里我需要手动创建新的 vfs inode。而 pDentry 却是新 inode 节点对应的 dentry 对象，内核帮我创建好了。很容易误解为父目录的 dentry，我们需要自己手动创建 dentry，但是内核似乎并没有这种函数。
+ * @param pInode 新创建的 inode 指针。
+ * @return 成功返回 0，失败返回非 0。失败时会释放 pInode。
+ * @details nvmixMknod() 和 nvmixSymlink() 的公共收尾逻辑。
  */
-static int nvmixMknod(struct inode *pParentDirInode, struct dentry *pDentry, umode_t mode, bool excl);
+static int nvmixInstantiate(struct dentry *pDentry, struct inode *pInode);
 
 
 struct dentry *nvmixLookup(struct inode *pParentDirInode, struct dentry *pDentry, unsigned int flags)
 {
     struct super_block *pSb = NULL;
-    struct NvmixDentry *pNd = NULL;
     struct inode *pInode = NULL;
-    struct buffer_head *pBh = NULL;
+    unsigned long ino = 0;
+    int slot = 0;
 
 
     pSb = pParentDirInode->i_sb;
@@ -97,19 +156,29 @@ struct dentry *nvmixLookup(struct inode *pParentDirInode, struct dentry *pDentry
 
     pr_info("nvmixfs: start looking up dentry %s\n", pDentry->d_name.name);
 
-    // 通过 vfs dentry 找到磁盘块上该目录的 NvmixDentry 信息。
-    pNd = nvmixFindDentry(pDentry, &pBh);
+    // 磁盘上的名字最多 NVMIX_MAX_NAME_LENGTH 个字节，超长的名字一定不存在，且不能截断后去匹配。
+    if (pDentry->d_name.len > NVMIX_MAX_NAME_LENGTH) return ERR_PTR(-ENAMETOOLONG);
+
+    // 在父目录的 RCU 副本中查找目录项。
+    slot = nvmixDirIndexLookup(pParentDirInode, &pDentry->d_name, &ino);
     // 注意未找到并不代表失败需要报错，只是代表 dentry 并无对应 inode，将其置为负状态即可（下面的 d_add()）。
-    if (!pNd)
+    if (-ENOENT == slot)
     {
         pr_info("nvmixfs: could not find target dentry in directory.\n");
     }
+    else if (slot < 0)
+    {
+        return ERR_PTR(slot);
+    }
     else
     {
-        pr_info("nvmixfs: found entry successfully: name: %s, ino: %ld\n", pNd->m_name, pNd->m_ino);
+        pr_info("nvmixfs: found entry successfully: name: %s, ino: %ld\n", pDentry->d_name.name, ino);
+
+        // 缓存槽位下标，后续 rename 和 unlink 直接使用。
+        NVMIX_SET_DENTRY_SLOT(pDentry, slot);
 
         // 通过 super_block 和全局唯一 inode 号找到对应 inode 结构。
-        pInode = nvmixIget(pSb, pNd->m_ino);
+        pInode = nvmixIget(pSb, ino);
 
         // ERR_CAST() 将错误指针转化为 void * 类型。
         if (IS_ERR(pInode)) return ERR_CAST(pInode);
@@ -119,9 +188,6 @@ struct dentry *nvmixLookup(struct inode *pParentDirInode, struct dentry *pDentry
     // 如果 pInode 为空，即走上面 pNd 为空代表找不到匹配的 dentry 和 inode 的分支，此时的 pDentry 为负状态。即当文件不存在时，负状态的 dentry 会被缓存，避免重复触发实际文件系统的查找操作。多次访问一个不存在的文件，负状态的 dentry 会直接返回 ENOENT。因此上面的两个分支都会走该函数。
     d_add(pDentry, pInode);
 
-    brelse(pBh);
-    pBh = NULL;
-
 
     // 大多数情况返回 NULL 表示成功。返回非空的 struct dentry * 代表是可能一些特殊情况，这里暂未遇到。
     return NULL;
@@ -132,7 +198,7 @@ int nvmixCreate(struct inode *pParentDirInode, struct dentry *pDentry, umode_t m
     int res = 0;
 
 
-    res = nvmixMknod(pParentDirInode, pDentry, mode | S_IFREG, excl);
+    res = nvmixMknod(pParentDirInode, pDentry, mode | S_IFREG, 0);
     if (0 != res)
     {
         pr_info("nvmixfs: failed to create new file.\n");
@@ -154,9 +220,7 @@ int nvmixUnlink(struct inode *pParentDirInode, struct dentry *pDentry)
     struct buffer_head *pBh = NULL;
     struct super_block *pSb = NULL;
     struct NvmixDentry *pNd = NULL;
-    struct NvmixNvmHelper *pNsbh = NULL;
-    struct NvmixSuperBlock *pNsb = NULL;
-    int i = 0;
+    int slot = 0;
     int res = 0;
 
 
@@ -171,7 +235,7 @@ int nvmixUnlink(struct inode *pParentDirInode, struct dentry *pDentry)
     pNih = NVMIX_I(pParentDirInode);
     pSb = pParentDirInode->i_sb;
 
-    pBh = sb_bread(pSb, pNih->m_dataBlockIndex);
+    pBh = sb_bread(pSb, NVMIX_SB_DATA_BLOCK(pSb, pNih->m_dataBlockIndex));
     if (!pBh)
     {
         pr_err("nvmixfs: could not read data block.\n");
@@ -181,44 +245,27 @@ int nvmixUnlink(struct inode *pParentDirInode, struct dentry *pDentry)
     }
 
     // 找到对应目录项并清除。
-    for (i = 0; i < NVMIX_MAX_ENTRY_NUM; ++i)
+    slot = nvmixGetDentrySlot(pBh, pDentry);
+    if (slot >= 0)
     {
-        pNd = (struct NvmixDentry *)(pBh->b_data) + i;
+        pNd = (struct NvmixDentry *)(pBh->b_data) + slot;
+        nvmixDentryClear(pNd);
 
-        // 留意 nvmixFindDentry() 中类似的部分，那里不能判断 pNd->m_ino == pInode->i_ino。这里可以，因为这里的 pDentry 与 pInode 已绑定好，是完整的。
-        if ((0 != pNd->m_ino) && (pNd->m_ino == pInode->i_ino) && (0 == strcmp(pNd->m_name, pDentry->d_name.name)))
-        {
-            memset(pNd->m_name, 0, NVMIX_MAX_NAME_LENGTH);
-            pNd->m_ino = 0;
+        mark_buffer_dirty(pBh);
 
-            break;
-        }
+        nvmixDirIndexUpdate(pParentDirInode, pBh);
     }
 
-    mark_buffer_dirty(pBh);
-
-
-    // 既然删除了 inode，超级块的 m_imap 位图信息需要更新，否则空占 inode。inode 区的内容倒不需要清空，新创建的时候覆盖即可。
-    // 磁盘上超级块区的缓冲区指针一直存在于内存中，被 NvmixNvmHelper 维护，不需要手动创建和释放。
-    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
-    pNsb = (struct NvmixSuperBlock *)(pNsbh->m_superBlockVirtAddr);
-
-    test_and_clear_bit(pInode->i_ino, &pNsb->m_imap);
-
-    clflush_cache_range(pNsb, sizeof(struct NvmixSuperBlock));
-
-    pr_info("nvmixfs: m_imap in nvmixUnlink(): %ld\n", pNsb->m_imap);
 
     pr_info("nvmixfs: unlinked file successfully.\n");
 
 
     // 减少文件的硬链接数。
     // inode_dec_link_count 先后调用 drop_nlink 和 mark_inode_dirty，逻辑更加完整，优先考虑这个函数。
+    // 这里不释放 m_imap 中的位。inode 可能还有其他硬链接，或者仍被进程打开，等到最后一个引用释放且硬链接数为 0 时，由 nvmixEvictInode() 释放。
     inode_dec_link_count(pInode);
 
-    // 释放目录项 dentry 的引用计数。
-    // 当调用 dput(pDentry) 时，如果 dentry 的引用计数（d_count）降为 0，内核会尝试释放该 dentry，并调用 iput() 减少 inode 的引用计数（i_count）。所以下面再调用 iput() 极可能会出现重复调用 iput() 导致内存泄漏进而导致内核崩溃的问题。
-    dput(pDentry);
+    // 这里也不调用 dput(pDentry)。simple_unlink() 调用 dput() 是因为 ramfs 等内存文件系统在创建时额外 dget() 了一次，把 dentry 钉在 dcache 中；本文件系统创建时没有这样做，dentry 的引用由 vfs 自己管理，再 dput() 会导致引用计数下溢。
 
     // iput() 是内核提供的函数，用于减少对 inode 的引用计数。
     // inode 的 i_count 表示内核中对该 inode 的活跃引用（如被打开的文件、dentry 缓存等）。调用 iput() 会原子地减少 i_count，并检查是否需要释放 inode。
@@ -249,6 +296,10 @@ int nvmixMkdir(struct inode *pParentDirInode, struct dentry *pDentry, umode_t mo
         goto ERR;
     }
 
+    // 新目录的 .. 指向父目录，父目录的硬链接数加 1。与 nvmixRmdir() 中的 drop_nlink() 对应。
+    inc_nlink(pParentDirInode);
+    mark_inode_dirty(pParentDirInode);
+
     pr_info("nvmixfs: created new directory successfully.\n");
 
 
@@ -261,12 +312,10 @@ int nvmixRmdir(struct inode *pParentDirInode, struct dentry *pDentry)
     int res = 0;
 
 
-    // 首先检查目录是否为空。
-    // simple_empty() 函数返回非 0 表示 true，即空，返回 0 表示 false，即非空。
-    if (0 == simple_empty(pDentry))
+    // 首先检查目录是否为空。以磁盘上的目录数据块为准，见 nvmixCheckDirEmpty()。
+    res = nvmixCheckDirEmpty(d_inode(pDentry));
+    if (0 != res)
     {
-        res = -ENOTEMPTY;
-
         pr_info("nvmixfs: error when removing a directory cause not empty.\n");
 
         goto ERR;
@@ -284,6 +333,187 @@ ERR:
     return res;
 }
 
+int nvmixRename(struct inode *pOldDirInode, struct dentry *pOldDentry, struct inode *pNewDirInode, struct dentry *pNewDentry, unsigned int flags)
+{
+    struct super_block *pSb = NULL;
+    struct inode *pOldInode = NULL;
+    struct inode *pNewInode = NULL;
+    struct buffer_head *pOldBh = NULL;
+    struct buffer_head *pNewBh = NULL;
+    struct NvmixDentry *pOldNd = NULL;
+    struct NvmixDentry *pNewNd = NULL;
+    struct NvmixJournalEntry entries[NVMIX_JOURNAL_MAX_ENTRY_NUM];
+    struct buffer_head *bhs[NVMIX_JOURNAL_MAX_ENTRY_NUM];
+    int isExchange = 0;
+    int oldSlot = 0;
+    int newSlot = 0;
+    int res = 0;
+
+
+    // RENAME_NOREPLACE 在 vfs 层已经检查过目标是否存在，这里不需要额外处理。RENAME_WHITEOUT 等其余标志暂不支持。
+    if (flags & ~(RENAME_NOREPLACE | RENAME_EXCHANGE)) return -EINVAL;
+
+    isExchange = !!(flags & RENAME_EXCHANGE);
+
+    pSb = pOldDirInode->i_sb;
+    pOldInode = d_inode(pOldDentry);
+    pNewInode = d_inode(pNewDentry);
+
+    // 覆盖一个目录时，被覆盖的目录必须为空。交换时两个目录项都保留，不需要检查。
+    if (!isExchange && pNewInode && S_ISDIR(pNewInode->i_mode))
+    {
+        res = nvmixCheckDirEmpty(pNewInode);
+        if (0 != res) goto ERR;
+    }
+
+    pOldBh = sb_bread(pSb, NVMIX_SB_DATA_BLOCK(pSb, NVMIX_I(pOldDirInode)->m_dataBlockIndex));
+    if (!pOldBh)
+    {
+        pr_err("nvmixfs: could not read data block.\n");
+
+        res = -EIO;
+        goto ERR;
+    }
+
+    // 同一目录内重命名时两个目录项在同一个数据块上，共用一个缓冲区，get_bh() 增加引用计数使得两次 brelse() 是平衡的。
+    if (pOldDirInode == pNewDirInode)
+    {
+        get_bh(pOldBh);
+        pNewBh = pOldBh;
+    }
+    else
+    {
+        pNewBh = sb_bread(pSb, NVMIX_SB_DATA_BLOCK(pSb, NVMIX_I(pNewDirInode)->m_dataBlockIndex));
+        if (!pNewBh)
+        {
+            pr_err("nvmixfs: could not read data block.\n");
+
+            res = -EIO;
+            goto ERR;
+        }
+    }
+
+    // 定位两个槽位。源目录项和已存在的目标目录项都有缓存的槽位下标，不需要遍历；只有目标不存在时才需要在目标目录中找一个空闲槽位。
+    oldSlot = nvmixGetDentrySlot(pOldBh, pOldDentry);
+    if (oldSlot < 0)
+    {
+        res = oldSlot;
+        goto ERR;
+    }
+
+    newSlot = pNewInode ? nvmixGetDentrySlot(pNewBh, pNewDentry) : nvmixFindFreeSlot(pNewBh);
+    if (newSlot < 0)
+    {
+        res = newSlot;
+        goto ERR;
+    }
+
+    pOldNd = (struct NvmixDentry *)(pOldBh->b_data) + oldSlot;
+    pNewNd = (struct NvmixDentry *)(pNewBh->b_data) + newSlot;
+
+    // 构造两个槽位更新后的内容。名字留在原来的槽位上，移动的只是 inode 号和文件类型。
+    memset(entries, 0, sizeof(entries));
+
+    entries[0].m_dataBlockIndex = NVMIX_I(pOldDirInode)->m_dataBlockIndex;
+    entries[0].m_slot = oldSlot;
+    entries[1].m_dataBlockIndex = NVMIX_I(pNewDirInode)->m_dataBlockIndex;
+    entries[1].m_slot = newSlot;
+
+    // 目标槽位：名字是新名字，指向源 inode。
+    nvmixDentryFill(&entries[1].m_dentry, (const char *)pNewDentry->d_name.name, pNewDentry->d_name.len, pOldNd->m_ino, pOldNd->m_fileType);
+
+    // 源槽位：交换时保留名字并指向目标 inode，否则清空。
+    if (isExchange)
+    {
+        memcpy(&entries[0].m_dentry, pOldNd, sizeof(struct NvmixDentry));
+        entries[0].m_dentry.m_ino = pNewNd->m_ino;
+        entries[0].m_dentry.m_fileType = pNewNd->m_fileType;
+    }
+
+    bhs[0] = pOldBh;
+    bhs[1] = pNewBh;
+
+    // 通过 NVM 日志区一次原子提交两个目录的修改。失败时什么都没有修改；提交以后即使写回 SSD 失败，重命名也已经生效（日志会被重放），必须继续维护 vfs 的数据结构，否则 dcache、缓存的槽位下标和目录数据块互相矛盾，被覆盖的 inode 也不会减少硬链接数。
+    res = nvmixJournalUpdateDentries(pSb, entries, bhs, NVMIX_JOURNAL_MAX_ENTRY_NUM);
+    if (0 != res) goto ERR;
+
+    // 缓冲区中已经是更新后的内容，RCU 副本与缓冲区保持一致。
+    nvmixDirIndexUpdate(pOldDirInode, pOldBh);
+    if (pOldDirInode != pNewDirInode) nvmixDirIndexUpdate(pNewDirInode, pNewBh);
+
+
+    // 以下维护 vfs 的数据结构，参考 simple_rename() 和 shmem_exchange()。
+    // rename 返回后 vfs 会调用 d_move() 或 d_exchange()，dentry 连同 d_fsdata 一起移动到新位置，因此这里预先更新缓存的槽位下标。
+    if (isExchange)
+    {
+        NVMIX_SET_DENTRY_SLOT(pOldDentry, newSlot);
+        NVMIX_SET_DENTRY_SLOT(pNewDentry, oldSlot);
+
+        // 目录和非目录跨目录交换时，子目录数量发生变化，需调整父目录的硬链接数。
+        if ((pOldDirInode != pNewDirInode) && (S_ISDIR(pOldInode->i_mode) != S_ISDIR(pNewInode->i_mode)))
+        {
+            if (S_ISDIR(pOldInode->i_mode))
+            {
+                drop_nlink(pOldDirInode);
+                inc_nlink(pNewDirInode);
+            }
+            else
+            {
+                drop_nlink(pNewDirInode);
+                inc_nlink(pOldDirInode);
+            }
+        }
+
+        pNewInode->i_ctime = current_time(pOldDirInode);
+        mark_inode_dirty(pNewInode);
+    }
+    else
+    {
+        NVMIX_SET_DENTRY_SLOT(pOldDentry, newSlot);
+
+        if (pNewInode)
+        {
+            // 被覆盖的目标失去一个目录项，同 nvmixUnlink()。硬链接数为 0 时由 nvmixEvictInode() 释放。
+            pNewInode->i_ctime = current_time(pOldDirInode);
+            drop_nlink(pNewInode);
+
+            if (S_ISDIR(pOldInode->i_mode))
+            {
+                drop_nlink(pNewInode);
+                drop_nlink(pOldDirInode);
+            }
+
+            mark_inode_dirty(pNewInode);
+        }
+        else if (S_ISDIR(pOldInode->i_mode))
+        {
+            drop_nlink(pOldDirInode);
+            inc_nlink(pNewDirInode);
+        }
+    }
+
+    pOldDirInode->i_ctime = pOldDirInode->i_mtime = current_time(pOldDirInode);
+    pNewDirInode->i_ctime = pNewDirInode->i_mtime = current_time(pOldDirInode);
+    pOldInode->i_ctime = current_time(pOldDirInode);
+
+    mark_inode_dirty(pOldDirInode);
+    mark_inode_dirty(pNewDirInode);
+    mark_inode_dirty(pOldInode);
+
+    pr_info("nvmixfs: renamed %s to %s successfully.\n", pOldDentry->d_name.name, pNewDentry->d_name.name);
+
+
+ERR:
+    brelse(pOldBh);
+    pOldBh = NULL;
+
+    brelse(pNewBh);
+    pNewBh = NULL;
+
+
+    return res;
+}
+
 
 struct inode *nvmixNewInode(struct inode *pParentDirInode)
 {
@@ -291,28 +521,32 @@ struct inode *nvmixNewInode(struct inode *pParentDirInode)
     struct NvmixNvmHelper *pNsbh = NULL;
     struct NvmixSuperBlock *pNsb = NULL;
     struct inode *pInode = NULL;
-    unsigned long index = 0;
+    long index = 0;
 
 
     pSb = pParentDirInode->i_sb;
     pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info); // pSb->s_fs_info 含义解释见 fs.c。
     pNsb = (struct NvmixSuperBlock *)(pNsbh->m_superBlockVirtAddr);
 
-    // find_first_zero_bit() 是内核提供的一个位图操作函数，其作用是从给定的位图中查找第一个值为 0 的位，即未使用的空闲资源。m_imap 是我们自己定义的管理 inode 分配状态的位图信息，类型是 unsigned long，8 个字节，64 位。对本文件系统而言，使用低 32 位，每一位用于标识分配状态。
-    index = find_first_zero_bit(&pNsb->m_imap, NVMIX_MAX_INODE_NUM);
-    if (NVMIX_MAX_INODE_NUM == index)
+    // m_imap 是我们自己定义的管理 inode 分配状态的位图信息，类型是 unsigned long，8 个字节，64 位。对本文件系统而言，使用低 32 位，每一位用于标识分配状态。
+    // 以父目录的 inode 号作为 hint，不同目录下的并发创建通常落在不同的分配组，不会争抢同一把锁。分配器负责持久化位图。
+    index = nvmixAllocatorAlloc(&pNsbh->m_inodeAllocator, pParentDirInode->i_ino);
+    if (index < 0)
     {
         pr_err("nvmixfs: no space left in imap.\n");
 
         goto ERR;
     }
 
-    // 原子性地测试并设置位图中的目标位，维护 m_imap 状态。
-    test_and_set_bit(index, &pNsb->m_imap);
+    pr_info("nvmixfs: m_imap in nvmixNewInode(): %ld\n", pNsb->m_imap);
 
-    clflush_cache_range(pNsb, sizeof(struct NvmixSuperBlock));
+    // 编号所在的 inode 组可能还没有被后台线程初始化，在这里同步完成。
+    if (0 != nvmixLazyInitGroup(pSb, NVMIX_INODE_GROUP(index)))
+    {
+        nvmixAllocatorFree(&pNsbh->m_inodeAllocator, index);
 
-    pr_info("nvmixfs: m_imap in nvmixNewInode(): %ld\n", pNsb->m_imap);
+        goto ERR;
+    }
 
 
     // 此函数创建新的 inode 结构，并关联到文件系统的超级块。
@@ -330,6 +564,9 @@ struct inode *nvmixNewInode(struct inode *pParentDirInode)
     pInode->i_ctime = current_time(pInode); // 变更时间 Change Time，作用对象是 inode 元数据。
     pInode->i_blocks = 0;                   // 初始化 inode 的数据块占用数。
 
+    // 编号可能来自刚被回收的 inode，扩展属性区需要清空。
+    nvmixXattrInit(pInode);
+
     // 将新创建的 inode 插入到内核维护的全局 inode 哈希表。
     insert_inode_hash(pInode);
 
@@ -353,7 +590,7 @@ int nvmixUpdateParentDirDentry(struct dentry *pDentry, struct inode *pInode)
     pNih = NVMIX_I(pParentDirInode);
     pSb = pParentDirInode->i_sb;
 
-    pBh = sb_bread(pSb, pNih->m_dataBlockIndex);
+    pBh = sb_bread(pSb, NVMIX_SB_DATA_BLOCK(pSb, pNih->m_dataBlockIndex));
     if (!pBh)
     {
         pr_err("nvmixfs: could not read data block.\n");
@@ -362,26 +599,22 @@ int nvmixUpdateParentDirDentry(struct dentry *pDentry, struct inode *pInode)
         goto ERR;
     }
 
-    // 找到第一个空闲的 NvmixDentry，即 inode 号为 0。
-    for (i = 0; i < NVMIX_MAX_ENTRY_NUM; ++i)
-    {
-        pNd = (struct NvmixDentry *)(pBh->b_data) + i;
-
-        if (0 == pNd->m_ino) break;
-    }
-
-    // 判断父目录是否已经满了。
-    if (NVMIX_MAX_ENTRY_NUM == i)
+    // 找到第一个空闲的 NvmixDentry，即 inode 号为 0。父目录已满时返回 -ENOSPC。
+    i = nvmixFindFreeSlot(pBh);
+    if (i < 0)
     {
         pr_err("nvmixfs: failed to add link, because parent directory is full.\n");
 
-        res = -ENOSPC;
+        res = i;
         goto ERR;
     }
 
-    // 填充磁盘上新目录项的元数据。
-    pNd->m_ino = pInode->i_ino;
-    strncpy(pNd->m_name, pDentry->d_name.name, NVMIX_MAX_NAME_LENGTH);
+    pNd = (struct NvmixDentry *)(pBh->b_data) + i;
+
+    // 填充磁盘上新目录项的元数据，并缓存槽位下标。
+    NVMIX_SET_DENTRY_SLOT(pDentry, i);
+    // 记录文件类型，readdir 直接返回给用户。fs_umode_to_dtype() 将 i_mode 转化为 DT_* 值。
+    nvmixDentryFill(pNd, (const char *)pDentry->d_name.name, pDentry->d_name.len, pInode->i_ino, fs_umode_to_dtype(pInode->i_mode));
 
     // 修改父目录的 Modified Time 和 Changed Time，维护 vfs 的数据结构。
     pParentDirInode->i_mtime = current_time(pInode);
@@ -389,6 +622,8 @@ int nvmixUpdateParentDirDentry(struct dentry *pDentry, struct inode *pInode)
 
     mark_buffer_dirty(pBh);
 
+    nvmixDirIndexUpdate(pParentDirInode, pBh);
+
 
 ERR:
     brelse(pBh);
@@ -398,73 +633,290 @@ ERR:
     return res;
 }
 
-struct NvmixDentry *nvmixFindDentry(struct dentry *pDentry, struct buffer_head **ppBh)
+int nvmixInstantiate(struct dentry *pDentry, struct inode *pInode)
 {
-    struct inode *pParentDirInode = NULL;
-    struct buffer_head *pBh = NULL;
-    struct super_block *pSb = NULL;
-    struct NvmixInodeHelper *pNih = NULL;
-    struct NvmixDentry *pNd = NULL;
-    struct NvmixDentry *pRes = NULL;
-    int i = 0;
+    int res = 0;
 
 
-    // 读取父目录的目录项数组信息，并进行查找。
-    pParentDirInode = pDentry->d_parent->d_inode;
-    pSb = pParentDirInode->i_sb;
-    pNih = NVMIX_I(pParentDirInode);
+    // 将新 inode 关联到父目录的目录项 dentry 中，会维护并修改父目录项的一些信息。与下面的 d_instantiate() 作用不同，注意区分。
+    // 注意此 pDentry 是 pInode 对应的 pDentry，而非父目录的 dentry，前面提到过。
+    // 安全模块（如 SELinux）需要在 inode 对外可见之前写入初始的 security.* 扩展属性。
+    res = nvmixXattrInitSecurity(pInode, d_inode(pDentry->d_parent), &pDentry->d_name);
+    if (0 == res) res = nvmixUpdateParentDirDentry(pDentry, pInode);
+    if (0 != res)
+    {
+        // 清空硬链接计数，目录的初始硬链接数是 2，inode_dec_link_count() 减一次不够。
+        clear_nlink(pInode);
 
-    pBh = sb_bread(pSb, pNih->m_dataBlockIndex);
-    if (!pBh)
+        // 释放 inode 的引用计数。硬链接数为 0，nvmixEvictInode() 会释放 m_imap 中的位。
+        iput(pInode);
+
+        goto ERR;
+    }
+
+    // dentry 作用是关联 inode 和文件名。d_instantiate() 将 dentry 与 inode 绑定，使文件名正确指向文件。
+    d_instantiate(pDentry, pInode);
+    // 标记 inode 为脏，表示其元数据（如权限、大小）或数据已修改，后续内核会通过回写机制将修改同步到磁盘。
+    // 问题来了，内核怎么知道 inode 区的逻辑块号，或者整个流程是怎样的？
+    // 答案是内核会通过 super_operations 的 write_inode 函数（本项目中即 nvmixWriteInode）进行回写，在那里面定义了完整的逻辑，这里只是起一个标记的作用。
+    mark_inode_dirty(pInode);
+
+    pr_info("nvmixfs: created new inode successfully, ino = %lu\n", pInode->i_ino);
+
+
+ERR:
+    return res;
+}
+
+int nvmixMknod(struct inode *pParentDirInode, struct dentry *pDentry, umode_t mode, dev_t rdev)
+{
+    int res = 0;
+    struct inode *pInode = NULL;
+    struct NvmixInodeHelper *pNih = NULL;
+    struct NvmixNvmHelper *pNsbh = NULL;
+    u32 *pRdev = NULL;
+    char *pBitmap = NULL;
+    struct NvmixInode *pNi = NULL;
+
+
+    pInode = nvmixNewInode(pParentDirInode);
+    if (!pInode)
     {
-        pr_err("nvmixfs: could not read data block.\n");
+        pr_err("nvmixfs: error when allocating a new inode.\n");
 
+        res = -ENOMEM;
         goto ERR;
     }
 
-    *ppBh = pBh;
+    pInode->i_mode = mode;
+
+    pNih = NVMIX_I(pInode);
+    pNih->m_dataBlockIndex = NVMIX_DATA_BLOCK_INDEX(pInode->i_ino);
 
-    for (i = 0; i < NVMIX_MAX_ENTRY_NUM; ++i)
+    // 设备文件的设备号持久化到 NVM 的 inline 区，nvmixIget() 从这里读回。
+    if (S_ISCHR(mode) || S_ISBLK(mode))
     {
-        pNd = (struct NvmixDentry *)(pBh->b_data) + i;
+        pNsbh = (struct NvmixNvmHelper *)(pInode->i_sb->s_fs_info);
+        pRdev = (u32 *)NVMIX_INLINE_DATA(pNsbh, pInode->i_ino);
 
-        // 注意这个地方 pDentry 的语义。nvmixFindDentry() 在 nvmixLookup() 中使用，目的是给定目标 pDentry 找到磁盘的 NvmixDentry 结构。读 nvmixLookup() 的代码可知，此时 pDentry 尚未与 pInode 绑定，只有 pDentry->d_name 有值，pDentry->d_inode 是空指针 NULL，因此不能判断 pNd->m_ino == pDentry->d_inode->i_ino，否则会指针内存泄漏。切记！切记！
-        if ((0 != pNd->m_ino) && (0 == strcmp(pNd->m_name, pDentry->d_name.name)))
-        {
-            pr_info("nvmixfs: found entry %s on position: %d\n", pNd->m_name, i);
+        *pRdev = new_encode_dev(rdev);
+        clflush_cache_range(pRdev, sizeof(u32));
+    }
+    else if (S_ISREG(mode))
+    {
+        // 普通文件的子簇位图在 inline 区，随 inode 号复用，新文件的所有数据块都是空洞。
+        pNsbh = (struct NvmixNvmHelper *)(pInode->i_sb->s_fs_info);
+        pBitmap = NVMIX_INLINE_DATA(pNsbh, pInode->i_ino);
+
+        memset(pBitmap, 0, NVMIX_INLINE_DATA_SIZE);
+        clflush_cache_range(pBitmap, NVMIX_INLINE_DATA_SIZE);
 
-            // 需要使用 pRes 存储返回值。因为 pNd 是遍历指针，如果找到条目了返回当然没问题，如果没找到就指向末元素，这样返回值就会出问题了。使用 pRes 则不会出现这样的问题，找到了赋值，找不到仍然是 NULL。
-            pRes = pNd;
+        // 未写入区段同样随 inode 号复用。
+        pNi = (struct NvmixInode *)(pNsbh->m_inodeVirtAddr) + pInode->i_ino;
 
-            break;
+        memset(pNi->m_unwritten, 0, sizeof(pNi->m_unwritten));
+        clflush_cache_range(pNi->m_unwritten, sizeof(pNi->m_unwritten));
+    }
+
+    // 参考 ext4_create()，根据 inode 类型注册对应的操作。
+    nvmixSetInodeOps(pInode, rdev);
+
+    // 数据块编号随 inode 号复用，新目录必须从空的数据块开始，否则会读到已删除目录残留的目录项。
+    if (S_ISDIR(mode))
+    {
+        res = nvmixZeroDataBlocks(pInode->i_sb, pNih->m_dataBlockIndex, 1);
+        if (0 != res)
+        {
+            clear_nlink(pInode);
+            iput(pInode);
+
+            goto ERR;
         }
     }
 
+    // 见 fs.c 的 nvmixIget() 函数注释。
+    if (S_ISDIR(mode)) inc_nlink(pInode);
+
+    res = nvmixInstantiate(pDentry, pInode);
+
 
-// 注意，这里一定不能释放 pBh，因为返回的 struct NvmixDentry * 依赖于 pBh 缓冲区的存在。如果释放了，传递出去以后就会内存泄露。nvmixFindDentry() 作为唯一被 nvmixLookup() 调用的工具函数，nvmixLookup() 需要用到 struct NvmixDentry * 指针，因此需要需要想办法将 pBh 传递出去。一种合适的方法就是使用 pBh 的指针，即二级指针 struct buffer_head **。至于 pBh 的释放留到 nvmixLookup() 中。
 ERR:
-    return pRes;
+    return res;
 }
 
-int nvmixMknod(struct inode *pParentDirInode, struct dentry *pDentry, umode_t mode, bool excl)
+int nvmixLink(struct dentry *pOldDentry, struct inode *pParentDirInode, struct dentry *pDentry)
 {
+    struct inode *pInode = NULL;
     int res = 0;
+
+
+    // vfs 已经保证 pOldDentry 不是目录，且与 pParentDirInode 在同一个文件系统中。参考 simple_link()。
+    pInode = d_inode(pOldDentry);
+
+    // 先写目录项，成功以后再修改 vfs 的计数，这样失败时不需要回滚。
+    res = nvmixUpdateParentDirDentry(pDentry, pInode);
+    if (0 != res)
+    {
+        pr_err("nvmixfs: failed to add hard link %s.\n", pDentry->d_name.name);
+
+        goto ERR;
+    }
+
+    pInode->i_ctime = current_time(pInode);
+    inc_nlink(pInode);
+    mark_inode_dirty(pInode);
+
+    // 新的 dentry 持有 inode 的一个引用。
+    ihold(pInode);
+    d_instantiate(pDentry, pInode);
+
+    pr_info("nvmixfs: linked inode %lu as %s, nlink = %u\n", pInode->i_ino, pDentry->d_name.name, pInode->i_nlink);
+
+
+ERR:
+    return res;
+}
+
+int nvmixSymlink(struct inode *pParentDirInode, struct dentry *pDentry, const char *pSymName)
+{
     struct inode *pInode = NULL;
     struct NvmixInodeHelper *pNih = NULL;
+    struct NvmixNvmHelper *pNsbh = NULL;
+    struct buffer_head *pBh = NULL;
+    char *pInline = NULL;
+    unsigned int len = 0;
+    int res = 0;
+
 
+    // 链接目标最长为一个块（含结尾的 '\0'），块大小在格式化时确定。
+    len = strlen(pSymName);
+    if (len >= pParentDirInode->i_sb->s_blocksize) return -ENAMETOOLONG;
 
     pInode = nvmixNewInode(pParentDirInode);
     if (!pInode)
     {
         pr_err("nvmixfs: error when allocating a new inode.\n");
 
-        res = -ENOMEM;
-        goto ERR;
+        return -ENOMEM;
     }
 
-    pInode->i_mode = mode;
+    pInode->i_mode = S_IFLNK | S_IRWXUGO;
+    pInode->i_size = len;
+
+    pNih = NVMIX_I(pInode);
+    pNih->m_dataBlockIndex = NVMIX_DATA_BLOCK_INDEX(pInode->i_ino);
+
+    if (len < NVMIX_INLINE_DATA_SIZE)
+    {
+        // 快速符号链接，链接目标连同 '\0' 一起写入 NVM 的 inline 区。
+        pNsbh = (struct NvmixNvmHelper *)(pInode->i_sb->s_fs_info);
+        pInline = NVMIX_INLINE_DATA(pNsbh, pInode->i_ino);
+
+        memcpy(pInline, pSymName, len + 1);
+        clflush_cache_range(pInline, len + 1);
+    }
+    else
+    {
+        // 普通符号链接，链接目标写入 SSD 的数据块。
+        pBh = sb_bread(pInode->i_sb, NVMIX_SB_DATA_BLOCK(pInode->i_sb, pNih->m_dataBlockIndex));
+        if (!pBh)
+        {
+            pr_err("nvmixfs: could not read data block.\n");
+
+            clear_nlink(pInode);
+            iput(pInode);
+
+            res = -EIO;
+            goto ERR;
+        }
+
+        memcpy(pBh->b_data, pSymName, len);
+        mark_buffer_dirty(pBh);
+    }
+
+    // i_size 已经设置好，nvmixSetInodeOps() 据此选择快速或普通符号链接的操作。
+    nvmixSetInodeOps(pInode, 0);
+
+    res = nvmixInstantiate(pDentry, pInode);
+
+
+ERR:
+    brelse(pBh);
+    pBh = NULL;
+
+
+    return res;
+}
+
+const char *nvmixGetLink(struct dentry *pDentry, struct inode *pInode, struct delayed_call *pDone)
+{
+    struct buffer_head *pBh = NULL;
+    char *pLink = NULL;
+
+
+    // pDentry 为 NULL 表示处于 RCU 路径解析模式，不能睡眠。读取 SSD 可能睡眠，返回 -ECHILD 让 vfs 退回到引用计数模式再调用一次。
+    if (!pDentry) return ERR_PTR(-ECHILD);
+
+    pBh = sb_bread(pInode->i_sb, NVMIX_SB_DATA_BLOCK(pInode->i_sb, NVMIX_I(pInode)->m_dataBlockIndex));
+    if (!pBh)
+    {
+        pr_err("nvmixfs: could not read data block.\n");
+
+
+        return ERR_PTR(-EIO);
+    }
+
+    pLink = kmalloc(pInode->i_size + 1, GFP_KERNEL);
+    if (pLink)
+    {
+        memcpy(pLink, pBh->b_data, pInode->i_size);
+        pLink[pInode->i_size] = '\0';
+
+        // 路径解析用完以后由 vfs 调用 kfree_link() 释放。
+        set_delayed_call(pDone, kfree_link, pLink);
+    }
+
+    brelse(pBh);
+    pBh = NULL;
+
+
+    return pLink ? pLink : ERR_PTR(-ENOMEM);
+}
+
+int nvmixSetattr(struct dentry *pDentry, struct iattr *pIattr)
+{
+    struct inode *pInode = d_inode(pDentry);
+    int res = 0;
+
+
+    res = setattr_prepare(pDentry, pIattr);
+    if (0 != res) return res;
 
-    // 参考 ext4_create()，对以下操作做了注册。注意对应文件和目录分别处理。
+    if ((pIattr->ia_valid & ATTR_SIZE) && (pIattr->ia_size != i_size_read(pInode)))
+    {
+        // 参考 ext2_setsize()，先等待进行中的直接 I/O，再清零新文件尾所在块的剩余部分，最后截断 page cache 和数据块。
+        inode_dio_wait(pInode);
+
+        res = block_truncate_page(pInode->i_mapping, pIattr->ia_size, nvmixGetBlock);
+        if (0 != res) return res;
+
+        truncate_setsize(pInode, pIattr->ia_size);
+        nvmixTruncateBlocks(pInode, pIattr->ia_size);
+    }
+
+    setattr_copy(pInode, pIattr);
+    mark_inode_dirty(pInode);
+
+
+    return 0;
+}
+
+void nvmixSetInodeOps(struct inode *pInode, dev_t rdev)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+
+
+    // 填充 page cache 相关的 address_space_operations。
     pInode->i_mapping->a_ops = &nvmixAops;
 
     if (S_ISREG(pInode->i_mode))
@@ -476,43 +928,107 @@ int nvmixMknod(struct inode *pParentDirInode, struct dentry *pDentry, umode_t mo
     {
         pInode->i_fop = &nvmixDirFileOps;
         pInode->i_op = &nvmixDirInodeOps;
+    }
+    else if (S_ISLNK(pInode->i_mode))
+    {
+        if (pInode->i_size < NVMIX_INLINE_DATA_SIZE)
+        {
+            // i_link 直接指向 NVM 的 inline 区，inline 区在文件系统卸载前一直有效。
+            pNsbh = (struct NvmixNvmHelper *)(pInode->i_sb->s_fs_info);
 
-        // 见 fs.c 的 nvmixIget() 函数注释。
-        inc_nlink(pInode);
+            pInode->i_link = NVMIX_INLINE_DATA(pNsbh, pInode->i_ino);
+            pInode->i_op = &nvmixFastSymlinkInodeOps;
+        }
+        else
+        {
+            pInode->i_op = &nvmixSymlinkInodeOps;
+        }
+
+        // 符号链接的数据不经过 page cache，但 inode_nohighmem() 是内核对符号链接 mapping 的惯例设置。
+        inode_nohighmem(pInode);
     }
     else
     {
-        // 非普通文件或目录，暂不考虑。
+        // 字符设备、块设备、FIFO 和 socket。init_special_inode() 根据类型设置 i_fop 和 i_rdev。
+        pInode->i_op = &nvmixSpecialInodeOps;
+
+        init_special_inode(pInode, pInode->i_mode, rdev);
     }
+}
 
+int nvmixGetDentrySlot(struct buffer_head *pBh, struct dentry *pDentry)
+{
+    struct NvmixDentry *pNd = NULL;
+    unsigned long ino = 0;
+    long slot = 0;
+    int i = 0;
 
-    pNih = NVMIX_I(pInode);
-    pNih->m_dataBlockIndex = NVMIX_FIRST_DATA_BLOCK_INDEX + pInode->i_ino;
 
-    // 将新 inode 关联到父目录的目录项 dentry 中，会维护并修改父目录项的一些信息。与下面的 d_instantiate() 作用不同，注意区分。
-    // 注意此 pDentry 是 pInode 对应的 pDentry，而非父目录的 dentry，前面提到过。
-    res = nvmixUpdateParentDirDentry(pDentry, pInode);
-    if (0 != res)
+    ino = d_inode(pDentry)->i_ino;
+
+    // 快速路径：缓存的槽位仍然指向该目录项。
+    slot = NVMIX_DENTRY_SLOT(pDentry);
+    if ((slot >= 0) && (slot < NVMIX_MAX_ENTRY_NUM))
     {
-        // 减少 inode 的硬链接计数。
-        inode_dec_link_count(pInode);
+        pNd = (struct NvmixDentry *)(pBh->b_data) + slot;
 
-        // 释放 inode 的引用计数。
-        iput(pInode);
+        if ((pNd->m_ino == ino) && nvmixDentryNameMatch(pNd, (const char *)pDentry->d_name.name, pDentry->d_name.len)) return slot;
+    }
 
-        goto ERR;
+    // 慢速路径：遍历目录并重新缓存。
+    for (i = 0; i < NVMIX_MAX_ENTRY_NUM; ++i)
+    {
+        pNd = (struct NvmixDentry *)(pBh->b_data) + i;
+
+        if ((0 != pNd->m_ino) && (pNd->m_ino == ino) && nvmixDentryNameMatch(pNd, (const char *)pDentry->d_name.name, pDentry->d_name.len))
+        {
+            NVMIX_SET_DENTRY_SLOT(pDentry, i);
+
+
+            return i;
+        }
     }
 
-    // dentry 作用是关联 inode 和文件名。d_instantiate() 将 dentry 与 inode 绑定，使文件名正确指向文件。
-    d_instantiate(pDentry, pInode);
-    // 标记 inode 为脏，表示其元数据（如权限、大小）或数据已修改，后续内核会通过回写机制将修改同步到磁盘。
-    // 问题来了，内核怎么知道 inode 区的逻辑块号，或者整个流程是怎样的？
-    // 答案是内核会通过 super_operations 的 write_inode 函数（本项目中即 nvmixWriteInode）进行回写，在那里面定义了完整的逻辑，这里只是起一个标记的作用。
-    mark_inode_dirty(pInode);
+    pr_err("nvmixfs: could not find dentry %s in its parent directory.\n", pDentry->d_name.name);
 
-    pr_info("nvmixfs: created new inode successfully, ino = %lu\n", pInode->i_ino);
+
+    return -ENOENT;
+}
+
+int nvmixFindFreeSlot(struct buffer_head *pBh)
+{
+    int i = 0;
+
+
+    i = nvmixDentryFindFree((struct NvmixDentry *)(pBh->b_data));
+    if (i >= 0) return i;
+
+    pr_err("nvmixfs: no free slot left in directory.\n");
+
+
+    return -ENOSPC;
+}
+
+int nvmixCheckDirEmpty(struct inode *pDirInode)
+{
+    struct buffer_head *pBh = NULL;
+    int res = 0;
+
+
+    pBh = sb_bread(pDirInode->i_sb, NVMIX_SB_DATA_BLOCK(pDirInode->i_sb, NVMIX_I(pDirInode)->m_dataBlockIndex));
+    if (!pBh)
+    {
+        pr_err("nvmixfs: could not read data block.\n");
+
+
+        return -EIO;
+    }
+
+    if (!nvmixDentryIsEmpty((struct NvmixDentry *)(pBh->b_data))) res = -ENOTEMPTY;
+
+    brelse(pBh);
+    pBh = NULL;
 
 
-ERR:
     return res;
 }
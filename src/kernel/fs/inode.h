@@ -11,6 +11,12 @@
 #define _NVMIX_INODE_H_
 
 #include <linux/fs.h>
+#include <linux/mutex.h>
+#include <linux/rwsem.h>
+#include <linux/rcupdate.h>
+
+
+struct NvmixDirIndex;
 
 
 /**
@@ -30,6 +36,23 @@ struct NvmixInodeHelper
      * @detail 目前本文件系统最多 32 个 inode，即最多 32 个数据块，因此目前使用 unsigned short 类型。
      */
     unsigned short m_dataBlockIndex;
+
+    /**
+     * @brief 保护该 inode 在 NVM 上扩展属性区的读写信号量。
+     * @details vfs 在 setxattr 时持有 i_rwsem，但 getxattr 不持有任何锁，需要本信号量防止读到写了一半的扩展属性。
+     */
+    struct rw_semaphore m_xattrSem;
+
+    /**
+     * @brief 保护普通文件在 NVM 上的未写入区段和子簇位图的组合更新，见 page.c。
+     * @details 回写和预读映射数据块时不持有 i_rwsem，只能由本锁与 fallocate 互斥。
+     */
+    struct mutex m_unwrittenLock;
+
+    /**
+     * @brief 目录数据块的 RCU 副本，只对目录有效，见 dir.h 的 NvmixDirIndex。
+     */
+    struct NvmixDirIndex __rcu *m_pDirIndex;
 };
 
 
@@ -41,6 +64,17 @@ struct NvmixInodeHelper
  */
 #define NVMIX_I(pVfsInode) container_of(pVfsInode, struct NvmixInodeHelper, m_vfsInode)
 
+/**
+ * @brief 获取 vfs dentry 缓存的目录项槽位下标。
+ * @details lookup 和创建目录项时会把目录项在父目录数据块 NvmixDentry[] 数组中的槽位下标缓存在 dentry 的私有数据 d_fsdata 中，rename 和 unlink 可以直接定位槽位，而不用遍历整个目录。d_fsdata 默认是 NULL，因此存储时加 1，未缓存时本宏得到 -1。
+ */
+#define NVMIX_DENTRY_SLOT(pDentry) ((long)((pDentry)->d_fsdata) - 1)
+
+/**
+ * @brief 设置 vfs dentry 缓存的目录项槽位下标。见 NVMIX_DENTRY_SLOT。
+ */
+#define NVMIX_SET_DENTRY_SLOT(pDentry, slot) ((pDentry)->d_fsdata = (void *)((long)(slot) + 1))
+
 
 /**
  * @brief 在父目录中查找指定目录项。注册目录 inode 操作接口的 lookup 函数。
@@ -48,6 +82,8 @@ struct NvmixInodeHelper
  * @param pDentry 要查找的目录项的 dentry 指针。
  * @param flags 标志位。
  * @return 返回 NULL 表示成功，返回非空代表可能是一些特殊情况。
+ * @details 在父目录的 RCU 副本中查找，副本建立以后不再读 SSD。inode 元数据在 NVM 上，nvmixIget() 也不读 SSD。
+ * @details 本文件系统是本地文件系统，dcache 中的 dentry 总是可信的，因此不提供 d_revalidate；也不提供 permission，由 vfs 使用 generic_permission()，它在 RCU 模式下只读 inode 字段。这样 dcache 命中时 stat() 的路径解析全程停留在 RCU 模式，不进入本文件系统，也不持有会睡眠的锁。
  */
 struct dentry *nvmixLookup(struct inode *pParentDirInode, struct dentry *pDentry, unsigned int flags);
 
@@ -61,6 +97,15 @@ struct dentry *nvmixLookup(struct inode *pParentDirInode, struct dentry *pDentry
  */
 int nvmixCreate(struct inode *pParentDirInode, struct dentry *pDentry, umode_t mode, bool excl);
 
+/**
+ * @brief 为已有的文件创建硬链接。注册目录 inode 操作接口的 link 函数。
+ * @param pOldDentry 已有文件的 dentry 指针。
+ * @param pParentDirInode 新链接所在父目录的 inode 指针。
+ * @param pDentry 新链接的 dentry 指针。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int nvmixLink(struct dentry *pOldDentry, struct inode *pParentDirInode, struct dentry *pDentry);
+
 /**
  * @brief 在父目录中删除指定文件。注册目录 inode 操作接口的 unlink 函数。
  * @param pParentDirInode 父目录的 inode 指针。
@@ -69,6 +114,16 @@ int nvmixCreate(struct inode *pParentDirInode, struct dentry *pDentry, umode_t m
  */
 int nvmixUnlink(struct inode *pParentDirInode, struct dentry *pDentry);
 
+/**
+ * @brief 在父目录中创建符号链接。注册目录 inode 操作接口的 symlink 函数。
+ * @param pParentDirInode 父目录的 inode 指针。
+ * @param pDentry 新创建的符号链接的 dentry 指针。
+ * @param pSymName 链接目标。
+ * @return 成功返回 0，失败返回非 0。
+ * @details 链接目标长度小于 NVMIX_INLINE_DATA_SIZE 时存储在 NVM 的 inline 区，否则存储在 SSD 的数据块上。
+ */
+int nvmixSymlink(struct inode *pParentDirInode, struct dentry *pDentry, const char *pSymName);
+
 /**
  * @brief 在父目录中创建新目录。注册目录 inode 操作接口的 mkdir 函数。
  * @param pParentDirInode 父目录的 inode 指针。
@@ -86,5 +141,55 @@ int nvmixMkdir(struct inode *pParentDirInode, struct dentry *pDentry, umode_t mo
  */
 int nvmixRmdir(struct inode *pParentDirInode, struct dentry *pDentry);
 
+/**
+ * @brief 在父目录中创建新的节点。注册目录 inode 操作接口的 mknod 函数。
+ * @param pParentDirInode 父目录的 inode 指针。
+ * @param pDentry 新创建的节点的 dentry 指针。
+ * @param mode 创建模式参数，包括文件类型。
+ * @param rdev 设备号，仅对字符设备和块设备有效。
+ * @return 成功返回 0，失败返回非 0。
+ * @details nvmixCreate() 和 nvmixMkdir() 也通过本函数创建普通文件和目录。
+ * @details 接口的参数逆天。pParentDirInode 是父目录的 inode 节点，在函数里我需要手动创建新的 vfs inode。而 pDentry 却是新 inode 节点对应的 dentry 对象，内核帮我创建好了。很容易误解为父目录的 dentry，我们需要自己手动创建 dentry，但是内核似乎并没有这种函数。
+ */
+int nvmixMknod(struct inode *pParentDirInode, struct dentry *pDentry, umode_t mode, dev_t rdev);
+
+/**
+ * @brief 重命名或移动目录项。注册目录 inode 操作接口的 rename 函数。
+ * @param pOldDirInode 源目录的 inode 指针。
+ * @param pOldDentry 源目录项的 dentry 指针。
+ * @param pNewDirInode 目标目录的 inode 指针。
+ * @param pNewDentry 目标目录项的 dentry 指针，可能是负状态。
+ * @param flags 标志位，支持 RENAME_NOREPLACE 和 RENAME_EXCHANGE。
+ * @return 成功返回 0，失败返回非 0。
+ * @details 两个目录的数据块修改通过 NVM 日志区一次原子提交，见 journal.h。目录项槽位通过 NVMIX_DENTRY_SLOT 直接定位，开销与目录大小无关。
+ */
+int nvmixRename(struct inode *pOldDirInode, struct dentry *pOldDentry, struct inode *pNewDirInode, struct dentry *pNewDentry, unsigned int flags);
+
+/**
+ * @brief 读取存储在 SSD 上的符号链接目标。注册普通符号链接 inode 操作接口的 get_link 函数。
+ * @param pDentry 符号链接的 dentry 指针，RCU 路径解析模式下为 NULL。
+ * @param pInode 符号链接的 inode 指针。
+ * @param pDone 用于注册释放返回值的回调。
+ * @return 成功返回链接目标，失败返回错误指针。
+ */
+const char *nvmixGetLink(struct dentry *pDentry, struct inode *pInode, struct delayed_call *pDone);
+
+/**
+ * @brief 修改文件的属性。注册文件 inode 操作接口的 setattr 函数。
+ * @param pDentry 文件的 dentry 指针。
+ * @param pIattr 要修改的属性。
+ * @return 成功返回 0，失败返回非 0。
+ * @details 与 simple_setattr() 相同，只是截断时还需要清零最后一个数据块中新文件尾之后的部分，并在子簇位图中释放新文件尾之后的数据块，否则再次扩展文件时会读到截断前的旧数据。
+ */
+int nvmixSetattr(struct dentry *pDentry, struct iattr *pIattr);
+
+/**
+ * @brief 根据 inode 的类型注册对应的 inode 操作、文件操作和页面缓存操作。
+ * @param pInode inode 指针，i_mode 和 i_size 需已设置好。
+ * @param rdev 设备号，仅对字符设备和块设备有效。
+ * @details nvmixIget() 从 NVM 读取 inode 和 nvmixMknod() 等新建 inode 时共用。
+ */
+void nvmixSetInodeOps(struct inode *pInode, dev_t rdev);
+
 
 #endif
@@ -0,0 +1,214 @@
+/**
+ * @file journal.c
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief NVM 日志区操作的源文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "journal.h"
+
+#include "defs.h"
+#include "fs.h"
+
+#include <linux/fs.h>
+#include <linux/buffer_head.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <asm/cacheflush.h>
+
+
+/**
+ * @brief 将一条更新记录应用到目录数据块的缓冲区上，并标记缓冲区为脏。
+ * @param pEntry 更新记录的指针。
+ * @param pBh 目录数据块的缓冲区头指针。
+ */
+static void nvmixJournalApply(const struct NvmixJournalEntry *pEntry, struct buffer_head *pBh);
+
+/**
+ * @brief 将已提交的日志中的记录全部写回 SSD，不清空日志。
+ * @param pSb 超级块指针。
+ * @param pNj NVM 日志区的指针。
+ * @return 成功返回 0，失败返回非 0。
+ */
+static int nvmixJournalReplay(struct super_block *pSb, struct NvmixJournal *pNj);
+
+/**
+ * @brief 清空日志，即清除提交标志并持久化。
+ * @param pNj NVM 日志区的指针。
+ */
+static void nvmixJournalClear(struct NvmixJournal *pNj);
+
+
+int nvmixJournalUpdateDentries(struct super_block *pSb, const struct NvmixJournalEntry *pEntries, struct buffer_head **ppBhs, int num)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+    struct NvmixJournal *pNj = NULL;
+    bool isSynced = true;
+    int i = 0;
+    int j = 0;
+    int res = 0;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+    pNj = (struct NvmixJournal *)(pNsbh->m_journalVirtAddr);
+
+    mutex_lock(&pNsbh->m_journalLock);
+
+    // 上一次更新写回失败时日志仍是提交状态。重放并清空之前不能覆盖其中的记录，否则在覆盖途中崩溃会重放新旧混杂的记录。
+    if (0 != pNj->m_commit)
+    {
+        res = nvmixJournalReplay(pSb, pNj);
+        if (0 != res)
+        {
+            pr_err("nvmixfs: committed journal still cannot be written back, refusing to update directories.\n");
+
+            goto ERR;
+        }
+
+        nvmixJournalClear(pNj);
+    }
+
+    // 第一步，写入更新记录并持久化。此时 m_commit 仍为 0，在这里崩溃的话日志会被忽略，相当于什么都没发生。
+    memcpy(pNj->m_entries, pEntries, num * sizeof(struct NvmixJournalEntry));
+    pNj->m_entryNum = num;
+
+    clflush_cache_range(pNj->m_entries, num * sizeof(struct NvmixJournalEntry));
+    clflush_cache_range(&pNj->m_entryNum, sizeof(pNj->m_entryNum));
+
+    // 第二步，提交。clflush_cache_range() 内部前后都有 mb()，保证更新记录一定先于提交标志落到 NVM 上。这一次 8 字节写入就是整个操作的原子提交点。
+    WRITE_ONCE(pNj->m_commit, 1);
+    clflush_cache_range(&pNj->m_commit, sizeof(pNj->m_commit));
+
+    // 第三步，修改 SSD 目录数据块的缓冲区。
+    for (i = 0; i < num; ++i) nvmixJournalApply(pEntries + i, ppBhs[i]);
+
+    // 第四步，同步写回 SSD。源目录和目标目录相同时两条记录对应同一个缓冲区，只需写一次。
+    for (i = 0; i < num; ++i)
+    {
+        for (j = 0; j < i; ++j)
+        {
+            if (ppBhs[j] == ppBhs[i]) break;
+        }
+        if (j < i) continue;
+
+        if (0 != sync_dirty_buffer(ppBhs[i])) isSynced = false;
+    }
+
+    // 更新在提交点已经生效，写回失败不改变结果。保留已提交的日志，由下一次更新或者下次挂载时的 nvmixJournalRecover() 重放。
+    if (!isSynced)
+    {
+        pr_err("nvmixfs: failed to write back directory blocks, journal kept for recovery.\n");
+
+        goto ERR;
+    }
+
+    // 第五步，目录数据块均已落盘，清空日志。
+    nvmixJournalClear(pNj);
+
+
+ERR:
+    mutex_unlock(&pNsbh->m_journalLock);
+
+
+    return res;
+}
+
+int nvmixJournalRecover(struct super_block *pSb)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+    struct NvmixJournal *pNj = NULL;
+    int res = 0;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+    pNj = (struct NvmixJournal *)(pNsbh->m_journalVirtAddr);
+
+    // 日志为空，上次是正常卸载或者崩溃发生在提交点之前。
+    if (0 == pNj->m_commit) return 0;
+
+    pr_info("nvmixfs: replaying journal with %u entries.\n", pNj->m_entryNum);
+
+    res = nvmixJournalReplay(pSb, pNj);
+    if (0 != res) goto ERR;
+
+    nvmixJournalClear(pNj);
+
+    pr_info("nvmixfs: replayed journal successfully.\n");
+
+
+ERR:
+    return res;
+}
+
+
+int nvmixJournalReplay(struct super_block *pSb, struct NvmixJournal *pNj)
+{
+    struct NvmixJournalEntry *pEntry = NULL;
+    struct buffer_head *pBh = NULL;
+    unsigned int i = 0;
+    int res = 0;
+
+
+    if (pNj->m_entryNum > NVMIX_JOURNAL_MAX_ENTRY_NUM)
+    {
+        pr_err("nvmixfs: corrupted journal, entry number is %u.\n", pNj->m_entryNum);
+
+        res = -EINVAL;
+        goto ERR;
+    }
+
+    for (i = 0; i < pNj->m_entryNum; ++i)
+    {
+        pEntry = pNj->m_entries + i;
+
+        if (pEntry->m_slot >= NVMIX_MAX_ENTRY_NUM)
+        {
+            pr_err("nvmixfs: corrupted journal, slot is %u.\n", pEntry->m_slot);
+
+            res = -EINVAL;
+            goto ERR;
+        }
+
+        pBh = sb_bread(pSb, NVMIX_SB_DATA_BLOCK(pSb, pEntry->m_dataBlockIndex));
+        if (!pBh)
+        {
+            pr_err("nvmixfs: could not read data block.\n");
+
+            res = -EIO;
+            goto ERR;
+        }
+
+        // 日志记录的是槽位的最终内容，重复写入是幂等的，因此不需要关心崩溃前已经写回了哪些块。
+        nvmixJournalApply(pEntry, pBh);
+        res = sync_dirty_buffer(pBh);
+
+        brelse(pBh);
+        pBh = NULL;
+
+        if (0 != res) goto ERR;
+    }
+
+
+ERR:
+    return res;
+}
+
+void nvmixJournalApply(const struct NvmixJournalEntry *pEntry, struct buffer_head *pBh)
+{
+    struct NvmixDentry *pNd = NULL;
+
+
+    pNd = (struct NvmixDentry *)(pBh->b_data) + pEntry->m_slot;
+
+    memcpy(pNd, &pEntry->m_dentry, sizeof(struct NvmixDentry));
+
+    mark_buffer_dirty(pBh);
+}
+
+void nvmixJournalClear(struct NvmixJournal *pNj)
+{
+    WRITE_ONCE(pNj->m_commit, 0);
+    clflush_cache_range(&pNj->m_commit, sizeof(pNj->m_commit));
+}
@@ -0,0 +1,39 @@
+/**
+ * @file journal.h
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief NVM 日志区操作的头文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#ifndef _NVMIX_JOURNAL_H_
+#define _NVMIX_JOURNAL_H_
+
+#include "defs.h"
+
+#include <linux/fs.h>
+#include <linux/buffer_head.h>
+
+
+/**
+ * @brief 原子地更新一个或多个目录数据块中的目录项槽位。
+ * @param pSb 超级块指针。
+ * @param pEntries 目录项槽位的更新记录数组。
+ * @param ppBhs 与 pEntries 一一对应的目录数据块的缓冲区头指针数组，由调用者读入并负责释放。
+ * @param num 更新记录的数量，不超过 NVMIX_JOURNAL_MAX_ENTRY_NUM。
+ * @return 更新已提交返回 0；失败返回非 0，此时缓冲区和 NVM 都没有修改。
+ * @details 先将更新记录写入 NVM 日志区并提交，然后修改缓冲区并同步写回 SSD，最后清空日志。提交以后更新就已经生效，写回失败时仍返回 0，保留已提交的日志：下一次调用先重放并清空它，重放失败时拒绝更新；没有下一次调用时在下次挂载时重放。
+ */
+int nvmixJournalUpdateDentries(struct super_block *pSb, const struct NvmixJournalEntry *pEntries, struct buffer_head **ppBhs, int num);
+
+/**
+ * @brief 挂载时重放 NVM 日志区中已提交但未完成的更新。
+ * @param pSb 超级块指针。
+ * @return 成功返回 0，失败返回非 0。
+ * @details 需在 sb_set_blocksize() 之后、读取根目录 inode 之前调用。
+ */
+int nvmixJournalRecover(struct super_block *pSb);
+
+
+#endif
@@ -0,0 +1,202 @@
+/**
+ * @file lazyinit.c
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief inode 组延迟初始化的源文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "lazyinit.h"
+
+#include "defs.h"
+#include "fs.h"
+
+#include <linux/fs.h>
+#include <linux/buffer_head.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <asm/cacheflush.h>
+
+
+/**
+ * @brief 后台线程每初始化一组以后让出的时间。
+ */
+#define NVMIX_LAZYINIT_INTERVAL (HZ / 10)
+
+
+/**
+ * @brief 后台初始化线程的主函数。
+ * @param pData 超级块指针。
+ * @return 总是返回 0。
+ */
+static int nvmixLazyInitThread(void *pData);
+
+
+int nvmixLazyInitGroup(struct super_block *pSb, unsigned int group)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+    struct NvmixSuperBlock *pNsb = NULL;
+    unsigned long firstIno = 0;
+    void *pSlot = NULL;
+    int res = 0;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+    pNsb = (struct NvmixSuperBlock *)(pNsbh->m_superBlockVirtAddr);
+
+    // 快速路径：组已经初始化。
+    if (test_bit(group, &pNsb->m_initGroups)) return 0;
+
+    mutex_lock(&pNsbh->m_lazyInitLock);
+
+    // 等锁期间可能已被其他线程初始化。
+    if (test_bit(group, &pNsb->m_initGroups)) goto ERR;
+
+    firstIno = group * NVMIX_INODE_GROUP_SIZE;
+
+    // 未初始化的组中不会有已分配的 inode，清零不会破坏任何数据。
+    pSlot = (struct NvmixInode *)(pNsbh->m_inodeVirtAddr) + firstIno;
+    memset(pSlot, 0, NVMIX_INODE_GROUP_SIZE * sizeof(struct NvmixInode));
+    clflush_cache_range(pSlot, NVMIX_INODE_GROUP_SIZE * sizeof(struct NvmixInode));
+
+    pSlot = NVMIX_INLINE_DATA(pNsbh, firstIno);
+    memset(pSlot, 0, NVMIX_INODE_GROUP_SIZE * NVMIX_INLINE_DATA_SIZE);
+    clflush_cache_range(pSlot, NVMIX_INODE_GROUP_SIZE * NVMIX_INLINE_DATA_SIZE);
+
+    pSlot = (char *)(pNsbh->m_xattrInlineVirtAddr) + firstIno * NVMIX_XATTR_INLINE_SIZE;
+    memset(pSlot, 0, NVMIX_INODE_GROUP_SIZE * NVMIX_XATTR_INLINE_SIZE);
+    clflush_cache_range(pSlot, NVMIX_INODE_GROUP_SIZE * NVMIX_XATTR_INLINE_SIZE);
+
+    res = nvmixZeroDataBlocks(pSb, NVMIX_DATA_BLOCK_INDEX(firstIno), NVMIX_INODE_GROUP_SIZE);
+    if (0 != res)
+    {
+        pr_err("nvmixfs: failed to initialize inode group %u.\n", group);
+
+        goto ERR;
+    }
+
+    // 以上内容都已持久化，最后置位。
+    set_bit(group, &pNsb->m_initGroups);
+    clflush_cache_range(&pNsb->m_initGroups, sizeof(pNsb->m_initGroups));
+
+    pr_info("nvmixfs: initialized inode group %u.\n", group);
+
+
+ERR:
+    mutex_unlock(&pNsbh->m_lazyInitLock);
+
+
+    return res;
+}
+
+int nvmixZeroDataBlocks(struct super_block *pSb, unsigned long blockIndex, unsigned int num)
+{
+    struct buffer_head *pBh = NULL;
+    unsigned int i = 0;
+    int res = 0;
+
+
+    for (i = 0; i < num; ++i)
+    {
+        // sb_getblk() 与 sb_bread() 不同，只获取缓冲区而不从磁盘读取旧内容。
+        pBh = sb_getblk(pSb, NVMIX_SB_DATA_BLOCK(pSb, blockIndex + i));
+        if (!pBh)
+        {
+            res = -ENOMEM;
+
+            break;
+        }
+
+        lock_buffer(pBh);
+        memset(pBh->b_data, 0, pBh->b_size);
+        set_buffer_uptodate(pBh);
+        unlock_buffer(pBh);
+
+        mark_buffer_dirty(pBh);
+
+        res = sync_dirty_buffer(pBh);
+
+        brelse(pBh);
+        pBh = NULL;
+
+        if (0 != res) break;
+    }
+
+
+    return res;
+}
+
+void nvmixLazyInitStart(struct super_block *pSb)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+    struct NvmixSuperBlock *pNsb = NULL;
+    struct task_struct *pTask = NULL;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+    pNsb = (struct NvmixSuperBlock *)(pNsbh->m_superBlockVirtAddr);
+
+    if (NVMIX_INODE_GROUP_NUM == find_first_zero_bit(&pNsb->m_initGroups, NVMIX_INODE_GROUP_NUM)) return;
+
+    // 启动失败不影响挂载，剩余的组会在第一次使用时初始化。
+    pTask = kthread_run(nvmixLazyInitThread, pSb, "nvmixfs-lazyinit/%s", pSb->s_id);
+    if (IS_ERR(pTask))
+    {
+        pr_err("nvmixfs: failed to start lazy init thread.\n");
+
+        return;
+    }
+
+    pNsbh->m_pLazyInitTask = pTask;
+}
+
+void nvmixLazyInitStop(struct super_block *pSb)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+
+    if (!pNsbh->m_pLazyInitTask) return;
+
+    kthread_stop(pNsbh->m_pLazyInitTask);
+    pNsbh->m_pLazyInitTask = NULL;
+}
+
+
+int nvmixLazyInitThread(void *pData)
+{
+    struct super_block *pSb = NULL;
+    unsigned int group = 0;
+
+
+    pSb = (struct super_block *)pData;
+
+    // 最低优先级，只在系统空闲时运行。
+    set_user_nice(current, MAX_NICE);
+
+    for (group = 0; (group < NVMIX_INODE_GROUP_NUM) && !kthread_should_stop(); ++group)
+    {
+        if (0 != nvmixLazyInitGroup(pSb, group)) break;
+
+        schedule_timeout_interruptible(NVMIX_LAZYINIT_INTERVAL);
+    }
+
+    // kthread_stop() 要求线程在被停止之前不能退出，因此初始化完成后睡眠等待。先设置状态再检查，避免错过 kthread_stop() 的唤醒。
+    for (;;)
+    {
+        set_current_state(TASK_INTERRUPTIBLE);
+
+        if (kthread_should_stop()) break;
+
+        schedule();
+    }
+
+    __set_current_state(TASK_RUNNING);
+
+
+    return 0;
+}
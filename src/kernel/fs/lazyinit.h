@@ -0,0 +1,49 @@
+/**
+ * @file lazyinit.h
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief inode 组延迟初始化的头文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#ifndef _NVMIX_LAZYINIT_H_
+#define _NVMIX_LAZYINIT_H_
+
+#include <linux/fs.h>
+
+
+/**
+ * @brief 确保 inode 组已经初始化。
+ * @param pSb 超级块指针。
+ * @param group inode 组号。
+ * @return 成功返回 0，失败返回非 0。
+ * @details 已初始化时只检查一位，不加锁。否则清零组内所有 inode 在 NVM 上的槽位和 SSD 上的数据块，全部持久化以后才在 m_initGroups 中置位，中途崩溃时下次仍会重新初始化。可能睡眠。
+ */
+int nvmixLazyInitGroup(struct super_block *pSb, unsigned int group);
+
+/**
+ * @brief 清零 SSD 上连续的簇的第一个数据块并同步写回。
+ * @param pSb 超级块指针。
+ * @param blockIndex 起始簇号。
+ * @param num 簇的数量。
+ * @return 成功返回 0，失败返回非 0。
+ * @details 不读取块的旧内容，直接覆盖。目录只使用簇的第一个数据块；普通文件未写过的数据块由子簇位图标记为空洞，不需要清零。
+ */
+int nvmixZeroDataBlocks(struct super_block *pSb, unsigned long blockIndex, unsigned int num);
+
+/**
+ * @brief 以读写方式挂载或者重新挂载为读写后启动后台线程初始化剩余的 inode 组。
+ * @param pSb 超级块指针。
+ * @details 所有组都已初始化时不启动。只读挂载时由调用者跳过，重新挂载时 s_flags 还没有更新，不能在这里判断。线程以最低优先级运行，每初始化一组让出一段时间，不影响前台 I/O。
+ */
+void nvmixLazyInitStart(struct super_block *pSb);
+
+/**
+ * @brief 停止后台初始化线程并等待其退出。卸载和重新挂载为只读时调用。
+ * @param pSb 超级块指针。
+ */
+void nvmixLazyInitStop(struct super_block *pSb);
+
+
+#endif
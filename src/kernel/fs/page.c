@@ -9,14 +9,991 @@
 
 #include "page.h"
 
-#include <linux/fs.h>
+#include "defs.h"
+#include "fs.h"
+#include "file.h"
+#include "inode.h"
 
+#include <linux/mm.h>
+#include <linux/bitmap.h>
+#include <linux/writeback.h>
+#include <linux/uio.h>
+#include <linux/mpage.h>
+#include <linux/blkdev.h>
+#include <linux/pagemap.h>
+#include <asm/cacheflush.h>
+
+
+/**
+ * @brief 获得普通文件的子簇位图。
+ */
+static unsigned long *nvmixClusterBitmap(struct inode *pInode);
+
+/**
+ * @brief 返回每个簇包含的数据块数量。
+ */
+static unsigned long nvmixClusterBlockNum(struct super_block *pSb);
+
+/**
+ * @brief 获得普通文件在 NVM 上的未写入区段。
+ */
+static struct NvmixUnwrittenExtent *nvmixUnwrittenExtents(struct inode *pInode);
+
+/**
+ * @brief 判断文件系统是否启用了未写入区段。未启用时所有置位的数据块都是已写入的，不需要加锁查询。
+ */
+static bool nvmixHasUnwritten(struct super_block *pSb);
+
+/**
+ * @brief 判断数据块是否在未写入区段中。调用者需持有 m_unwrittenLock。
+ */
+static bool nvmixIsUnwritten(struct inode *pInode, unsigned long block);
+
+/**
+ * @brief 将未写入区段展开为位图。调用者需持有 m_unwrittenLock。
+ * @param pInode 普通文件的 inode 指针。
+ * @param pUnwritten 输出的位图，共 NVMIX_CLUSTER_BITMAP_BITS 位。
+ */
+static void nvmixLoadUnwritten(struct inode *pInode, unsigned long *pUnwritten);
+
+/**
+ * @brief 将位图重新编码为未写入区段并持久化。调用者需持有 m_unwrittenLock。
+ * @param pInode 普通文件的 inode 指针。
+ * @param pUnwritten 未写入的数据块的位图，必须是子簇位图的子集。
+ * @return 成功返回 0，清零 SSD 失败返回负的错误码，此时 NVM 上的区段不变。
+ * @details 按块号顺序记录前 NVMIX_MAX_UNWRITTEN_NUM 段，记录不下的区段直接在 SSD 上清零，之后按已写入处理，读到的内容同样是 0。第一次记录区段时启用 NVMIX_FEATURE_INCOMPAT_UNWRITTEN。
+ */
+static int nvmixStoreUnwritten(struct inode *pInode, const unsigned long *pUnwritten);
+
+/**
+ * @brief 从未写入区段中去掉 [start, end) 中的数据块。调用者需持有 m_unwrittenLock。
+ */
+static int nvmixClearUnwritten(struct inode *pInode, unsigned long start, unsigned long end);
+
+/**
+ * @brief 在超级块上启用 NVMIX_FEATURE_INCOMPAT_UNWRITTEN。
+ */
+static void nvmixEnableUnwritten(struct super_block *pSb);
+
+/**
+ * @brief 判断数据块是否已经写入，即在子簇位图中置位并且不在未写入区段中。
+ */
+static bool nvmixIsWritten(struct inode *pInode, unsigned long block);
+
+/**
+ * @brief 判断文件的 [pos, pos + count) 是否涉及未写入区段，供不能睡眠的调用者使用。
+ * @return 涉及或者拿不到 m_unwrittenLock 时返回 true。
+ */
+static bool nvmixRangeTouchesUnwritten(struct inode *pInode, loff_t pos, size_t count);
+
+/**
+ * @brief 计算已经写入的数据块的位图，即子簇位图去掉未写入区段。
+ * @param pInode 普通文件的 inode 指针。
+ * @param pWritten 输出的位图，共 NVMIX_CLUSTER_BITMAP_BITS 位。
+ * @param pUnwritten 非 NULL 时同时输出未写入的数据块的位图。
+ */
+static void nvmixLoadWritten(struct inode *pInode, unsigned long *pWritten, unsigned long *pUnwritten);
+
+/**
+ * @brief 等待已经提交的缓冲区读写完成并释放它们。
+ * @return 全部成功返回 0，否则返回 -EIO。
+ */
+static int nvmixWaitBuffers(struct buffer_head **ppBhs, int num);
 
 /**
- * @brief 注册本文件系统的页面缓存操作，提供基本的文件读写缓存能力。
+ * @brief 持久化子簇位图中 [start, end) 所在的字。
+ */
+static void nvmixFlushBitmap(unsigned long *pBitmap, unsigned long start, unsigned long end);
+
+/**
+ * @brief 读取一页。注册页面缓存操作的 readpage 函数。
+ */
+static int nvmixReadpage(struct file *pFile, struct page *pPage);
+
+/**
+ * @brief 读取预读窗口中的一批页。注册页面缓存操作的 readpages 函数。
+ * @details 簇内的数据块是连续的，mpage_readpages() 把相邻的页合并为一个 bio。整页都是空洞的页只清零，不读取 SSD，单独统计。统计同时计入挂载点和发起读取的打开的文件，见 NvmixFileInfo。
+ */
+static int nvmixReadpages(struct file *pFile, struct address_space *pMapping, struct list_head *pPages, unsigned nrPages);
+
+/**
+ * @brief 判断文件的第 index 页是否整页都是空洞或者未写入的块。
+ */
+static bool nvmixPageIsHole(struct inode *pInode, pgoff_t index);
+
+/**
+ * @brief 回写一页。注册页面缓存操作的 writepage 函数。
+ */
+static int nvmixWritepage(struct page *pPage, struct writeback_control *pWbc);
+
+/**
+ * @brief 准备写入。注册页面缓存操作的 write_begin 函数。
+ * @details 写入失败时，文件尾之后新映射的数据块需要释放，同 ext2_write_failed()。
+ */
+static int nvmixWriteBegin(struct file *pFile, struct address_space *pMapping, loff_t pos, unsigned len, unsigned flags, struct page **ppPage, void **ppFsdata);
+
+/**
+ * @brief 完成写入。注册页面缓存操作的 write_end 函数。
+ */
+static int nvmixWriteEnd(struct file *pFile, struct address_space *pMapping, loff_t pos, unsigned len, unsigned copied, struct page *pPage, void *pFsdata);
+
+/**
+ * @brief 写入失败以后丢弃文件尾之后的 page cache 和数据块。
+ */
+static void nvmixWriteFailed(struct address_space *pMapping, loff_t to);
+
+/**
+ * @brief 绕过 page cache 直接读写 SSD 上的簇。注册页面缓存操作的 direct_IO 函数。
+ * @details 异步的 kiocb 提交 bio 以后立即返回，由 bio 的完成回调通知调用者。写入失败的处理同 nvmixWriteBegin()。IOCB_NOWAIT 的写入涉及未写入区段时返回 -EAGAIN。
+ */
+static ssize_t nvmixDirectIO(struct kiocb *pIocb, struct iov_iter *pIter);
+
+/**
+ * @brief 文件逻辑块到设备块号的映射。注册页面缓存操作的 bmap 函数。
+ */
+static sector_t nvmixBmap(struct address_space *pMapping, sector_t block);
+
+
+/**
+ * @brief 注册本文件系统的页面缓存操作，普通文件的数据经过 page cache 读写 SSD 上的簇。
  */
 struct address_space_operations nvmixAops = {
-    .readpage = simple_readpage,
-    .write_begin = simple_write_begin,
-    .write_end = simple_write_end,
+    .readpage = nvmixReadpage,
+    .readpages = nvmixReadpages,
+    .writepage = nvmixWritepage,
+    .write_begin = nvmixWriteBegin,
+    .write_end = nvmixWriteEnd,
+    .bmap = nvmixBmap,
+    .direct_IO = nvmixDirectIO,
 };
+
+
+int nvmixGetBlock(struct inode *pInode, sector_t iblock, struct buffer_head *pBhResult, int create)
+{
+    struct super_block *pSb = pInode->i_sb;
+    struct NvmixSuperBlock *pNsb = NULL;
+    unsigned long *pBitmap = NULL;
+    bool isNew = false;
+    bool isUnwritten = false;
+    int res = 0;
+
+
+    pNsb = (struct NvmixSuperBlock *)(((struct NvmixNvmHelper *)(pSb->s_fs_info))->m_superBlockVirtAddr);
+
+    // 每个文件最多占满自己的簇，s_maxbytes 保证正常的写入不会越界。
+    if (iblock >= (1UL << pNsb->m_clusterBits)) return -EFBIG;
+
+    pBitmap = nvmixClusterBitmap(pInode);
+
+    if (!test_bit(iblock, pBitmap))
+    {
+        if (!create) return 0;
+
+        // 回写不持有 inode 锁，可能与 fallocate 同时修改子簇位图。nvmixPreallocBlocks() 在 m_unwrittenLock 下根据位图判断哪些块是新预分配的，这里在同一把锁下检查并置位，否则刚写入数据的块可能被记录为未写入。
+        mutex_lock(&NVMIX_I(pInode)->m_unwrittenLock);
+
+        isNew = !test_and_set_bit(iblock, pBitmap);
+        if (isNew)
+        {
+            // 与 ext2 一样，位图先于数据落盘，崩溃后该块可能读到簇中残留的旧数据。
+            clflush_cache_range(pBitmap + iblock / BITS_PER_LONG, sizeof(unsigned long));
+
+            pInode->i_blocks += pSb->s_blocksize >> 9;
+        }
+
+        mutex_unlock(&NVMIX_I(pInode)->m_unwrittenLock);
+
+        if (isNew)
+        {
+            mark_inode_dirty(pInode);
+
+            map_bh(pBhResult, pSb, NVMIX_SB_DATA_BLOCK(pSb, NVMIX_I(pInode)->m_dataBlockIndex) + iblock);
+            set_buffer_new(pBhResult);
+
+            // 簇随 inode 号复用，块设备的缓存中可能还有已删除目录的脏缓冲区，不能让它回写覆盖文件数据，同 ext2_get_blocks()。
+            clean_bdev_bh_alias(pBhResult);
+
+
+            return 0;
+        }
+
+        // 拿到锁之前已经被预分配，按下面已经置位的块处理。
+    }
+
+    if (nvmixHasUnwritten(pSb))
+    {
+        mutex_lock(&NVMIX_I(pInode)->m_unwrittenLock);
+
+        isUnwritten = nvmixIsUnwritten(pInode, iblock);
+
+        // 第一次写入未写入的块只需要修改 NVM 上的区段，子簇位图已经置位。
+        if (isUnwritten && create) res = nvmixClearUnwritten(pInode, iblock, iblock + 1);
+
+        mutex_unlock(&NVMIX_I(pInode)->m_unwrittenLock);
+
+        if (0 != res) return res;
+
+        // 读取时不建立映射，同空洞一样由调用者填零。
+        if (isUnwritten && !create) return 0;
+
+        if (isUnwritten)
+        {
+            map_bh(pBhResult, pSb, NVMIX_SB_DATA_BLOCK(pSb, NVMIX_I(pInode)->m_dataBlockIndex) + iblock);
+            set_buffer_new(pBhResult);
+            clean_bdev_bh_alias(pBhResult);
+
+
+            return 0;
+        }
+    }
+
+    map_bh(pBhResult, pSb, NVMIX_SB_DATA_BLOCK(pSb, NVMIX_I(pInode)->m_dataBlockIndex) + iblock);
+
+
+    return 0;
+}
+
+int nvmixPreallocBlocks(struct inode *pInode, unsigned long start, unsigned long end, bool isZero)
+{
+    struct NvmixInodeHelper *pNih = NVMIX_I(pInode);
+    unsigned long *pBitmap = nvmixClusterBitmap(pInode);
+    DECLARE_BITMAP(unwritten, NVMIX_CLUSTER_BITMAP_BITS);
+    DECLARE_BITMAP(added, NVMIX_CLUSTER_BITMAP_BITS);
+    unsigned long block = 0;
+    int res = 0;
+
+
+    // nvmixGetBlock() 在同一把锁下置位，下面判断为新预分配的块不会同时被回写分配。
+    mutex_lock(&pNih->m_unwrittenLock);
+
+    nvmixLoadUnwritten(pInode, unwritten);
+    bitmap_zero(added, NVMIX_CLUSTER_BITMAP_BITS);
+
+    for (block = start; block < end; ++block)
+    {
+        if (!test_bit(block, pBitmap)) __set_bit(block, added);
+        if (isZero || !test_bit(block, pBitmap)) __set_bit(block, unwritten);
+    }
+
+    // 未写入的块在子簇位图中一定置位，因此先置位，再记录区段。崩溃时新块可能只有置位，读到簇中残留的旧数据，同 nvmixGetBlock()。
+    for (block = find_next_bit(added, end, start); block < end; block = find_next_bit(added, end, block + 1)) set_bit(block, pBitmap);
+    nvmixFlushBitmap(pBitmap, start, end);
+
+    res = nvmixStoreUnwritten(pInode, unwritten);
+    if (0 != res)
+    {
+        // 区段没有修改，只撤销本次新置位的块。
+        for (block = find_next_bit(added, end, start); block < end; block = find_next_bit(added, end, block + 1)) clear_bit(block, pBitmap);
+        nvmixFlushBitmap(pBitmap, start, end);
+    }
+
+    pInode->i_blocks = nvmixCountBlocks(pInode);
+
+    mutex_unlock(&pNih->m_unwrittenLock);
+
+    mark_inode_dirty(pInode);
+
+
+    return res;
+}
+
+int nvmixPunchBlocks(struct inode *pInode, unsigned long start, unsigned long end)
+{
+    struct NvmixInodeHelper *pNih = NVMIX_I(pInode);
+    unsigned long *pBitmap = nvmixClusterBitmap(pInode);
+    unsigned long block = 0;
+    int res = 0;
+
+
+    if (find_next_bit(pBitmap, end, start) >= end) return 0;
+
+    mutex_lock(&pNih->m_unwrittenLock);
+
+    // 与 nvmixPreallocBlocks() 相反，先丢弃区段，再清除子簇位图。
+    if (nvmixHasUnwritten(pInode->i_sb)) res = nvmixClearUnwritten(pInode, start, end);
+
+    if (0 == res)
+    {
+        for (block = find_next_bit(pBitmap, end, start); block < end; block = find_next_bit(pBitmap, end, block + 1)) clear_bit(block, pBitmap);
+        nvmixFlushBitmap(pBitmap, start, end);
+    }
+
+    pInode->i_blocks = nvmixCountBlocks(pInode);
+
+    mutex_unlock(&pNih->m_unwrittenLock);
+
+    mark_inode_dirty(pInode);
+
+
+    return res;
+}
+
+int nvmixCollapseBlocks(struct inode *pInode, unsigned long start, unsigned long end)
+{
+    struct super_block *pSb = pInode->i_sb;
+    struct NvmixInodeHelper *pNih = NVMIX_I(pInode);
+    unsigned long *pBitmap = nvmixClusterBitmap(pInode);
+    unsigned long blockNum = nvmixClusterBlockNum(pSb);
+    unsigned long base = NVMIX_SB_DATA_BLOCK(pSb, pNih->m_dataBlockIndex);
+    unsigned long shift = end - start;
+    DECLARE_BITMAP(unwritten, NVMIX_CLUSTER_BITMAP_BITS);
+    DECLARE_BITMAP(newUnwritten, NVMIX_CLUSTER_BITMAP_BITS);
+    DECLARE_BITMAP(newBitmap, NVMIX_CLUSTER_BITMAP_BITS);
+    struct buffer_head *pSrcBh = NULL;
+    struct buffer_head *pDstBh = NULL;
+    unsigned long block = 0;
+    int res = 0;
+
+
+    mutex_lock(&pNih->m_unwrittenLock);
+
+    nvmixLoadUnwritten(pInode, unwritten);
+
+    // 块设备的缓存中可能有簇内数据块的旧副本，搬移前丢弃，保证从 SSD 读到文件回写后的数据。
+    clean_bdev_aliases(pSb->s_bdev, base, blockNum);
+    invalidate_mapping_pages(pSb->s_bdev->bd_inode->i_mapping, (base << pSb->s_blocksize_bits) >> PAGE_SHIFT, (((base + blockNum) << pSb->s_blocksize_bits) - 1) >> PAGE_SHIFT);
+
+    // 簇内的映射是固定的，只能搬移数据。按块号递增的顺序搬移，目标块总是已经读过的块。空洞和未写入的块不需要搬移。
+    for (block = end; block < blockNum; ++block)
+    {
+        if (!test_bit(block, pBitmap) || test_bit(block, unwritten)) continue;
+
+        pSrcBh = sb_bread(pSb, base + block);
+        pDstBh = sb_getblk(pSb, base + block - shift);
+        if (!pSrcBh || !pDstBh)
+        {
+            res = -EIO;
+            goto ERR;
+        }
+
+        lock_buffer(pDstBh);
+        memcpy(pDstBh->b_data, pSrcBh->b_data, pSb->s_blocksize);
+        set_buffer_uptodate(pDstBh);
+        unlock_buffer(pDstBh);
+
+        mark_buffer_dirty(pDstBh);
+        res = sync_dirty_buffer(pDstBh);
+        if (0 != res) goto ERR;
+
+        brelse(pSrcBh);
+        pSrcBh = NULL;
+
+        brelse(pDstBh);
+        pDstBh = NULL;
+    }
+
+    bitmap_copy(newBitmap, pBitmap, blockNum);
+    bitmap_copy(newUnwritten, unwritten, blockNum);
+
+    for (block = start; block < blockNum; ++block)
+    {
+        __assign_bit(block, newBitmap, (block + shift < blockNum) && test_bit(block + shift, pBitmap));
+        __assign_bit(block, newUnwritten, (block + shift < blockNum) && test_bit(block + shift, unwritten));
+    }
+
+    // 数据搬移完成以后再修改元数据：先清空区段，再写入新的子簇位图，最后记录新的区段，任何时刻未写入的块都已经置位。
+    bitmap_zero(unwritten, blockNum);
+    res = nvmixStoreUnwritten(pInode, unwritten);
+    if (0 != res) goto ERR;
+
+    for (block = start; block < blockNum; ++block) assign_bit(block, pBitmap, test_bit(block, newBitmap));
+    nvmixFlushBitmap(pBitmap, start, blockNum);
+
+    // 区段整体平移，数量不会增加，不会清零 SSD。
+    res = nvmixStoreUnwritten(pInode, newUnwritten);
+
+    pInode->i_blocks = nvmixCountBlocks(pInode);
+    mark_inode_dirty(pInode);
+
+
+ERR:
+    brelse(pSrcBh);
+    pSrcBh = NULL;
+
+    brelse(pDstBh);
+    pDstBh = NULL;
+
+    mutex_unlock(&pNih->m_unwrittenLock);
+
+
+    return res;
+}
+
+int nvmixZeroRange(struct inode *pInode, loff_t from, loff_t to)
+{
+    struct page *pPage = NULL;
+    int res = 0;
+
+
+    // 文件尾之后的数据总是 0。
+    to = min(to, i_size_read(pInode));
+    if (from >= to) return 0;
+
+    // 空洞和未写入的块本来就读到 0，不需要为了清零而写入。
+    if (!nvmixIsWritten(pInode, from >> pInode->i_sb->s_blocksize_bits)) return 0;
+
+    res = block_write_begin(pInode->i_mapping, from, to - from, 0, &pPage, nvmixGetBlock);
+    if (0 != res) return res;
+
+    zero_user(pPage, from & (PAGE_SIZE - 1), to - from);
+
+    res = generic_write_end(NULL, pInode->i_mapping, from, to - from, to - from, pPage, NULL);
+
+
+    return (res < 0) ? res : 0;
+}
+
+loff_t nvmixSeekData(struct inode *pInode, loff_t offset, bool isData)
+{
+    unsigned bits = pInode->i_sb->s_blocksize_bits;
+    loff_t size = i_size_read(pInode);
+    unsigned long blockNum = (size + pInode->i_sb->s_blocksize - 1) >> bits;
+    DECLARE_BITMAP(written, NVMIX_CLUSTER_BITMAP_BITS);
+    unsigned long block = 0;
+
+
+    if ((offset < 0) || (offset >= size)) return -ENXIO;
+
+    nvmixLoadWritten(pInode, written, NULL);
+
+    block = isData ? find_next_bit(written, blockNum, offset >> bits) : find_next_zero_bit(written, blockNum, offset >> bits);
+
+    // 文件尾之后没有数据，文件尾本身总是一个空洞。
+    if (block >= blockNum) return isData ? -ENXIO : size;
+
+
+    return max(offset, (loff_t)block << bits);
+}
+
+int nvmixFiemap(struct inode *pInode, struct fiemap_extent_info *pFieinfo, u64 start, u64 len)
+{
+    struct super_block *pSb = pInode->i_sb;
+    unsigned bits = pSb->s_blocksize_bits;
+    unsigned long blockNum = nvmixClusterBlockNum(pSb);
+    u64 base = (u64)NVMIX_SB_DATA_BLOCK(pSb, NVMIX_I(pInode)->m_dataBlockIndex) << bits;
+    DECLARE_BITMAP(written, NVMIX_CLUSTER_BITMAP_BITS);
+    DECLARE_BITMAP(unwritten, NVMIX_CLUSTER_BITMAP_BITS);
+    unsigned long first = 0;
+    unsigned long last = 0;
+    unsigned long block = 0;
+    unsigned long runEnd = 0;
+    bool isUnwritten = false;
+    u32 flags = 0;
+    int res = 0;
+
+
+    res = fiemap_check_flags(pFieinfo, FIEMAP_FLAG_SYNC);
+    if (0 != res) return res;
+
+    // ioctl_fiemap() 已经把范围限制在 s_maxbytes 以内，不会溢出。
+    first = min_t(u64, start >> bits, blockNum);
+    last = min_t(u64, (start + len + pSb->s_blocksize - 1) >> bits, blockNum);
+
+    inode_lock_shared(pInode);
+
+    nvmixLoadWritten(pInode, written, unwritten);
+
+    // 合并为一个位图，置位的块都有 SSD 上的映射，再按是否未写入切分为区段。
+    bitmap_or(written, written, unwritten, blockNum);
+
+    for (block = find_next_bit(written, last, first); block < last; block = find_next_bit(written, last, runEnd))
+    {
+        isUnwritten = test_bit(block, unwritten);
+
+        runEnd = block + 1;
+        while ((runEnd < blockNum) && test_bit(runEnd, written) && (isUnwritten == test_bit(runEnd, unwritten))) ++runEnd;
+
+        // 数据总是在 SSD 上，未写入的区段只存在于 NVM 的元数据中，没有可读的数据。
+        flags = isUnwritten ? FIEMAP_EXTENT_UNWRITTEN : 0;
+        if (find_next_bit(written, blockNum, runEnd) >= blockNum) flags |= FIEMAP_EXTENT_LAST;
+
+        res = fiemap_fill_next_extent(pFieinfo, (u64)block << bits, base + ((u64)block << bits), (u64)(runEnd - block) << bits, flags);
+        if (0 != res) break;
+    }
+
+    inode_unlock_shared(pInode);
+
+
+    // 返回 1 表示用户的缓冲区已满。
+    return (1 == res) ? 0 : res;
+}
+
+int nvmixCopyBlocks(struct inode *pDstInode, unsigned long dstStart, struct inode *pSrcInode, unsigned long srcStart, unsigned long num)
+{
+    struct super_block *pSb = pSrcInode->i_sb;
+    unsigned long srcBase = NVMIX_SB_DATA_BLOCK(pSb, NVMIX_I(pSrcInode)->m_dataBlockIndex);
+    unsigned long dstBase = NVMIX_SB_DATA_BLOCK(pSb, NVMIX_I(pDstInode)->m_dataBlockIndex);
+    unsigned long srcEnd = srcStart + num;
+    unsigned long *pDstBitmap = nvmixClusterBitmap(pDstInode);
+    DECLARE_BITMAP(written, NVMIX_CLUSTER_BITMAP_BITS);
+    DECLARE_BITMAP(unwritten, NVMIX_CLUSTER_BITMAP_BITS);
+    struct buffer_head *pSrcBhs[NVMIX_COPY_BATCH_NUM];
+    struct buffer_head *pDstBhs[NVMIX_COPY_BATCH_NUM];
+    unsigned long block = 0;
+    unsigned long end = 0;
+    int srcNum = 0;
+    int dstNum = 0;
+    int i = 0;
+    int res = 0;
+
+
+    nvmixLoadWritten(pSrcInode, written, unwritten);
+
+    // 目标范围先变为空洞，之后按源文件的状态逐块重建。
+    res = nvmixPunchBlocks(pDstInode, dstStart, dstStart + num);
+    if (0 != res) return res;
+
+    // 块设备的缓存中可能有源簇的旧副本，同 nvmixCollapseBlocks()。
+    clean_bdev_aliases(pSb->s_bdev, srcBase + srcStart, num);
+    invalidate_mapping_pages(pSb->s_bdev->bd_inode->i_mapping, ((srcBase + srcStart) << pSb->s_blocksize_bits) >> PAGE_SHIFT, (((srcBase + srcEnd) << pSb->s_blocksize_bits) - 1) >> PAGE_SHIFT);
+
+    // 只有已经写入的块需要读写 SSD。每批先提交全部读取，再逐块等待、复制并提交写入，最后等待写入完成，读和写都让 SSD 同时处理多个请求。
+    for (block = find_next_bit(written, srcEnd, srcStart); block < srcEnd;)
+    {
+        for (; (srcNum < NVMIX_COPY_BATCH_NUM) && (block < srcEnd); block = find_next_bit(written, srcEnd, block + 1))
+        {
+            pSrcBhs[srcNum] = sb_getblk(pSb, srcBase + block);
+            if (!pSrcBhs[srcNum])
+            {
+                res = -EIO;
+                goto ERR;
+            }
+            ++srcNum;
+        }
+
+        // 已经是最新的缓冲区不会重复读取。
+        ll_rw_block(REQ_OP_READ, 0, srcNum, pSrcBhs);
+
+        for (i = 0; i < srcNum; ++i)
+        {
+            wait_on_buffer(pSrcBhs[i]);
+            if (!buffer_uptodate(pSrcBhs[i]))
+            {
+                res = -EIO;
+                goto ERR;
+            }
+
+            pDstBhs[dstNum] = sb_getblk(pSb, dstBase + dstStart + (pSrcBhs[i]->b_blocknr - srcBase - srcStart));
+            if (!pDstBhs[dstNum])
+            {
+                res = -EIO;
+                goto ERR;
+            }
+
+            lock_buffer(pDstBhs[dstNum]);
+            memcpy(pDstBhs[dstNum]->b_data, pSrcBhs[i]->b_data, pSb->s_blocksize);
+            set_buffer_uptodate(pDstBhs[dstNum]);
+            unlock_buffer(pDstBhs[dstNum]);
+
+            mark_buffer_dirty(pDstBhs[dstNum]);
+            write_dirty_buffer(pDstBhs[dstNum], 0);
+            ++dstNum;
+        }
+
+        // 读取都已经完成并检查过，这里只释放源缓冲区。
+        nvmixWaitBuffers(pSrcBhs, srcNum);
+        srcNum = 0;
+
+        res = nvmixWaitBuffers(pDstBhs, dstNum);
+        dstNum = 0;
+        if (0 != res) goto ERR;
+    }
+
+    // 数据落盘以后再在子簇位图中置位。同 nvmixPreallocBlocks()，回写可能同时在 nvmixGetBlock() 中修改目标文件的位图，在 m_unwrittenLock 下修改。
+    mutex_lock(&NVMIX_I(pDstInode)->m_unwrittenLock);
+
+    for (block = find_next_bit(written, srcEnd, srcStart); block < srcEnd; block = find_next_bit(written, srcEnd, block + 1))
+    {
+        set_bit(dstStart + block - srcStart, pDstBitmap);
+    }
+    nvmixFlushBitmap(pDstBitmap, dstStart, dstStart + num);
+
+    pDstInode->i_blocks = nvmixCountBlocks(pDstInode);
+
+    mutex_unlock(&NVMIX_I(pDstInode)->m_unwrittenLock);
+
+    mark_inode_dirty(pDstInode);
+
+    // 未写入的块只复制 NVM 上的元数据。
+    for (block = find_next_bit(unwritten, srcEnd, srcStart); block < srcEnd; block = find_next_bit(unwritten, srcEnd, end))
+    {
+        end = find_next_zero_bit(unwritten, srcEnd, block);
+
+        res = nvmixPreallocBlocks(pDstInode, dstStart + block - srcStart, dstStart + end - srcStart, true);
+        if (0 != res) goto ERR;
+    }
+
+
+ERR:
+    // 出错时等待已经提交的读写，释放缓冲区头。
+    if (0 != srcNum) nvmixWaitBuffers(pSrcBhs, srcNum);
+    if (0 != dstNum) nvmixWaitBuffers(pDstBhs, dstNum);
+
+
+    return res;
+}
+
+int nvmixWaitBuffers(struct buffer_head **ppBhs, int num)
+{
+    int res = 0;
+    int i = 0;
+
+
+    for (i = 0; i < num; ++i)
+    {
+        wait_on_buffer(ppBhs[i]);
+        if (!buffer_uptodate(ppBhs[i])) res = -EIO;
+
+        brelse(ppBhs[i]);
+        ppBhs[i] = NULL;
+    }
+
+
+    return res;
+}
+
+void nvmixTruncateBlocks(struct inode *pInode, loff_t size)
+{
+    struct super_block *pSb = pInode->i_sb;
+    struct NvmixSuperBlock *pNsb = NULL;
+    unsigned long *pBitmap = NULL;
+    unsigned long start = 0;
+    unsigned long end = 0;
+
+
+    if (sb_rdonly(pSb)) return;
+
+    pNsb = (struct NvmixSuperBlock *)(((struct NvmixNvmHelper *)(pSb->s_fs_info))->m_superBlockVirtAddr);
+    pBitmap = nvmixClusterBitmap(pInode);
+
+    start = (size + pSb->s_blocksize - 1) >> pSb->s_blocksize_bits;
+    end = 1UL << pNsb->m_clusterBits;
+
+    if (find_next_bit(pBitmap, end, start) >= end) return;
+
+    // 只去掉文件尾之后的部分，区段不会分裂，不会清零 SSD，不会失败。
+    nvmixPunchBlocks(pInode, start, end);
+}
+
+blkcnt_t nvmixCountBlocks(struct inode *pInode)
+{
+    struct super_block *pSb = pInode->i_sb;
+    struct NvmixSuperBlock *pNsb = NULL;
+
+
+    pNsb = (struct NvmixSuperBlock *)(((struct NvmixNvmHelper *)(pSb->s_fs_info))->m_superBlockVirtAddr);
+
+
+    return (blkcnt_t)bitmap_weight(nvmixClusterBitmap(pInode), 1U << pNsb->m_clusterBits) << (pSb->s_blocksize_bits - 9);
+}
+
+unsigned long *nvmixClusterBitmap(struct inode *pInode)
+{
+    return (unsigned long *)NVMIX_INLINE_DATA((struct NvmixNvmHelper *)(pInode->i_sb->s_fs_info), pInode->i_ino);
+}
+
+unsigned long nvmixClusterBlockNum(struct super_block *pSb)
+{
+    return 1UL << ((struct NvmixSuperBlock *)(((struct NvmixNvmHelper *)(pSb->s_fs_info))->m_superBlockVirtAddr))->m_clusterBits;
+}
+
+struct NvmixUnwrittenExtent *nvmixUnwrittenExtents(struct inode *pInode)
+{
+    return ((struct NvmixInode *)(((struct NvmixNvmHelper *)(pInode->i_sb->s_fs_info))->m_inodeVirtAddr) + pInode->i_ino)->m_unwritten;
+}
+
+bool nvmixHasUnwritten(struct super_block *pSb)
+{
+    struct NvmixSuperBlock *pNsb = (struct NvmixSuperBlock *)(((struct NvmixNvmHelper *)(pSb->s_fs_info))->m_superBlockVirtAddr);
+
+
+    return NVMIX_HAS_FEATURE(pNsb, Incompat, NVMIX_FEATURE_INCOMPAT_UNWRITTEN);
+}
+
+bool nvmixIsUnwritten(struct inode *pInode, unsigned long block)
+{
+    struct NvmixUnwrittenExtent *pExtents = nvmixUnwrittenExtents(pInode);
+    int i = 0;
+
+
+    for (i = 0; i < NVMIX_MAX_UNWRITTEN_NUM; ++i)
+    {
+        if ((block >= pExtents[i].m_start) && (block < (unsigned long)pExtents[i].m_start + pExtents[i].m_length)) return true;
+    }
+
+
+    return false;
+}
+
+void nvmixLoadUnwritten(struct inode *pInode, unsigned long *pUnwritten)
+{
+    struct NvmixUnwrittenExtent *pExtents = nvmixUnwrittenExtents(pInode);
+    int i = 0;
+
+
+    bitmap_zero(pUnwritten, NVMIX_CLUSTER_BITMAP_BITS);
+
+    if (!nvmixHasUnwritten(pInode->i_sb)) return;
+
+    for (i = 0; i < NVMIX_MAX_UNWRITTEN_NUM; ++i)
+    {
+        if (0 != pExtents[i].m_length) bitmap_set(pUnwritten, pExtents[i].m_start, pExtents[i].m_length);
+    }
+}
+
+int nvmixStoreUnwritten(struct inode *pInode, const unsigned long *pUnwritten)
+{
+    struct super_block *pSb = pInode->i_sb;
+    struct NvmixUnwrittenExtent extents[NVMIX_MAX_UNWRITTEN_NUM];
+    struct NvmixUnwrittenExtent *pExtents = nvmixUnwrittenExtents(pInode);
+    unsigned long blockNum = nvmixClusterBlockNum(pSb);
+    unsigned long start = 0;
+    unsigned long end = 0;
+    int num = 0;
+    int res = 0;
+
+
+    memset(extents, 0, sizeof(extents));
+
+    for (start = find_next_bit(pUnwritten, blockNum, 0); start < blockNum; start = find_next_bit(pUnwritten, blockNum, end))
+    {
+        end = find_next_zero_bit(pUnwritten, blockNum, start);
+
+        if (num < NVMIX_MAX_UNWRITTEN_NUM)
+        {
+            extents[num].m_start = start;
+            extents[num].m_length = end - start;
+            ++num;
+
+            continue;
+        }
+
+        res = sb_issue_zeroout(pSb, NVMIX_SB_DATA_BLOCK(pSb, NVMIX_I(pInode)->m_dataBlockIndex) + start, end - start, GFP_NOFS);
+        if (0 != res) return res;
+    }
+
+    if (0 == memcmp(pExtents, extents, sizeof(extents))) return 0;
+
+    if (0 != num) nvmixEnableUnwritten(pSb);
+
+    memcpy(pExtents, extents, sizeof(extents));
+    clflush_cache_range(pExtents, sizeof(extents));
+
+
+    return 0;
+}
+
+int nvmixClearUnwritten(struct inode *pInode, unsigned long start, unsigned long end)
+{
+    DECLARE_BITMAP(unwritten, NVMIX_CLUSTER_BITMAP_BITS);
+
+
+    nvmixLoadUnwritten(pInode, unwritten);
+
+    if (find_next_bit(unwritten, end, start) >= end) return 0;
+
+    bitmap_clear(unwritten, start, end - start);
+
+
+    return nvmixStoreUnwritten(pInode, unwritten);
+}
+
+void nvmixEnableUnwritten(struct super_block *pSb)
+{
+    struct NvmixSuperBlock *pNsb = (struct NvmixSuperBlock *)(((struct NvmixNvmHelper *)(pSb->s_fs_info))->m_superBlockVirtAddr);
+    unsigned int features = 0;
+
+
+    // 不同文件的 fallocate 可能同时启用，用 cmpxchg 保证不丢失特性位图中的其他位。
+    do
+    {
+        features = READ_ONCE(pNsb->m_featureIncompat);
+        if (features & NVMIX_FEATURE_INCOMPAT_UNWRITTEN) return;
+    } while (features != cmpxchg(&pNsb->m_featureIncompat, features, features | NVMIX_FEATURE_INCOMPAT_UNWRITTEN));
+
+    clflush_cache_range(&pNsb->m_featureIncompat, sizeof(pNsb->m_featureIncompat));
+
+    pr_info("nvmixfs: enabled the unwritten feature on %s.\n", pSb->s_id);
+}
+
+bool nvmixIsWritten(struct inode *pInode, unsigned long block)
+{
+    bool isWritten = test_bit(block, nvmixClusterBitmap(pInode));
+
+
+    if (isWritten && nvmixHasUnwritten(pInode->i_sb))
+    {
+        mutex_lock(&NVMIX_I(pInode)->m_unwrittenLock);
+        isWritten = !nvmixIsUnwritten(pInode, block);
+        mutex_unlock(&NVMIX_I(pInode)->m_unwrittenLock);
+    }
+
+
+    return isWritten;
+}
+
+bool nvmixRangeTouchesUnwritten(struct inode *pInode, loff_t pos, size_t count)
+{
+    struct super_block *pSb = pInode->i_sb;
+    unsigned long start = pos >> pSb->s_blocksize_bits;
+    unsigned long end = min((unsigned long)((pos + count + pSb->s_blocksize - 1) >> pSb->s_blocksize_bits), nvmixClusterBlockNum(pSb));
+    DECLARE_BITMAP(unwritten, NVMIX_CLUSTER_BITMAP_BITS);
+
+
+    if (!nvmixHasUnwritten(pSb)) return false;
+
+    if (!mutex_trylock(&NVMIX_I(pInode)->m_unwrittenLock)) return true;
+
+    nvmixLoadUnwritten(pInode, unwritten);
+
+    mutex_unlock(&NVMIX_I(pInode)->m_unwrittenLock);
+
+
+    return find_next_bit(unwritten, end, start) < end;
+}
+
+void nvmixLoadWritten(struct inode *pInode, unsigned long *pWritten, unsigned long *pUnwritten)
+{
+    DECLARE_BITMAP(unwritten, NVMIX_CLUSTER_BITMAP_BITS);
+
+
+    mutex_lock(&NVMIX_I(pInode)->m_unwrittenLock);
+
+    nvmixLoadUnwritten(pInode, unwritten);
+    bitmap_andnot(pWritten, nvmixClusterBitmap(pInode), unwritten, NVMIX_CLUSTER_BITMAP_BITS);
+
+    mutex_unlock(&NVMIX_I(pInode)->m_unwrittenLock);
+
+    if (pUnwritten) bitmap_copy(pUnwritten, unwritten, NVMIX_CLUSTER_BITMAP_BITS);
+}
+
+void nvmixFlushBitmap(unsigned long *pBitmap, unsigned long start, unsigned long end)
+{
+    if (start >= end) return;
+
+    clflush_cache_range(pBitmap + start / BITS_PER_LONG, (BITS_TO_LONGS(end) - start / BITS_PER_LONG) * sizeof(unsigned long));
+}
+
+int nvmixReadpage(struct file *pFile, struct page *pPage)
+{
+    struct NvmixNvmHelper *pNsbh = (struct NvmixNvmHelper *)(pPage->mapping->host->i_sb->s_fs_info);
+    struct NvmixFileInfo *pInfo = NVMIX_FILE_INFO(pFile);
+
+
+    atomic64_inc(&pNsbh->m_readpageNum);
+    if (pInfo) atomic64_inc(&pInfo->m_readpageNum);
+
+
+    return block_read_full_page(pPage, nvmixGetBlock);
+}
+
+int nvmixReadpages(struct file *pFile, struct address_space *pMapping, struct list_head *pPages, unsigned nrPages)
+{
+    struct inode *pInode = pMapping->host;
+    struct NvmixNvmHelper *pNsbh = (struct NvmixNvmHelper *)(pInode->i_sb->s_fs_info);
+    struct NvmixFileInfo *pInfo = NVMIX_FILE_INFO(pFile);
+    struct page *pPage = NULL;
+    long holeNum = 0;
+
+
+    list_for_each_entry(pPage, pPages, lru)
+    {
+        if (nvmixPageIsHole(pInode, pPage->index)) ++holeNum;
+    }
+
+    atomic64_add(nrPages, &pNsbh->m_readaheadPageNum);
+    atomic64_add(holeNum, &pNsbh->m_readaheadHolePageNum);
+
+    if (pInfo)
+    {
+        atomic64_add(nrPages, &pInfo->m_readaheadPageNum);
+        atomic64_add(holeNum, &pInfo->m_readaheadHolePageNum);
+    }
+
+
+    return mpage_readpages(pMapping, pPages, nrPages, nvmixGetBlock);
+}
+
+bool nvmixPageIsHole(struct inode *pInode, pgoff_t index)
+{
+    struct super_block *pSb = pInode->i_sb;
+    unsigned long start = (unsigned long)index << (PAGE_SHIFT - pSb->s_blocksize_bits);
+    unsigned long end = min(start + (1UL << (PAGE_SHIFT - pSb->s_blocksize_bits)), nvmixClusterBlockNum(pSb));
+    unsigned long block = 0;
+
+
+    // 未写入的块同空洞一样不读取 SSD。
+    for (block = start; block < end; ++block)
+    {
+        if (nvmixIsWritten(pInode, block)) return false;
+    }
+
+
+    return true;
+}
+
+int nvmixWritepage(struct page *pPage, struct writeback_control *pWbc)
+{
+    return block_write_full_page(pPage, nvmixGetBlock, pWbc);
+}
+
+int nvmixWriteBegin(struct file *pFile, struct address_space *pMapping, loff_t pos, unsigned len, unsigned flags, struct page **ppPage, void **ppFsdata)
+{
+    int res = 0;
+
+
+    res = block_write_begin(pMapping, pos, len, flags, ppPage, nvmixGetBlock);
+    if (res < 0) nvmixWriteFailed(pMapping, pos + len);
+
+
+    return res;
+}
+
+int nvmixWriteEnd(struct file *pFile, struct address_space *pMapping, loff_t pos, unsigned len, unsigned copied, struct page *pPage, void *pFsdata)
+{
+    int res = 0;
+
+
+    res = generic_write_end(pFile, pMapping, pos, len, copied, pPage, pFsdata);
+    if (res < len) nvmixWriteFailed(pMapping, pos + len);
+
+
+    return res;
+}
+
+void nvmixWriteFailed(struct address_space *pMapping, loff_t to)
+{
+    struct inode *pInode = pMapping->host;
+
+
+    if (to > pInode->i_size)
+    {
+        truncate_pagecache(pInode, pInode->i_size);
+        nvmixTruncateBlocks(pInode, pInode->i_size);
+    }
+}
+
+ssize_t nvmixDirectIO(struct kiocb *pIocb, struct iov_iter *pIter)
+{
+    struct address_space *pMapping = pIocb->ki_filp->f_mapping;
+    struct inode *pInode = pMapping->host;
+    size_t count = iov_iter_count(pIter);
+    loff_t pos = pIocb->ki_pos;
+    ssize_t res = 0;
+
+
+    // 第一次写入未写入的块要在 m_unwrittenLock 下修改区段，区段分裂以后放不下时还要清零 SSD，都可能睡眠，交给 io-wq 重试。
+    if ((pIocb->ki_flags & IOCB_NOWAIT) && (WRITE == iov_iter_rw(pIter)) && nvmixRangeTouchesUnwritten(pInode, pos, count)) return -EAGAIN;
+
+    // 簇内的映射是固定的，其余的分配只在 m_unwrittenLock 下修改 NVM 上的位图，可能短暂等待该锁的其他持有者，但不读写 SSD。
+    res = blockdev_direct_IO(pIocb, pInode, pIter, nvmixGetBlock);
+    if ((res < 0) && (WRITE == iov_iter_rw(pIter))) nvmixWriteFailed(pMapping, pos + count);
+
+
+    return res;
+}
+
+sector_t nvmixBmap(struct address_space *pMapping, sector_t block)
+{
+    return generic_block_bmap(pMapping, block, nvmixGetBlock);
+}
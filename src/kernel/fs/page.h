@@ -2,6 +2,7 @@
  * @file page.h
  * @author DavidingPlus (davidingplus@qq.com)
  * @brief 页面缓存操作的头文件。
+ * @details 普通文件的数据存储在 SSD 上该 inode 独占的簇中，簇内第 i 个数据块就是文件的第 i 个块，映射是固定的。簇内哪些数据块已经写过由 NVM inline 区中的子簇位图记录，未写过的是空洞，读到 0，因此新簇不需要预先清零。
  *
  * Copyright (c) 2025 电子科技大学 刘治学
  *
@@ -10,5 +11,93 @@
 #ifndef _NVMIX_PAGE_H_
 #define _NVMIX_PAGE_H_
 
+#include <linux/fs.h>
+#include <linux/buffer_head.h>
+
+
+/**
+ * @brief nvmixCopyBlocks() 每批同时提交读取和写入的数据块数量。
+ */
+#define NVMIX_COPY_BATCH_NUM 32
+
+
+/**
+ * @brief 将文件的逻辑块映射到 SSD 上的数据块，即 get_block_t。
+ * @param pInode 普通文件的 inode 指针。
+ * @param iblock 文件内的逻辑块号。
+ * @param pBhResult 用于返回映射结果的缓冲区头。
+ * @param create 是否为写入映射空洞。
+ * @return 成功返回 0，超出簇的范围返回 -EFBIG。
+ * @details 读取空洞时不建立映射，由调用者填零。写入空洞时在子簇位图中置位并标记为新块，block_write_begin() 会清零块中本次没有写到的部分。未写入的块与空洞相同，写入时只从未写入区段中去掉。
+ */
+int nvmixGetBlock(struct inode *pInode, sector_t iblock, struct buffer_head *pBhResult, int create);
+
+/**
+ * @brief 在子簇位图中释放新文件尾之后的数据块。
+ * @param pInode 普通文件的 inode 指针。
+ * @param size 新的文件大小。
+ * @details 调用者需已截断 page cache。只读挂载时不修改位图。未写入区段一并丢弃。
+ */
+void nvmixTruncateBlocks(struct inode *pInode, loff_t size);
+
+/**
+ * @brief 将 [start, end) 中的数据块预分配为未写入的块。调用者需持有 i_rwsem。
+ * @param pInode 普通文件的 inode 指针。
+ * @param start 第一个数据块在簇内的编号。
+ * @param end 最后一个数据块之后的编号。
+ * @param isZero 为 false 时只预分配空洞，已经写入的块保持不变；为 true 时所有块都变为未写入，即清零，调用者需先回写并丢弃这些块的 page cache。
+ * @return 成功返回 0，失败返回负的错误码。
+ * @details 未写入的块在子簇位图中置位，同时记录在 NvmixInode 的 m_unwritten 中，读到 0 而不读取 SSD，见 nvmixGetBlock()。
+ */
+int nvmixPreallocBlocks(struct inode *pInode, unsigned long start, unsigned long end, bool isZero);
+
+/**
+ * @brief 将 [start, end) 中的数据块变为空洞。调用者需持有 i_rwsem，并已丢弃这些块的 page cache。
+ * @return 成功返回 0，失败返回负的错误码。
+ */
+int nvmixPunchBlocks(struct inode *pInode, unsigned long start, unsigned long end);
+
+/**
+ * @brief 删除 [start, end) 中的数据块，之后的数据块整体前移。调用者需持有 i_rwsem，并已回写和丢弃 start 之后的 page cache。
+ * @return 成功返回 0，失败返回负的错误码。
+ * @details 簇内的映射是固定的，已写入的块需要在 SSD 上搬移，未写入的块和空洞只修改 NVM 上的元数据。数据搬移完成以后才修改元数据，但搬移本身不是原子的，中途崩溃时文件内容可能部分前移。
+ */
+int nvmixCollapseBlocks(struct inode *pInode, unsigned long start, unsigned long end);
+
+/**
+ * @brief 通过 page cache 清零一个数据块中的 [from, to)。调用者需持有 i_rwsem。
+ * @details 用于 fallocate 范围首尾不足一个块的部分。文件尾之后、空洞和未写入的块不需要清零。
+ */
+int nvmixZeroRange(struct inode *pInode, loff_t from, loff_t to);
+
+/**
+ * @brief 从 offset 开始查找下一段数据或者空洞，实现 SEEK_DATA 和 SEEK_HOLE。调用者需持有 i_rwsem。
+ * @param pInode 普通文件的 inode 指针。
+ * @param offset 开始查找的位置。
+ * @param isData 为 true 时查找数据，否则查找空洞。
+ * @return 找到的位置，offset 不在文件内或者之后没有数据时返回 -ENXIO。
+ * @details 只查询 NVM 上的子簇位图和未写入区段，不读取 SSD。未写入的块读到 0，按空洞处理。
+ */
+loff_t nvmixSeekData(struct inode *pInode, loff_t offset, bool isData);
+
+/**
+ * @brief 报告普通文件的数据块映射。注册 inode 操作的 fiemap 函数。
+ * @details 映射完全由 NVM 上的元数据得出，不读取 SSD。物理地址是 SSD 上的字节偏移量，未写入区段带有 FIEMAP_EXTENT_UNWRITTEN，它们只存在于 NVM 的元数据中。
+ */
+int nvmixFiemap(struct inode *pInode, struct fiemap_extent_info *pFieinfo, u64 start, u64 len);
+
+/**
+ * @brief 在 SSD 上复制源文件 [srcStart, srcStart + num) 中的数据块到目标文件从 dstStart 开始的位置。调用者需持有两个文件的 i_rwsem，回写源范围的 page cache，并回写和丢弃目标范围的 page cache。
+ * @return 成功返回 0，失败返回负的错误码。
+ * @details 数据不经过文件的 page cache。只有已经写入的块需要读写 SSD；空洞和未写入的块只复制 NVM 上的元数据，不产生 I/O。
+ */
+int nvmixCopyBlocks(struct inode *pDstInode, unsigned long dstStart, struct inode *pSrcInode, unsigned long srcStart, unsigned long num);
+
+/**
+ * @brief 计算普通文件已经写过的数据块占据的 i_blocks。
+ * @param pInode 普通文件的 inode 指针。
+ */
+blkcnt_t nvmixCountBlocks(struct inode *pInode);
+
 
 #endif
@@ -0,0 +1,294 @@
+/**
+ * @file sysfs.c
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief sysfs 接口的源文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "sysfs.h"
+
+#include "defs.h"
+#include "fs.h"
+
+#include <linux/fs.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/completion.h>
+
+
+/**
+ * @struct NvmixSysfsAttr
+ * @brief 只读 sysfs 属性，show 函数直接拿到 NvmixNvmHelper。
+ */
+struct NvmixSysfsAttr
+{
+    /**
+     * @brief 内嵌的通用 sysfs 属性。
+     */
+    struct attribute m_attr;
+
+    /**
+     * @brief 输出属性内容的函数。
+     */
+    ssize_t (*m_show)(struct NvmixNvmHelper *pNsbh, char *pBuffer);
+};
+
+
+/**
+ * @brief 输出 nvm_total_bytes。
+ */
+static ssize_t nvmixSysfsNvmTotalBytesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer);
+
+/**
+ * @brief 输出 nvm_used_bytes。
+ */
+static ssize_t nvmixSysfsNvmUsedBytesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer);
+
+/**
+ * @brief 输出 nvm_free_bytes。
+ */
+static ssize_t nvmixSysfsNvmFreeBytesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer);
+
+/**
+ * @brief 输出 inode_writes。
+ */
+static ssize_t nvmixSysfsInodeWritesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer);
+
+/**
+ * @brief 输出 inode_flushes。
+ */
+static ssize_t nvmixSysfsInodeFlushesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer);
+
+/**
+ * @brief 输出 readahead_pages。
+ */
+static ssize_t nvmixSysfsReadaheadPagesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer);
+
+/**
+ * @brief 输出 readahead_hole_pages。
+ */
+static ssize_t nvmixSysfsReadaheadHolePagesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer);
+
+/**
+ * @brief 输出 readpage_pages。
+ */
+static ssize_t nvmixSysfsReadpagePagesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer);
+
+/**
+ * @brief 计算 NVM 上的空闲字节数。
+ * @param pNsbh NvmixNvmHelper 结构指针。
+ * @return 空闲字节数。
+ * @details 元数据区大小固定，只有扩展属性块池是动态分配的。
+ */
+static unsigned long nvmixSysfsNvmFreeBytes(struct NvmixNvmHelper *pNsbh);
+
+/**
+ * @brief sysfs_ops 的 show 接口，分发到具体属性的 m_show。
+ */
+static ssize_t nvmixSysfsShow(struct kobject *pKobj, struct attribute *pAttr, char *pBuffer);
+
+/**
+ * @brief kobj_type 的 release 接口，通知 nvmixSysfsUnregister() 所有引用已释放。
+ */
+static void nvmixSysfsRelease(struct kobject *pKobj);
+
+
+static struct NvmixSysfsAttr nvmixSysfsNvmTotalBytesAttr = {
+    .m_attr = {.name = "nvm_total_bytes", .mode = 0444},
+    .m_show = nvmixSysfsNvmTotalBytesShow,
+};
+
+static struct NvmixSysfsAttr nvmixSysfsNvmUsedBytesAttr = {
+    .m_attr = {.name = "nvm_used_bytes", .mode = 0444},
+    .m_show = nvmixSysfsNvmUsedBytesShow,
+};
+
+static struct NvmixSysfsAttr nvmixSysfsNvmFreeBytesAttr = {
+    .m_attr = {.name = "nvm_free_bytes", .mode = 0444},
+    .m_show = nvmixSysfsNvmFreeBytesShow,
+};
+
+static struct NvmixSysfsAttr nvmixSysfsInodeWritesAttr = {
+    .m_attr = {.name = "inode_writes", .mode = 0444},
+    .m_show = nvmixSysfsInodeWritesShow,
+};
+
+static struct NvmixSysfsAttr nvmixSysfsInodeFlushesAttr = {
+    .m_attr = {.name = "inode_flushes", .mode = 0444},
+    .m_show = nvmixSysfsInodeFlushesShow,
+};
+
+static struct NvmixSysfsAttr nvmixSysfsReadaheadPagesAttr = {
+    .m_attr = {.name = "readahead_pages", .mode = 0444},
+    .m_show = nvmixSysfsReadaheadPagesShow,
+};
+
+static struct NvmixSysfsAttr nvmixSysfsReadaheadHolePagesAttr = {
+    .m_attr = {.name = "readahead_hole_pages", .mode = 0444},
+    .m_show = nvmixSysfsReadaheadHolePagesShow,
+};
+
+static struct NvmixSysfsAttr nvmixSysfsReadpagePagesAttr = {
+    .m_attr = {.name = "readpage_pages", .mode = 0444},
+    .m_show = nvmixSysfsReadpagePagesShow,
+};
+
+static struct attribute *nvmixSysfsAttrs[] = {
+    &nvmixSysfsNvmTotalBytesAttr.m_attr,
+    &nvmixSysfsNvmUsedBytesAttr.m_attr,
+    &nvmixSysfsNvmFreeBytesAttr.m_attr,
+    &nvmixSysfsInodeWritesAttr.m_attr,
+    &nvmixSysfsInodeFlushesAttr.m_attr,
+    &nvmixSysfsReadaheadPagesAttr.m_attr,
+    &nvmixSysfsReadaheadHolePagesAttr.m_attr,
+    &nvmixSysfsReadpagePagesAttr.m_attr,
+    NULL,
+};
+
+static const struct sysfs_ops nvmixSysfsOps = {
+    .show = nvmixSysfsShow,
+};
+
+static struct kobj_type nvmixSysfsKtype = {
+    .default_attrs = nvmixSysfsAttrs,
+    .sysfs_ops = &nvmixSysfsOps,
+    .release = nvmixSysfsRelease,
+};
+
+/**
+ * @brief /sys/fs/nvmixfs 对应的 kobject。
+ */
+static struct kobject *nvmixSysfsRoot = NULL;
+
+
+int nvmixSysfsInit(void)
+{
+    // fs_kobj 即 /sys/fs。
+    nvmixSysfsRoot = kobject_create_and_add("nvmixfs", fs_kobj);
+    if (!nvmixSysfsRoot)
+    {
+        pr_err("nvmixfs: failed to create /sys/fs/nvmixfs.\n");
+
+
+        return -ENOMEM;
+    }
+
+
+    return 0;
+}
+
+void nvmixSysfsExit(void)
+{
+    kobject_put(nvmixSysfsRoot);
+    nvmixSysfsRoot = NULL;
+}
+
+int nvmixSysfsRegister(struct super_block *pSb)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+    int res = 0;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+
+    init_completion(&pNsbh->m_kobjUnregister);
+
+    // 目录名使用块设备名，例如 /sys/fs/nvmixfs/sdb。
+    res = kobject_init_and_add(&pNsbh->m_kobj, &nvmixSysfsKtype, nvmixSysfsRoot, "%s", pSb->s_id);
+    if (0 != res)
+    {
+        pr_err("nvmixfs: failed to create sysfs directory for %s.\n", pSb->s_id);
+
+        // kobject_init_and_add() 失败后也需要 kobject_put() 释放引用，由 nvmixSysfsUnregister() 完成。
+    }
+
+
+    return res;
+}
+
+void nvmixSysfsUnregister(struct super_block *pSb)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+
+    if (!pNsbh->m_kobj.state_initialized) return;
+
+    kobject_del(&pNsbh->m_kobj);
+    kobject_put(&pNsbh->m_kobj);
+
+    // 正在读取属性文件的进程持有引用，等它们结束后 NvmixNvmHelper 才能释放。
+    wait_for_completion(&pNsbh->m_kobjUnregister);
+}
+
+
+ssize_t nvmixSysfsNvmTotalBytesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer)
+{
+    return snprintf(pBuffer, PAGE_SIZE, "%lu\n", (unsigned long)NVMIX_NVM_LAYOUT_SIZE);
+}
+
+ssize_t nvmixSysfsNvmUsedBytesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer)
+{
+    return snprintf(pBuffer, PAGE_SIZE, "%lu\n", (unsigned long)NVMIX_NVM_LAYOUT_SIZE - nvmixSysfsNvmFreeBytes(pNsbh));
+}
+
+ssize_t nvmixSysfsNvmFreeBytesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer)
+{
+    return snprintf(pBuffer, PAGE_SIZE, "%lu\n", nvmixSysfsNvmFreeBytes(pNsbh));
+}
+
+ssize_t nvmixSysfsInodeWritesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer)
+{
+    return snprintf(pBuffer, PAGE_SIZE, "%lld\n", (long long)atomic64_read(&pNsbh->m_inodeWriteNum));
+}
+
+ssize_t nvmixSysfsInodeFlushesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer)
+{
+    return snprintf(pBuffer, PAGE_SIZE, "%lld\n", (long long)atomic64_read(&pNsbh->m_inodeFlushNum));
+}
+
+ssize_t nvmixSysfsReadaheadPagesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer)
+{
+    return snprintf(pBuffer, PAGE_SIZE, "%lld\n", (long long)atomic64_read(&pNsbh->m_readaheadPageNum));
+}
+
+ssize_t nvmixSysfsReadaheadHolePagesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer)
+{
+    return snprintf(pBuffer, PAGE_SIZE, "%lld\n", (long long)atomic64_read(&pNsbh->m_readaheadHolePageNum));
+}
+
+ssize_t nvmixSysfsReadpagePagesShow(struct NvmixNvmHelper *pNsbh, char *pBuffer)
+{
+    return snprintf(pBuffer, PAGE_SIZE, "%lld\n", (long long)atomic64_read(&pNsbh->m_readpageNum));
+}
+
+unsigned long nvmixSysfsNvmFreeBytes(struct NvmixNvmHelper *pNsbh)
+{
+    return (unsigned long)nvmixAllocatorFreeCount(&pNsbh->m_xattrBlockAllocator) * NVMIX_BLOCK_SIZE;
+}
+
+ssize_t nvmixSysfsShow(struct kobject *pKobj, struct attribute *pAttr, char *pBuffer)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+    struct NvmixSysfsAttr *pNsa = NULL;
+
+
+    pNsbh = container_of(pKobj, struct NvmixNvmHelper, m_kobj);
+    pNsa = container_of(pAttr, struct NvmixSysfsAttr, m_attr);
+
+
+    return pNsa->m_show(pNsbh, pBuffer);
+}
+
+void nvmixSysfsRelease(struct kobject *pKobj)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+
+
+    pNsbh = container_of(pKobj, struct NvmixNvmHelper, m_kobj);
+
+    complete(&pNsbh->m_kobjUnregister);
+}
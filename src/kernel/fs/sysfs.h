@@ -0,0 +1,46 @@
+/**
+ * @file sysfs.h
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief sysfs 接口的头文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#ifndef _NVMIX_SYSFS_H_
+#define _NVMIX_SYSFS_H_
+
+#include <linux/fs.h>
+
+
+/**
+ * @brief 创建 /sys/fs/nvmixfs 目录。加载内核模块时调用。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int nvmixSysfsInit(void);
+
+/**
+ * @brief 删除 /sys/fs/nvmixfs 目录。卸载内核模块时调用。
+ */
+void nvmixSysfsExit(void);
+
+/**
+ * @brief 为文件系统实例创建 /sys/fs/nvmixfs/<设备名>/ 目录。
+ * @param pSb 超级块指针。
+ * @return 成功返回 0，失败返回非 0。
+ * @details 目录下的文件只读，导出 NVM 层的使用情况：
+ * 1. nvm_total_bytes：文件系统布局在 NVM 上占用的总字节数。
+ * 2. nvm_used_bytes：已使用的字节数，包括固定的元数据区和已分配的扩展属性块。
+ * 3. nvm_free_bytes：空闲字节数，即扩展属性块池中的空闲块。
+ */
+int nvmixSysfsRegister(struct super_block *pSb);
+
+/**
+ * @brief 删除文件系统实例的 sysfs 目录，并等待所有访问结束。
+ * @param pSb 超级块指针。
+ * @details 未注册时调用是安全的，便于 fill_super 的错误流程统一处理。
+ */
+void nvmixSysfsUnregister(struct super_block *pSb);
+
+
+#endif
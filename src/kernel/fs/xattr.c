@@ -0,0 +1,547 @@
+/**
+ * @file xattr.c
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 扩展属性操作的源文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "xattr.h"
+
+#include "defs.h"
+#include "fs.h"
+#include "inode.h"
+
+#include <linux/fs.h>
+#include <linux/xattr.h>
+#include <linux/security.h>
+#include <linux/capability.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <asm/cacheflush.h>
+
+
+/**
+ * @brief 扩展属性 inline 区中可用于存放条目的字节数，即去掉头部以后的空间。
+ */
+#define NVMIX_XATTR_INLINE_CAPACITY (NVMIX_XATTR_INLINE_SIZE - sizeof(struct NvmixXattrHeader))
+
+
+/**
+ * @brief 获得 inode 在扩展属性 inline 区上的头部。
+ * @param pInode inode 指针。
+ * @return 头部的虚拟地址。
+ */
+static struct NvmixXattrHeader *nvmixXattrGetHeader(struct inode *pInode);
+
+/**
+ * @brief 获得 inode 的扩展属性条目所在的区域，可能在 inline 区中，也可能在块池中。
+ * @param pInode inode 指针。
+ * @param pNxh inode 的扩展属性头部指针。
+ * @return 条目区域的起始虚拟地址。
+ */
+static char *nvmixXattrGetArea(struct inode *pInode, const struct NvmixXattrHeader *pNxh);
+
+/**
+ * @brief 在条目区域中查找指定的扩展属性。
+ * @param pArea 条目区域的起始地址。
+ * @param size 条目区域的有效字节数。
+ * @param nameIndex 名字前缀的编号。
+ * @param pName 去掉前缀以后的名字。
+ * @param nameLength 名字的长度。
+ * @return 找到返回条目头指针，否则返回 NULL。
+ */
+static struct NvmixXattrEntry *nvmixXattrFind(char *pArea, unsigned int size, int nameIndex, const char *pName, size_t nameLength);
+
+/**
+ * @brief 读取扩展属性的值。
+ * @param pInode inode 指针。
+ * @param nameIndex 名字前缀的编号。
+ * @param pName 去掉前缀以后的名字。
+ * @param pBuffer 存放值的缓冲区。
+ * @param size 缓冲区大小，为 0 时只返回值的长度。
+ * @return 成功返回值的长度，失败返回负的错误码。
+ * @details 只读 NVM，不会访问 SSD。
+ */
+static int nvmixXattrGet(struct inode *pInode, int nameIndex, const char *pName, void *pBuffer, size_t size);
+
+/**
+ * @brief 设置或删除扩展属性。
+ * @param pInode inode 指针。
+ * @param nameIndex 名字前缀的编号。
+ * @param pName 去掉前缀以后的名字。
+ * @param pValue 值，为 NULL 时表示删除。
+ * @param size 值的长度。
+ * @param flags XATTR_CREATE 或 XATTR_REPLACE。
+ * @return 成功返回 0，失败返回负的错误码。
+ * @details 先在内存中构造出所有条目的新内容，再根据总大小决定存放在 inline 区还是块池中。写入块池时总是使用新块，写完以后通过 nvmixXattrCommitHeader() 一次性切换，然后才释放旧块。inline 区内的原地改写不是崩溃原子的，但只影响该 inode 自己的 inline 扩展属性。
+ */
+static int nvmixXattrSet(struct inode *pInode, int nameIndex, const char *pName, const void *pValue, size_t size, int flags);
+
+/**
+ * @brief 从扩展属性块池中分配一个块。
+ * @param pSb 超级块指针。
+ * @param hint 选择起始分配组的提示。
+ * @return 成功返回块号，失败返回 -ENOSPC。
+ */
+static int nvmixXattrAllocBlock(struct super_block *pSb, unsigned long hint);
+
+/**
+ * @brief 释放扩展属性块池中的一个块。
+ * @param pSb 超级块指针。
+ * @param blockIndex 块号。
+ */
+static void nvmixXattrFreeBlock(struct super_block *pSb, unsigned int blockIndex);
+
+/**
+ * @brief 以一次 8 字节写入更新扩展属性头部并持久化。
+ * @param pNxh 头部指针。
+ * @param blockIndex 新的 m_blockIndex。
+ * @param size 新的 m_size。
+ */
+static void nvmixXattrCommitHeader(struct NvmixXattrHeader *pNxh, unsigned int blockIndex, unsigned int size);
+
+/**
+ * @brief 扩展属性处理函数的 get 接口，前缀编号存放在 pHandler->flags 中。
+ */
+static int nvmixXattrHandlerGet(const struct xattr_handler *pHandler, struct dentry *pDentry, struct inode *pInode, const char *pName, void *pBuffer, size_t size);
+
+/**
+ * @brief 扩展属性处理函数的 set 接口，前缀编号存放在 pHandler->flags 中。
+ */
+static int nvmixXattrHandlerSet(const struct xattr_handler *pHandler, struct dentry *pDentry, struct inode *pInode, const char *pName, const void *pValue, size_t size, int flags);
+
+/**
+ * @brief trusted.* 只对拥有 CAP_SYS_ADMIN 的进程可见。
+ */
+static bool nvmixXattrTrustedList(struct dentry *pDentry);
+
+/**
+ * @brief security_inode_init_security() 的回调，将安全模块给出的初始扩展属性写入 NVM。
+ */
+static int nvmixXattrInitSecurityCallback(struct inode *pInode, const struct xattr *pXattrArray, void *pFsInfo);
+
+
+static const struct xattr_handler nvmixXattrUserHandler = {
+    .prefix = XATTR_USER_PREFIX,
+    .flags = NVMIX_XATTR_INDEX_USER,
+    .get = nvmixXattrHandlerGet,
+    .set = nvmixXattrHandlerSet,
+};
+
+static const struct xattr_handler nvmixXattrTrustedHandler = {
+    .prefix = XATTR_TRUSTED_PREFIX,
+    .flags = NVMIX_XATTR_INDEX_TRUSTED,
+    .list = nvmixXattrTrustedList,
+    .get = nvmixXattrHandlerGet,
+    .set = nvmixXattrHandlerSet,
+};
+
+static const struct xattr_handler nvmixXattrSecurityHandler = {
+    .prefix = XATTR_SECURITY_PREFIX,
+    .flags = NVMIX_XATTR_INDEX_SECURITY,
+    .get = nvmixXattrHandlerGet,
+    .set = nvmixXattrHandlerSet,
+};
+
+/**
+ * @brief 前缀编号到处理函数的映射，listxattr 时用于还原完整名字。
+ */
+static const struct xattr_handler *nvmixXattrHandlerMap[] = {
+    [NVMIX_XATTR_INDEX_USER] = &nvmixXattrUserHandler,
+    [NVMIX_XATTR_INDEX_TRUSTED] = &nvmixXattrTrustedHandler,
+    [NVMIX_XATTR_INDEX_SECURITY] = &nvmixXattrSecurityHandler,
+};
+
+const struct xattr_handler *nvmixXattrHandlers[] = {
+    &nvmixXattrUserHandler,
+    &nvmixXattrTrustedHandler,
+    &nvmixXattrSecurityHandler,
+    NULL,
+};
+
+
+ssize_t nvmixListxattr(struct dentry *pDentry, char *pBuffer, size_t size)
+{
+    struct inode *pInode = NULL;
+    struct NvmixInodeHelper *pNih = NULL;
+    struct NvmixXattrHeader *pNxh = NULL;
+    struct NvmixXattrEntry *pNxe = NULL;
+    const struct xattr_handler *pHandler = NULL;
+    const char *pPrefix = NULL;
+    char *pArea = NULL;
+    unsigned int pos = 0;
+    unsigned int entrySize = 0;
+    size_t prefixLength = 0;
+    size_t length = 0;
+    ssize_t res = 0;
+
+
+    pInode = d_inode(pDentry);
+    pNih = NVMIX_I(pInode);
+
+    down_read(&pNih->m_xattrSem);
+
+    pNxh = nvmixXattrGetHeader(pInode);
+    pArea = nvmixXattrGetArea(pInode, pNxh);
+
+    for (pos = 0; pos + sizeof(struct NvmixXattrEntry) <= pNxh->m_size; pos += entrySize)
+    {
+        pNxe = (struct NvmixXattrEntry *)(pArea + pos);
+        entrySize = NVMIX_XATTR_ENTRY_SIZE(pNxe->m_nameLength, pNxe->m_valueSize);
+
+        pHandler = (pNxe->m_nameIndex < ARRAY_SIZE(nvmixXattrHandlerMap)) ? nvmixXattrHandlerMap[pNxe->m_nameIndex] : NULL;
+        if (!pHandler || (pHandler->list && !pHandler->list(pDentry))) continue;
+
+        pPrefix = xattr_prefix(pHandler);
+        prefixLength = strlen(pPrefix);
+        length = prefixLength + pNxe->m_nameLength + 1;
+
+        // pBuffer 为 NULL 时用户只是询问需要多大的缓冲区。
+        if (pBuffer)
+        {
+            if (res + length > size)
+            {
+                res = -ERANGE;
+
+                break;
+            }
+
+            memcpy(pBuffer + res, pPrefix, prefixLength);
+            memcpy(pBuffer + res + prefixLength, (char *)(pNxe + 1), pNxe->m_nameLength);
+            pBuffer[res + length - 1] = '\0';
+        }
+
+        res += length;
+    }
+
+    up_read(&pNih->m_xattrSem);
+
+
+    return res;
+}
+
+int nvmixXattrInitSecurity(struct inode *pInode, struct inode *pDirInode, const struct qstr *pName)
+{
+    // 未启用安全模块时 security_inode_init_security() 直接返回 0。
+    return security_inode_init_security(pInode, pDirInode, pName, nvmixXattrInitSecurityCallback, NULL);
+}
+
+void nvmixXattrInit(struct inode *pInode)
+{
+    nvmixXattrCommitHeader(nvmixXattrGetHeader(pInode), 0, 0);
+}
+
+void nvmixXattrDrop(struct inode *pInode)
+{
+    struct NvmixInodeHelper *pNih = NULL;
+    struct NvmixXattrHeader *pNxh = NULL;
+    unsigned int blockIndex = 0;
+
+
+    pNih = NVMIX_I(pInode);
+
+    down_write(&pNih->m_xattrSem);
+
+    pNxh = nvmixXattrGetHeader(pInode);
+    blockIndex = pNxh->m_blockIndex;
+
+    // 先让头部不再引用块，再释放块，顺序反过来的话崩溃后块可能被两个 inode 同时引用。
+    nvmixXattrCommitHeader(pNxh, 0, 0);
+
+    if (0 != blockIndex) nvmixXattrFreeBlock(pInode->i_sb, blockIndex - 1);
+
+    up_write(&pNih->m_xattrSem);
+}
+
+
+struct NvmixXattrHeader *nvmixXattrGetHeader(struct inode *pInode)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pInode->i_sb->s_fs_info);
+
+
+    return (struct NvmixXattrHeader *)((char *)(pNsbh->m_xattrInlineVirtAddr) + pInode->i_ino * NVMIX_XATTR_INLINE_SIZE);
+}
+
+char *nvmixXattrGetArea(struct inode *pInode, const struct NvmixXattrHeader *pNxh)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+
+
+    // 条目存放在 inline 区时紧跟在头部之后。
+    if (0 == pNxh->m_blockIndex) return (char *)(pNxh + 1);
+
+    pNsbh = (struct NvmixNvmHelper *)(pInode->i_sb->s_fs_info);
+
+
+    return (char *)(pNsbh->m_xattrPoolVirtAddr) + (pNxh->m_blockIndex - 1) * NVMIX_BLOCK_SIZE;
+}
+
+struct NvmixXattrEntry *nvmixXattrFind(char *pArea, unsigned int size, int nameIndex, const char *pName, size_t nameLength)
+{
+    struct NvmixXattrEntry *pNxe = NULL;
+    unsigned int pos = 0;
+    unsigned int entrySize = 0;
+
+
+    for (pos = 0; pos + sizeof(struct NvmixXattrEntry) <= size; pos += entrySize)
+    {
+        pNxe = (struct NvmixXattrEntry *)(pArea + pos);
+        entrySize = NVMIX_XATTR_ENTRY_SIZE(pNxe->m_nameLength, pNxe->m_valueSize);
+
+        if ((pNxe->m_nameIndex == nameIndex) && (pNxe->m_nameLength == nameLength) && (0 == memcmp(pNxe + 1, pName, nameLength))) return pNxe;
+    }
+
+
+    return NULL;
+}
+
+int nvmixXattrGet(struct inode *pInode, int nameIndex, const char *pName, void *pBuffer, size_t size)
+{
+    struct NvmixInodeHelper *pNih = NULL;
+    struct NvmixXattrHeader *pNxh = NULL;
+    struct NvmixXattrEntry *pNxe = NULL;
+    int res = 0;
+
+
+    pNih = NVMIX_I(pInode);
+
+    down_read(&pNih->m_xattrSem);
+
+    pNxh = nvmixXattrGetHeader(pInode);
+
+    pNxe = nvmixXattrFind(nvmixXattrGetArea(pInode, pNxh), pNxh->m_size, nameIndex, pName, strlen(pName));
+    if (!pNxe)
+    {
+        res = -ENODATA;
+        goto ERR;
+    }
+
+    res = pNxe->m_valueSize;
+
+    // size 为 0 时用户只是询问值的长度。
+    if (0 == size) goto ERR;
+
+    if (size < pNxe->m_valueSize)
+    {
+        res = -ERANGE;
+        goto ERR;
+    }
+
+    memcpy(pBuffer, (char *)(pNxe + 1) + pNxe->m_nameLength, pNxe->m_valueSize);
+
+
+ERR:
+    up_read(&pNih->m_xattrSem);
+
+
+    return res;
+}
+
+int nvmixXattrSet(struct inode *pInode, int nameIndex, const char *pName, const void *pValue, size_t size, int flags)
+{
+    struct NvmixInodeHelper *pNih = NULL;
+    struct NvmixXattrHeader *pNxh = NULL;
+    struct NvmixXattrEntry *pNxe = NULL;
+    char *pOldArea = NULL;
+    char *pNewArea = NULL;
+    char *pBuffer = NULL;
+    unsigned int oldBlockIndex = 0;
+    unsigned int pos = 0;
+    unsigned int entrySize = 0;
+    unsigned int newSize = 0;
+    size_t nameLength = 0;
+    int blockIndex = 0;
+    int isFound = 0;
+    int res = 0;
+
+
+    // 名字长度存放在 unsigned char 中。vfs 已经限制了完整名字不超过 XATTR_NAME_MAX（255）。
+    nameLength = strlen(pName);
+    if (nameLength > XATTR_NAME_MAX) return -ERANGE;
+
+    // 单个 inode 的所有扩展属性最多占一个块。
+    if (size > NVMIX_BLOCK_SIZE) return -ENOSPC;
+
+    pBuffer = kmalloc(NVMIX_BLOCK_SIZE, GFP_KERNEL);
+    if (!pBuffer) return -ENOMEM;
+
+    pNih = NVMIX_I(pInode);
+
+    down_write(&pNih->m_xattrSem);
+
+    pNxh = nvmixXattrGetHeader(pInode);
+    pOldArea = nvmixXattrGetArea(pInode, pNxh);
+    oldBlockIndex = pNxh->m_blockIndex;
+
+    // 把除目标以外的条目复制到缓冲区中。
+    for (pos = 0; pos + sizeof(struct NvmixXattrEntry) <= pNxh->m_size; pos += entrySize)
+    {
+        pNxe = (struct NvmixXattrEntry *)(pOldArea + pos);
+        entrySize = NVMIX_XATTR_ENTRY_SIZE(pNxe->m_nameLength, pNxe->m_valueSize);
+
+        if ((pNxe->m_nameIndex == nameIndex) && (pNxe->m_nameLength == nameLength) && (0 == memcmp(pNxe + 1, pName, nameLength)))
+        {
+            isFound = 1;
+
+            continue;
+        }
+
+        memcpy(pBuffer + newSize, pNxe, entrySize);
+        newSize += entrySize;
+    }
+
+    if ((flags & XATTR_CREATE) && isFound)
+    {
+        res = -EEXIST;
+        goto ERR;
+    }
+
+    // 删除操作 vfs 会带上 XATTR_REPLACE，因此删除不存在的扩展属性也走这里。
+    if ((flags & XATTR_REPLACE) && !isFound)
+    {
+        res = -ENODATA;
+        goto ERR;
+    }
+
+    // 追加新条目。
+    if (pValue)
+    {
+        entrySize = NVMIX_XATTR_ENTRY_SIZE(nameLength, size);
+        if (newSize + entrySize > NVMIX_BLOCK_SIZE)
+        {
+            res = -ENOSPC;
+            goto ERR;
+        }
+
+        memset(pBuffer + newSize, 0, entrySize);
+
+        pNxe = (struct NvmixXattrEntry *)(pBuffer + newSize);
+        pNxe->m_nameIndex = nameIndex;
+        pNxe->m_nameLength = nameLength;
+        pNxe->m_valueSize = size;
+
+        memcpy((char *)(pNxe + 1), pName, nameLength);
+        memcpy((char *)(pNxe + 1) + nameLength, pValue, size);
+
+        newSize += entrySize;
+    }
+
+    if (newSize <= NVMIX_XATTR_INLINE_CAPACITY)
+    {
+        // 放得下就存放在 inline 区。原来在块池中时 inline 区处于空闲状态，写入是安全的。
+        pNewArea = (char *)(pNxh + 1);
+
+        memcpy(pNewArea, pBuffer, newSize);
+        if (newSize) clflush_cache_range(pNewArea, newSize);
+
+        nvmixXattrCommitHeader(pNxh, 0, newSize);
+    }
+    else
+    {
+        // 放不下则整体写入块池中的一个新块。
+        blockIndex = nvmixXattrAllocBlock(pInode->i_sb, pInode->i_ino);
+        if (blockIndex < 0)
+        {
+            res = blockIndex;
+            goto ERR;
+        }
+
+        pNewArea = (char *)(((struct NvmixNvmHelper *)(pInode->i_sb->s_fs_info))->m_xattrPoolVirtAddr) + blockIndex * NVMIX_BLOCK_SIZE;
+
+        memcpy(pNewArea, pBuffer, newSize);
+        clflush_cache_range(pNewArea, newSize);
+
+        nvmixXattrCommitHeader(pNxh, blockIndex + 1, newSize);
+    }
+
+    // 头部已经切换到新位置，旧块不再被引用。
+    if (0 != oldBlockIndex) nvmixXattrFreeBlock(pInode->i_sb, oldBlockIndex - 1);
+
+    pInode->i_ctime = current_time(pInode);
+    mark_inode_dirty(pInode);
+
+
+ERR:
+    up_write(&pNih->m_xattrSem);
+
+    kfree(pBuffer);
+    pBuffer = NULL;
+
+
+    return res;
+}
+
+int nvmixXattrAllocBlock(struct super_block *pSb, unsigned long hint)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+    long index = 0;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+
+    index = nvmixAllocatorAlloc(&pNsbh->m_xattrBlockAllocator, hint);
+    if (index < 0) pr_err("nvmixfs: no space left in xattr block pool.\n");
+
+
+    return index;
+}
+
+void nvmixXattrFreeBlock(struct super_block *pSb, unsigned int blockIndex)
+{
+    struct NvmixNvmHelper *pNsbh = NULL;
+
+
+    pNsbh = (struct NvmixNvmHelper *)(pSb->s_fs_info);
+
+    nvmixAllocatorFree(&pNsbh->m_xattrBlockAllocator, blockIndex);
+}
+
+void nvmixXattrCommitHeader(struct NvmixXattrHeader *pNxh, unsigned int blockIndex, unsigned int size)
+{
+    struct NvmixXattrHeader newNxh = {
+        .m_blockIndex = blockIndex,
+        .m_size = size,
+    };
+
+
+    // 头部 8 字节且按 NVMIX_XATTR_INLINE_SIZE 对齐，作为一个整体写入是原子的。
+    WRITE_ONCE(*(u64 *)pNxh, *(u64 *)&newNxh);
+
+    clflush_cache_range(pNxh, sizeof(struct NvmixXattrHeader));
+}
+
+int nvmixXattrHandlerGet(const struct xattr_handler *pHandler, struct dentry *pDentry, struct inode *pInode, const char *pName, void *pBuffer, size_t size)
+{
+    return nvmixXattrGet(pInode, pHandler->flags, pName, pBuffer, size);
+}
+
+int nvmixXattrHandlerSet(const struct xattr_handler *pHandler, struct dentry *pDentry, struct inode *pInode, const char *pName, const void *pValue, size_t size, int flags)
+{
+    return nvmixXattrSet(pInode, pHandler->flags, pName, pValue, size, flags);
+}
+
+bool nvmixXattrTrustedList(struct dentry *pDentry)
+{
+    return capable(CAP_SYS_ADMIN);
+}
+
+int nvmixXattrInitSecurityCallback(struct inode *pInode, const struct xattr *pXattrArray, void *pFsInfo)
+{
+    const struct xattr *pXattr = NULL;
+    int res = 0;
+
+
+    for (pXattr = pXattrArray; pXattr->name; ++pXattr)
+    {
+        res = nvmixXattrSet(pInode, NVMIX_XATTR_INDEX_SECURITY, pXattr->name, pXattr->value, pXattr->value_len, 0);
+        if (0 != res) break;
+    }
+
+
+    return res;
+}
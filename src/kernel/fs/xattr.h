@@ -0,0 +1,56 @@
+/**
+ * @file xattr.h
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 扩展属性操作的头文件。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#ifndef _NVMIX_XATTR_H_
+#define _NVMIX_XATTR_H_
+
+#include <linux/fs.h>
+#include <linux/xattr.h>
+
+
+/**
+ * @brief 本文件系统支持的扩展属性处理函数表，以 NULL 结尾。注册到超级块的 s_xattr。
+ * @details 支持 user.*、trusted.* 和 security.* 三种前缀。
+ */
+extern const struct xattr_handler *nvmixXattrHandlers[];
+
+
+/**
+ * @brief 列出 inode 的所有扩展属性名字。注册 inode 操作接口的 listxattr 函数。
+ * @param pDentry 目标的 dentry 指针。
+ * @param pBuffer 用户缓冲区，名字之间以 '\0' 分隔。为 NULL 时只返回所需大小。
+ * @param size 用户缓冲区大小。
+ * @return 成功返回名字列表的总字节数，失败返回负的错误码。
+ */
+ssize_t nvmixListxattr(struct dentry *pDentry, char *pBuffer, size_t size);
+
+/**
+ * @brief 为新创建的 inode 初始化安全模块（如 SELinux）要求的 security.* 扩展属性。
+ * @param pInode 新创建的 inode 指针。
+ * @param pDirInode 父目录的 inode 指针。
+ * @param pName 新目录项的名字。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int nvmixXattrInitSecurity(struct inode *pInode, struct inode *pDirInode, const struct qstr *pName);
+
+/**
+ * @brief 清空新分配的 inode 在 NVM 上的扩展属性区。
+ * @param pInode 新分配的 inode 指针。
+ * @details 只清空头部，不释放块池中的块。上一任使用者的块在其回收时已由 nvmixXattrDrop() 释放。
+ */
+void nvmixXattrInit(struct inode *pInode);
+
+/**
+ * @brief 释放 inode 在 NVM 上的扩展属性，包括块池中的块。
+ * @param pInode 要释放的 inode 指针，硬链接数需已为 0。
+ */
+void nvmixXattrDrop(struct inode *pInode);
+
+
+#endif
@@ -13,6 +13,8 @@
 #include <linux/io.h>
 
 #include "config.h"
+#include "nvm.h"
+#include "sysfs.h"
 
 
 MODULE_VERSION(NVMIX_CONFIG_VERSION);
@@ -29,6 +31,8 @@ extern unsigned long nvmixNvmPhySize;
 
 extern void *nvmixNvmVirtAddr;
 
+extern bool nvmixNvmHugeMap;
+
 
 /**
  * @brief 内核提供的用于定义内核模块参数的宏。
@@ -44,6 +48,9 @@ MODULE_PARM_DESC(nvmixNvmPhyAddr, "Starting Physical Address Of NVM Space.");
 module_param(nvmixNvmPhySize, ulong, S_IRUGO);
 MODULE_PARM_DESC(nvmixNvmPhySize, "Size Of NVM Space.");
 
+module_param(nvmixNvmHugeMap, bool, S_IRUGO);
+MODULE_PARM_DESC(nvmixNvmHugeMap, "Map NVM Space With Huge Pages Where Possible.");
+
 
 static int __init nvmixInit(void)
 {
@@ -55,8 +62,9 @@ static int __init nvmixInit(void)
     // 在计算机系统中，I/O 内存是指通过内存映射 I/O（Memory-Mapped I/O, MMIO）方式访问的硬件设备资源。这些资源可以是设备的寄存器、缓冲区或其他控制接口，它们被映射到处理器的物理地址空间中，使得软件（如操作系统或驱动程序）能够像访问普通内存一样读写这些硬件资源。
     // memremap()：用于映射普通内存（如 RAM、持久内存等）到内核虚拟地址空间。支持灵活的缓存策略（如 Write-Through、Write-Back）。
     // memremap() 的第三个参数指定缓存类型：MEMREMAP_WB Write-Back 缓存（性能优化）。MEMREMAP_WT Write-Through 缓存（写入直达内存）。MEMREMAP_UC Uncached（类似 ioremap）。
-    nvmixNvmVirtAddr = memremap(nvmixNvmPhyAddr, nvmixNvmPhySize, MEMREMAP_WB);
-    if (IS_ERR(nvmixNvmVirtAddr))
+    // nvmixNvmMap() 在 memremap() 的基础上尽量使用大页，见其说明。memremap() 失败时返回 NULL 而不是错误指针。
+    nvmixNvmVirtAddr = nvmixNvmMap(nvmixNvmPhyAddr, nvmixNvmPhySize);
+    if (IS_ERR_OR_NULL(nvmixNvmVirtAddr))
     {
         pr_err("nvmixfs: failed to map reserved memory.\n");
 
@@ -69,12 +77,18 @@ static int __init nvmixInit(void)
 
     pr_info("nvmixfs: mapped reserved memory successfully.\n");
 
+    // 创建 /sys/fs/nvmixfs，挂载时在其下为每个文件系统实例创建目录。
+    res = nvmixSysfsInit();
+    if (0 != res) goto ERR;
+
     // 注册文件系统。
     res = register_filesystem(&nvmixFileSystemType);
     if (0 != res)
     {
         pr_err("nvmixfs: failed to register nvmixfs.\n");
 
+        nvmixSysfsExit();
+
         goto ERR;
     }
 
@@ -94,7 +108,7 @@ static void __exit nvmixExit(void)
     memset(nvmixNvmVirtAddr, 0, nvmixNvmPhySize);
 
     // 释放映射。
-    memunmap(nvmixNvmVirtAddr);
+    nvmixNvmUnmap();
     nvmixNvmVirtAddr = NULL;
 
     pr_info("nvmixfs: unmapped reserved memory successfully.\n");
@@ -109,6 +123,8 @@ static void __exit nvmixExit(void)
         return;
     }
 
+    nvmixSysfsExit();
+
     pr_info("nvmisfs: nvmixfs module unloaded.\n");
 }
 
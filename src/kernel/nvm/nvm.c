@@ -1,7 +1,7 @@
 /**
  * @file nvm.c
  * @author DavidingPlus (davidingplus@qq.com)
- * @brief 存放 NVM 空间的变量的源文件。
+ * @brief 存放 NVM 空间的变量和映射函数的源文件。
  *
  * Copyright (c) 2025 电子科技大学 刘治学
  *
@@ -10,6 +10,11 @@
 #include "nvm.h"
 
 #include <linux/stddef.h>
+#include <linux/kernel.h>
+#include <linux/io.h>
+#include <linux/ioport.h>
+#include <linux/mm.h>
+#include <asm/pgtable.h>
 
 
 unsigned long nvmixNvmPhyAddr = 0;
@@ -17,3 +22,223 @@ unsigned long nvmixNvmPhyAddr = 0;
 unsigned long nvmixNvmPhySize = 0;
 
 void *nvmixNvmVirtAddr = NULL;
+
+bool nvmixNvmHugeMap = true;
+
+
+/**
+ * @brief 实际映射的起始虚拟地址，扩展映射时小于 nvmixNvmVirtAddr。
+ */
+static void *nvmixNvmMapBase = NULL;
+
+
+/**
+ * @struct NvmixNvmResourceSearch
+ * @brief 在 iomem 资源树中查找包含 NVM 空间的资源时使用的参数。
+ */
+struct NvmixNvmResourceSearch
+{
+    /**
+     * @brief NVM 空间的起始物理地址。
+     */
+    unsigned long m_phyAddr;
+
+    /**
+     * @brief NVM 空间的大小。
+     */
+    unsigned long m_size;
+
+    /**
+     * @brief 找到的资源截断到查找范围以后的起始物理地址。
+     */
+    unsigned long m_start;
+
+    /**
+     * @brief 找到的资源截断到查找范围以后的结束物理地址，不包含在内。
+     */
+    unsigned long m_end;
+};
+
+
+/**
+ * @brief 选择映射对齐的粒度：能覆盖至少一个完整大页的最大页大小。
+ * @param size NVM 空间的大小。
+ * @return PUD_SIZE、PMD_SIZE 或者 PAGE_SIZE。
+ */
+static unsigned long nvmixNvmMapAlign(unsigned long size);
+
+/**
+ * @brief 将扩展后的映射范围限制在包含 NVM 空间的资源以内。
+ * @param phyAddr NVM 空间的起始物理地址。
+ * @param size NVM 空间的大小。
+ * @param pStart 扩展后的起始物理地址，返回时被限制到资源以内。
+ * @param pEnd 扩展后的结束物理地址，不包含在内，返回时被限制到资源以内。
+ * @details 驱动占用的 pmem 命名空间带有 IORESOURCE_BUSY，而 pmem 区域本身没有，因此先查找包含 NVM 空间的命名空间，找不到再查找区域。都找不到时不扩展。
+ */
+static void nvmixNvmClampToResource(unsigned long phyAddr, unsigned long size, unsigned long *pStart, unsigned long *pEnd);
+
+/**
+ * @brief walk_iomem_res_desc() 的回调函数，记录完全包含 NVM 空间的资源。
+ * @param pRes 资源，已经被截断到查找范围以内。
+ * @param pArg struct NvmixNvmResourceSearch 指针。
+ * @return 找到返回 1，结束遍历，否则返回 0。
+ */
+static int nvmixNvmFindResource(struct resource *pRes, void *pArg);
+
+/**
+ * @brief 判断物理地址范围是否完全是持久内存。
+ * @param start 起始物理地址。
+ * @param size 大小。
+ * @return 是返回 true。
+ */
+static bool nvmixNvmIsPmem(unsigned long start, unsigned long size);
+
+/**
+ * @brief 遍历内核页表，打印映射实际使用的各种页的数量。
+ * @param pAddr 起始虚拟地址。
+ * @param size 大小。
+ */
+static void nvmixNvmReportPageSizes(void *pAddr, unsigned long size);
+
+
+void *nvmixNvmMap(unsigned long phyAddr, unsigned long size)
+{
+    unsigned long align = PAGE_SIZE;
+    unsigned long start = phyAddr;
+    unsigned long end = phyAddr + size;
+    void *pAddr = NULL;
+
+
+    if (nvmixNvmHugeMap) align = nvmixNvmMapAlign(size);
+
+    // 1 GiB 的边界超出资源时再尝试 2 MiB 的边界。
+    for (; align > PAGE_SIZE; align = (PUD_SIZE == align) ? PMD_SIZE : PAGE_SIZE)
+    {
+        start = ALIGN_DOWN(phyAddr, align);
+        end = ALIGN(phyAddr + size, align);
+
+        // 扩展的部分不能覆盖相邻的命名空间、其他设备或者普通内存，缓存类型不同的重叠映射也是不允许的。
+        nvmixNvmClampToResource(phyAddr, size, &start, &end);
+
+        // 起始地址对齐以后虚拟地址和物理地址才能同时按大页对齐，结束地址被截断时只有末尾不足一个大页的部分使用小页。
+        if (IS_ALIGNED(start, align) && nvmixNvmIsPmem(start, end - start)) break;
+
+        pr_info("nvmixfs: NVM space is not aligned to %lu KiB and cannot be extended within its resource.\n", align >> 10);
+
+        start = phyAddr;
+        end = phyAddr + size;
+    }
+
+    pAddr = memremap(start, end - start, MEMREMAP_WB);
+    if (!pAddr) return NULL;
+
+    nvmixNvmMapBase = pAddr;
+    pAddr = (char *)pAddr + (phyAddr - start);
+
+    nvmixNvmReportPageSizes(pAddr, size);
+
+
+    return pAddr;
+}
+
+void nvmixNvmUnmap(void)
+{
+    if (nvmixNvmMapBase) memunmap(nvmixNvmMapBase);
+
+    nvmixNvmMapBase = NULL;
+}
+
+unsigned long nvmixNvmMapAlign(unsigned long size)
+{
+#ifdef CONFIG_X86
+    if ((size >= PUD_SIZE) && boot_cpu_has(X86_FEATURE_GBPAGES)) return PUD_SIZE;
+#endif
+
+    if (size >= PMD_SIZE) return PMD_SIZE;
+
+
+    return PAGE_SIZE;
+}
+
+void nvmixNvmClampToResource(unsigned long phyAddr, unsigned long size, unsigned long *pStart, unsigned long *pEnd)
+{
+    struct NvmixNvmResourceSearch search = {
+        .m_phyAddr = phyAddr,
+        .m_size = size,
+        .m_start = phyAddr,
+        .m_end = phyAddr + size,
+    };
+
+
+    // 遍历先访问父资源，找到后跳过其整个范围，因此不带 IORESOURCE_BUSY 查找时得到的是最外层的区域。
+    if (walk_iomem_res_desc(IORES_DESC_NONE, IORESOURCE_MEM | IORESOURCE_BUSY, *pStart, *pEnd - 1, &search, nvmixNvmFindResource) <= 0)
+    {
+        walk_iomem_res_desc(IORES_DESC_NONE, IORESOURCE_MEM, *pStart, *pEnd - 1, &search, nvmixNvmFindResource);
+    }
+
+    *pStart = search.m_start;
+    *pEnd = search.m_end;
+}
+
+int nvmixNvmFindResource(struct resource *pRes, void *pArg)
+{
+    struct NvmixNvmResourceSearch *pSearch = (struct NvmixNvmResourceSearch *)pArg;
+
+
+    if ((pRes->start > pSearch->m_phyAddr) || (pRes->end < pSearch->m_phyAddr + pSearch->m_size - 1)) return 0;
+
+    pSearch->m_start = pRes->start;
+    pSearch->m_end = pRes->end + 1;
+
+
+    return 1;
+}
+
+bool nvmixNvmIsPmem(unsigned long start, unsigned long size)
+{
+    // memmap=nn!ss 预留的是 legacy 类型，真实的 pmem 是 IORES_DESC_PERSISTENT_MEMORY。
+    if (REGION_INTERSECTS == region_intersects(start, size, IORESOURCE_MEM, IORES_DESC_PERSISTENT_MEMORY_LEGACY)) return true;
+
+
+    return REGION_INTERSECTS == region_intersects(start, size, IORESOURCE_MEM, IORES_DESC_PERSISTENT_MEMORY);
+}
+
+void nvmixNvmReportPageSizes(void *pAddr, unsigned long size)
+{
+#ifdef CONFIG_X86
+    unsigned long addr = (unsigned long)pAddr & PAGE_MASK;
+    unsigned long end = (unsigned long)pAddr + size;
+    unsigned long gigaNum = 0;
+    unsigned long hugeNum = 0;
+    unsigned long pageNum = 0;
+    unsigned int level = 0;
+
+
+    while (addr < end)
+    {
+        if (!lookup_address(addr, &level))
+        {
+            addr += PAGE_SIZE;
+            continue;
+        }
+
+        if (PG_LEVEL_1G == level)
+        {
+            ++gigaNum;
+            addr = ALIGN_DOWN(addr, PUD_SIZE) + PUD_SIZE;
+        }
+        else if (PG_LEVEL_2M == level)
+        {
+            ++hugeNum;
+            addr = ALIGN_DOWN(addr, PMD_SIZE) + PMD_SIZE;
+        }
+        else
+        {
+            ++pageNum;
+            addr += PAGE_SIZE;
+        }
+    }
+
+    pr_info("nvmixfs: NVM space mapped with %lu 1 GiB pages, %lu 2 MiB pages and %lu 4 KiB pages.\n", gigaNum, hugeNum, pageNum);
+#endif
+}
@@ -10,6 +10,8 @@
 #ifndef _NVMIX_NVM_H_
 #define _NVMIX_NVM_H_
 
+#include <linux/types.h>
+
 
 /**
  * @brief NVM 空间的起始物理地址。
@@ -27,5 +29,25 @@ extern unsigned long nvmixNvmPhySize;
  */
 extern void *nvmixNvmVirtAddr;
 
+/**
+ * @brief 是否尽量以大页映射 NVM 空间，通过内核模块参数配置，默认开启。关闭时与普通的 memremap() 相同，用于对比测试。
+ */
+extern bool nvmixNvmHugeMap;
+
+
+/**
+ * @brief 以回写缓存映射 NVM 空间，尽量使用 2 MiB 和 1 GiB 的大页。
+ * @param phyAddr NVM 空间的起始物理地址。
+ * @param size NVM 空间的大小。
+ * @return 成功返回 phyAddr 对应的虚拟地址，失败返回 NULL。
+ * @details memremap() 映射非 RAM 的持久内存时，只有物理地址和虚拟地址都按大页对齐的部分才能使用大页，而虚拟地址总是按映射大小对齐的，物理起始地址不对齐时整个映射都退化为 4 KiB 的页，随机访问元数据时 TLB 频繁缺失。因此将映射范围向两端扩展到大页边界，扩展的部分限制在包含 NVM 空间的 pmem 命名空间或者区域以内，并且仍然完全是持久内存；起始地址无法扩展到 1 GiB 边界时尝试 2 MiB 边界，都不行时按原范围映射。映射完成后打印实际使用的各种页的数量。
+ */
+void *nvmixNvmMap(unsigned long phyAddr, unsigned long size);
+
+/**
+ * @brief 释放 nvmixNvmMap() 建立的映射。
+ */
+void nvmixNvmUnmap(void);
+
 
 #endif
@@ -9,26 +9,244 @@
 
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
 
 #include <sys/stat.h>
+#include <sys/ioctl.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <dirent.h>
+#include <linux/fs.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "config.h"
 
 #include "defs.h"
 
 
-int main(int argc, char const *argv[])
+/**
+ * @brief O_DIRECT 写入时缓冲区、偏移量和长度的对齐要求。
+ * @details 取 4 KiB，能满足绝大多数设备的逻辑块大小。
+ */
+#define NVMIX_MKFS_DIRECT_ALIGN 4096
+
+/**
+ * @brief 清零 SSD 时每次 pwrite() 的最大字节数。
+ */
+#define NVMIX_MKFS_ZERO_BATCH_SIZE (1024 * 1024)
+
+
+/**
+ * @brief 计时工具，返回从 start 到现在经过的毫秒数。
+ */
+static double elapsedMs(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief 使用非临时（streaming）存储指令将一段内存清零。
+ * @param pDst 目标地址。
+ * @param size 字节数。
+ * @details 非临时存储绕过 CPU 缓存直接写入内存，清零大段 NVM 时不会把缓存中的有用数据挤出去，也省去了之后逐行刷写缓存的开销。不支持 SSE2 的平台退回 memset()。调用者仍需 msync() 保证持久化。
+ */
+static void streamZero(void *pDst, size_t size)
 {
-    if (4 != argc)
+    char *p = (char *)pDst;
+    char *pEnd = p + size;
+
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+
+    // 开头不满 16 字节对齐的部分使用普通写入。
+    while ((p < pEnd) && (0 != ((uintptr_t)p & 15))) *p++ = 0;
+
+    for (; p + 16 <= pEnd; p += 16) _mm_stream_si128((__m128i *)p, zero);
+
+    // 非临时存储是弱序的，sfence 保证它们在后续写入之前完成。
+    _mm_sfence();
+#endif
+
+    if (p < pEnd) memset(p, 0, pEnd - p);
+}
+
+/**
+ * @brief 使用多个线程以 O_DIRECT 批量写入的方式将 SSD 的一段区域清零。
+ * @param fd SSD 的文件描述符。
+ * @param offset 起始偏移量，需按 NVMIX_MKFS_DIRECT_ALIGN 对齐。
+ * @param size 字节数，需按 NVMIX_MKFS_DIRECT_ALIGN 对齐。
+ * @return 成功返回 0，失败返回 -1 并设置 errno。
+ * @details 区域被均分给各个线程，每个线程使用自己对齐的零缓冲区，每次写入 NVMIX_MKFS_ZERO_BATCH_SIZE 字节。
+ */
+static int parallelZero(int fd, off_t offset, off_t size)
+{
+    unsigned threadNum = std::max(1u, std::thread::hardware_concurrency());
+    off_t chunkSize = 0;
+    std::vector<std::thread> threads;
+    std::vector<int> errnos;
+
+
+    // 每个线程至少分到一个批次，避免为很小的区域创建过多线程。
+    threadNum = std::min<off_t>(threadNum, (size + NVMIX_MKFS_ZERO_BATCH_SIZE - 1) / NVMIX_MKFS_ZERO_BATCH_SIZE);
+    threadNum = std::max(1u, threadNum);
+
+    chunkSize = (size / threadNum + NVMIX_MKFS_DIRECT_ALIGN - 1) / NVMIX_MKFS_DIRECT_ALIGN * NVMIX_MKFS_DIRECT_ALIGN;
+
+    errnos.assign(threadNum, 0);
+
+    for (unsigned i = 0; i < threadNum; ++i)
+    {
+        threads.emplace_back([=, &errnos]() {
+            off_t start = offset + i * chunkSize;
+            off_t end = std::min(offset + size, start + chunkSize);
+            void *pZero = nullptr;
+
+
+            if (start >= end) return;
+
+            if (0 != posix_memalign(&pZero, NVMIX_MKFS_DIRECT_ALIGN, NVMIX_MKFS_ZERO_BATCH_SIZE))
+            {
+                errnos[i] = ENOMEM;
+
+                return;
+            }
+            memset(pZero, 0, NVMIX_MKFS_ZERO_BATCH_SIZE);
+
+            while (start < end)
+            {
+                ssize_t n = pwrite(fd, pZero, std::min<off_t>(NVMIX_MKFS_ZERO_BATCH_SIZE, end - start), start);
+                if (n <= 0)
+                {
+                    errnos[i] = (0 == n) ? EIO : errno;
+
+                    break;
+                }
+
+                start += n;
+            }
+
+            free(pZero);
+        });
+    }
+
+    for (auto &thread : threads) thread.join();
+
+    for (int e : errnos)
+    {
+        if (0 != e)
+        {
+            errno = e;
+
+
+            return -1;
+        }
+    }
+
+
+    return 0;
+}
+
+
+/**
+ * @brief 解析 2 的幂次的字节数。
+ * @param pStr 十进制或 0x 开头的十六进制字符串。
+ * @param pBits 返回以 2 为底的对数。
+ * @return 成功返回 true。
+ */
+static bool parsePowerOfTwo(const char *pStr, unsigned *pBits)
+{
+    unsigned long value = 0;
+
+
+    try
+    {
+        size_t pos = 0;
+
+        value = std::stoul(pStr, &pos, 0);
+        if ('\0' != pStr[pos]) return false;
+    }
+    catch (const std::exception &e)
+    {
+        return false;
+    }
+
+    if ((0 == value) || (0 != (value & (value - 1)))) return false;
+
+    *pBits = __builtin_ctzl(value);
+
+
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    bool isDiscard = true;
+    unsigned blockSizeBits = NVMIX_BLOCK_SIZE_BITS;
+    unsigned clusterSizeBits = NVMIX_BLOCK_SIZE_BITS;
+    bool isClusterSet = false;
+    int opt = 0;
+
+
+    // -K、-b 和 -C 与 mke2fs 含义相同：不对 SSD 执行 discard、数据块大小和簇大小。
+    while (-1 != (opt = getopt(argc, argv, "Kb:C:")))
+    {
+        if ('K' == opt)
+        {
+            isDiscard = false;
+        }
+        else if ('b' == opt)
+        {
+            if (!parsePowerOfTwo(optarg, &blockSizeBits)) argc = 0;
+        }
+        else if ('C' == opt)
+        {
+            isClusterSet = true;
+
+            if (!parsePowerOfTwo(optarg, &clusterSizeBits)) argc = 0;
+        }
+        else
+        {
+            argc = 0;
+        }
+
+        if (0 == argc) break;
+    }
+
+    // 不指定簇大小时，每个簇只有一个数据块。
+    if (!isClusterSet) clusterSizeBits = blockSizeBits;
+
+    if ((0 != argc) && ((clusterSizeBits < blockSizeBits) || !NVMIX_IS_VALID_GEOMETRY(blockSizeBits, clusterSizeBits - blockSizeBits)))
+    {
+        std::cerr << "Error: Block size must be 1024 to 4096 bytes, cluster size must be at least one block and at most "
+                  << (1 << NVMIX_MAX_CLUSTER_SIZE_BITS) << " bytes or " << NVMIX_CLUSTER_BITMAP_BITS << " blocks." << std::endl;
+
+
+        return EXIT_FAILURE;
+    }
+
+    if (3 != argc - optind)
     {
         std::cerr << "Error: Invalid arguments.\n"
                   << "Usage: " << argv[0]
-                  << " <nvm-device-path> <nvm-size-bytes> <ssd-device-path>\n"
+                  << " [-K] [-b block-size] [-C cluster-size] <nvm-device-path> <nvm-size-bytes> <ssd-device-path>\n"
+                  << "  -K                    Do not discard blocks on the SSD\n"
+                  << "  -b block-size         Size of SSD data blocks in bytes, 1024, 2048 or 4096 (default 4096)\n"
+                  << "  -C cluster-size       Size of the SSD space owned by each inode in bytes, 64 KiB to 1 MiB for large files (default one block)\n"
                   << "  <nvm-device-path>     Path to persistent memory device (e.g. /dev/pmem0)\n"
-                  << "  <nvm-size-bytes> Size of NVM space in bytes (e.g. 1048576 for 1MB)\n"
+                  << "  <nvm-size-bytes>      Size of NVM space in bytes, decimal or 0x-prefixed hex (e.g. 1048576 or 0x100000)\n"
                   << "  <ssd-device-path>     Path to SSD block device (e.g. /dev/sdb2)\n";
 
 
@@ -36,22 +254,39 @@ int main(int argc, char const *argv[])
     }
 
 
-    const char *nvmDevicePath = argv[1];
-    const char *ssdDevicePath = argv[3];
+    const char *nvmDevicePath = argv[optind];
+    const char *ssdDevicePath = argv[optind + 2];
     unsigned long nvmPhySize = 0;
+    auto totalStart = std::chrono::steady_clock::now();
 
-    // 将字符串表示的十六进制数字转化为 unsigned long 类型的十进制数。
+    // 将字符串转化为 unsigned long。基数为 0 时按前缀识别进制，0x 开头为十六进制。unsigned long 在 64 位 Linux 上是 64 位，可以表示超过 2 GiB 的 NVM 空间。
     try
     {
-        nvmPhySize = std::stoi(argv[2], nullptr, 16);
+        size_t pos = 0;
+
+        nvmPhySize = std::stoul(argv[optind + 1], &pos, 0);
+        if ('\0' != argv[optind + 1][pos]) throw std::invalid_argument(argv[optind + 1]);
     }
     catch (const std::exception &e)
     {
-        throw std::invalid_argument(std::string("Invalid argument: ") + argv[2]);
+        std::cerr << "Error: Invalid NVM size: " << argv[optind + 1] << std::endl;
+
+
+        return EXIT_FAILURE;
+    }
+
+    if (nvmPhySize < NVMIX_NVM_LAYOUT_SIZE)
+    {
+        std::cerr << "Error: NVM size must be at least " << NVMIX_NVM_LAYOUT_SIZE << " bytes." << std::endl;
+
+
+        return EXIT_FAILURE;
     }
 
 
     // 写入元数据。
+    auto nvmStart = std::chrono::steady_clock::now();
+
     int nvmFd = open(nvmDevicePath, O_RDWR);
     if (-1 == nvmFd)
     {
@@ -62,7 +297,8 @@ int main(int argc, char const *argv[])
     }
 
     // 具体映射逻辑见 snippet/PmemTest/main.cpp，使用 mmap 映射到用户态内存中，并通过 msync() 保证同步。
-    void *nvmVirtAddr = mmap(NULL, nvmPhySize, PROT_READ | PROT_WRITE, MAP_SHARED, nvmFd, 0);
+    // 只映射文件系统布局用到的部分，格式化耗时与 NVM 空间的大小无关。
+    void *nvmVirtAddr = mmap(NULL, NVMIX_NVM_LAYOUT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, nvmFd, 0);
     if (MAP_FAILED == nvmVirtAddr)
     {
         perror("mmap");
@@ -73,31 +309,15 @@ int main(int argc, char const *argv[])
         return EXIT_FAILURE;
     }
 
-    NvmixSuperBlock superBlock = {
-        .m_magic = NVMIX_MAGIC_NUMBER,
-        // 直接访问块设备就不会走 vfs 这一层了，所以初始化的时候 m_imap 需要考虑 reserved.txt（为了测试预先保留在本文件系统中的文件），写为 3 而不是 1。
-        .m_imap = 0x03,
-        .m_version = NvmixVersion{
-            .m_major = NVMIX_CONFIG_VERSION_MAJOR,
-            .m_minor = NVMIX_CONFIG_VERSION_MINOR,
-            .m_alter = NVMIX_CONFIG_VERSION_ALTER,
-        },
-    };
-
-    NvmixSuperBlock *superBlockVirtAddr = (NvmixSuperBlock *)((char *)nvmVirtAddr + NVMIX_SUPER_BLOCK_OFFSET);
-
-    *superBlockVirtAddr = superBlock;
-
-    // msync() 是一个用户态函数，用于将通过 mmap() 映射的内存区域中的修改数据强制同步回磁盘或其他底层存储设备。
-    // 写操作在用户层通过 msync 同步，在内核层通过 clflush_cache_range 同步。
-    int res = msync(superBlockVirtAddr, sizeof(NvmixSuperBlock), MS_SYNC);
-    if (-1 == res)
-    {
-        perror("msync");
-
+    // 用非临时存储清空超级块和日志区，防止挂载时重放残留的日志。
+    streamZero((char *)nvmVirtAddr + NVMIX_SUPER_BLOCK_OFFSET, NVMIX_BLOCK_SIZE);
+    streamZero((char *)nvmVirtAddr + NVMIX_JOURNAL_BLOCK_OFFSET, NVMIX_BLOCK_SIZE);
 
-        return EXIT_FAILURE;
-    }
+    // inode 区、inline 区和扩展属性 inline 区只清空第 0 个 inode 组（包含根目录和 reserved.txt）的槽位，其余的组由内核在挂载后延迟初始化，见 src/kernel/fs/lazyinit.h。
+    // 扩展属性块池由超级块的 m_xmap 管理，不需要清空。
+    streamZero((char *)nvmVirtAddr + NVMIX_INODE_BLOCK_OFFSET, NVMIX_INODE_GROUP_SIZE * sizeof(NvmixInode));
+    streamZero((char *)nvmVirtAddr + NVMIX_INLINE_BLOCK_OFFSET, NVMIX_INODE_GROUP_SIZE * NVMIX_INLINE_DATA_SIZE);
+    streamZero((char *)nvmVirtAddr + NVMIX_XATTR_INLINE_BLOCK_OFFSET, NVMIX_INODE_GROUP_SIZE * NVMIX_XATTR_INLINE_SIZE);
 
     NvmixInode rootDirInode = {
         .m_mode = S_IFDIR | 0755,
@@ -105,6 +325,8 @@ int main(int argc, char const *argv[])
         .m_gid = 0,
         .m_size = 0,
         .m_dataBlockIndex = NVMIX_FIRST_DATA_BLOCK_INDEX,
+        // 目录的硬链接数是 2，即自身的 . 和父目录中的目录项。根目录的父目录就是自己。
+        .m_nlink = 2,
     };
 
     NvmixInode fileInode = {
@@ -113,19 +335,56 @@ int main(int argc, char const *argv[])
         .m_gid = 0,
         .m_size = 0,
         .m_dataBlockIndex = 1 + NVMIX_FIRST_DATA_BLOCK_INDEX,
+        .m_nlink = 1,
     };
 
     NvmixInode *inodeVirtAddr = (NvmixInode *)((char *)nvmVirtAddr + NVMIX_INODE_BLOCK_OFFSET);
 
-    NvmixInode *rootDirInodeVirtAddr = inodeVirtAddr;
-    NvmixInode *fileInodeVirtAddr = inodeVirtAddr + 1;
+    inodeVirtAddr[0] = rootDirInode;
+    inodeVirtAddr[1] = fileInode;
+
+    // msync() 是一个用户态函数，用于将通过 mmap() 映射的内存区域中的修改数据强制同步回磁盘或其他底层存储设备。
+    // 写操作在用户层通过 msync 同步，在内核层通过 clflush_cache_range 同步。
+    // 注意：msync() 的参数给定的地址是需要页对齐的。除超级块以外的所有区域一次 msync() 即可。
+    int res = msync((char *)nvmVirtAddr + NVMIX_INODE_BLOCK_OFFSET, NVMIX_NVM_LAYOUT_SIZE - (NVMIX_INODE_BLOCK_OFFSET), MS_SYNC);
+    if (-1 == res)
+    {
+        perror("msync");
+
+
+        return EXIT_FAILURE;
+    }
+
+    NvmixSuperBlock superBlock = {
+        .m_magic = NVMIX_MAGIC_NUMBER,
+        // 直接访问块设备就不会走 vfs 这一层了，所以初始化的时候 m_imap 需要考虑 reserved.txt（为了测试预先保留在本文件系统中的文件），写为 3 而不是 1。
+        .m_imap = 0x03,
+        .m_xmap = 0,
+        // 只有第 0 个 inode 组已经初始化。
+        .m_initGroups = 0x01,
+        .m_version = NvmixVersion{
+            .m_major = NVMIX_CONFIG_VERSION_MAJOR,
+            .m_minor = NVMIX_CONFIG_VERSION_MINOR,
+            .m_alter = NVMIX_CONFIG_VERSION_ALTER,
+        },
+        .m_blockSizeBits = (unsigned char)blockSizeBits,
+        .m_clusterBits = (unsigned char)(clusterSizeBits - blockSizeBits),
+        .m_featureCompat = 0,
+        .m_featureRoCompat = NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE,
+        // 默认布局以外的数据块大小和簇大小需要实现支持，不支持的实现拒绝挂载。
+        .m_featureIncompat = ((NVMIX_BLOCK_SIZE_BITS != blockSizeBits) || (clusterSizeBits != blockSizeBits)) ? (unsigned int)NVMIX_FEATURE_INCOMPAT_CLUSTER : 0,
+        // 新格式化的镜像是干净的，第一次挂载也不需要扫描位图。
+        .m_state = NVMIX_STATE_CLEAN,
+        .m_freeInodeNum = NVMIX_MAX_INODE_NUM - 2,
+        .m_freeXattrBlockNum = NVMIX_MAX_XATTR_BLOCK_NUM,
+    };
+
+    NvmixSuperBlock *superBlockVirtAddr = (NvmixSuperBlock *)((char *)nvmVirtAddr + NVMIX_SUPER_BLOCK_OFFSET);
 
-    *rootDirInodeVirtAddr = rootDirInode;
-    *fileInodeVirtAddr = fileInode;
+    // 超级块最后写入，魔数只有在其余元数据都持久化以后才生效，格式化中途失败不会留下一个看似有效的文件系统。
+    *superBlockVirtAddr = superBlock;
 
-    // 注意：msync() 的参数给定的地址是需要页对齐的。因此这个地方的写入需要合并在一起，不能分开，否则 msync 同步 fileInodeVirtAddr 会失败。
-    // 内核的 clflush_cache_range() 的地址不需要页对齐。
-    res = msync(inodeVirtAddr, 2 * sizeof(NvmixInode), MS_SYNC);
+    res = msync(superBlockVirtAddr, sizeof(NvmixSuperBlock), MS_SYNC);
     if (-1 == res)
     {
         perror("msync");
@@ -134,13 +393,17 @@ int main(int argc, char const *argv[])
         return EXIT_FAILURE;
     }
 
-    munmap(nvmVirtAddr, nvmPhySize);
+    munmap(nvmVirtAddr, NVMIX_NVM_LAYOUT_SIZE);
 
     close(nvmFd);
 
+    double nvmMs = elapsedMs(nvmStart);
+
 
     // 写入 SSD 上的目录项数据。
-    int ssdFd = open(ssdDevicePath, O_RDWR);
+    // 优先使用 O_DIRECT 绕过页缓存。tmpfs 等不支持 O_DIRECT 的文件系统上的镜像文件会返回 EINVAL，此时退回普通 I/O。
+    int ssdFd = open(ssdDevicePath, O_RDWR | O_DIRECT);
+    if ((-1 == ssdFd) && (EINVAL == errno)) ssdFd = open(ssdDevicePath, O_RDWR);
     if (-1 == ssdFd)
     {
         perror("open");
@@ -149,24 +412,106 @@ int main(int argc, char const *argv[])
         return EXIT_FAILURE;
     }
 
-    // 将本文件系统管理的所有数据块清空。
-    const char zeroStr[NVMIX_BLOCK_SIZE] = {0};
+    struct stat ssdStat;
+    if (-1 == fstat(ssdFd, &ssdStat))
+    {
+        perror("fstat");
+
+
+        return EXIT_FAILURE;
+    }
 
-    // write() 执行以后文件偏移量会自动往后移，因此不用手动设置。
-    // 上个版本这里是 nvmFd，是不对的，应该是 ssdFd，但是程序没有跑出问题。原因是前面释放了 nvmFd 文件描述符对应的文件，但是变量 nvmFd 没有清空，例如是 3。新打开的文件优先使用空闲的文件描述符，因此 ssdFd 的值也是 3，这样歪打正着就成了，但是实际上是不符合语义的。
-    for (int i = 0; i < NVMIX_MAX_INODE_NUM; ++i) write(ssdFd, zeroStr, sizeof(zeroStr));
+    const bool isBlockDevice = S_ISBLK(ssdStat.st_mode);
+    // 本文件系统管理的簇从 NVMIX_FIRST_DATA_BLOCK_INDEX 开始，共 NVMIX_MAX_INODE_NUM 个。这里只清空第 0 个 inode 组对应的簇，其余的由内核延迟初始化。
+    // 至少清空一个对齐单位，根目录的数据块按对齐单位写入。
+    const off_t dataSize = std::max<off_t>((off_t)(NVMIX_FIRST_DATA_BLOCK_INDEX + NVMIX_INODE_GROUP_SIZE) << clusterSizeBits, NVMIX_MKFS_DIRECT_ALIGN);
+    double discardMs = 0;
+    double zeroMs = 0;
 
-    NvmixDentry fileDentry = {
-        .m_ino = 1,
-    };
-    strcpy(fileDentry.m_name, "reserved.txt");
+    // 对整个设备执行 discard，告诉 SSD 旧数据已经无用，便于其垃圾回收。设备不支持时忽略。
+    if (isDiscard && isBlockDevice)
+    {
+        auto discardStart = std::chrono::steady_clock::now();
+        uint64_t deviceSize = 0;
+
+        if (-1 == ioctl(ssdFd, BLKGETSIZE64, &deviceSize))
+        {
+            perror("ioctl BLKGETSIZE64");
+
+
+            return EXIT_FAILURE;
+        }
+
+        uint64_t range[2] = {0, deviceSize};
+        if (-1 == ioctl(ssdFd, BLKDISCARD, range))
+        {
+            if ((EOPNOTSUPP != errno) && (ENOTTY != errno)) perror("ioctl BLKDISCARD");
+        }
+
+        discardMs = elapsedMs(discardStart);
+    }
+
+    // 将第 0 个 inode 组的数据块清空。discard 之后读到的内容不一定是 0，因此仍需要清零。
+    // 块设备优先使用 BLKZEROOUT，由设备（例如 WRITE ZEROES 命令）完成，不需要传输数据；不支持时退回多线程 O_DIRECT 写入。
+    auto zeroStart = std::chrono::steady_clock::now();
+
+    uint64_t zeroRange[2] = {0, (uint64_t)dataSize};
+    if (!isBlockDevice || (-1 == ioctl(ssdFd, BLKZEROOUT, zeroRange)))
+    {
+        if (-1 == parallelZero(ssdFd, 0, dataSize))
+        {
+            perror("pwrite");
+
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    zeroMs = elapsedMs(zeroStart);
+
+    // 根目录的数据块中只有 reserved.txt 一个目录项。O_DIRECT 要求缓冲区对齐，因此写入一个对齐单位，数据块更小时多写的部分仍然是 0。
+    void *rootDirBlock = nullptr;
+    if (0 != posix_memalign(&rootDirBlock, NVMIX_MKFS_DIRECT_ALIGN, NVMIX_BLOCK_SIZE))
+    {
+        std::cerr << "Error: Failed to allocate memory." << std::endl;
+
+
+        return EXIT_FAILURE;
+    }
+    memset(rootDirBlock, 0, NVMIX_BLOCK_SIZE);
+
+    NvmixDentry *fileDentry = (NvmixDentry *)rootDirBlock;
+    fileDentry->m_ino = 1;
+    fileDentry->m_fileType = DT_REG;
+    strcpy(fileDentry->m_name, "reserved.txt");
 
-    lseek(ssdFd, NVMIX_FIRST_DATA_BLOCK_INDEX * NVMIX_BLOCK_SIZE, SEEK_SET);
+    if (NVMIX_BLOCK_SIZE != pwrite(ssdFd, rootDirBlock, NVMIX_BLOCK_SIZE, (off_t)NVMIX_FIRST_DATA_BLOCK_INDEX << clusterSizeBits))
+    {
+        perror("pwrite");
 
-    write(ssdFd, &fileDentry, sizeof(NvmixDentry));
+
+        return EXIT_FAILURE;
+    }
+
+    free(rootDirBlock);
+
+    // O_DIRECT 不经过页缓存，但设备自身的写缓存仍需要 fsync() 刷下去。
+    if (-1 == fsync(ssdFd))
+    {
+        perror("fsync");
+
+
+        return EXIT_FAILURE;
+    }
 
     close(ssdFd);
 
 
-    return 0;
+    std::cout << "nvm init:    " << nvmMs << " ms\n"
+              << "ssd discard: " << discardMs << " ms\n"
+              << "ssd zero:    " << zeroMs << " ms\n"
+              << "total:       " << elapsedMs(totalStart) << " ms" << std::endl;
+
+
+    return EXIT_SUCCESS;
 }
@@ -0,0 +1,241 @@
+/**
+ * @file backend.cpp
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief nvmix-bench 的两个测试后端：已挂载的文件系统和用户层引擎。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "bench.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "engine.h"
+
+
+/**
+ * @class PosixBackend
+ * @brief 通过系统调用访问已挂载的文件系统。
+ * @details 所有操作相对于目录的文件描述符进行（mkdirat()、openat()、fstatat() 等），避免路径解析的开销掩盖文件系统本身的开销。
+ */
+class PosixBackend : public BenchBackend
+{
+public:
+    PosixBackend(const std::string &path, int parentFd, int rootFd) : m_name("bench." + std::to_string(getpid())), m_path(path), m_parentFd(parentFd), m_rootFd(rootFd) {}
+
+    ~PosixBackend() override
+    {
+        close(m_rootFd);
+        unlinkat(m_parentFd, m_name.c_str(), AT_REMOVEDIR);
+        close(m_parentFd);
+    }
+
+    std::string name() const override { return "posix:" + m_path; }
+
+    unsigned long root() const override { return m_rootFd; }
+
+    int mkdir(unsigned long dir, const std::string &name, unsigned long *pChild) override
+    {
+        int fd = -1;
+
+
+        if (0 != mkdirat(dir, name.c_str(), 0755)) return -errno;
+
+        fd = openat(dir, name.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) return -errno;
+
+        *pChild = fd;
+
+
+        return 0;
+    }
+
+    int rmdir(unsigned long dir, const std::string &name) override { return 0 == unlinkat(dir, name.c_str(), AT_REMOVEDIR) ? 0 : -errno; }
+
+    int create(unsigned long dir, const std::string &name) override
+    {
+        int fd = openat(dir, name.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+
+
+        if (fd < 0) return -errno;
+
+        close(fd);
+
+
+        return 0;
+    }
+
+    int stat(unsigned long dir, const std::string &name) override
+    {
+        struct stat st;
+
+
+        return 0 == fstatat(dir, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) ? 0 : -errno;
+    }
+
+    int readdir(unsigned long dir) override
+    {
+        // fdopendir() 接管文件描述符，因此先复制一份。
+        int fd = openat(dir, ".", O_RDONLY | O_DIRECTORY);
+        DIR *pDir = nullptr;
+        int num = 0;
+
+
+        if (fd < 0) return -errno;
+
+        pDir = fdopendir(fd);
+        if (!pDir)
+        {
+            close(fd);
+            return -errno;
+        }
+
+        while (::readdir(pDir)) ++num;
+
+        closedir(pDir);
+
+
+        return num;
+    }
+
+    int unlink(unsigned long dir, const std::string &name) override { return 0 == unlinkat(dir, name.c_str(), 0) ? 0 : -errno; }
+
+    void release(unsigned long dir) override { close(dir); }
+
+private:
+    std::string m_name;
+
+    std::string m_path;
+
+    int m_parentFd;
+
+    int m_rootFd;
+};
+
+
+/**
+ * @class EngineBackend
+ * @brief 直接调用用户层引擎，目录句柄就是 inode 号。
+ */
+class EngineBackend : public BenchBackend
+{
+public:
+    explicit EngineBackend(bool isSync) : m_isSync(isSync) {}
+
+    ~EngineBackend() override { m_engine.unmount(); }
+
+    int mount(const std::string &nvmPath, const std::string &ssdPath)
+    {
+        int res = NvmixEngine::format(nvmPath, ssdPath);
+
+
+        if (0 != res) return res;
+
+
+        return m_engine.mount(nvmPath, ssdPath, m_isSync);
+    }
+
+    std::string name() const override { return m_isSync ? "engine-sync" : "engine"; }
+
+    unsigned long root() const override { return NVMIX_ROOT_DIR_INODE_NUMBER; }
+
+    int mkdir(unsigned long dir, const std::string &name, unsigned long *pChild) override { return m_engine.mkdir(dir, name, 0755, pChild); }
+
+    int rmdir(unsigned long dir, const std::string &name) override { return m_engine.rmdir(dir, name); }
+
+    int create(unsigned long dir, const std::string &name) override { return m_engine.create(dir, name, 0644); }
+
+    int stat(unsigned long dir, const std::string &name) override
+    {
+        unsigned long ino = 0;
+        NvmixInode ni;
+        int res = m_engine.lookup(dir, name, &ino);
+
+
+        if (0 != res) return res;
+
+
+        return m_engine.getattr(ino, &ni);
+    }
+
+    int readdir(unsigned long dir) override
+    {
+        std::vector<NvmixDentry> entries;
+        int res = m_engine.readdir(dir, &entries);
+
+
+        return 0 == res ? (int)entries.size() : res;
+    }
+
+    int unlink(unsigned long dir, const std::string &name) override { return m_engine.unlink(dir, name); }
+
+    void release(unsigned long) override {}
+
+private:
+    bool m_isSync;
+
+    NvmixEngine m_engine;
+};
+
+
+std::unique_ptr<BenchBackend> createPosixBackend(const std::string &path)
+{
+    std::string name = "bench." + std::to_string(getpid());
+    int parentFd = -1;
+    int rootFd = -1;
+
+
+    parentFd = open(path.c_str(), O_RDONLY | O_DIRECTORY);
+    if (parentFd < 0)
+    {
+        fprintf(stderr, "nvmix-bench: cannot open %s: %s\n", path.c_str(), strerror(errno));
+        goto ERR;
+    }
+
+    // 在独立的工作目录中测试，不影响 path 下已有的文件。
+    if (0 != mkdirat(parentFd, name.c_str(), 0755))
+    {
+        fprintf(stderr, "nvmix-bench: cannot create %s/%s: %s\n", path.c_str(), name.c_str(), strerror(errno));
+        goto ERR;
+    }
+
+    rootFd = openat(parentFd, name.c_str(), O_RDONLY | O_DIRECTORY);
+    if (rootFd < 0)
+    {
+        fprintf(stderr, "nvmix-bench: cannot open %s/%s: %s\n", path.c_str(), name.c_str(), strerror(errno));
+        unlinkat(parentFd, name.c_str(), AT_REMOVEDIR);
+        goto ERR;
+    }
+
+
+    return std::unique_ptr<BenchBackend>(new PosixBackend(path, parentFd, rootFd));
+
+ERR:
+    if (parentFd >= 0) close(parentFd);
+
+
+    return nullptr;
+}
+
+std::unique_ptr<BenchBackend> createEngineBackend(const std::string &nvmPath, const std::string &ssdPath, bool isSync)
+{
+    std::unique_ptr<EngineBackend> pBackend(new EngineBackend(isSync));
+    int res = pBackend->mount(nvmPath, ssdPath);
+
+
+    if (0 != res)
+    {
+        fprintf(stderr, "nvmix-bench: cannot mount the engine on %s and %s: %s\n", nvmPath.c_str(), ssdPath.c_str(), strerror(-res));
+        return nullptr;
+    }
+
+
+    return std::unique_ptr<BenchBackend>(std::move(pBackend));
+}
@@ -0,0 +1,251 @@
+/**
+ * @file bench.cpp
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief nvmix-bench 的计时、线程和 JSON 输出工具。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "bench.h"
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+
+/**
+ * @brief 按最近秩法计算已排序样本的分位数。
+ * @param sorted 升序排列的样本。
+ * @param q 分位，例如 0.99。
+ */
+static uint64_t percentile(const std::vector<uint64_t> &sorted, double q)
+{
+    size_t rank = 0;
+
+
+    if (sorted.empty()) return 0;
+
+    rank = (size_t)(q * sorted.size() + 0.999999);
+    rank = std::max<size_t>(rank, 1);
+
+
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+
+BenchResult runThreads(unsigned threadNum, const std::function<void(unsigned, BenchResult &)> &body)
+{
+    std::vector<BenchResult> perThread(threadNum);
+    std::vector<std::thread> threads;
+    std::atomic<unsigned> readyNum(0);
+    std::atomic<bool> isGo(false);
+    std::chrono::steady_clock::time_point start;
+    BenchResult merged;
+
+
+    for (unsigned i = 0; i < threadNum; ++i)
+    {
+        threads.emplace_back([&, i]() {
+            ++readyNum;
+
+            // 所有线程创建完毕后同时开始，线程创建的开销不计入测试时间。
+            while (!isGo.load(std::memory_order_acquire)) std::this_thread::yield();
+
+            body(i, perThread[i]);
+        });
+    }
+
+    while (readyNum.load() < threadNum) std::this_thread::yield();
+
+    start = std::chrono::steady_clock::now();
+    isGo.store(true, std::memory_order_release);
+
+    for (auto &thread : threads) thread.join();
+
+    merged.m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (BenchResult &result : perThread)
+    {
+        merged.m_ops += result.m_ops;
+        merged.m_errors += result.m_errors;
+        merged.m_bytes += result.m_bytes;
+        merged.m_latencies.insert(merged.m_latencies.end(), result.m_latencies.begin(), result.m_latencies.end());
+    }
+
+
+    return merged;
+}
+
+long timeOp(BenchResult &result, const std::function<long()> &op, uint64_t bytes)
+{
+    uint64_t start = nowNs();
+    long res = op();
+
+
+    recordOp(result, nowNs() - start, res, bytes);
+
+
+    return res;
+}
+
+void recordOp(BenchResult &result, uint64_t latency, long res, uint64_t bytes)
+{
+    result.m_latencies.push_back(latency);
+
+    if (res < 0)
+    {
+        ++result.m_errors;
+    }
+    else
+    {
+        ++result.m_ops;
+        result.m_bytes += bytes;
+    }
+}
+
+uint64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string jsonString(const std::string &s)
+{
+    std::ostringstream out;
+
+
+    out << '"';
+    for (char c : s)
+    {
+        if (('"' == c) || ('\\' == c))
+        {
+            out << '\\' << c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+        }
+        else
+        {
+            out << c;
+        }
+    }
+    out << '"';
+
+
+    return out.str();
+}
+
+void printJson(FILE *pFile, const std::vector<std::pair<std::string, std::string>> &config, std::vector<BenchResult> &results)
+{
+    std::ostringstream out;
+
+
+    if (!pFile) pFile = stdout;
+
+    out << std::fixed << std::setprecision(6);
+    out << "{\n";
+
+    for (const auto &kv : config) out << "  " << jsonString(kv.first) << ": " << kv.second << ",\n";
+
+    out << "  \"results\": [";
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        BenchResult &result = results[i];
+        double seconds = std::max(result.m_seconds, 1e-9);
+
+
+        std::sort(result.m_latencies.begin(), result.m_latencies.end());
+
+        out << (0 == i ? "\n" : ",\n") << "    {\"phase\": " << jsonString(result.m_phase);
+
+        for (const auto &kv : result.m_labels) out << ", " << jsonString(kv.first) << ": " << jsonString(kv.second);
+
+        out << ", \"ops\": " << result.m_ops
+            << ", \"errors\": " << result.m_errors
+            << ", \"seconds\": " << result.m_seconds
+            << ", \"ops_per_sec\": " << result.m_ops / seconds;
+
+        if (0 != result.m_bytes) out << ", \"bytes\": " << result.m_bytes << ", \"mib_per_sec\": " << result.m_bytes / seconds / (1024 * 1024);
+
+        for (const auto &kv : result.m_counters) out << ", " << jsonString(kv.first) << ": " << kv.second;
+
+        out << ", \"latency_ns\": {"
+            << "\"p50\": " << percentile(result.m_latencies, 0.50)
+            << ", \"p99\": " << percentile(result.m_latencies, 0.99)
+            << ", \"p999\": " << percentile(result.m_latencies, 0.999)
+            << ", \"max\": " << (result.m_latencies.empty() ? 0 : result.m_latencies.back())
+            << "}}";
+    }
+
+    out << "\n  ]\n}\n";
+
+    fputs(out.str().c_str(), pFile);
+    fflush(pFile);
+}
+
+uint64_t parseSize(const std::string &s)
+{
+    char *pEnd = nullptr;
+    uint64_t value = strtoull(s.c_str(), &pEnd, 0);
+
+
+    switch (*pEnd)
+    {
+        case 'K':
+        case 'k':
+            value <<= 10;
+            ++pEnd;
+            break;
+        case 'M':
+        case 'm':
+            value <<= 20;
+            ++pEnd;
+            break;
+        case 'G':
+        case 'g':
+            value <<= 30;
+            ++pEnd;
+            break;
+        default:
+            break;
+    }
+
+
+    return '\0' == *pEnd ? value : 0;
+}
+
+std::vector<std::string> splitList(const std::string &s)
+{
+    std::vector<std::string> items;
+    std::istringstream in(s);
+    std::string item;
+
+
+    while (std::getline(in, item, ','))
+    {
+        if (!item.empty()) items.push_back(item);
+    }
+
+
+    return items;
+}
+
+uint64_t nextRandom(uint64_t *pState)
+{
+    uint64_t x = *pState;
+
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *pState = x;
+
+
+    return x;
+}
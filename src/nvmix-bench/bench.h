@@ -0,0 +1,204 @@
+/**
+ * @file bench.h
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief nvmix-bench 基准测试程序的公共头文件。
+ * @details nvmix-bench 用于在升级前后运行可复现的基准测试，结果以 JSON 格式输出，便于比较和存档。测试对象可以是已挂载的 nvmixfs（通过普通的系统调用访问），也可以是用户层引擎 nvmix-engine，二者通过 BenchBackend 统一。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#ifndef _NVMIX_BENCH_H_
+#define _NVMIX_BENCH_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <cstdio>
+
+
+/**
+ * @class BenchBackend
+ * @brief 元数据测试中元数据操作的统一接口。
+ * @details 目录通过句柄引用：已挂载的文件系统上是目录的文件描述符，用户层引擎上是 inode 号。所有操作成功返回非负值，失败返回负的 errno。
+ */
+class BenchBackend
+{
+public:
+    virtual ~BenchBackend() = default;
+
+    /**
+     * @brief 后端的名字，写入 JSON 结果。
+     */
+    virtual std::string name() const = 0;
+
+    /**
+     * @brief 返回测试工作目录的句柄。
+     */
+    virtual unsigned long root() const = 0;
+
+    virtual int mkdir(unsigned long dir, const std::string &name, unsigned long *pChild) = 0;
+
+    virtual int rmdir(unsigned long dir, const std::string &name) = 0;
+
+    virtual int create(unsigned long dir, const std::string &name) = 0;
+
+    virtual int stat(unsigned long dir, const std::string &name) = 0;
+
+    /**
+     * @brief 完整地列出一次目录。
+     * @return 成功返回目录项的数量。
+     */
+    virtual int readdir(unsigned long dir) = 0;
+
+    virtual int unlink(unsigned long dir, const std::string &name) = 0;
+
+    /**
+     * @brief 释放 mkdir() 返回的句柄。
+     */
+    virtual void release(unsigned long dir) = 0;
+};
+
+/**
+ * @brief 在已挂载的文件系统的目录 path 下创建工作目录，通过系统调用测试。
+ * @return 失败返回 nullptr，并打印原因。
+ */
+std::unique_ptr<BenchBackend> createPosixBackend(const std::string &path);
+
+/**
+ * @brief 格式化并挂载用户层引擎，在根目录下测试。
+ * @param nvmPath 模拟 NVM 的文件路径。
+ * @param ssdPath 模拟 SSD 的文件路径。
+ * @param isSync 见 NvmixEngine::mount()。
+ * @return 失败返回 nullptr，并打印原因。
+ */
+std::unique_ptr<BenchBackend> createEngineBackend(const std::string &nvmPath, const std::string &ssdPath, bool isSync);
+
+
+/**
+ * @struct BenchResult
+ * @brief 一个测试阶段的结果。
+ */
+struct BenchResult
+{
+    /**
+     * @brief 测试阶段的名字，例如 create。
+     */
+    std::string m_phase;
+
+    /**
+     * @brief 附加的标签，例如 {"variant", "single-dir"}，原样写入 JSON。
+     */
+    std::vector<std::pair<std::string, std::string>> m_labels;
+
+    /**
+     * @brief 成功的操作数。
+     */
+    uint64_t m_ops = 0;
+
+    /**
+     * @brief 失败的操作数。
+     */
+    uint64_t m_errors = 0;
+
+    /**
+     * @brief 处理的字节数，元数据测试为 0。
+     */
+    uint64_t m_bytes = 0;
+
+    /**
+     * @brief 从所有线程同时开始到全部结束的时间，单位是秒。
+     */
+    double m_seconds = 0;
+
+    /**
+     * @brief 每个操作的延迟，单位是纳秒。
+     */
+    std::vector<uint64_t> m_latencies;
+
+    /**
+     * @brief 附加的计数器，例如 {"dtlb_misses", 12345}，以数字写入 JSON。
+     */
+    std::vector<std::pair<std::string, double>> m_counters;
+};
+
+/**
+ * @brief 用 threadNum 个线程并发执行 body，统计一个测试阶段。
+ * @param threadNum 线程数量。
+ * @param body 每个线程执行的函数，参数是线程编号和该线程的结果，函数内用 timeOp() 记录每个操作。
+ * @return 合并后的结果，m_seconds 是所有线程同时开始到全部结束的时间。
+ */
+BenchResult runThreads(unsigned threadNum, const std::function<void(unsigned, BenchResult &)> &body);
+
+/**
+ * @brief 执行并计时一个操作，结果记入 result。
+ * @param result 当前线程的结果。
+ * @param op 操作，返回负值表示失败。
+ * @param bytes 成功时计入的字节数。
+ * @return op 的返回值。
+ */
+long timeOp(BenchResult &result, const std::function<long()> &op, uint64_t bytes = 0);
+
+/**
+ * @brief 记录一个已经完成的操作，用于无法用 timeOp() 包裹的异步操作。
+ * @param result 当前线程的结果。
+ * @param latency 从提交到完成的延迟，单位是纳秒。
+ * @param res 操作的返回值，负值表示失败。
+ * @param bytes 成功时计入的字节数。
+ */
+void recordOp(BenchResult &result, uint64_t latency, long res, uint64_t bytes = 0);
+
+/**
+ * @brief 返回单调时钟的当前时间，单位是纳秒。
+ */
+uint64_t nowNs();
+
+/**
+ * @brief 将一组结果以 JSON 输出。
+ * @param pFile 输出的文件，为 nullptr 时输出到标准输出。
+ * @param config 测试配置，作为顶层的键值对原样输出，值已经是 JSON 格式。
+ * @param results 各阶段的结果。
+ */
+void printJson(FILE *pFile, const std::vector<std::pair<std::string, std::string>> &config, std::vector<BenchResult> &results);
+
+/**
+ * @brief 将字符串转为 JSON 字符串字面量。
+ */
+std::string jsonString(const std::string &s);
+
+/**
+ * @brief 解析带 K、M、G 后缀的大小。
+ * @return 格式错误返回 0。
+ */
+uint64_t parseSize(const std::string &s);
+
+/**
+ * @brief 解析逗号分隔的列表。
+ */
+std::vector<std::string> splitList(const std::string &s);
+
+/**
+ * @brief xorshift64，随机访问的偏移量生成器，开销远小于被测操作。
+ * @param pState 生成器的状态，不能为 0。
+ */
+uint64_t nextRandom(uint64_t *pState);
+
+/**
+ * @brief 元数据基准测试的入口，nvmix-bench meta。
+ */
+int runMetaBench(int argc, char *argv[]);
+
+/**
+ * @brief 数据通路基准测试的入口，nvmix-bench data。
+ */
+int runDataBench(int argc, char *argv[]);
+
+/**
+ * @brief 元数据扫描的 TLB 测试的入口，nvmix-bench scan。
+ */
+int runScanBench(int argc, char *argv[]);
+
+
+#endif
@@ -0,0 +1,697 @@
+/**
+ * @file data.cpp
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief nvmix-bench data：数据通路的带宽和延迟测试，在同一台机器上比较 NVM 和 SSD 两个存储层。
+ * @details SSD 层通过 pread() 和 pwrite() 访问一个文件或者块设备，例如已挂载的 nvmixfs 上的文件或者 SSD 本身，支持页缓存（buffered）和 O_DIRECT（direct）两种方式，队列深度大于 1 时使用 Linux 原生 AIO 提交。NVM 层将 pmem 设备或者 DAX 文件映射到用户空间，读是直接的内存拷贝，写是内存拷贝加上逐个缓存行的 clflush 和最后的 sfence，与内核持久化 NVM 元数据的 clflush_cache_range() 相同。
+ * @details 每种组合依次测试顺序写、顺序读、随机写和随机读。顺序访问时每个线程负责文件中连续的一段，随机访问时所有线程在整个文件中按块对齐随机访问，总操作数与顺序访问相同。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "bench.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <linux/aio_abi.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+#ifndef MAP_SHARED_VALIDATE
+#define MAP_SHARED_VALIDATE 0x03
+#endif
+
+#ifndef MAP_SYNC
+#define MAP_SYNC 0x80000
+#endif
+
+
+/**
+ * @brief 缓存行大小，NVM 层按缓存行刷写。
+ */
+#define NVMIX_BENCH_CACHE_LINE 64
+
+/**
+ * @brief O_DIRECT 要求的缓冲区对齐。
+ */
+#define NVMIX_BENCH_DIRECT_ALIGN 4096
+
+
+/**
+ * @struct DataConfig
+ * @brief 数据通路测试的配置。
+ */
+struct DataConfig
+{
+    /**
+     * @brief SSD 层的测试文件或者块设备，为空时不测试。
+     */
+    std::string m_ssdPath;
+
+    /**
+     * @brief NVM 层映射的 pmem 设备或者文件，为空时不测试。
+     */
+    std::string m_nvmPath;
+
+    /**
+     * @brief 测试文件的大小，单位是字节。
+     */
+    uint64_t m_size = 64 << 20;
+
+    unsigned m_threadNum = 1;
+
+    std::vector<unsigned> m_blockSizes{4096, 65536};
+
+    std::vector<unsigned> m_queueDepths{1, 16};
+
+    /**
+     * @brief SSD 层测试的方式，buffered 和（或）direct。
+     */
+    std::vector<std::string> m_modes{"buffered", "direct"};
+
+    /**
+     * @brief 随机访问的种子，相同的种子产生相同的访问序列。
+     */
+    unsigned m_seed = 1;
+};
+
+/**
+ * @struct DataPhase
+ * @brief 一个测试阶段的参数。
+ */
+struct DataPhase
+{
+    bool m_isWrite;
+
+    bool m_isRandom;
+
+    unsigned m_blockSize;
+
+    unsigned m_queueDepth;
+};
+
+
+/**
+ * @brief 打印用法。
+ */
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: nvmix-bench data [options] [--ssd <path>] [--nvm <path>]\n"
+            "      --ssd <path>            file or block device accessed with pread/pwrite\n"
+            "      --nvm <path>            pmem device or file mapped and accessed with loads/stores\n"
+            "  -s, --size <bytes>          test file size, K/M/G suffixes allowed (default 64M)\n"
+            "  -t, --threads <n>           worker threads (default 1)\n"
+            "  -b, --block-sizes <list>    comma separated block sizes (default 4K,64K)\n"
+            "  -q, --queue-depths <list>   comma separated queue depths for --ssd (default 1,16)\n"
+            "  -m, --modes <list>          buffered and/or direct for --ssd (default buffered,direct)\n"
+            "      --seed <n>              random offset seed (default 1)\n"
+            "  -o, --output <file>         write JSON to file instead of stdout\n");
+}
+
+/**
+ * @brief 生成线程 thread 在一个阶段中访问的偏移量序列。
+ */
+static std::vector<uint64_t> phaseOffsets(const DataConfig &config, const DataPhase &phase, unsigned thread)
+{
+    const uint64_t blockNum = config.m_size / phase.m_blockSize;
+    const uint64_t perThread = blockNum / config.m_threadNum;
+    std::vector<uint64_t> offsets(perThread);
+    uint64_t state = ((uint64_t)config.m_seed << 32) ^ (thread + 1) * 0x9E3779B97F4A7C15ULL;
+
+
+    for (uint64_t i = 0; i < perThread; ++i)
+    {
+        offsets[i] = (phase.m_isRandom ? nextRandom(&state) % blockNum : thread * perThread + i) * phase.m_blockSize;
+    }
+
+
+    return offsets;
+}
+
+/**
+ * @brief 生成结果的标签。
+ */
+static std::vector<std::pair<std::string, std::string>> phaseLabels(const std::string &tier, const std::string &mode, const DataPhase &phase)
+{
+    return {
+        {"tier", tier},
+        {"mode", mode},
+        {"pattern", phase.m_isRandom ? "random" : "sequential"},
+        {"block_size", std::to_string(phase.m_blockSize)},
+        {"queue_depth", std::to_string(phase.m_queueDepth)},
+    };
+}
+
+/**
+ * @brief 按顺序遍历四种访问方式。
+ * @param body 参数是是否写和是否随机。
+ */
+static void forEachPattern(const std::function<void(bool, bool)> &body)
+{
+    body(true, false);
+    body(false, false);
+    body(true, true);
+    body(false, true);
+}
+
+
+/**
+ * @brief 用 Linux 原生 AIO 以 queueDepth 的深度执行一组读写，每个操作的延迟是从提交到完成的时间。
+ * @details 直接使用系统调用，不依赖 libaio。没有 O_DIRECT 时内核会同步完成提交，结果与同步读写相同，这与 fio 的 libaio 引擎一致。
+ * @return 成功返回 0，AIO 不可用返回负的 errno。
+ */
+static int runAio(int fd, const DataPhase &phase, const std::vector<uint64_t> &offsets, char *pBufs, BenchResult &result)
+{
+    const unsigned depth = phase.m_queueDepth;
+    aio_context_t ctx = 0;
+    std::vector<struct iocb> iocbs(depth);
+    std::vector<struct iocb *> pIocbs(depth);
+    std::vector<struct io_event> events(depth);
+    std::vector<uint64_t> submitTimes(depth);
+    std::vector<unsigned> freeSlots;
+    size_t next = 0;
+    unsigned inflight = 0;
+    long res = 0;
+
+
+    if (0 != syscall(SYS_io_setup, depth, &ctx)) return -errno;
+
+    for (unsigned i = depth; i-- > 0;) freeSlots.push_back(i);
+
+    while ((next < offsets.size()) || (inflight > 0))
+    {
+        unsigned submitNum = 0;
+
+
+        // 用空闲的槽位填满队列，一次提交。
+        while ((next < offsets.size()) && !freeSlots.empty())
+        {
+            unsigned slot = freeSlots.back();
+            struct iocb *pIocb = &iocbs[slot];
+
+
+            freeSlots.pop_back();
+
+            memset(pIocb, 0, sizeof(*pIocb));
+            pIocb->aio_data = slot;
+            pIocb->aio_lio_opcode = phase.m_isWrite ? IOCB_CMD_PWRITE : IOCB_CMD_PREAD;
+            pIocb->aio_fildes = fd;
+            pIocb->aio_buf = (uint64_t)(uintptr_t)(pBufs + (size_t)slot * phase.m_blockSize);
+            pIocb->aio_nbytes = phase.m_blockSize;
+            pIocb->aio_offset = offsets[next++];
+
+            pIocbs[submitNum++] = pIocb;
+            submitTimes[slot] = nowNs();
+        }
+
+        if (submitNum > 0)
+        {
+            res = syscall(SYS_io_submit, ctx, submitNum, pIocbs.data());
+            if (res < 0) res = -errno;
+
+            // 未能提交的请求记为失败并归还槽位。
+            for (long i = std::max(res, 0L); i < (long)submitNum; ++i)
+            {
+                recordOp(result, 0, res < 0 ? res : -EAGAIN);
+                freeSlots.push_back(pIocbs[i]->aio_data);
+            }
+
+            inflight += std::max(res, 0L);
+        }
+
+        if (0 == inflight) continue;
+
+        res = syscall(SYS_io_getevents, ctx, 1, depth, events.data(), nullptr);
+        if (res < 0)
+        {
+            if (EINTR == errno) continue;
+
+            res = -errno;
+            break;
+        }
+
+        for (long i = 0; i < res; ++i)
+        {
+            unsigned slot = events[i].data;
+            long ioRes = events[i].res;
+
+
+            recordOp(result, nowNs() - submitTimes[slot], (ioRes == (long)phase.m_blockSize) ? ioRes : (ioRes < 0 ? ioRes : -EIO), phase.m_blockSize);
+            freeSlots.push_back(slot);
+            --inflight;
+        }
+
+        res = 0;
+    }
+
+    syscall(SYS_io_destroy, ctx);
+
+
+    return res < 0 ? res : 0;
+}
+
+/**
+ * @brief 测试一个 SSD 层的阶段。
+ * @return 成功返回 0，以该方式无法打开文件返回负的 errno，调用者跳过该方式。
+ */
+static int runSsdPhase(const DataConfig &config, const std::string &mode, const DataPhase &phase, BenchResult *pResult)
+{
+    const bool isDirect = ("direct" == mode);
+    std::vector<int> fds(config.m_threadNum, -1);
+    int res = 0;
+
+
+    for (unsigned t = 0; t < config.m_threadNum; ++t)
+    {
+        fds[t] = open(config.m_ssdPath.c_str(), O_RDWR | (isDirect ? O_DIRECT : 0));
+        if (fds[t] < 0)
+        {
+            res = -errno;
+            goto OUT;
+        }
+    }
+
+    // 丢弃准备阶段和上一阶段留在页缓存中的数据，读测试从设备开始。
+    fdatasync(fds[0]);
+    posix_fadvise(fds[0], 0, 0, POSIX_FADV_DONTNEED);
+
+    *pResult = runThreads(config.m_threadNum, [&](unsigned t, BenchResult &r) {
+        const std::vector<uint64_t> offsets = phaseOffsets(config, phase, t);
+        const size_t bufSize = (size_t)phase.m_blockSize * phase.m_queueDepth;
+        char *pBufs = nullptr;
+        int aioRes = 0;
+
+
+        if (0 != posix_memalign((void **)&pBufs, NVMIX_BENCH_DIRECT_ALIGN, bufSize))
+        {
+            recordOp(r, 0, -ENOMEM);
+            return;
+        }
+        memset(pBufs, 0x5A, bufSize);
+
+        if (1 == phase.m_queueDepth)
+        {
+            for (uint64_t offset : offsets)
+            {
+                timeOp(
+                    r, [&]() -> long {
+                        ssize_t n = phase.m_isWrite ? pwrite(fds[t], pBufs, phase.m_blockSize, offset) : pread(fds[t], pBufs, phase.m_blockSize, offset);
+
+
+                        return n == (ssize_t)phase.m_blockSize ? n : (n < 0 ? -errno : -EIO);
+                    },
+                    phase.m_blockSize);
+            }
+        }
+        else
+        {
+            aioRes = runAio(fds[t], phase, offsets, pBufs, r);
+            if (0 != aioRes) recordOp(r, 0, aioRes);
+        }
+
+        // 写阶段的时间包含最后的 fdatasync()，带宽反映的是持久化的速度而不是写入页缓存的速度。
+        if (phase.m_isWrite && (0 != fdatasync(fds[t]))) recordOp(r, 0, -errno);
+
+        free(pBufs);
+    });
+
+OUT:
+    for (int fd : fds)
+    {
+        if (fd >= 0) close(fd);
+    }
+
+
+    return res;
+}
+
+/**
+ * @brief 准备 SSD 层的测试文件：不存在时创建，并完整写入一遍，避免读到空洞。
+ * @param pIsCreated 用于返回文件是否由本程序创建，结束时删除。
+ * @return 成功返回 0，失败返回负的 errno。
+ */
+static int prepareSsd(const DataConfig &config, bool *pIsCreated)
+{
+    const size_t chunk = 1 << 20;
+    struct stat st;
+    std::vector<char> buf(chunk, 0x5A);
+    int fd = -1;
+    int res = 0;
+
+
+    *pIsCreated = (0 != stat(config.m_ssdPath.c_str(), &st));
+
+    fd = open(config.m_ssdPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return -errno;
+
+    if (0 != fstat(fd, &st))
+    {
+        res = -errno;
+        goto ERR;
+    }
+
+    // 块设备的大小是固定的，只检查是否足够。
+    if (S_ISBLK(st.st_mode))
+    {
+        uint64_t deviceSize = lseek(fd, 0, SEEK_END);
+
+
+        if (deviceSize < config.m_size)
+        {
+            res = -ENOSPC;
+            goto ERR;
+        }
+    }
+
+    for (uint64_t offset = 0; offset < config.m_size; offset += chunk)
+    {
+        size_t size = std::min<uint64_t>(chunk, config.m_size - offset);
+
+
+        if (pwrite(fd, buf.data(), size, offset) != (ssize_t)size)
+        {
+            res = errno ? -errno : -EIO;
+            goto ERR;
+        }
+    }
+
+    if (0 != fsync(fd)) res = -errno;
+
+ERR:
+    close(fd);
+
+    if ((0 != res) && *pIsCreated) unlink(config.m_ssdPath.c_str());
+
+
+    return res;
+}
+
+/**
+ * @brief 测试 SSD 层的所有组合。
+ * @return 成功返回 0，失败返回负的 errno。
+ */
+static int runSsd(const DataConfig &config, std::vector<BenchResult> &results)
+{
+    bool isCreated = false;
+    int res = prepareSsd(config, &isCreated);
+
+
+    if (0 != res)
+    {
+        fprintf(stderr, "nvmix-bench: cannot prepare %s: %s\n", config.m_ssdPath.c_str(), strerror(-res));
+        return res;
+    }
+
+    for (const std::string &mode : config.m_modes)
+    {
+        bool isSupported = true;
+
+
+        for (unsigned blockSize : config.m_blockSizes)
+        {
+            for (unsigned queueDepth : config.m_queueDepths)
+            {
+                forEachPattern([&](bool isWrite, bool isRandom) {
+                    DataPhase phase{isWrite, isRandom, blockSize, queueDepth};
+                    BenchResult result;
+                    int phaseRes = 0;
+
+
+                    if (!isSupported) return;
+
+                    phaseRes = runSsdPhase(config, mode, phase, &result);
+                    if (0 != phaseRes)
+                    {
+                        // 例如 tmpfs 和目前的 nvmixfs 都不支持 O_DIRECT，跳过这种方式而不是计为失败。
+                        fprintf(stderr, "nvmix-bench: skipping %s mode on %s: %s\n", mode.c_str(), config.m_ssdPath.c_str(), strerror(-phaseRes));
+                        isSupported = false;
+                        return;
+                    }
+
+                    result.m_phase = isWrite ? "write" : "read";
+                    result.m_labels = phaseLabels("ssd", mode, phase);
+                    results.push_back(std::move(result));
+                });
+            }
+        }
+    }
+
+    if (isCreated) unlink(config.m_ssdPath.c_str());
+
+
+    return 0;
+}
+
+/**
+ * @brief 将 [pAddr, pAddr + size) 刷写到持久化域，与内核的 clflush_cache_range() 相同。
+ * @param isMapSync 映射是否带 MAP_SYNC。不带时映射的不是真正的 DAX，缓存行刷写无法保证持久化，只能用 msync()。
+ */
+static void persistRange(char *pAddr, size_t size, bool isMapSync)
+{
+    if (!isMapSync)
+    {
+        uintptr_t start = (uintptr_t)pAddr & ~((uintptr_t)sysconf(_SC_PAGESIZE) - 1);
+
+
+        msync((void *)start, (uintptr_t)pAddr + size - start, MS_SYNC);
+        return;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    for (uintptr_t line = (uintptr_t)pAddr & ~(uintptr_t)(NVMIX_BENCH_CACHE_LINE - 1); line < (uintptr_t)pAddr + size; line += NVMIX_BENCH_CACHE_LINE)
+    {
+        __builtin_ia32_clflush((void *)line);
+    }
+    __builtin_ia32_sfence();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * @brief 测试 NVM 层的所有组合。
+ * @details 优先以 MAP_SYNC 映射，成功时模式为 dax，写入只需要刷写缓存行；否则以普通的共享映射模拟，模式为 mmap，每次写入后 msync()，只用于在没有 pmem 的机器上试运行。队列深度对内存访问没有意义，固定为 1。
+ * @return 成功返回 0，失败返回负的 errno。
+ */
+static int runNvm(const DataConfig &config, std::vector<BenchResult> &results)
+{
+    struct stat st;
+    bool isCreated = false;
+    bool isMapSync = true;
+    char *pBase = nullptr;
+    int fd = -1;
+    int res = 0;
+
+
+    isCreated = (0 != stat(config.m_nvmPath.c_str(), &st));
+
+    fd = open(config.m_nvmPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        res = -errno;
+        goto ERR;
+    }
+
+    if ((0 == fstat(fd, &st)) && S_ISREG(st.st_mode) && ((uint64_t)st.st_size < config.m_size))
+    {
+        // 与 SSD 层相同，分配全部空间，避免首次访问时缺页分配的开销计入测试。
+        res = posix_fallocate(fd, 0, config.m_size);
+        if (0 != res)
+        {
+            res = -res;
+            goto ERR;
+        }
+    }
+
+    pBase = (char *)mmap(nullptr, config.m_size, PROT_READ | PROT_WRITE, MAP_SHARED_VALIDATE | MAP_SYNC, fd, 0);
+    if (MAP_FAILED == pBase)
+    {
+        isMapSync = false;
+        pBase = (char *)mmap(nullptr, config.m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (MAP_FAILED == pBase)
+    {
+        res = -errno;
+        pBase = nullptr;
+        goto ERR;
+    }
+
+    memset(pBase, 0x5A, config.m_size);
+    persistRange(pBase, config.m_size, isMapSync);
+
+    for (unsigned blockSize : config.m_blockSizes)
+    {
+        forEachPattern([&](bool isWrite, bool isRandom) {
+            DataPhase phase{isWrite, isRandom, blockSize, 1};
+            BenchResult result;
+
+
+            result = runThreads(config.m_threadNum, [&](unsigned t, BenchResult &r) {
+                const std::vector<uint64_t> offsets = phaseOffsets(config, phase, t);
+                std::vector<char> buf(blockSize, 0x5A);
+
+
+                for (uint64_t offset : offsets)
+                {
+                    timeOp(
+                        r, [&]() -> long {
+                            if (isWrite)
+                            {
+                                memcpy(pBase + offset, buf.data(), blockSize);
+                                persistRange(pBase + offset, blockSize, isMapSync);
+                            }
+                            else
+                            {
+                                memcpy(buf.data(), pBase + offset, blockSize);
+                            }
+
+
+                            return blockSize;
+                        },
+                        blockSize);
+                }
+            });
+
+            result.m_phase = isWrite ? "write" : "read";
+            result.m_labels = phaseLabels("nvm", isMapSync ? "dax" : "mmap", phase);
+            results.push_back(std::move(result));
+        });
+    }
+
+ERR:
+    if (pBase) munmap(pBase, config.m_size);
+
+    if (fd >= 0) close(fd);
+
+    if (isCreated) unlink(config.m_nvmPath.c_str());
+
+    if (0 != res) fprintf(stderr, "nvmix-bench: cannot map %s: %s\n", config.m_nvmPath.c_str(), strerror(-res));
+
+
+    return res;
+}
+
+
+int runDataBench(int argc, char *argv[])
+{
+    static const struct option options[] = {
+        {"ssd", required_argument, nullptr, 'S'},
+        {"nvm", required_argument, nullptr, 'N'},
+        {"size", required_argument, nullptr, 's'},
+        {"threads", required_argument, nullptr, 't'},
+        {"block-sizes", required_argument, nullptr, 'b'},
+        {"queue-depths", required_argument, nullptr, 'q'},
+        {"modes", required_argument, nullptr, 'm'},
+        {"seed", required_argument, nullptr, 'R'},
+        {"output", required_argument, nullptr, 'o'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+    DataConfig config;
+    std::string outputPath;
+    std::vector<BenchResult> results;
+    uint64_t errorNum = 0;
+    FILE *pOutput = nullptr;
+    bool isValid = true;
+    int opt = 0;
+
+
+    while (-1 != (opt = getopt_long(argc, argv, "s:t:b:q:m:o:h", options, nullptr)))
+    {
+        switch (opt)
+        {
+            case 'S':
+                config.m_ssdPath = optarg;
+                break;
+            case 'N':
+                config.m_nvmPath = optarg;
+                break;
+            case 's':
+                config.m_size = parseSize(optarg);
+                break;
+            case 't':
+                config.m_threadNum = strtoul(optarg, nullptr, 0);
+                break;
+            case 'b':
+                config.m_blockSizes.clear();
+                for (const std::string &item : splitList(optarg)) config.m_blockSizes.push_back(parseSize(item));
+                break;
+            case 'q':
+                config.m_queueDepths.clear();
+                for (const std::string &item : splitList(optarg)) config.m_queueDepths.push_back(strtoul(item.c_str(), nullptr, 0));
+                break;
+            case 'm':
+                config.m_modes = splitList(optarg);
+                break;
+            case 'R':
+                config.m_seed = strtoul(optarg, nullptr, 0);
+                break;
+            case 'o':
+                outputPath = optarg;
+                break;
+            default:
+                usage();
+                return 'h' == opt ? 0 : 2;
+        }
+    }
+
+    isValid = (optind == argc) && (!config.m_ssdPath.empty() || !config.m_nvmPath.empty()) && (0 != config.m_threadNum) && (0 != config.m_size);
+    isValid = isValid && !config.m_blockSizes.empty() && !config.m_queueDepths.empty() && !config.m_modes.empty();
+
+    for (unsigned blockSize : config.m_blockSizes)
+    {
+        // O_DIRECT 要求块大小按 NVMIX_BENCH_DIRECT_ALIGN 对齐，每个线程至少访问一个块。
+        isValid = isValid && (0 != blockSize) && (0 == blockSize % NVMIX_BENCH_DIRECT_ALIGN) && (config.m_size / blockSize >= config.m_threadNum);
+    }
+    for (unsigned queueDepth : config.m_queueDepths) isValid = isValid && (0 != queueDepth);
+    for (const std::string &mode : config.m_modes) isValid = isValid && (("buffered" == mode) || ("direct" == mode));
+
+    if (!isValid)
+    {
+        usage();
+        return 2;
+    }
+
+    if (!config.m_nvmPath.empty() && (0 != runNvm(config, results))) return 1;
+
+    if (!config.m_ssdPath.empty() && (0 != runSsd(config, results))) return 1;
+
+    for (const BenchResult &result : results) errorNum += result.m_errors;
+
+    if (!outputPath.empty())
+    {
+        pOutput = fopen(outputPath.c_str(), "w");
+        if (!pOutput)
+        {
+            fprintf(stderr, "nvmix-bench: cannot open %s: %s\n", outputPath.c_str(), strerror(errno));
+            return 1;
+        }
+    }
+
+    printJson(pOutput,
+              {
+                  {"benchmark", jsonString("data")},
+                  {"ssd", jsonString(config.m_ssdPath)},
+                  {"nvm", jsonString(config.m_nvmPath)},
+                  {"size", std::to_string(config.m_size)},
+                  {"threads", std::to_string(config.m_threadNum)},
+                  {"seed", std::to_string(config.m_seed)},
+              },
+              results);
+
+    if (pOutput) fclose(pOutput);
+
+    if (0 != errorNum) fprintf(stderr, "nvmix-bench: %llu operations failed\n", (unsigned long long)errorNum);
+
+
+    return 0 == errorNum ? 0 : 1;
+}
@@ -0,0 +1,35 @@
+/**
+ * @file main.cpp
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief nvmix-bench 的入口，按子命令分发。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "bench.h"
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: nvmix-bench <meta|data|scan> [options]\n");
+        return 2;
+    }
+
+    // 子命令之后的参数交给子命令解析，argv[0] 换成子命令的名字。
+    if (0 == strcmp(argv[1], "meta")) return runMetaBench(argc - 1, argv + 1);
+
+    if (0 == strcmp(argv[1], "data")) return runDataBench(argc - 1, argv + 1);
+
+    if (0 == strcmp(argv[1], "scan")) return runScanBench(argc - 1, argv + 1);
+
+    fprintf(stderr, "nvmix-bench: unknown benchmark %s\n", argv[1]);
+
+
+    return 2;
+}
@@ -0,0 +1,359 @@
+/**
+ * @file meta.cpp
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief nvmix-bench meta：mdtest 风格的元数据基准测试。
+ * @details 每轮依次测试两种目录布局：single-dir 中所有线程在同一个目录下操作，测试目录锁的竞争；many-dir 中每个线程使用自己的目录，测试可扩展性。每种布局依次执行 create、stat、readdir 和 unlink 阶段，最后用 mkdir 和 rmdir 建立和删除目录树。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "bench.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <getopt.h>
+
+
+/**
+ * @struct MetaConfig
+ * @brief 元数据测试的配置。
+ */
+struct MetaConfig
+{
+    unsigned m_threadNum = 1;
+
+    /**
+     * @brief 每个线程创建的文件数量。
+     */
+    unsigned m_itemNum = 8;
+
+    unsigned m_iterationNum = 1;
+
+    /**
+     * @brief 目录树每层的分支数。
+     */
+    unsigned m_fanout = 2;
+
+    /**
+     * @brief 目录树的层数，不含每个线程的树根。
+     */
+    unsigned m_depth = 2;
+};
+
+
+/**
+ * @brief 打印用法。
+ */
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: nvmix-bench meta [options] (--dir <path> | --engine <nvm> <ssd>)\n"
+            "  -t, --threads <n>     worker threads (default 1)\n"
+            "  -n, --items <n>       files per thread (default 8)\n"
+            "  -i, --iterations <n>  repeat the suite n times (default 1)\n"
+            "  -f, --fanout <n>      directories per tree level (default 2)\n"
+            "  -d, --depth <n>       tree levels below each thread's root (default 2)\n"
+            "      --dir <path>      benchmark a mounted file system under path\n"
+            "      --engine <nvm> <ssd>  format and benchmark the userspace engine\n"
+            "      --sync            engine only: persist after every change\n"
+            "  -o, --output <file>   write JSON to file instead of stdout\n");
+}
+
+/**
+ * @brief 文件名，线程编号和序号保证在同一个目录中唯一。
+ */
+static std::string fileName(unsigned thread, unsigned i)
+{
+    return "f" + std::to_string(thread) + "." + std::to_string(i);
+}
+
+/**
+ * @brief 测试一种目录布局的 create、stat、readdir 和 unlink 阶段。
+ * @param pBackend 后端。
+ * @param config 配置。
+ * @param dirs 每个线程使用的目录句柄。
+ * @param labels 写入每个结果的标签。
+ * @param results 用于追加结果。
+ */
+static void runFilePhases(BenchBackend *pBackend, const MetaConfig &config, const std::vector<unsigned long> &dirs,
+                          const std::vector<std::pair<std::string, std::string>> &labels, std::vector<BenchResult> &results)
+{
+    const unsigned itemNum = config.m_itemNum;
+    BenchResult result;
+
+
+    result = runThreads(config.m_threadNum, [&](unsigned t, BenchResult &r) {
+        for (unsigned i = 0; i < itemNum; ++i) timeOp(r, [&]() { return pBackend->create(dirs[t], fileName(t, i)); });
+    });
+    result.m_phase = "create";
+    result.m_labels = labels;
+    results.push_back(std::move(result));
+
+    result = runThreads(config.m_threadNum, [&](unsigned t, BenchResult &r) {
+        for (unsigned i = 0; i < itemNum; ++i) timeOp(r, [&]() { return pBackend->stat(dirs[t], fileName(t, i)); });
+    });
+    result.m_phase = "stat";
+    result.m_labels = labels;
+    results.push_back(std::move(result));
+
+    // 每个线程完整列出自己的目录 itemNum 次，single-dir 下所有线程列出同一个目录。
+    result = runThreads(config.m_threadNum, [&](unsigned t, BenchResult &r) {
+        for (unsigned i = 0; i < itemNum; ++i) timeOp(r, [&]() { return pBackend->readdir(dirs[t]); });
+    });
+    result.m_phase = "readdir";
+    result.m_labels = labels;
+    results.push_back(std::move(result));
+
+    result = runThreads(config.m_threadNum, [&](unsigned t, BenchResult &r) {
+        for (unsigned i = 0; i < itemNum; ++i) timeOp(r, [&]() { return pBackend->unlink(dirs[t], fileName(t, i)); });
+    });
+    result.m_phase = "unlink";
+    result.m_labels = labels;
+    results.push_back(std::move(result));
+}
+
+/**
+ * @brief 测试目录树的 mkdir 和 rmdir 阶段，每个线程在根目录下建立自己的树。
+ * @details 按层建立，每个目录有 fanout 个子目录，共 depth 层；删除时按建立的逆序进行，保证先删除子目录。
+ */
+static void runTreePhases(BenchBackend *pBackend, const MetaConfig &config, const std::vector<std::pair<std::string, std::string>> &labels,
+                          std::vector<BenchResult> &results)
+{
+    // 每个线程按建立的顺序记录 (父目录句柄, 名字, 自身句柄)。
+    struct TreeNode
+    {
+        unsigned long m_parent;
+        std::string m_name;
+        unsigned long m_self;
+    };
+    std::vector<std::vector<TreeNode>> trees(config.m_threadNum);
+    BenchResult result;
+
+
+    result = runThreads(config.m_threadNum, [&](unsigned t, BenchResult &r) {
+        std::vector<TreeNode> &nodes = trees[t];
+        size_t levelBegin = 0;
+        size_t levelEnd = 0;
+        TreeNode node{pBackend->root(), "t" + std::to_string(t), 0};
+
+
+        if (timeOp(r, [&]() { return pBackend->mkdir(node.m_parent, node.m_name, &node.m_self); }) < 0) return;
+        nodes.push_back(node);
+
+        for (unsigned level = 0; level < config.m_depth; ++level)
+        {
+            levelEnd = nodes.size();
+
+            for (size_t p = levelBegin; p < levelEnd; ++p)
+            {
+                for (unsigned c = 0; c < config.m_fanout; ++c)
+                {
+                    TreeNode child{nodes[p].m_self, "d" + std::to_string(c), 0};
+
+
+                    if (timeOp(r, [&]() { return pBackend->mkdir(child.m_parent, child.m_name, &child.m_self); }) >= 0) nodes.push_back(child);
+                }
+            }
+
+            levelBegin = levelEnd;
+        }
+    });
+    result.m_phase = "mkdir";
+    result.m_labels = labels;
+    results.push_back(std::move(result));
+
+    result = runThreads(config.m_threadNum, [&](unsigned t, BenchResult &r) {
+        std::vector<TreeNode> &nodes = trees[t];
+
+
+        for (size_t i = nodes.size(); i-- > 0;)
+        {
+            pBackend->release(nodes[i].m_self);
+            timeOp(r, [&]() { return pBackend->rmdir(nodes[i].m_parent, nodes[i].m_name); });
+        }
+    });
+    result.m_phase = "rmdir";
+    result.m_labels = labels;
+    results.push_back(std::move(result));
+}
+
+/**
+ * @brief 执行一轮完整的测试。
+ * @return 布局的准备和清理成功返回 0，失败返回负的 errno。
+ */
+static int runIteration(BenchBackend *pBackend, const MetaConfig &config, unsigned iteration, std::vector<BenchResult> &results)
+{
+    const std::string iterationLabel = std::to_string(iteration);
+    std::vector<unsigned long> dirs;
+    unsigned long dir = 0;
+    int res = 0;
+
+
+    // single-dir：所有线程共享目录 s，目录的建立和删除不计入结果。
+    res = pBackend->mkdir(pBackend->root(), "s", &dir);
+    if (0 != res) goto ERR;
+
+    dirs.assign(config.m_threadNum, dir);
+    runFilePhases(pBackend, config, dirs, {{"variant", "single-dir"}, {"iteration", iterationLabel}}, results);
+
+    pBackend->release(dir);
+    res = pBackend->rmdir(pBackend->root(), "s");
+    if (0 != res) goto ERR;
+
+    // many-dir：每个线程使用自己的目录 m<t>。
+    dirs.clear();
+    for (unsigned t = 0; t < config.m_threadNum; ++t)
+    {
+        res = pBackend->mkdir(pBackend->root(), "m" + std::to_string(t), &dir);
+        if (0 != res) goto ERR;
+
+        dirs.push_back(dir);
+    }
+
+    runFilePhases(pBackend, config, dirs, {{"variant", "many-dir"}, {"iteration", iterationLabel}}, results);
+
+    for (unsigned t = 0; t < config.m_threadNum; ++t)
+    {
+        pBackend->release(dirs[t]);
+
+        res = pBackend->rmdir(pBackend->root(), "m" + std::to_string(t));
+        if (0 != res) goto ERR;
+    }
+    dirs.clear();
+
+    runTreePhases(pBackend, config, {{"variant", "tree"}, {"iteration", iterationLabel}}, results);
+
+
+    return 0;
+
+ERR:
+    for (unsigned long d : dirs) pBackend->release(d);
+
+    fprintf(stderr, "nvmix-bench: failed to prepare the benchmark directories: %s\n", strerror(-res));
+
+
+    return res;
+}
+
+
+int runMetaBench(int argc, char *argv[])
+{
+    static const struct option options[] = {
+        {"threads", required_argument, nullptr, 't'},
+        {"items", required_argument, nullptr, 'n'},
+        {"iterations", required_argument, nullptr, 'i'},
+        {"fanout", required_argument, nullptr, 'f'},
+        {"depth", required_argument, nullptr, 'd'},
+        {"dir", required_argument, nullptr, 'D'},
+        {"engine", required_argument, nullptr, 'E'},
+        {"sync", no_argument, nullptr, 'S'},
+        {"output", required_argument, nullptr, 'o'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+    MetaConfig config;
+    std::string dirPath;
+    std::string nvmPath;
+    std::string ssdPath;
+    std::string outputPath;
+    bool isSync = false;
+    std::unique_ptr<BenchBackend> pBackend;
+    std::vector<BenchResult> results;
+    uint64_t errorNum = 0;
+    FILE *pOutput = nullptr;
+    int opt = 0;
+
+
+    while (-1 != (opt = getopt_long(argc, argv, "t:n:i:f:d:o:h", options, nullptr)))
+    {
+        switch (opt)
+        {
+            case 't':
+                config.m_threadNum = strtoul(optarg, nullptr, 0);
+                break;
+            case 'n':
+                config.m_itemNum = strtoul(optarg, nullptr, 0);
+                break;
+            case 'i':
+                config.m_iterationNum = strtoul(optarg, nullptr, 0);
+                break;
+            case 'f':
+                config.m_fanout = strtoul(optarg, nullptr, 0);
+                break;
+            case 'd':
+                config.m_depth = strtoul(optarg, nullptr, 0);
+                break;
+            case 'D':
+                dirPath = optarg;
+                break;
+            case 'E':
+                // --engine 带两个参数，第二个是下一个非选项参数。
+                if (optind >= argc)
+                {
+                    usage();
+                    return 2;
+                }
+                nvmPath = optarg;
+                ssdPath = argv[optind++];
+                break;
+            case 'S':
+                isSync = true;
+                break;
+            case 'o':
+                outputPath = optarg;
+                break;
+            default:
+                usage();
+                return 'h' == opt ? 0 : 2;
+        }
+    }
+
+    if ((dirPath.empty() == nvmPath.empty()) || (0 == config.m_threadNum) || (0 == config.m_iterationNum) || (optind != argc))
+    {
+        usage();
+        return 2;
+    }
+
+    pBackend = dirPath.empty() ? createEngineBackend(nvmPath, ssdPath, isSync) : createPosixBackend(dirPath);
+    if (!pBackend) return 1;
+
+    for (unsigned iteration = 0; iteration < config.m_iterationNum; ++iteration)
+    {
+        if (0 != runIteration(pBackend.get(), config, iteration, results)) return 1;
+    }
+
+    for (const BenchResult &result : results) errorNum += result.m_errors;
+
+    if (!outputPath.empty())
+    {
+        pOutput = fopen(outputPath.c_str(), "w");
+        if (!pOutput)
+        {
+            fprintf(stderr, "nvmix-bench: cannot open %s: %s\n", outputPath.c_str(), strerror(errno));
+            return 1;
+        }
+    }
+
+    printJson(pOutput,
+              {
+                  {"benchmark", jsonString("meta")},
+                  {"backend", jsonString(pBackend->name())},
+                  {"threads", std::to_string(config.m_threadNum)},
+                  {"items", std::to_string(config.m_itemNum)},
+                  {"iterations", std::to_string(config.m_iterationNum)},
+                  {"fanout", std::to_string(config.m_fanout)},
+                  {"depth", std::to_string(config.m_depth)},
+              },
+              results);
+
+    if (pOutput) fclose(pOutput);
+
+    // 失败的操作通常是容量不足，例如 nvmixfs 只有 32 个 inode，结果仍然输出，但以非零状态退出。
+    if (0 != errorNum) fprintf(stderr, "nvmix-bench: %llu operations failed\n", (unsigned long long)errorNum);
+
+
+    return 0 == errorNum ? 0 : 1;
+}
@@ -0,0 +1,367 @@
+/**
+ * @file scan.cpp
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief nvmix-bench scan：元数据扫描的 TLB 测试，比较不同页大小下 inode 表访问的 dTLB 缺失。
+ * @details 在一段内存中铺满 NvmixInode，按顺序或者随机读取每个 inode 的 m_mode，模拟大容量 NVM 上的 inode 扫描。内存可以是 4 KiB 的普通页（4k）、透明大页（thp）、hugetlbfs 的 2 MiB 和 1 GiB 大页（2m、1g），或者 --file 指定的文件（例如 DAX 文件系统上的文件）。dTLB 缺失数通过 perf_event_open() 读取硬件计数器，不可用时不输出。内核模块对 NVM 空间的映射见 nvmixNvmMap()，本测试给出的是同样访问模式下页大小带来的差异。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include "bench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "defs.h"
+
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+
+/**
+ * @brief 每批访问的次数，延迟按批计时后取平均，避免计时本身的开销超过一次内存访问。
+ */
+#define NVMIX_SCAN_BATCH 4096
+
+
+/**
+ * @struct ScanConfig
+ * @brief 扫描测试的配置。
+ */
+struct ScanConfig
+{
+    /**
+     * @brief inode 表的大小，单位是字节。
+     */
+    uint64_t m_size = 1ULL << 30;
+
+    /**
+     * @brief 每个线程访问 inode 的次数。
+     */
+    uint64_t m_accessNum = 1 << 24;
+
+    unsigned m_threadNum = 1;
+
+    std::vector<std::string> m_pages{"4k", "thp", "2m"};
+
+    std::vector<std::string> m_patterns{"sequential", "random"};
+
+    /**
+     * @brief 映射的文件，不为空时只测试该文件。
+     */
+    std::string m_filePath;
+
+    unsigned m_seed = 1;
+};
+
+
+/**
+ * @brief 打印用法。
+ */
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: nvmix-bench scan [options]\n"
+            "  -s, --size <bytes>        inode table size, K/M/G suffixes allowed (default 1G)\n"
+            "  -n, --accesses <n>        inode reads per thread (default 16M)\n"
+            "  -t, --threads <n>         worker threads (default 1)\n"
+            "  -p, --pages <list>        4k, thp, 2m and/or 1g (default 4k,thp,2m)\n"
+            "      --patterns <list>     sequential and/or random (default both)\n"
+            "      --file <path>         map this file instead, e.g. a file on a DAX file system\n"
+            "      --seed <n>            random index seed (default 1)\n"
+            "  -o, --output <file>       write JSON to file instead of stdout\n");
+}
+
+/**
+ * @brief 按页的类型映射一段内存。
+ * @return 成功返回起始地址，失败返回 nullptr 并设置 errno。
+ */
+static char *mapTable(const ScanConfig &config, const std::string &pages)
+{
+    const uint64_t hugeSize = 2 << 20;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void *pAddr = MAP_FAILED;
+    int fd = -1;
+
+
+    if (!config.m_filePath.empty())
+    {
+        fd = open(config.m_filePath.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) return nullptr;
+
+        if ((0 != ftruncate(fd, config.m_size)) || MAP_FAILED == (pAddr = mmap(nullptr, config.m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)))
+        {
+            int err = errno;
+
+
+            close(fd);
+            errno = err;
+            return nullptr;
+        }
+
+        close(fd);
+
+
+        return (char *)pAddr;
+    }
+
+    if ("2m" == pages) flags |= MAP_HUGETLB | (21 << MAP_HUGE_SHIFT);
+    if ("1g" == pages) flags |= MAP_HUGETLB | (30 << MAP_HUGE_SHIFT);
+
+    if ("thp" == pages)
+    {
+        // 透明大页要求虚拟地址按 2 MiB 对齐，多映射一个大页再截掉两端。
+        char *pRaw = (char *)mmap(nullptr, config.m_size + hugeSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+        char *pAligned = nullptr;
+
+
+        if (MAP_FAILED == pRaw) return nullptr;
+
+        pAligned = (char *)(((uintptr_t)pRaw + hugeSize - 1) & ~(uintptr_t)(hugeSize - 1));
+        if (pAligned > pRaw) munmap(pRaw, pAligned - pRaw);
+        munmap(pAligned + config.m_size, pRaw + hugeSize - pAligned);
+
+        madvise(pAligned, config.m_size, MADV_HUGEPAGE);
+
+
+        return pAligned;
+    }
+
+    pAddr = mmap(nullptr, config.m_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (MAP_FAILED == pAddr) return nullptr;
+
+    if ("4k" == pages) madvise(pAddr, config.m_size, MADV_NOHUGEPAGE);
+
+
+    return (char *)pAddr;
+}
+
+/**
+ * @brief 打开当前线程的 dTLB 读缺失计数器。
+ * @return 成功返回文件描述符，不可用返回 -1。
+ */
+static int openTlbCounter()
+{
+    struct perf_event_attr attr;
+
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * @brief 测试一种页类型和访问方式。
+ * @param pIsCounted 用于返回 dTLB 计数器是否可用。
+ */
+static BenchResult runScan(const ScanConfig &config, const char *pTable, const std::string &pattern, bool *pIsCounted)
+{
+    const uint64_t inodeNum = config.m_size / sizeof(NvmixInode);
+    std::atomic<uint64_t> misses(0);
+    std::atomic<bool> isCounted(true);
+    BenchResult result;
+
+
+    result = runThreads(config.m_threadNum, [&](unsigned t, BenchResult &r) {
+        const NvmixInode *pInodes = (const NvmixInode *)pTable;
+        uint64_t state = ((uint64_t)config.m_seed << 32) ^ (t + 1) * 0x9E3779B97F4A7C15ULL;
+        uint64_t index = (inodeNum / config.m_threadNum) * t;
+        uint64_t count = 0;
+        unsigned sum = 0;
+        int fd = openTlbCounter();
+
+
+        if (fd < 0) isCounted = false;
+        if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+
+        for (uint64_t done = 0; done < config.m_accessNum; done += NVMIX_SCAN_BATCH)
+        {
+            const uint64_t batch = std::min<uint64_t>(NVMIX_SCAN_BATCH, config.m_accessNum - done);
+            uint64_t start = nowNs();
+
+
+            for (uint64_t i = 0; i < batch; ++i)
+            {
+                index = ("random" == pattern) ? nextRandom(&state) % inodeNum : (index + 1) % inodeNum;
+                sum += pInodes[index].m_mode;
+            }
+
+            // 记录这一批中每次访问的平均延迟，recordOp() 只计一次操作，其余的直接计入 m_ops。
+            recordOp(r, (nowNs() - start) / batch, 0);
+            r.m_ops += batch - 1;
+        }
+
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (sizeof(count) == read(fd, &count, sizeof(count))) misses += count;
+            close(fd);
+        }
+
+        // 防止编译器优化掉读取。
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (0xFFFFFFFF == sum) fprintf(stderr, "\n");
+    });
+
+    *pIsCounted = isCounted;
+    if (isCounted)
+    {
+        result.m_counters.emplace_back("dtlb_misses", misses.load());
+        result.m_counters.emplace_back("dtlb_misses_per_kaccess", misses.load() * 1000.0 / std::max<uint64_t>(result.m_ops, 1));
+    }
+
+
+    return result;
+}
+
+
+int runScanBench(int argc, char *argv[])
+{
+    static const struct option options[] = {
+        {"size", required_argument, nullptr, 's'},
+        {"accesses", required_argument, nullptr, 'n'},
+        {"threads", required_argument, nullptr, 't'},
+        {"pages", required_argument, nullptr, 'p'},
+        {"patterns", required_argument, nullptr, 'P'},
+        {"file", required_argument, nullptr, 'F'},
+        {"seed", required_argument, nullptr, 'R'},
+        {"output", required_argument, nullptr, 'o'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+    ScanConfig config;
+    std::string outputPath;
+    std::vector<BenchResult> results;
+    bool isCounted = true;
+    bool isValid = true;
+    FILE *pOutput = nullptr;
+    int opt = 0;
+
+
+    while (-1 != (opt = getopt_long(argc, argv, "s:n:t:p:o:h", options, nullptr)))
+    {
+        switch (opt)
+        {
+            case 's':
+                config.m_size = parseSize(optarg);
+                break;
+            case 'n':
+                config.m_accessNum = parseSize(optarg);
+                break;
+            case 't':
+                config.m_threadNum = strtoul(optarg, nullptr, 0);
+                break;
+            case 'p':
+                config.m_pages = splitList(optarg);
+                break;
+            case 'P':
+                config.m_patterns = splitList(optarg);
+                break;
+            case 'F':
+                config.m_filePath = optarg;
+                break;
+            case 'R':
+                config.m_seed = strtoul(optarg, nullptr, 0);
+                break;
+            case 'o':
+                outputPath = optarg;
+                break;
+            default:
+                usage();
+                return 'h' == opt ? 0 : 2;
+        }
+    }
+
+    isValid = (optind == argc) && (config.m_size >= sizeof(NvmixInode)) && (0 != config.m_accessNum) && (0 != config.m_threadNum);
+    for (const std::string &pages : config.m_pages) isValid = isValid && (("4k" == pages) || ("thp" == pages) || ("2m" == pages) || ("1g" == pages));
+    for (const std::string &pattern : config.m_patterns) isValid = isValid && (("sequential" == pattern) || ("random" == pattern));
+
+    if (!isValid)
+    {
+        usage();
+        return 2;
+    }
+
+    // 映射文件时页大小由文件系统决定，只测试一次。
+    if (!config.m_filePath.empty()) config.m_pages.assign(1, "file");
+
+    for (const std::string &pages : config.m_pages)
+    {
+        char *pTable = mapTable(config, pages);
+
+
+        if (!pTable)
+        {
+            // 例如没有预留 hugetlbfs 大页，跳过而不是失败。
+            fprintf(stderr, "nvmix-bench: skipping %s pages: %s\n", pages.c_str(), strerror(errno));
+            continue;
+        }
+
+        // 预先触碰所有页，缺页不计入测试。
+        for (uint64_t i = 0; i < config.m_size / sizeof(NvmixInode); ++i) ((NvmixInode *)pTable)[i].m_mode = S_IFREG | 0644;
+
+        for (const std::string &pattern : config.m_patterns)
+        {
+            BenchResult result = runScan(config, pTable, pattern, &isCounted);
+
+
+            result.m_phase = "scan";
+            result.m_labels = {{"pages", pages}, {"pattern", pattern}};
+            results.push_back(std::move(result));
+        }
+
+        munmap(pTable, config.m_size);
+    }
+
+    if (!config.m_filePath.empty()) unlink(config.m_filePath.c_str());
+
+    if (!isCounted) fprintf(stderr, "nvmix-bench: dTLB counters are unavailable (perf_event_paranoid or no PMU), only timings are reported\n");
+
+    if (!outputPath.empty())
+    {
+        pOutput = fopen(outputPath.c_str(), "w");
+        if (!pOutput)
+        {
+            fprintf(stderr, "nvmix-bench: cannot open %s: %s\n", outputPath.c_str(), strerror(errno));
+            return 1;
+        }
+    }
+
+    printJson(pOutput,
+              {
+                  {"benchmark", jsonString("scan")},
+                  {"size", std::to_string(config.m_size)},
+                  {"accesses", std::to_string(config.m_accessNum)},
+                  {"threads", std::to_string(config.m_threadNum)},
+                  {"inode_size", std::to_string(sizeof(NvmixInode))},
+                  {"seed", std::to_string(config.m_seed)},
+              },
+              results);
+
+    if (pOutput) fclose(pOutput);
+
+
+    return results.empty() ? 1 : 0;
+}
@@ -0,0 +1,518 @@
+/**
+ * @file main.cpp
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 崩溃一致性测试程序 nvmix-crash。
+ * @details 在用户层引擎上运行一组工作负载，用 NvmixCrashRecorder 记录每一个持久化点，枚举掉电可能留下的所有介质状态。每个状态写入一对镜像文件，依次用 fsck.nvmixfs -n 检查、fsck.nvmixfs -y 修复、再次 fsck.nvmixfs -n 确认修复收敛，最后用引擎挂载并遍历整棵目录树。修复后仍不一致或者无法挂载的状态视为失败；--strict 时未经修复就不一致的状态也视为失败。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "defs.h"
+#include "engine.h"
+#include "crash.h"
+
+
+/**
+ * @brief 与 fsck.nvmixfs 相同的退出码。
+ */
+#define NVMIX_FSCK_EXIT_OK 0
+
+
+/**
+ * @struct CrashWorkload
+ * @brief 一个工作负载：准备阶段不记录，运行阶段记录每一个持久化点。
+ */
+struct CrashWorkload
+{
+    const char *m_pName;
+
+    std::function<int(NvmixEngine &)> m_setup;
+
+    std::function<int(NvmixEngine &)> m_run;
+};
+
+/**
+ * @struct CrashConfig
+ * @brief 测试的配置。
+ */
+struct CrashConfig
+{
+    std::string m_fsckPath;
+
+    /**
+     * @brief 保存失败状态镜像的目录，为空时不保存。
+     */
+    std::string m_keepDir;
+
+    unsigned m_maxExhaustive = 8;
+
+    bool m_isTorn = true;
+
+    bool m_isStrict = false;
+
+    bool m_isVerbose = false;
+
+    unsigned m_threadNum = 1;
+};
+
+/**
+ * @struct CrashSummary
+ * @brief 一个工作负载的结果。
+ */
+struct CrashSummary
+{
+    std::atomic<unsigned> m_cleanNum{0};
+
+    std::atomic<unsigned> m_repairedNum{0};
+
+    std::atomic<unsigned> m_failedNum{0};
+};
+
+
+/**
+ * @brief 返回所有工作负载。
+ */
+static std::vector<CrashWorkload> workloads()
+{
+    const unsigned long root = NVMIX_ROOT_DIR_INODE_NUMBER;
+    auto none = [](NvmixEngine &) { return 0; };
+
+
+    return {
+        {"create", none, [=](NvmixEngine &engine) { return engine.create(root, "a", 0644); }},
+        {"mkdir", none,
+         [=](NvmixEngine &engine) {
+             unsigned long ino = 0;
+             int res = engine.mkdir(root, "d", 0755, &ino);
+
+
+             return (0 != res) ? res : engine.create(ino, "f", 0644);
+         }},
+        {"unlink", [=](NvmixEngine &engine) { return engine.create(root, "a", 0644); }, [=](NvmixEngine &engine) { return engine.unlink(root, "a"); }},
+        {"rmdir", [=](NvmixEngine &engine) { return engine.mkdir(root, "d", 0755); }, [=](NvmixEngine &engine) { return engine.rmdir(root, "d"); }},
+        {"write", [=](NvmixEngine &engine) { return engine.create(root, "a", 0644); },
+         [=](NvmixEngine &engine) {
+             unsigned long ino = 0;
+             int res = engine.lookup(root, "a", &ino);
+
+
+             return (0 != res) ? res : (int)std::min(0L, engine.write(ino, 0, "nvmixfs", 7));
+         }},
+        // 第 0 组只有 NVMIX_INODE_GROUP_SIZE 个 inode，填满以后的下一次创建触发第 1 组的延迟初始化。
+        {"lazyinit",
+         [=](NvmixEngine &engine) {
+             int res = 0;
+
+
+             for (unsigned i = 1; (0 == res) && (i < NVMIX_INODE_GROUP_SIZE); ++i) res = engine.create(root, "f" + std::to_string(i), 0644);
+
+
+             return res;
+         },
+         [=](NvmixEngine &engine) { return engine.create(root, "g", 0644); }},
+    };
+}
+
+/**
+ * @brief 打印用法。
+ */
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: nvmix-crash [options] [workload...]\n"
+            "  -f, --fsck <path>          fsck.nvmixfs to run (default: next to nvmix-crash)\n"
+            "  -k, --keep <dir>           save the images of failed crash states in dir\n"
+            "  -e, --max-exhaustive <n>   try every subset of at most n dirty cache lines (default 8)\n"
+            "      --no-torn              do not tear SSD block writes at sector boundaries\n"
+            "  -s, --strict               also fail on states that are inconsistent before repair\n"
+            "  -j, --threads <n>          check states in parallel (default 1)\n"
+            "  -v, --verbose              report every state and show fsck output\n"
+            "Workloads:");
+
+    for (const CrashWorkload &workload : workloads()) fprintf(stderr, " %s", workload.m_pName);
+
+    fprintf(stderr, " (default: all)\n");
+}
+
+/**
+ * @brief 将内容写入文件。
+ * @return 成功返回 0，失败返回负的 errno。
+ */
+static int writeFile(const std::string &path, const std::string &content)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int res = 0;
+
+
+    if (-1 == fd) return -errno;
+
+    if ((ssize_t)content.size() != write(fd, content.data(), content.size())) res = -EIO;
+
+    close(fd);
+
+
+    return res;
+}
+
+/**
+ * @brief 运行 fsck.nvmixfs。
+ * @return fsck.nvmixfs 的退出码，无法运行时返回 -1。
+ */
+static int runFsck(const CrashConfig &config, const char *pMode, const std::string &nvmPath, const std::string &ssdPath)
+{
+    pid_t pid = fork();
+    int status = 0;
+
+
+    if (-1 == pid) return -1;
+
+    if (0 == pid)
+    {
+        if (!config.m_isVerbose)
+        {
+            int fd = open("/dev/null", O_WRONLY);
+
+
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+        }
+
+        execl(config.m_fsckPath.c_str(), config.m_fsckPath.c_str(), pMode, "-j", "1", nvmPath.c_str(), ssdPath.c_str(), (char *)nullptr);
+        _exit(127);
+    }
+
+    if ((-1 == waitpid(pid, &status, 0)) || !WIFEXITED(status)) return -1;
+
+
+    return WEXITSTATUS(status);
+}
+
+/**
+ * @brief 遍历目录树，对每个目录项调用 lookup() 和 getattr()。
+ * @return 成功返回 0，失败返回负的 errno。
+ */
+static int walkTree(NvmixEngine &engine, unsigned long dirIno, unsigned depth)
+{
+    std::vector<NvmixDentry> entries;
+    int res = 0;
+
+
+    // 目录树的深度不可能超过 inode 的数量，超过说明有环。
+    if (depth > NVMIX_MAX_INODE_NUM) return -ELOOP;
+
+    res = engine.readdir(dirIno, &entries);
+    if (0 != res) return res;
+
+    for (const NvmixDentry &entry : entries)
+    {
+        std::string name(entry.m_name, strnlen(entry.m_name, NVMIX_MAX_NAME_LENGTH));
+        unsigned long ino = 0;
+        NvmixInode ni;
+
+
+        res = engine.lookup(dirIno, name, &ino);
+        if (0 == res) res = engine.getattr(ino, &ni);
+        if ((0 == res) && S_ISDIR(ni.m_mode)) res = walkTree(engine, ino, depth + 1);
+        if (0 != res) return res;
+    }
+
+
+    return 0;
+}
+
+/**
+ * @brief 检查一个崩溃状态。
+ * @param pReason 失败时用于返回原因。
+ * @return 一致返回 0，修复后一致返回 1，失败返回 -1。
+ */
+static int checkState(const CrashConfig &config, const NvmixCrashImage &image, const std::string &nvmPath, const std::string &ssdPath, std::string *pReason)
+{
+    NvmixEngine engine;
+    int before = 0;
+    int res = 0;
+
+
+    if ((0 != writeFile(nvmPath, image.m_nvm)) || (0 != writeFile(ssdPath, image.m_ssd)))
+    {
+        *pReason = "cannot write the images";
+        return -1;
+    }
+
+    before = runFsck(config, "-n", nvmPath, ssdPath);
+    if (before < 0)
+    {
+        *pReason = "cannot run " + config.m_fsckPath;
+        return -1;
+    }
+
+    if (NVMIX_FSCK_EXIT_OK != before)
+    {
+        runFsck(config, "-y", nvmPath, ssdPath);
+
+        res = runFsck(config, "-n", nvmPath, ssdPath);
+        if (NVMIX_FSCK_EXIT_OK != res)
+        {
+            *pReason = "still inconsistent after repair (fsck exit " + std::to_string(res) + ")";
+            return -1;
+        }
+    }
+
+    res = engine.mount(nvmPath, ssdPath);
+    if (0 == res) res = walkTree(engine, NVMIX_ROOT_DIR_INODE_NUMBER, 0);
+    engine.unmount();
+    if (0 != res)
+    {
+        *pReason = std::string("cannot mount and walk: ") + strerror(-res);
+        return -1;
+    }
+
+    if (config.m_isStrict && (NVMIX_FSCK_EXIT_OK != before))
+    {
+        *pReason = "inconsistent before repair (fsck exit " + std::to_string(before) + ")";
+        return -1;
+    }
+
+
+    return (NVMIX_FSCK_EXIT_OK == before) ? 0 : 1;
+}
+
+/**
+ * @brief 运行一个工作负载并检查它的所有崩溃状态。
+ * @return 成功返回 0，工作负载本身失败返回负的 errno。
+ */
+static int runWorkload(const CrashConfig &config, const std::string &dir, const CrashWorkload &workload, CrashSummary *pSummary)
+{
+    const std::string nvmPath = dir + "/" + workload.m_pName + ".nvm";
+    const std::string ssdPath = dir + "/" + workload.m_pName + ".ssd";
+    NvmixCrashRecorder recorder;
+    std::vector<NvmixCrashState> states;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> next(0);
+    std::mutex printLock;
+    int res = 0;
+
+
+    {
+        NvmixEngine engine;
+
+
+        res = NvmixEngine::format(nvmPath, ssdPath);
+        if (0 == res) res = engine.mount(nvmPath, ssdPath);
+        if (0 == res) res = workload.m_setup(engine);
+        if (0 == res) res = recorder.start(engine.nvmAddr(), ssdPath);
+        if (0 != res) goto OUT;
+
+        engine.setObserver(&recorder);
+        res = workload.m_run(engine);
+        engine.setObserver(nullptr);
+        recorder.stop(engine.nvmAddr());
+        if (0 != res) goto OUT;
+    }
+
+    states = recorder.enumerate(config.m_maxExhaustive, config.m_isTorn);
+
+    for (unsigned t = 0; t < config.m_threadNum; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            const std::string stateNvmPath = dir + "/state" + std::to_string(t) + ".nvm";
+            const std::string stateSsdPath = dir + "/state" + std::to_string(t) + ".ssd";
+            NvmixCrashImage image;
+            std::string reason;
+
+
+            for (size_t i = next++; i < states.size(); i = next++)
+            {
+                int result = 0;
+
+
+                recorder.materialize(states[i], &image);
+                result = checkState(config, image, stateNvmPath, stateSsdPath, &reason);
+
+                if (0 == result) ++pSummary->m_cleanNum;
+                if (1 == result) ++pSummary->m_repairedNum;
+                if (result < 0) ++pSummary->m_failedNum;
+
+                if ((result < 0) || config.m_isVerbose)
+                {
+                    std::lock_guard<std::mutex> lock(printLock);
+
+
+                    fprintf(stderr, "%s: state %zu (%s): %s\n", workload.m_pName, i, recorder.describe(states[i]).c_str(), result < 0 ? reason.c_str() : (0 == result ? "clean" : "repaired"));
+
+                    // 保存的是修复之前的镜像，可以直接交给 fsck.nvmixfs 复现。
+                    if ((result < 0) && !config.m_keepDir.empty())
+                    {
+                        std::string prefix = config.m_keepDir + "/" + workload.m_pName + "." + std::to_string(i);
+
+
+                        writeFile(prefix + ".nvm", image.m_nvm);
+                        writeFile(prefix + ".ssd", image.m_ssd);
+                    }
+                }
+            }
+
+            unlink(stateNvmPath.c_str());
+            unlink(stateSsdPath.c_str());
+        });
+    }
+
+    for (std::thread &thread : threads) thread.join();
+
+    printf("%-8s %4zu persistence points, %5zu crash states: %5u clean, %5u repaired, %5u failed\n", workload.m_pName, recorder.pointNum() - 1, states.size(),
+           pSummary->m_cleanNum.load(), pSummary->m_repairedNum.load(), pSummary->m_failedNum.load());
+
+
+OUT:
+    unlink(nvmPath.c_str());
+    unlink(ssdPath.c_str());
+
+    if (0 != res) fprintf(stderr, "nvmix-crash: workload %s failed: %s\n", workload.m_pName, strerror(-res));
+
+
+    return res;
+}
+
+/**
+ * @brief 默认的 fsck.nvmixfs 路径：与本程序在同一个目录下。
+ */
+static std::string defaultFsckPath()
+{
+    char path[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    std::string dir = ".";
+
+
+    if (n > 0)
+    {
+        path[n] = '\0';
+        dir = path;
+        dir = dir.substr(0, dir.rfind('/'));
+    }
+
+
+    return dir + "/fsck.nvmixfs";
+}
+
+
+int main(int argc, char *argv[])
+{
+    static const struct option options[] = {
+        {"fsck", required_argument, nullptr, 'f'},
+        {"keep", required_argument, nullptr, 'k'},
+        {"max-exhaustive", required_argument, nullptr, 'e'},
+        {"no-torn", no_argument, nullptr, 'T'},
+        {"strict", no_argument, nullptr, 's'},
+        {"threads", required_argument, nullptr, 'j'},
+        {"verbose", no_argument, nullptr, 'v'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+    const std::vector<CrashWorkload> allWorkloads = workloads();
+    std::vector<const CrashWorkload *> selected;
+    CrashConfig config;
+    char dir[] = "/tmp/nvmix-crash-XXXXXX";
+    unsigned failedNum = 0;
+    int opt = 0;
+
+
+    config.m_fsckPath = defaultFsckPath();
+
+    while (-1 != (opt = getopt_long(argc, argv, "f:k:e:sj:vh", options, nullptr)))
+    {
+        switch (opt)
+        {
+            case 'f':
+                config.m_fsckPath = optarg;
+                break;
+            case 'k':
+                config.m_keepDir = optarg;
+                break;
+            case 'e':
+                // 子集的数量是 2 的 n 次方，限制 n 以免枚举失控。
+                config.m_maxExhaustive = std::min(20UL, strtoul(optarg, nullptr, 0));
+                break;
+            case 'T':
+                config.m_isTorn = false;
+                break;
+            case 's':
+                config.m_isStrict = true;
+                break;
+            case 'j':
+                config.m_threadNum = std::max(1UL, strtoul(optarg, nullptr, 0));
+                break;
+            case 'v':
+                config.m_isVerbose = true;
+                break;
+            default:
+                usage();
+                return 'h' == opt ? 0 : 2;
+        }
+    }
+
+    for (int i = optind; i < argc; ++i)
+    {
+        auto it = std::find_if(allWorkloads.begin(), allWorkloads.end(), [&](const CrashWorkload &workload) { return 0 == strcmp(workload.m_pName, argv[i]); });
+
+
+        if (allWorkloads.end() == it)
+        {
+            fprintf(stderr, "nvmix-crash: unknown workload %s\n", argv[i]);
+            usage();
+            return 2;
+        }
+
+        selected.push_back(&*it);
+    }
+
+    if (selected.empty())
+    {
+        for (const CrashWorkload &workload : allWorkloads) selected.push_back(&workload);
+    }
+
+    if (0 != access(config.m_fsckPath.c_str(), X_OK))
+    {
+        fprintf(stderr, "nvmix-crash: cannot execute %s, use --fsck\n", config.m_fsckPath.c_str());
+        return 2;
+    }
+
+    if (!mkdtemp(dir))
+    {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    for (const CrashWorkload *pWorkload : selected)
+    {
+        CrashSummary summary;
+
+
+        if (0 != runWorkload(config, dir, *pWorkload, &summary)) ++failedNum;
+
+        failedNum += summary.m_failedNum;
+    }
+
+    rmdir(dir);
+
+
+    return 0 == failedNum ? 0 : 1;
+}
@@ -0,0 +1,533 @@
+/**
+ * @file main.cpp
+ * @author DavidingPlus (davidingplus@qq.com)
+ * @brief 查看和原地升级 nvmixfs 文件系统的用户层程序。
+ * @details 在文件系统未挂载时运行。-l 打印超级块记录的版本号、布局和特性，-U 将镜像原地升级到当前版本的磁盘格式，不需要重新格式化：主版本号相同时只更新版本号并补上布局对应的特性位；主版本号 1 的镜像需要把 inode 区和所有目录的数据块转换为新的布局。-O 在已有的镜像上启用或者关闭可以切换的特性。
+ *
+ * Copyright (c) 2025 电子科技大学 刘治学
+ *
+ */
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "config.h"
+
+#include "defs.h"
+
+
+/**
+ * @brief 升级主版本号 1 的镜像时，备份区在 NVM 空间上的偏移量。
+ * @details 备份区借用日志区的后半部分。升级前日志必须是空的，1.x 的日志结构只占日志区开头的不到 100 字节。
+ */
+#define NVMIX_TUNE_BACKUP_OFFSET (NVMIX_JOURNAL_BLOCK_OFFSET + 1024)
+
+/**
+ * @brief 备份区的魔数，即 "nvmixUPG"。
+ */
+#define NVMIX_TUNE_BACKUP_MAGIC 0x6E766D6978555047UL
+
+
+/**
+ * @struct NvmixInodeV1
+ * @brief 主版本号 1 的 inode，20 字节，字段与当前的 NvmixInode 的前 20 字节相同。
+ */
+struct NvmixInodeV1
+{
+    unsigned int m_mode;
+
+    unsigned int m_uid;
+
+    unsigned int m_gid;
+
+    unsigned int m_size;
+
+    unsigned short m_dataBlockIndex;
+
+    unsigned short m_nlink;
+};
+
+/**
+ * @struct NvmixDentryV1
+ * @brief 主版本号 1 的目录项，32 字节，inode 号是 8 字节。
+ */
+struct NvmixDentryV1
+{
+    char m_name[NVMIX_MAX_NAME_LENGTH];
+
+    unsigned long m_ino;
+
+    unsigned char m_fileType;
+};
+
+/**
+ * @struct TuneBackup
+ * @brief 升级主版本号 1 的镜像时保存在 NVM 上的备份和进度。
+ * @details 升级开始时先备份旧的 inode 区，再在超级块上设置 NVMIX_FEATURE_INCOMPAT_UPGRADE。之后每个目录转换前先备份它的旧数据块，转换完成后在 m_doneDirs 中标记。任何时刻崩溃，重新运行 -U 都能从备份继续，已经转换的数据不会被当作旧布局再转换一次。
+ */
+struct TuneBackup
+{
+    /**
+     * @brief NVMIX_TUNE_BACKUP_MAGIC，与超级块上的升级标记同时有效时才继续升级。
+     */
+    unsigned long m_magic;
+
+    /**
+     * @brief 已经转换完成的目录，每一位代表一个 inode 号。
+     */
+    unsigned long m_doneDirs;
+
+    /**
+     * @brief 正在转换的目录的 inode 号加 1，0 表示没有。它的旧数据块保存在 m_dirBlock 中。
+     */
+    unsigned long m_currentDir;
+
+    /**
+     * @brief 旧的 inode 区。
+     */
+    struct NvmixInodeV1 m_inodes[NVMIX_MAX_INODE_NUM];
+
+    /**
+     * @brief 正在转换的目录的旧目录项。
+     */
+    struct NvmixDentryV1 m_dirBlock[NVMIX_MAX_ENTRY_NUM];
+};
+
+
+/**
+ * @brief 将 NVM 映射上的一段区域持久化。
+ * @return 成功返回 0，失败返回 -1 并设置 errno。
+ * @details msync() 要求地址按页对齐，这里向下取整。
+ */
+static int persist(const void *pAddr, size_t size)
+{
+    uintptr_t start = (uintptr_t)pAddr & ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+
+
+    return msync((void *)start, (uintptr_t)pAddr + size - start, MS_SYNC);
+}
+
+/**
+ * @brief 将版本号合成一个可以比较大小的整数。
+ */
+static unsigned versionCode(unsigned major, unsigned minor, unsigned alter)
+{
+    return (major << 16) | (minor << 8) | alter;
+}
+
+/**
+ * @brief 返回超级块记录的布局对应的不兼容特性。
+ */
+static unsigned int layoutFeatures(const NvmixSuperBlock *pNsb)
+{
+    bool isDefaultGeometry = (NVMIX_BLOCK_SIZE_BITS == NVMIX_SB_BLOCK_SIZE_BITS(pNsb)) && (0 == pNsb->m_clusterBits);
+
+
+    return isDefaultGeometry ? 0 : NVMIX_FEATURE_INCOMPAT_CLUSTER;
+}
+
+/**
+ * @brief 计算目录数据块在 SSD 上的偏移量，即簇的第一个数据块。
+ * @param pNsb NvmixSuperBlock 结构指针。
+ * @param index 簇号，即 inode 的 m_dataBlockIndex。
+ */
+static off_t dirBlockOffset(const NvmixSuperBlock *pNsb, unsigned long index)
+{
+    return (off_t)NVMIX_DATA_BLOCK_NR(pNsb, index) << NVMIX_SB_BLOCK_SIZE_BITS(pNsb);
+}
+
+/**
+ * @brief 打印超级块记录的版本号、布局和特性。
+ */
+static void listSuperBlock(const NvmixSuperBlock *pNsb)
+{
+    unsigned int unknownRoCompat = pNsb->m_featureRoCompat & ~NVMIX_FEATURE_RO_COMPAT_SUPP;
+    unsigned int unknownIncompat = pNsb->m_featureIncompat & ~(NVMIX_FEATURE_INCOMPAT_SUPP | NVMIX_FEATURE_INCOMPAT_UPGRADE);
+    std::string features;
+
+
+    if (NVMIX_HAS_FEATURE(pNsb, RoCompat, NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE)) features += (NVMIX_STATE_CLEAN == pNsb->m_state) ? " mount_state(clean)" : " mount_state(dirty)";
+    if (NVMIX_HAS_FEATURE(pNsb, Incompat, NVMIX_FEATURE_INCOMPAT_CLUSTER)) features += " cluster";
+    if (NVMIX_HAS_FEATURE(pNsb, Incompat, NVMIX_FEATURE_INCOMPAT_UNWRITTEN)) features += " unwritten";
+    if (NVMIX_HAS_FEATURE(pNsb, Incompat, NVMIX_FEATURE_INCOMPAT_UPGRADE)) features += " upgrade-in-progress";
+
+    std::cout << "Version:        " << (int)pNsb->m_version.m_major << "." << (int)pNsb->m_version.m_minor << "." << (int)pNsb->m_version.m_alter << "\n"
+              << "Block size:     " << (1U << NVMIX_SB_BLOCK_SIZE_BITS(pNsb)) << "\n"
+              << "Cluster size:   " << (1UL << (NVMIX_SB_BLOCK_SIZE_BITS(pNsb) + pNsb->m_clusterBits)) << "\n"
+              << "Inodes:         " << __builtin_popcountl(pNsb->m_imap) << "/" << NVMIX_MAX_INODE_NUM << "\n"
+              << "Features:      " << (features.empty() ? " (none)" : features) << std::endl;
+
+    // 主版本号 1 的镜像没有特性位图，这些字节的内容没有意义。
+    if ((1 != pNsb->m_version.m_major) && ((0 != pNsb->m_featureCompat) || (0 != unknownRoCompat) || (0 != unknownIncompat)))
+    {
+        std::cout << std::hex << "Unknown:        compat 0x" << pNsb->m_featureCompat << ", ro_compat 0x" << unknownRoCompat << ", incompat 0x" << unknownIncompat << std::dec << std::endl;
+    }
+}
+
+/**
+ * @brief 启用或者关闭一个可以在已有镜像上切换的特性。
+ * @param pNsb NvmixSuperBlock 结构指针，镜像的主版本号必须与当前版本相同。
+ * @param name 特性的名字，以 ^ 开头表示关闭。
+ * @return 成功返回 0，不认识的特性返回 -1。
+ * @details 目前只有 mount_state：启用时根据位图统计空闲计数并标记为干净，下次挂载即可跳过扫描；关闭时清除干净标记，不支持该特性的旧版本内核模块可以再次读写挂载。
+ */
+static int setFeature(NvmixSuperBlock *pNsb, const std::string &name)
+{
+    bool isEnable = (name.empty() || ('^' != name[0]));
+
+
+    if ((isEnable ? name : name.substr(1)) != "mount_state") return -1;
+
+    if (isEnable)
+    {
+        pNsb->m_freeInodeNum = NVMIX_MAX_INODE_NUM - __builtin_popcountl(pNsb->m_imap);
+        pNsb->m_freeXattrBlockNum = NVMIX_MAX_XATTR_BLOCK_NUM - __builtin_popcountl(pNsb->m_xmap);
+        pNsb->m_state = NVMIX_STATE_CLEAN;
+        pNsb->m_featureRoCompat |= NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE;
+    }
+    else
+    {
+        pNsb->m_state = 0;
+        pNsb->m_featureRoCompat &= ~NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE;
+    }
+
+
+    return 0;
+}
+
+/**
+ * @brief 将主版本号 1 的镜像转换为当前的布局。
+ * @param pNvm NVM 映射的起始地址。
+ * @param ssdFd SSD 的文件描述符。
+ * @return 成功返回 0，失败返回 -1 并设置 errno。
+ * @details 需要转换的是 inode 区（20 字节扩展到一个缓存行）和所有目录的数据块（目录项从 32 字节缩小到 24 字节），inline 区、扩展属性区和位图的布局没有变化。1.x 的内核模块不把普通文件的数据写入 SSD，普通文件的 inline 槽位不是子簇位图，一并清零。
+ */
+static int upgradeV1(char *pNvm, int ssdFd)
+{
+    NvmixSuperBlock *pNsb = (NvmixSuperBlock *)(pNvm + NVMIX_SUPER_BLOCK_OFFSET);
+    TuneBackup *pBackup = (TuneBackup *)(pNvm + NVMIX_TUNE_BACKUP_OFFSET);
+    NvmixInode *pInodes = (NvmixInode *)(pNvm + NVMIX_INODE_BLOCK_OFFSET);
+    unsigned blockSize = 1U << NVMIX_SB_BLOCK_SIZE_BITS(pNsb);
+    std::vector<char> block(blockSize);
+
+
+    static_assert(sizeof(NvmixInodeV1) == 20, "NvmixInodeV1 layout changed");
+    static_assert(sizeof(NvmixDentryV1) == 32, "NvmixDentryV1 layout changed");
+    static_assert(sizeof(NvmixDentryV1) * NVMIX_MAX_ENTRY_NUM <= (1 << NVMIX_MIN_BLOCK_SIZE_BITS), "a 1.x directory must fit in the smallest data block");
+    static_assert(NVMIX_TUNE_BACKUP_OFFSET + sizeof(TuneBackup) <= NVMIX_JOURNAL_BLOCK_OFFSET + NVMIX_BLOCK_SIZE, "the backup must fit in the journal zone");
+
+    // 第一次运行：备份旧的 inode 区，然后标记升级开始。标记之前崩溃时镜像仍然是完整的 1.x 镜像。
+    if (!NVMIX_HAS_FEATURE(pNsb, Incompat, NVMIX_FEATURE_INCOMPAT_UPGRADE) || (NVMIX_TUNE_BACKUP_MAGIC != pBackup->m_magic))
+    {
+        memset(pBackup, 0, sizeof(TuneBackup));
+        memcpy(pBackup->m_inodes, pInodes, sizeof(pBackup->m_inodes));
+        pBackup->m_magic = NVMIX_TUNE_BACKUP_MAGIC;
+        if (-1 == persist(pBackup, sizeof(TuneBackup))) return -1;
+
+        pNsb->m_featureCompat = 0;
+        pNsb->m_featureRoCompat = 0;
+        pNsb->m_featureIncompat = NVMIX_FEATURE_INCOMPAT_UPGRADE;
+        pNsb->m_state = 0;
+        pNsb->m_freeInodeNum = 0;
+        pNsb->m_freeXattrBlockNum = 0;
+        if (-1 == persist(pNsb, sizeof(NvmixSuperBlock))) return -1;
+    }
+
+    // 逐个转换目录的数据块。旧数据块先备份，写入新数据块以后才标记完成。
+    for (unsigned long ino = 0; ino < NVMIX_MAX_INODE_NUM; ++ino)
+    {
+        const NvmixInodeV1 &oldInode = pBackup->m_inodes[ino];
+        off_t offset = dirBlockOffset(pNsb, oldInode.m_dataBlockIndex);
+        NvmixDentry *pDentries = (NvmixDentry *)block.data();
+
+
+        if (!(pNsb->m_imap & (1UL << ino)) || !S_ISDIR(oldInode.m_mode) || (pBackup->m_doneDirs & (1UL << ino))) continue;
+
+        if (ino + 1 != pBackup->m_currentDir)
+        {
+            if ((ssize_t)blockSize != pread(ssdFd, block.data(), blockSize, offset)) return -1;
+
+            memcpy(pBackup->m_dirBlock, block.data(), sizeof(pBackup->m_dirBlock));
+            if (-1 == persist(pBackup->m_dirBlock, sizeof(pBackup->m_dirBlock))) return -1;
+
+            pBackup->m_currentDir = ino + 1;
+            if (-1 == persist(&pBackup->m_currentDir, sizeof(pBackup->m_currentDir))) return -1;
+        }
+
+        // 目录只使用数据块开头的目录项，其余部分清零。
+        memset(block.data(), 0, blockSize);
+        for (unsigned slot = 0; slot < NVMIX_MAX_ENTRY_NUM; ++slot)
+        {
+            memcpy(pDentries[slot].m_name, pBackup->m_dirBlock[slot].m_name, NVMIX_MAX_NAME_LENGTH);
+            pDentries[slot].m_ino = (unsigned int)pBackup->m_dirBlock[slot].m_ino;
+            pDentries[slot].m_fileType = pBackup->m_dirBlock[slot].m_fileType;
+        }
+
+        if ((ssize_t)blockSize != pwrite(ssdFd, block.data(), blockSize, offset)) return -1;
+        if (-1 == fdatasync(ssdFd)) return -1;
+
+        // 先标记完成再清除 m_currentDir，反过来的话崩溃后会把新数据块当作旧布局再转换一次。
+        pBackup->m_doneDirs |= 1UL << ino;
+        if (-1 == persist(&pBackup->m_doneDirs, sizeof(pBackup->m_doneDirs))) return -1;
+
+        pBackup->m_currentDir = 0;
+        if (-1 == persist(&pBackup->m_currentDir, sizeof(pBackup->m_currentDir))) return -1;
+    }
+
+    // inode 区从备份重建，可以重复执行。
+    memset(pInodes, 0, NVMIX_MAX_INODE_NUM * sizeof(NvmixInode));
+    for (unsigned long ino = 0; ino < NVMIX_MAX_INODE_NUM; ++ino)
+    {
+        const NvmixInodeV1 &oldInode = pBackup->m_inodes[ino];
+
+
+        pInodes[ino].m_mode = oldInode.m_mode;
+        pInodes[ino].m_uid = oldInode.m_uid;
+        pInodes[ino].m_gid = oldInode.m_gid;
+        pInodes[ino].m_size = oldInode.m_size;
+        pInodes[ino].m_dataBlockIndex = oldInode.m_dataBlockIndex;
+        pInodes[ino].m_nlink = oldInode.m_nlink;
+
+        if ((pNsb->m_imap & (1UL << ino)) && S_ISREG(oldInode.m_mode)) memset(pNvm + NVMIX_INLINE_BLOCK_OFFSET + ino * NVMIX_INLINE_DATA_SIZE, 0, NVMIX_INLINE_DATA_SIZE);
+    }
+    if (-1 == persist(pInodes, NVMIX_MAX_INODE_NUM * sizeof(NvmixInode))) return -1;
+    if (-1 == persist(pNvm + NVMIX_INLINE_BLOCK_OFFSET, NVMIX_MAX_INODE_NUM * NVMIX_INLINE_DATA_SIZE)) return -1;
+
+    // 先写版本号再清除升级标记，中间崩溃时标记仍在，重新运行会再从备份重建一次。
+    pNsb->m_version.m_major = NVMIX_CONFIG_VERSION_MAJOR;
+    pNsb->m_version.m_minor = NVMIX_CONFIG_VERSION_MINOR;
+    pNsb->m_version.m_alter = NVMIX_CONFIG_VERSION_ALTER;
+    pNsb->m_blockSizeBits = NVMIX_SB_BLOCK_SIZE_BITS(pNsb);
+    if (-1 == persist(pNsb, sizeof(NvmixSuperBlock))) return -1;
+
+    pNsb->m_featureIncompat = layoutFeatures(pNsb);
+    if (-1 == persist(pNsb, sizeof(NvmixSuperBlock))) return -1;
+
+    // 日志区的后半部分恢复为全零。
+    memset(pBackup, 0, sizeof(TuneBackup));
+
+
+    return persist(pBackup, sizeof(TuneBackup));
+}
+
+/**
+ * @brief 将镜像原地升级到当前版本。
+ * @param pNvm NVM 映射的起始地址。
+ * @param ssdDevicePath SSD 的路径，只有主版本号 1 的镜像需要。
+ * @return 成功返回 0，失败返回 -1 并打印原因。
+ */
+static int upgrade(char *pNvm, const char *ssdDevicePath)
+{
+    NvmixSuperBlock *pNsb = (NvmixSuperBlock *)(pNvm + NVMIX_SUPER_BLOCK_OFFSET);
+    TuneBackup *pBackup = (TuneBackup *)(pNvm + NVMIX_TUNE_BACKUP_OFFSET);
+    // 中断的升级以备份为准继续，此时超级块上的版本号可能已经更新。
+    bool isResume = NVMIX_HAS_FEATURE(pNsb, Incompat, NVMIX_FEATURE_INCOMPAT_UPGRADE) && (NVMIX_TUNE_BACKUP_MAGIC == pBackup->m_magic);
+    int ssdFd = -1;
+
+
+    if (!isResume && (1 != pNsb->m_version.m_major) && (NVMIX_CONFIG_VERSION_MAJOR != pNsb->m_version.m_major))
+    {
+        std::cerr << "Error: Cannot upgrade file system version " << (int)pNsb->m_version.m_major << "." << (int)pNsb->m_version.m_minor << "." << (int)pNsb->m_version.m_alter << " to " << NVMIX_CONFIG_VERSION << "." << std::endl;
+
+
+        return -1;
+    }
+
+    if (isResume || (1 == pNsb->m_version.m_major))
+    {
+        // 1.x 的日志记录按旧的目录项布局保存，必须先由 1.x 的内核模块或者 fsck.nvmixfs 重放。
+        if (!isResume && (0 != ((NvmixJournal *)(pNvm + NVMIX_JOURNAL_BLOCK_OFFSET))->m_commit))
+        {
+            std::cerr << "Error: The journal is not empty, replay it with version 1.x of nvmixfs before upgrading." << std::endl;
+
+
+            return -1;
+        }
+
+        ssdFd = open(ssdDevicePath, O_RDWR);
+        if (-1 == ssdFd)
+        {
+            perror("open");
+
+
+            return -1;
+        }
+
+        if (-1 == upgradeV1(pNvm, ssdFd))
+        {
+            perror("upgrade");
+            std::cerr << "Error: The upgrade was interrupted, run tune.nvmixfs -U again to finish it." << std::endl;
+            close(ssdFd);
+
+
+            return -1;
+        }
+
+        close(ssdFd);
+    }
+    else
+    {
+        // 升级的最后一步是清除备份，在此之前崩溃会留下过期的备份。
+        if (NVMIX_TUNE_BACKUP_MAGIC == pBackup->m_magic)
+        {
+            memset(pBackup, 0, sizeof(TuneBackup));
+            persist(pBackup, sizeof(TuneBackup));
+        }
+
+        // 主版本号相同的镜像布局兼容，只补上布局对应的特性位，不降低更新的次版本号。
+        pNsb->m_featureIncompat |= layoutFeatures(pNsb);
+
+        if (versionCode(NVMIX_CONFIG_VERSION_MAJOR, NVMIX_CONFIG_VERSION_MINOR, NVMIX_CONFIG_VERSION_ALTER) > versionCode(pNsb->m_version.m_major, pNsb->m_version.m_minor, pNsb->m_version.m_alter))
+        {
+            pNsb->m_version.m_minor = NVMIX_CONFIG_VERSION_MINOR;
+            pNsb->m_version.m_alter = NVMIX_CONFIG_VERSION_ALTER;
+        }
+
+        if (-1 == persist(pNsb, sizeof(NvmixSuperBlock)))
+        {
+            perror("msync");
+
+
+            return -1;
+        }
+    }
+
+
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    bool isList = false;
+    bool isUpgrade = false;
+    std::vector<std::string> features;
+    int opt = 0;
+
+
+    while (-1 != (opt = getopt(argc, argv, "lUO:")))
+    {
+        if ('l' == opt)
+        {
+            isList = true;
+        }
+        else if ('U' == opt)
+        {
+            isUpgrade = true;
+        }
+        else if ('O' == opt)
+        {
+            features.push_back(optarg);
+        }
+        else
+        {
+            argc = 0;
+
+            break;
+        }
+    }
+
+    if ((2 != argc - optind) || (!isList && !isUpgrade && features.empty()))
+    {
+        std::cerr << "Error: Invalid arguments.\n"
+                  << "Usage: " << argv[0]
+                  << " [-l] [-U] [-O [^]feature] <nvm-device-path> <ssd-device-path>\n"
+                  << "  -l                    List the version, layout and features of the file system\n"
+                  << "  -U                    Upgrade the file system in place to version " << NVMIX_CONFIG_VERSION << "\n"
+                  << "  -O [^]feature         Enable or (with ^) disable a feature, currently only mount_state\n"
+                  << "  <nvm-device-path>     Path to persistent memory device (e.g. /dev/pmem0)\n"
+                  << "  <ssd-device-path>     Path to SSD block device (e.g. /dev/sdb2)\n";
+
+
+        return EXIT_FAILURE;
+    }
+
+
+    const char *nvmDevicePath = argv[optind];
+    const char *ssdDevicePath = argv[optind + 1];
+
+    bool isWrite = isUpgrade || !features.empty();
+
+    int nvmFd = open(nvmDevicePath, isWrite ? O_RDWR : O_RDONLY);
+    if (-1 == nvmFd)
+    {
+        perror("open");
+
+
+        return EXIT_FAILURE;
+    }
+
+    void *nvmVirtAddr = mmap(nullptr, NVMIX_NVM_LAYOUT_SIZE, isWrite ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, nvmFd, 0);
+    close(nvmFd);
+    if (MAP_FAILED == nvmVirtAddr)
+    {
+        perror("mmap");
+
+
+        return EXIT_FAILURE;
+    }
+
+    char *pNvm = (char *)nvmVirtAddr;
+    NvmixSuperBlock *pNsb = (NvmixSuperBlock *)(pNvm + NVMIX_SUPER_BLOCK_OFFSET);
+
+    if (NVMIX_MAGIC_NUMBER != pNsb->m_magic)
+    {
+        std::cerr << "Error: Wrong nvmix magic number, " << nvmDevicePath << " does not contain an nvmixfs file system." << std::endl;
+
+
+        return EXIT_FAILURE;
+    }
+
+    if (isUpgrade)
+    {
+        if (-1 == upgrade(pNvm, ssdDevicePath)) return EXIT_FAILURE;
+
+        std::cout << nvmDevicePath << ", " << ssdDevicePath << ": upgraded to version " << NVMIX_CONFIG_VERSION << "." << std::endl;
+    }
+
+    // 特性位的含义由主版本号决定，未完成升级的镜像不能修改。
+    if (!features.empty() && ((NVMIX_CONFIG_VERSION_MAJOR != pNsb->m_version.m_major) || NVMIX_HAS_FEATURE(pNsb, Incompat, NVMIX_FEATURE_INCOMPAT_UPGRADE)))
+    {
+        std::cerr << "Error: Run " << argv[0] << " -U before changing features." << std::endl;
+
+
+        return EXIT_FAILURE;
+    }
+
+    for (const std::string &feature : features)
+    {
+        if (-1 == setFeature(pNsb, feature))
+        {
+            std::cerr << "Error: Unknown feature " << feature << "." << std::endl;
+
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!features.empty() && (-1 == persist(pNsb, sizeof(NvmixSuperBlock))))
+    {
+        perror("msync");
+
+
+        return EXIT_FAILURE;
+    }
+
+    // 最后打印，显示的是升级和修改特性以后的状态。
+    if (isList) listSuperBlock(pNsb);
+
+    munmap(nvmVirtAddr, NVMIX_NVM_LAYOUT_SIZE);
+
+
+    return EXIT_SUCCESS;
+}
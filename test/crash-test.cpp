@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "engine.h"
+#include "crash.h"
+#include "defs.h"
+#include "dentry.h"
+
+
+/**
+ * @brief 每个测试格式化一对新的镜像，挂载以后开始记录。
+ */
+class CrashTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char dir[] = "/tmp/nvmix-crash-test-XXXXXX";
+
+        ASSERT_NE(mkdtemp(dir), nullptr);
+
+        m_dir = dir;
+        m_nvmPath = m_dir + "/nvm.img";
+        m_ssdPath = m_dir + "/ssd.img";
+
+        ASSERT_EQ(NvmixEngine::format(m_nvmPath, m_ssdPath), 0);
+        ASSERT_EQ(m_engine.mount(m_nvmPath, m_ssdPath), 0);
+        ASSERT_EQ(m_recorder.start(m_engine.nvmAddr(), m_ssdPath), 0);
+
+        m_engine.setObserver(&m_recorder);
+    }
+
+    void TearDown() override
+    {
+        m_engine.setObserver(nullptr);
+        m_engine.unmount();
+
+        unlink(m_nvmPath.c_str());
+        unlink(m_ssdPath.c_str());
+        rmdir(m_dir.c_str());
+    }
+
+    /**
+     * @brief 结束记录。
+     */
+    void stop()
+    {
+        m_engine.setObserver(nullptr);
+        m_recorder.stop(m_engine.nvmAddr());
+    }
+
+    std::string m_dir;
+    std::string m_nvmPath;
+    std::string m_ssdPath;
+    NvmixEngine m_engine;
+    NvmixCrashRecorder m_recorder;
+};
+
+
+TEST_F(CrashTest, FinalStateTest)
+{
+    std::vector<NvmixCrashState> states;
+    NvmixCrashImage image;
+    NvmixCrashState last;
+    std::string ssd(NVMIX_DATA_BLOCK_INDEX(NVMIX_MAX_INODE_NUM) * NVMIX_BLOCK_SIZE, '\0');
+    int fd = -1;
+
+    ASSERT_EQ(m_engine.mkdir(NVMIX_ROOT_DIR_INODE_NUMBER, "d", 0755), 0);
+    stop();
+
+    // mkdir 至少刷写位图、inode 和父目录，并写入两个目录数据块。
+    EXPECT_GE(m_recorder.pointNum(), 6u);
+
+    states = m_recorder.enumerate(8, true);
+    EXPECT_GT(states.size(), 1u);
+
+    // 所有操作之后、没有脏缓存行的状态就是引擎当前的内容。
+    last.m_point = m_recorder.pointNum() - 1;
+    m_recorder.materialize(last, &image);
+
+    EXPECT_EQ(0, memcmp(image.m_nvm.data(), m_engine.nvmAddr(), NVMIX_NVM_LAYOUT_SIZE));
+
+    fd = open(m_ssdPath.c_str(), O_RDONLY);
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(pread(fd, &ssd[0], ssd.size(), 0), (ssize_t)ssd.size());
+    close(fd);
+
+    EXPECT_EQ(image.m_ssd, ssd);
+}
+
+TEST_F(CrashTest, CreateOrderingTest)
+{
+    std::vector<NvmixCrashState> states;
+    NvmixCrashImage image;
+    unsigned long ino = 0;
+
+    ASSERT_EQ(m_engine.create(NVMIX_ROOT_DIR_INODE_NUMBER, "a", 0644, &ino), 0);
+    stop();
+
+    states = m_recorder.enumerate(8, true);
+
+    // 目录项是最后写入的：任何崩溃状态中只要目录项可见，它指向的 inode 就已经分配并且初始化。
+    for (const NvmixCrashState &state : states)
+    {
+        const NvmixDentry *pDentries = nullptr;
+        const NvmixSuperBlock *pNsb = nullptr;
+        const NvmixInode *pNi = nullptr;
+
+        m_recorder.materialize(state, &image);
+
+        pDentries = (const NvmixDentry *)(image.m_ssd.data() + NVMIX_DATA_BLOCK_INDEX(NVMIX_ROOT_DIR_INODE_NUMBER) * NVMIX_BLOCK_SIZE);
+        pNsb = (const NvmixSuperBlock *)(image.m_nvm.data() + NVMIX_SUPER_BLOCK_OFFSET);
+        pNi = (const NvmixInode *)(image.m_nvm.data() + NVMIX_INODE_BLOCK_OFFSET) + ino;
+
+        if (nvmixDentryFind(pDentries, "a", 1) < 0) continue;
+
+        EXPECT_TRUE(pNsb->m_imap & (1UL << ino)) << m_recorder.describe(state);
+        EXPECT_TRUE(S_ISREG(pNi->m_mode)) << m_recorder.describe(state);
+    }
+}
+
+TEST_F(CrashTest, TornWriteTest)
+{
+    ASSERT_EQ(m_engine.create(NVMIX_ROOT_DIR_INODE_NUMBER, "a", 0644), 0);
+    ASSERT_EQ(m_engine.create(NVMIX_ROOT_DIR_INODE_NUMBER, "b", 0644), 0);
+    stop();
+
+    // 撕裂只会增加状态，不会减少。
+    EXPECT_GE(m_recorder.enumerate(8, true).size(), m_recorder.enumerate(8, false).size());
+    EXPECT_LE(m_recorder.enumerate(0, false).size(), m_recorder.enumerate(8, false).size());
+}
@@ -1,11 +1,46 @@
 #include <gtest/gtest.h>
+#include <cstddef>
 
 #include "defs.h"
 
 
+// 磁盘格式的布局在编译期检查，改动结构时不需要运行测试就能发现问题。
+// 每个 inode 独占一个缓存行，inode 区按缓存行对齐。
+static_assert(sizeof(struct NvmixInode) == NVMIX_CACHE_LINE_SIZE, "an inode must fill exactly one cache line");
+static_assert(0 == NVMIX_INODE_BLOCK_OFFSET % NVMIX_CACHE_LINE_SIZE, "the inode zone must be cache line aligned");
+static_assert(sizeof(struct NvmixInode) * NVMIX_MAX_INODE_NUM <= NVMIX_BLOCK_SIZE, "the inode table must fit in the inode zone");
+
+// 常用字段在结构开头，偏移量是磁盘格式的一部分。
+static_assert(0 == offsetof(struct NvmixInode, m_mode), "NvmixInode layout changed");
+static_assert(12 == offsetof(struct NvmixInode, m_size), "NvmixInode layout changed");
+static_assert(16 == offsetof(struct NvmixInode, m_dataBlockIndex), "NvmixInode layout changed");
+static_assert(18 == offsetof(struct NvmixInode, m_nlink), "NvmixInode layout changed");
+static_assert(20 == offsetof(struct NvmixInode, m_unwritten), "NvmixInode layout changed");
+
+// 未写入区段用 16 位记录簇内的数据块编号。
+static_assert(NVMIX_CLUSTER_BITMAP_BITS <= 0xFFFF, "unwritten extents must address every block of a cluster");
+
+// 目录项没有隐式的填充字节，一个目录的所有目录项放得下最小的数据块。
+static_assert(sizeof(struct NvmixDentry) == 24, "NvmixDentry layout changed");
+static_assert(16 == offsetof(struct NvmixDentry, m_ino), "NvmixDentry layout changed");
+static_assert(20 == offsetof(struct NvmixDentry, m_fileType), "NvmixDentry layout changed");
+static_assert(sizeof(struct NvmixDentry) * NVMIX_MAX_ENTRY_NUM <= (1 << NVMIX_MIN_BLOCK_SIZE_BITS), "a directory must fit in the smallest data block");
+
+// 超级块只占第一个缓存行，位图的 8 字节写入是原子的。
+static_assert(sizeof(struct NvmixSuperBlock) <= NVMIX_CACHE_LINE_SIZE, "the super block must fit in one cache line");
+static_assert(0 == offsetof(struct NvmixSuperBlock, m_imap) % 8, "bitmaps must be 8-byte aligned");
+static_assert(40 == offsetof(struct NvmixSuperBlock, m_featureCompat), "NvmixSuperBlock layout changed");
+static_assert(48 == offsetof(struct NvmixSuperBlock, m_featureIncompat), "NvmixSuperBlock layout changed");
+static_assert(52 == offsetof(struct NvmixSuperBlock, m_state), "NvmixSuperBlock layout changed");
+
+// inline 区和扩展属性 inline 区的槽位按缓存行划分，不同 inode 的槽位不共用缓存行。
+static_assert(0 == NVMIX_INLINE_DATA_SIZE % NVMIX_CACHE_LINE_SIZE, "inline slots must not share cache lines");
+static_assert(0 == NVMIX_XATTR_INLINE_SIZE % NVMIX_CACHE_LINE_SIZE, "xattr inline slots must not share cache lines");
+
+
 TEST(DefsTest, SuperBlockTest)
 {
-    EXPECT_EQ(sizeof(struct NvmixSuperBlock), 24);
+    EXPECT_EQ(sizeof(struct NvmixSuperBlock), 64);
     EXPECT_TRUE(sizeof(struct NvmixSuperBlock) < 4096);
 
     EXPECT_EQ(NVMIX_SUPER_BLOCK_OFFSET, 0);
@@ -13,8 +48,13 @@ TEST(DefsTest, SuperBlockTest)
 
 TEST(DefsTest, InodeTest)
 {
-    EXPECT_EQ(sizeof(struct NvmixInode), 20);
-    EXPECT_EQ(sizeof(struct NvmixInode) * NVMIX_MAX_INODE_NUM, 640);
+    // inode 组等分所有 inode，且组数不超过 m_initGroups 的位数。
+    EXPECT_EQ(NVMIX_INODE_GROUP_SIZE * NVMIX_INODE_GROUP_NUM, NVMIX_MAX_INODE_NUM);
+    EXPECT_TRUE(NVMIX_INODE_GROUP_NUM <= 8 * sizeof(((struct NvmixSuperBlock *)0)->m_initGroups));
+
+    EXPECT_EQ(sizeof(struct NvmixInode), 64);
+    EXPECT_EQ(offsetof(struct NvmixInode, m_nlink), 18);
+    EXPECT_EQ(sizeof(struct NvmixInode) * NVMIX_MAX_INODE_NUM, 2048);
     EXPECT_TRUE(sizeof(struct NvmixInode) * NVMIX_MAX_INODE_NUM < 4096);
 
     EXPECT_EQ(NVMIX_INODE_BLOCK_OFFSET, 4096);
@@ -26,3 +66,93 @@ TEST(DefsTest, DataBlockTest)
     EXPECT_EQ(sizeof(struct NvmixDentry) * NVMIX_MAX_INODE_NUM, 768);
     EXPECT_TRUE(sizeof(struct NvmixDentry) * NVMIX_MAX_INODE_NUM < 4096);
 }
+
+TEST(DefsTest, GeometryTest)
+{
+    struct NvmixSuperBlock nsb = {};
+
+
+    // 旧镜像的数据块大小字段为 0，按默认值处理。
+    EXPECT_EQ(NVMIX_SB_BLOCK_SIZE_BITS(&nsb), NVMIX_BLOCK_SIZE_BITS);
+    EXPECT_EQ(1 << NVMIX_BLOCK_SIZE_BITS, NVMIX_BLOCK_SIZE);
+    EXPECT_EQ(NVMIX_DATA_BLOCK_NR(&nsb, 5), 5);
+
+    nsb.m_blockSizeBits = 10;
+    nsb.m_clusterBits = 6;
+    EXPECT_EQ(NVMIX_SB_BLOCK_SIZE_BITS(&nsb), 10);
+    EXPECT_EQ(NVMIX_DATA_BLOCK_NR(&nsb, 5), 320);
+
+    // 目录的数据块至少要放下所有目录项。
+    EXPECT_TRUE(sizeof(struct NvmixDentry) * NVMIX_MAX_ENTRY_NUM <= (1 << NVMIX_MIN_BLOCK_SIZE_BITS));
+
+    EXPECT_TRUE(NVMIX_IS_VALID_GEOMETRY(12, 0));
+    EXPECT_TRUE(NVMIX_IS_VALID_GEOMETRY(10, 0));
+    EXPECT_TRUE(NVMIX_IS_VALID_GEOMETRY(12, 8));
+    EXPECT_TRUE(NVMIX_IS_VALID_GEOMETRY(10, 10));
+    EXPECT_FALSE(NVMIX_IS_VALID_GEOMETRY(9, 0));
+    EXPECT_FALSE(NVMIX_IS_VALID_GEOMETRY(13, 0));
+    EXPECT_FALSE(NVMIX_IS_VALID_GEOMETRY(12, 9));
+}
+
+TEST(DefsTest, FeatureTest)
+{
+    struct NvmixSuperBlock nsb = {};
+
+
+    // 2.0 版本的镜像没有启用任何特性。
+    EXPECT_FALSE(NVMIX_HAS_FEATURE(&nsb, Incompat, NVMIX_FEATURE_INCOMPAT_CLUSTER));
+
+    nsb.m_featureIncompat = NVMIX_FEATURE_INCOMPAT_CLUSTER;
+    EXPECT_TRUE(NVMIX_HAS_FEATURE(&nsb, Incompat, NVMIX_FEATURE_INCOMPAT_CLUSTER));
+    EXPECT_FALSE(NVMIX_HAS_FEATURE(&nsb, Compat, NVMIX_FEATURE_INCOMPAT_CLUSTER));
+
+    // 挂载状态是只读兼容特性，不认识它的实现写入以后不会清除干净标记。
+    EXPECT_NE(NVMIX_FEATURE_RO_COMPAT_SUPP & NVMIX_FEATURE_RO_COMPAT_MOUNT_STATE, 0);
+
+    // 未写入区段改变了子簇位图的含义，不认识它的实现会读到簇中残留的数据。
+    EXPECT_NE(NVMIX_FEATURE_INCOMPAT_SUPP & NVMIX_FEATURE_INCOMPAT_UNWRITTEN, 0);
+
+    // 升级中的镜像不能被任何实现挂载。
+    EXPECT_EQ(NVMIX_FEATURE_INCOMPAT_SUPP & NVMIX_FEATURE_INCOMPAT_UPGRADE, 0);
+}
+
+TEST(DefsTest, JournalTest)
+{
+    EXPECT_EQ(sizeof(struct NvmixJournalEntry), 28);
+    EXPECT_EQ(sizeof(struct NvmixJournal), 72);
+    EXPECT_TRUE(sizeof(struct NvmixJournal) < 4096);
+
+    // 提交标志必须是 8 字节对齐的，才能保证单次写入是原子的。
+    EXPECT_EQ(offsetof(struct NvmixJournal, m_commit) % 8, 0);
+
+    EXPECT_EQ(NVMIX_JOURNAL_BLOCK_OFFSET, 8192);
+}
+
+TEST(DefsTest, InlineTest)
+{
+    // inline 区按 inode 号划分，正好占满一个块。
+    EXPECT_EQ(NVMIX_INLINE_DATA_SIZE * NVMIX_MAX_INODE_NUM, 4096);
+
+    EXPECT_EQ(NVMIX_INLINE_BLOCK_OFFSET, 12288);
+}
+
+TEST(DefsTest, XattrTest)
+{
+    // 头部必须是 8 字节，才能通过单次写入原子地切换存放位置。
+    EXPECT_EQ(sizeof(struct NvmixXattrHeader), 8);
+    EXPECT_EQ(sizeof(struct NvmixXattrEntry), 4);
+
+    // 条目按 4 字节对齐。
+    EXPECT_EQ(NVMIX_XATTR_ENTRY_SIZE(1, 1), 8);
+    EXPECT_EQ(NVMIX_XATTR_ENTRY_SIZE(4, 0), 8);
+    EXPECT_EQ(NVMIX_XATTR_ENTRY_SIZE(5, 0), 12);
+
+    // 扩展属性 inline 区按 inode 号划分，正好占满两个块。
+    EXPECT_EQ(NVMIX_XATTR_INLINE_SIZE * NVMIX_MAX_INODE_NUM, 8192);
+
+    EXPECT_EQ(NVMIX_XATTR_INLINE_BLOCK_OFFSET, 16384);
+    EXPECT_EQ(NVMIX_XATTR_POOL_BLOCK_OFFSET, 24576);
+
+    // 块池是最后一个区。
+    EXPECT_EQ(NVMIX_NVM_LAYOUT_SIZE, 155648);
+}
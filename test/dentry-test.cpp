@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <cstring>
+
+#include "dentry.h"
+#include "bitmap.h"
+#include "defs.h"
+
+
+TEST(DentryTest, NameMatchTest)
+{
+    struct NvmixDentry nd = {};
+
+    nvmixDentryFill(&nd, "abc", 3, 1, 8);
+
+    EXPECT_TRUE(nvmixDentryNameMatch(&nd, "abc", 3));
+    EXPECT_FALSE(nvmixDentryNameMatch(&nd, "ab", 2));
+    EXPECT_FALSE(nvmixDentryNameMatch(&nd, "abcd", 4));
+    EXPECT_FALSE(nvmixDentryNameMatch(&nd, "", 0));
+
+    // 名字占满 NVMIX_MAX_NAME_LENGTH 时没有结尾的 '\0'。
+    nvmixDentryFill(&nd, "0123456789abcdef", NVMIX_MAX_NAME_LENGTH, 1, 8);
+
+    EXPECT_TRUE(nvmixDentryNameMatch(&nd, "0123456789abcdef", NVMIX_MAX_NAME_LENGTH));
+    EXPECT_FALSE(nvmixDentryNameMatch(&nd, "0123456789abcdefg", NVMIX_MAX_NAME_LENGTH + 1));
+}
+
+TEST(DentryTest, FindTest)
+{
+    struct NvmixDentry dentries[NVMIX_MAX_ENTRY_NUM] = {};
+
+    EXPECT_TRUE(nvmixDentryIsEmpty(dentries));
+    EXPECT_EQ(nvmixDentryFindFree(dentries), 0);
+    EXPECT_EQ(nvmixDentryFind(dentries, "a", 1), -1);
+
+    nvmixDentryFill(dentries + 0, "a", 1, 3, 8);
+    nvmixDentryFill(dentries + 2, "b", 1, 4, 4);
+
+    EXPECT_FALSE(nvmixDentryIsEmpty(dentries));
+    EXPECT_EQ(nvmixDentryFindFree(dentries), 1);
+    EXPECT_EQ(nvmixDentryFind(dentries, "b", 1), 2);
+
+    nvmixDentryClear(dentries + 2);
+
+    EXPECT_EQ(nvmixDentryFind(dentries, "b", 1), -1);
+
+    for (int i = 0; i < NVMIX_MAX_ENTRY_NUM; ++i) dentries[i].m_ino = i + 1;
+
+    EXPECT_EQ(nvmixDentryFindFree(dentries), -1);
+}
+
+TEST(BitmapTest, FindZeroTest)
+{
+    unsigned long bitmap[2] = {0, 0};
+
+    EXPECT_EQ(nvmixBitmapFindZero(bitmap, 0, 32), 0);
+    EXPECT_EQ(nvmixBitmapFindZero(bitmap, 5, 32), 5);
+
+    bitmap[0] = 0xff;
+    EXPECT_EQ(nvmixBitmapFindZero(bitmap, 0, 8), 8);
+    EXPECT_EQ(nvmixBitmapFindZero(bitmap, 0, 32), 8);
+
+    // 跨越 unsigned long 的边界。
+    bitmap[0] = ~0UL;
+    EXPECT_EQ(nvmixBitmapFindZero(bitmap, 3, 128), 64);
+    EXPECT_EQ(nvmixBitmapFindZero(bitmap, 3, 64), 64);
+}
+
+TEST(BitmapTest, GroupProbeTest)
+{
+    EXPECT_EQ(nvmixAllocGroupProbe(0, 0), 0);
+    EXPECT_EQ(nvmixAllocGroupProbe(NVMIX_ALLOC_GROUP_NUM - 1, 1), 0);
+    EXPECT_EQ(nvmixAllocGroupProbe(5, 2), (5 + 2) % NVMIX_ALLOC_GROUP_NUM);
+}
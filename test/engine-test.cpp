@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "engine.h"
+#include "defs.h"
+
+
+/**
+ * @brief 每个测试在临时目录中格式化一对新的 NVM 和 SSD 文件。
+ */
+class EngineTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char dir[] = "/tmp/nvmix-engine-XXXXXX";
+
+        ASSERT_NE(mkdtemp(dir), nullptr);
+
+        m_dir = dir;
+        m_nvmPath = m_dir + "/nvm.img";
+        m_ssdPath = m_dir + "/ssd.img";
+
+        ASSERT_EQ(NvmixEngine::format(m_nvmPath, m_ssdPath), 0);
+        ASSERT_EQ(m_engine.mount(m_nvmPath, m_ssdPath), 0);
+    }
+
+    void TearDown() override
+    {
+        m_engine.unmount();
+
+        unlink(m_nvmPath.c_str());
+        unlink(m_ssdPath.c_str());
+        rmdir(m_dir.c_str());
+    }
+
+    std::string m_dir;
+    std::string m_nvmPath;
+    std::string m_ssdPath;
+    NvmixEngine m_engine;
+};
+
+
+TEST_F(EngineTest, CreateLookupTest)
+{
+    unsigned long ino = 0;
+    unsigned long found = 0;
+    NvmixInode ni = {};
+
+    ASSERT_EQ(m_engine.create(NVMIX_ROOT_DIR_INODE_NUMBER, "a.txt", 0644, &ino), 0);
+    EXPECT_NE(ino, NVMIX_ROOT_DIR_INODE_NUMBER);
+
+    ASSERT_EQ(m_engine.lookup(NVMIX_ROOT_DIR_INODE_NUMBER, "a.txt", &found), 0);
+    EXPECT_EQ(found, ino);
+
+    ASSERT_EQ(m_engine.getattr(ino, &ni), 0);
+    EXPECT_TRUE(S_ISREG(ni.m_mode));
+    EXPECT_EQ(ni.m_nlink, 1);
+    EXPECT_EQ(ni.m_dataBlockIndex, NVMIX_DATA_BLOCK_INDEX(ino));
+
+    EXPECT_EQ(m_engine.create(NVMIX_ROOT_DIR_INODE_NUMBER, "a.txt", 0644), -EEXIST);
+    EXPECT_EQ(m_engine.lookup(NVMIX_ROOT_DIR_INODE_NUMBER, "b.txt", &found), -ENOENT);
+    EXPECT_EQ(m_engine.create(NVMIX_ROOT_DIR_INODE_NUMBER, "0123456789abcdefg", 0644), -ENAMETOOLONG);
+}
+
+TEST_F(EngineTest, MkdirRmdirTest)
+{
+    unsigned long dirIno = 0;
+    NvmixInode ni = {};
+
+    ASSERT_EQ(m_engine.mkdir(NVMIX_ROOT_DIR_INODE_NUMBER, "d", 0755, &dirIno), 0);
+    ASSERT_EQ(m_engine.create(dirIno, "f", 0644), 0);
+
+    ASSERT_EQ(m_engine.getattr(NVMIX_ROOT_DIR_INODE_NUMBER, &ni), 0);
+    EXPECT_EQ(ni.m_nlink, 3);
+
+    EXPECT_EQ(m_engine.rmdir(NVMIX_ROOT_DIR_INODE_NUMBER, "d"), -ENOTEMPTY);
+    EXPECT_EQ(m_engine.unlink(NVMIX_ROOT_DIR_INODE_NUMBER, "d"), -EISDIR);
+
+    ASSERT_EQ(m_engine.unlink(dirIno, "f"), 0);
+    ASSERT_EQ(m_engine.rmdir(NVMIX_ROOT_DIR_INODE_NUMBER, "d"), 0);
+
+    ASSERT_EQ(m_engine.getattr(NVMIX_ROOT_DIR_INODE_NUMBER, &ni), 0);
+    EXPECT_EQ(ni.m_nlink, 2);
+    EXPECT_EQ(m_engine.getattr(dirIno, &ni), -ENOENT);
+    EXPECT_EQ(m_engine.freeInodeNum(), NVMIX_MAX_INODE_NUM - 1);
+}
+
+TEST_F(EngineTest, ReuseDirBlockTest)
+{
+    unsigned long first = 0;
+    unsigned long second = 0;
+    std::vector<NvmixDentry> entries;
+
+    // 删除目录以后复用同一个 inode 号，新目录不能看到旧目录的目录项。
+    ASSERT_EQ(m_engine.mkdir(NVMIX_ROOT_DIR_INODE_NUMBER, "d", 0755, &first), 0);
+    ASSERT_EQ(m_engine.create(first, "f", 0644), 0);
+    ASSERT_EQ(m_engine.unlink(first, "f"), 0);
+    ASSERT_EQ(m_engine.rmdir(NVMIX_ROOT_DIR_INODE_NUMBER, "d"), 0);
+
+    ASSERT_EQ(m_engine.mkdir(NVMIX_ROOT_DIR_INODE_NUMBER, "e", 0755, &second), 0);
+    ASSERT_EQ(m_engine.readdir(second, &entries), 0);
+    EXPECT_TRUE(entries.empty());
+}
+
+TEST_F(EngineTest, NoSpaceTest)
+{
+    // 根目录占用一个 inode，剩下的都可以分配出去。
+    for (int i = 1; i < NVMIX_MAX_INODE_NUM; ++i) ASSERT_EQ(m_engine.create(NVMIX_ROOT_DIR_INODE_NUMBER, "f" + std::to_string(i), 0644), 0);
+
+    EXPECT_EQ(m_engine.freeInodeNum(), 0);
+    EXPECT_EQ(m_engine.create(NVMIX_ROOT_DIR_INODE_NUMBER, "full", 0644), -ENOSPC);
+}
+
+TEST_F(EngineTest, ReadWriteTest)
+{
+    unsigned long ino = 0;
+    char buf[16] = {};
+
+    ASSERT_EQ(m_engine.create(NVMIX_ROOT_DIR_INODE_NUMBER, "a.txt", 0644, &ino), 0);
+
+    EXPECT_EQ(m_engine.write(ino, 0, "hello", 5), 5);
+    EXPECT_EQ(m_engine.read(ino, 0, buf, sizeof(buf)), 5);
+    EXPECT_STREQ(buf, "hello");
+
+    EXPECT_EQ(m_engine.write(ino, NVMIX_BLOCK_SIZE - 1, "ab", 2), -EFBIG);
+}
+
+TEST_F(EngineTest, PersistenceTest)
+{
+    unsigned long dirIno = 0;
+    unsigned long found = 0;
+    std::vector<NvmixDentry> entries;
+
+    ASSERT_EQ(m_engine.mkdir(NVMIX_ROOT_DIR_INODE_NUMBER, "d", 0755, &dirIno), 0);
+    ASSERT_EQ(m_engine.create(dirIno, "f", 0644), 0);
+
+    ASSERT_EQ(m_engine.unmount(), 0);
+    ASSERT_EQ(m_engine.mount(m_nvmPath, m_ssdPath), 0);
+
+    ASSERT_EQ(m_engine.lookup(NVMIX_ROOT_DIR_INODE_NUMBER, "d", &found), 0);
+    EXPECT_EQ(found, dirIno);
+
+    ASSERT_EQ(m_engine.readdir(dirIno, &entries), 0);
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_STREQ(entries[0].m_name, "f");
+}
+
+TEST_F(EngineTest, MountStateTest)
+{
+    const NvmixSuperBlock *pNsb = (const NvmixSuperBlock *)(m_engine.nvmAddr() + NVMIX_SUPER_BLOCK_OFFSET);
+
+    // 挂载期间不干净，卸载时保存空闲计数。
+    EXPECT_NE(pNsb->m_state, NVMIX_STATE_CLEAN);
+
+    ASSERT_EQ(m_engine.create(NVMIX_ROOT_DIR_INODE_NUMBER, "a", 0644), 0);
+    ASSERT_EQ(m_engine.mkdir(NVMIX_ROOT_DIR_INODE_NUMBER, "d", 0755), 0);
+    ASSERT_EQ(m_engine.freeInodeNum(), NVMIX_MAX_INODE_NUM - 3);
+
+    ASSERT_EQ(m_engine.unmount(), 0);
+    ASSERT_EQ(m_engine.mount(m_nvmPath, m_ssdPath), 0);
+    pNsb = (const NvmixSuperBlock *)(m_engine.nvmAddr() + NVMIX_SUPER_BLOCK_OFFSET);
+
+    EXPECT_EQ(pNsb->m_freeInodeNum, NVMIX_MAX_INODE_NUM - 3);
+    EXPECT_EQ(m_engine.freeInodeNum(), NVMIX_MAX_INODE_NUM - 3);
+    EXPECT_NE(pNsb->m_state, NVMIX_STATE_CLEAN);
+}
+
+TEST_F(EngineTest, ConcurrentCreateTest)
+{
+    const int threadNum = 3;
+    const int fileNum = 8;
+    std::vector<unsigned long> dirInos(threadNum);
+    std::vector<std::thread> threads;
+    std::vector<int> failures(threadNum, 0);
+
+    for (int i = 0; i < threadNum; ++i) ASSERT_EQ(m_engine.mkdir(NVMIX_ROOT_DIR_INODE_NUMBER, "d" + std::to_string(i), 0755, &dirInos[i]), 0);
+
+    for (int i = 0; i < threadNum; ++i)
+    {
+        threads.emplace_back([&, i]() {
+            for (int j = 0; j < fileNum; ++j)
+            {
+                if (0 != m_engine.create(dirInos[i], "f" + std::to_string(j), 0644)) ++failures[i];
+            }
+        });
+    }
+
+    for (auto &thread : threads) thread.join();
+
+    for (int i = 0; i < threadNum; ++i)
+    {
+        std::vector<NvmixDentry> entries;
+
+        EXPECT_EQ(failures[i], 0);
+        ASSERT_EQ(m_engine.readdir(dirInos[i], &entries), 0);
+        EXPECT_EQ(entries.size(), fileNum);
+    }
+
+    EXPECT_EQ(m_engine.freeInodeNum(), NVMIX_MAX_INODE_NUM - 1 - threadNum - threadNum * fileNum);
+}
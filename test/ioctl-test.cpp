@@ -0,0 +1,15 @@
+#include <gtest/gtest.h>
+
+#include "ioctl.h"
+
+
+// 参数结构是内核和用户层之间的接口，32 位和 64 位的用户层必须看到相同的布局。
+static_assert(sizeof(struct NvmixReadaheadStats) == 32, "NvmixReadaheadStats layout changed");
+
+
+TEST(IoctlTest, ReadaheadStatsTest)
+{
+    EXPECT_EQ(_IOC_READ, _IOC_DIR(NVMIX_IOC_GET_READAHEAD_STATS));
+    EXPECT_EQ(NVMIX_IOC_MAGIC, _IOC_TYPE(NVMIX_IOC_GET_READAHEAD_STATS));
+    EXPECT_EQ(sizeof(struct NvmixReadaheadStats), _IOC_SIZE(NVMIX_IOC_GET_READAHEAD_STATS));
+}
@@ -13,4 +13,4 @@ target("tests")
     set_default (false) -- 类似 CMake 中的 EXCLUDE_FROM_ALL。默认不构建，需要显式指定才会构建。
     set_targetdir ("$(builddir)/$(plat)/$(arch)/$(mode)/test/")
 
-    add_deps ("nvmix-cross-space")
+    add_deps ("nvmix-cross-space", "nvmix-engine")
@@ -1,5 +1,5 @@
 set_project ("nvmixfs")
-set_version ("1.1.1")
+set_version ("2.1.0")
 
 
 option ("linux-headers", {showmenu = true, description = "Set linux-headers path."})
@@ -12,6 +12,7 @@ add_configfiles ("src/config.h.in")
 add_includedirs ("$(builddir)/config/")
 add_includedirs ("src/")
 add_includedirs ("src/cross-space/")
+add_includedirs ("src/engine/")
 add_includedirs ("src/kernel/")
 add_includedirs ("src/kernel/fs/")
 add_includedirs ("src/kernel/nvm/")
@@ -37,9 +38,50 @@ target ("nvmix-cross-space")
 
     set_targetdir ("$(builddir)/$(plat)/$(arch)/$(mode)/bin/")
 
+target ("nvmix-engine")
+    set_kind ("static")
+    add_files ("src/engine/*.cpp")
+    add_deps ("nvmix-cross-space")
+    add_syslinks ("pthread")
+    set_languages ("c++11")
+
+    set_targetdir ("$(builddir)/$(plat)/$(arch)/$(mode)/bin/")
+
 target ("mkfs.nvmixfs")
     set_kind ("binary")
     add_files ("src/mkfs.nvmixfs/main.cpp")
+    add_syslinks ("pthread")
+
+    set_targetdir ("$(builddir)/$(plat)/$(arch)/$(mode)/bin/")
+
+target ("fsck.nvmixfs")
+    set_kind ("binary")
+    add_files ("src/fsck.nvmixfs/main.cpp")
+    add_syslinks ("pthread")
+
+    set_targetdir ("$(builddir)/$(plat)/$(arch)/$(mode)/bin/")
+
+target ("tune.nvmixfs")
+    set_kind ("binary")
+    add_files ("src/tune.nvmixfs/main.cpp")
+
+    set_targetdir ("$(builddir)/$(plat)/$(arch)/$(mode)/bin/")
+
+target ("nvmix-bench")
+    set_kind ("binary")
+    add_files ("src/nvmix-bench/*.cpp")
+    add_deps ("nvmix-engine")
+    add_syslinks ("pthread")
+    set_languages ("c++11")
+
+    set_targetdir ("$(builddir)/$(plat)/$(arch)/$(mode)/bin/")
+
+target ("nvmix-crash")
+    set_kind ("binary")
+    add_files ("src/nvmix-crash/main.cpp")
+    add_deps ("nvmix-engine", "fsck.nvmixfs")
+    add_syslinks ("pthread")
+    set_languages ("c++11")
 
     set_targetdir ("$(builddir)/$(plat)/$(arch)/$(mode)/bin/")
 